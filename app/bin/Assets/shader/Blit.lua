@@ -1,11 +1,15 @@
 local vs = [[
+VK_UNIFORM_BINDING(3) uniform PerMaterialVertex
+{
+	vec4 u_texture_scale_offset;
+};
 layout(location = 0) in vec4 i_vertex;
 layout(location = 2) in vec2 i_uv;
 VK_LAYOUT_LOCATION(0) out vec2 v_uv;
 void main()
 {
 	gl_Position = i_vertex;
-	v_uv = i_uv;
+	v_uv = i_uv * u_texture_scale_offset.xy + u_texture_scale_offset.zw;
 
 	vk_convert();
 }
@@ -54,6 +58,16 @@ local pass = {
     fs = fs,
     rs = rs,
 	uniforms = {
+		{
+            name = "PerMaterialVertex",
+            binding = 3,
+            members = {
+                {
+                    name = "u_texture_scale_offset",
+                    size = 16,
+                },
+            },
+        },
 	},
 	samplers = {
 		{
@@ -35,10 +35,10 @@ VK_LAYOUT_LOCATION(2) out vec3 v_normal;
 	layout(location = 7) in vec4 i_bone_indices;
 	mat4 skin_mat()
 	{
-		int index_0 = int(i_bone_indices.x);
-		int index_1 = int(i_bone_indices.y);
-		int index_2 = int(i_bone_indices.z);
-		int index_3 = int(i_bone_indices.w);
+		int index_0 = int(i_bone_indices.x * 255.0 + 0.5);
+		int index_1 = int(i_bone_indices.y * 255.0 + 0.5);
+		int index_2 = int(i_bone_indices.z * 255.0 + 0.5);
+		int index_3 = int(i_bone_indices.w * 255.0 + 0.5);
 		float weights_0 = i_bone_weights.x;
 		float weights_1 = i_bone_weights.y;
 		float weights_2 = i_bone_weights.z;
@@ -52,11 +52,12 @@ VK_LAYOUT_LOCATION(2) out vec3 v_normal;
 #endif
 
 #if (RECIEVE_SHADOW_ON == 1)
-	VK_LAYOUT_LOCATION(3) out vec4 v_pos_light_proj;
+	VK_LAYOUT_LOCATION(3) out vec4 v_pos_light_proj[6];
+	VK_LAYOUT_LOCATION(9) out float v_view_depth;
 	VK_UNIFORM_BINDING(5) uniform PerLightVertex
 	{
 		mat4 u_light_view_matrix;
-		mat4 u_light_projection_matrix;
+		mat4 u_light_projection_matrices[6];
 	};
 #endif
 
@@ -75,7 +76,12 @@ void main()
     v_normal = (vec4(i_normal, 0.0) * model_matrix).xyz;
 
 #if (RECIEVE_SHADOW_ON == 1)
-	v_pos_light_proj = i_vertex * model_matrix * u_light_view_matrix * u_light_projection_matrix;
+	vec4 pos_light_view = world_pos * u_light_view_matrix;
+	for (int i = 0; i < 6; ++i)
+	{
+		v_pos_light_proj[i] = pos_light_view * u_light_projection_matrices[i];
+	}
+	v_view_depth = -(world_pos * u_view_matrix).z;
 #endif
 
 	vk_convert();
@@ -107,6 +113,9 @@ VK_UNIFORM_BINDING(6) uniform PerLightFragment
 	vec4 u_light_atten;
 	vec4 u_spot_light_dir;
 	vec4 u_shadow_params;
+	vec4 u_shadow_cascade_splits;
+	vec4 u_shadow_texel_size;
+	vec4 u_shadow_rects[6];
 };
 VK_LAYOUT_LOCATION(0) in vec3 v_pos;
 VK_LAYOUT_LOCATION(1) in vec2 v_uv;
@@ -114,7 +123,8 @@ VK_LAYOUT_LOCATION(2) in vec3 v_normal;
 
 #if (RECIEVE_SHADOW_ON == 1)
 	VK_SAMPLER_BINDING(1) uniform highp sampler2D u_shadow_texture;
-	VK_LAYOUT_LOCATION(3) in vec4 v_pos_light_proj;
+	VK_LAYOUT_LOCATION(3) in vec4 v_pos_light_proj[6];
+	VK_LAYOUT_LOCATION(9) in float v_view_depth;
 	const vec2 Poisson25[25] = vec2[](
 		vec2(-0.978698, -0.0884121),
 		vec2(-0.841121, 0.521165),
@@ -142,9 +152,9 @@ VK_LAYOUT_LOCATION(2) in vec3 v_normal;
 		vec2(0.968871, 0.840449),
 		vec2(0.991882, -0.657338)
 	);
-	float texture_shadow(vec2 uv)
+	float texture_shadow(vec2 uv, vec4 tile)
 	{
-		if (uv.x < 0.0 || uv.x > 1.0 || uv.y < 0.0 || uv.y > 1.0)
+		if (uv.x < tile.x || uv.x > tile.z || uv.y < tile.y || uv.y > tile.w)
 		{
 			return 1.0;
 		}
@@ -153,13 +163,13 @@ VK_LAYOUT_LOCATION(2) in vec3 v_normal;
 			return texture(u_shadow_texture, uv).r;
 		}
 	}
-	float poisson_filter(float z, vec2 uv, float shadow_z_bias, vec2 filter_radius)
+	float poisson_filter(float z, vec2 uv, float shadow_z_bias, vec2 filter_radius, vec4 tile)
 	{
 		float shadow = 0.0;
 		for (int i = 0; i < 25; ++i)
 		{
 			vec2 offset = Poisson25[i] * filter_radius;
-			float shadow_depth = texture_shadow(uv + offset);
+			float shadow_depth = texture_shadow(uv + offset, tile);
 			if (z - shadow_z_bias > shadow_depth)
 			{
 				shadow += 1.0;
@@ -167,7 +177,7 @@ VK_LAYOUT_LOCATION(2) in vec3 v_normal;
 		}
 		return shadow / 25.0;
 	}
-	float pcf_filter(float z, vec2 uv, float shadow_z_bias, vec2 filter_radius)
+	float pcf_filter(float z, vec2 uv, float shadow_z_bias, vec2 filter_radius, vec4 tile)
 	{
 		float shadow = 0.0;
 		for (int i = -1; i <= 1; ++i)
@@ -175,7 +185,7 @@ VK_LAYOUT_LOCATION(2) in vec3 v_normal;
 			for (int j = -1; j <= 1; ++j)
 			{
 				vec2 offset = vec2(i, j) * filter_radius;
-				float shadow_depth = texture_shadow(uv + offset);
+				float shadow_depth = texture_shadow(uv + offset, tile);
 				if (z - shadow_z_bias > shadow_depth)
 				{
 					shadow += 1.0;
@@ -184,9 +194,9 @@ VK_LAYOUT_LOCATION(2) in vec3 v_normal;
 		}
 		return shadow / 9.0;
 	}
-	float linear_filter(float z, vec2 uv, float shadow_z_bias, vec2 filter_radius)
+	float linear_filter(float z, vec2 uv, float shadow_z_bias, vec2 filter_radius, vec4 tile)
 	{
-		float shadow_depth = texture_shadow(uv);
+		float shadow_depth = texture_shadow(uv, tile);
 		if (z - shadow_z_bias > shadow_depth)
 		{
 			return 1.0;
@@ -196,17 +206,73 @@ VK_LAYOUT_LOCATION(2) in vec3 v_normal;
 			return 0.0;
 		}
 	}
-	float sample_shadow(vec4 pos_light_proj, float nl)
+	int point_light_face()
 	{
+		// faces in +x, -x, +y, -y, +z, -z order
+		vec3 dir = v_pos - u_light_pos.xyz;
+		vec3 a = abs(dir);
+		if (a.x >= a.y && a.x >= a.z)
+		{
+			return dir.x > 0.0 ? 0 : 1;
+		}
+		else if (a.y >= a.z)
+		{
+			return dir.y > 0.0 ? 2 : 3;
+		}
+		else
+		{
+			return dir.z > 0.0 ? 4 : 5;
+		}
+	}
+	vec4 pos_light_proj_of(int view)
+	{
+		if (view == 0) return v_pos_light_proj[0];
+		else if (view == 1) return v_pos_light_proj[1];
+		else if (view == 2) return v_pos_light_proj[2];
+		else if (view == 3) return v_pos_light_proj[3];
+		else if (view == 4) return v_pos_light_proj[4];
+		else return v_pos_light_proj[5];
+	}
+	float sample_shadow(float nl)
+	{
+		// cascades and atlas tiles are rects of the shadow texture
+		int view;
+		if (int(u_light_color.a) == 2)
+		{
+			view = point_light_face();
+		}
+		else if (v_view_depth <= u_shadow_cascade_splits.x)
+		{
+			view = 0;
+		}
+		else if (v_view_depth <= u_shadow_cascade_splits.y)
+		{
+			view = 1;
+		}
+		else if (v_view_depth <= u_shadow_cascade_splits.z)
+		{
+			view = 2;
+		}
+		else if (v_view_depth <= u_shadow_cascade_splits.w)
+		{
+			view = 3;
+		}
+		else
+		{
+			return 0.0;
+		}
+		vec4 pos_light_proj = pos_light_proj_of(view);
+		vec4 tile = u_shadow_rects[view];
+
 		pos_light_proj = pos_light_proj / pos_light_proj.w;
 		vec2 uv = pos_light_proj.xy * 0.5 + 0.5;
 #if (VR_GLES == 0)
 		uv.y = 1.0 - uv.y;
 #endif
 		float z = pos_light_proj.z * 0.5 + 0.5;
-		vec2 filter_radius = vec2(u_shadow_params.w);
+		vec2 filter_radius = u_shadow_params.w * u_shadow_texel_size.xy;
 		float shadow_z_bias = u_shadow_params.y + u_shadow_params.z * tan(acos(nl));
-		return poisson_filter(z, uv, shadow_z_bias, filter_radius) * u_shadow_params.x;
+		return poisson_filter(z, uv, shadow_z_bias, filter_radius, tile) * u_shadow_params.x;
 	}
 #endif
 
@@ -238,7 +304,7 @@ void main()
 	vec3 diffuse = c.rgb * nl * u_light_color.rgb * atten;
 
 #if (RECIEVE_SHADOW_ON == 1)
-	float shadow = sample_shadow(v_pos_light_proj, nl);
+	float shadow = sample_shadow(nl);
     diffuse = diffuse * (1.0 - shadow);
 #endif
 
@@ -352,8 +418,8 @@ local pass = {
 					size = 64,
 				},
                 {
-                    name = "u_light_projection_matrix",
-                    size = 64,
+                    name = "u_light_projection_matrices",
+                    size = 64 * 6,
                 },
 			},
         },
@@ -384,6 +450,18 @@ local pass = {
 				{
                     name = "u_shadow_params",
                     size = 16,
+                },
+				{
+                    name = "u_shadow_cascade_splits",
+                    size = 16,
+                },
+				{
+                    name = "u_shadow_texel_size",
+                    size = 16,
+                },
+				{
+                    name = "u_shadow_rects",
+                    size = 16 * 6,
                 },
             },
         },
@@ -0,0 +1,70 @@
+local vs = [[
+layout(location = 0) in vec4 i_vertex;
+void main()
+{
+	gl_Position = i_vertex;
+
+	vk_convert();
+}
+]]
+
+local fs = [[
+precision highp float;
+VK_SAMPLER_BINDING(0) uniform highp sampler2D u_texture;
+void main()
+{
+	gl_FragDepth = texelFetch(u_texture, ivec2(gl_FragCoord.xy), 0).r;
+}
+]]
+
+--[[
+    Cull
+	    Back | Front | Off
+    ZTest
+	    Less | Greater | LEqual | GEqual | Equal | NotEqual | Always
+    ZWrite
+	    On | Off
+    SrcBlendMode
+	DstBlendMode
+	    One | Zero | SrcColor | SrcAlpha | DstColor | DstAlpha
+		| OneMinusSrcColor | OneMinusSrcAlpha | OneMinusDstColor | OneMinusDstAlpha
+	CWrite
+		On | Off
+	Queue
+		Background | Geometry | AlphaTest | Transparent | Overlay
+]]
+
+local rs = {
+    Cull = Off,
+    ZTest = Always,
+    ZWrite = On,
+    SrcBlendMode = One,
+    DstBlendMode = Zero,
+	CWrite = Off,
+    Queue = Geometry,
+}
+
+local pass = {
+    vs = vs,
+    fs = fs,
+    rs = rs,
+	uniforms = {
+	},
+	samplers = {
+		{
+			name = "PerMaterialFragment",
+			binding = 4,
+			samplers = {
+				{
+					name = "u_texture",
+					binding = 0,
+				},
+			},
+		},
+	},
+}
+
+-- return pass array
+return {
+    pass
+}
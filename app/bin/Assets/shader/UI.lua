@@ -15,14 +15,17 @@ VK_UNIFORM_BINDING(3) uniform PerMaterialVertex
 layout(location = 0) in vec4 i_vertex;
 layout(location = 1) in vec4 i_color;
 layout(location = 2) in vec2 i_uv;
+layout(location = 3) in vec2 i_uv2;
 VK_LAYOUT_LOCATION(0) out vec2 v_uv;
 VK_LAYOUT_LOCATION(1) out vec4 v_color;
+VK_LAYOUT_LOCATION(2) out vec2 v_sdf;
 void main()
 {
     mat4 model_matrix = u_model_matrix;
 	gl_Position = i_vertex * model_matrix * u_view_matrix * u_projection_matrix;
 	v_uv = i_uv * u_texture_scale_offset.xy + u_texture_scale_offset.zw;
 	v_color = i_color;
+	v_sdf = i_uv2;
 
 	vk_convert();
 }
@@ -37,10 +40,20 @@ VK_UNIFORM_BINDING(4) uniform PerMaterialFragment
 };
 VK_LAYOUT_LOCATION(0) in vec2 v_uv;
 VK_LAYOUT_LOCATION(1) in vec4 v_color;
+VK_LAYOUT_LOCATION(2) in vec2 v_sdf;
 layout(location = 0) out vec4 o_color;
 void main()
 {
-	o_color = texture(u_texture, v_uv) * v_color * u_color;
+	vec4 c = texture(u_texture, v_uv);
+	// distance field glyph, x is the edge dilation and y the edge softness
+	if (v_sdf.y > 0.0)
+	{
+		float d = c.a;
+		float edge = 0.5 - v_sdf.x;
+		float w = max(fwidth(d) * v_sdf.y, 0.0001);
+		c = vec4(1.0, 1.0, 1.0, smoothstep(edge - w, edge + w, d));
+	}
+	o_color = c * v_color * u_color;
 }
 ]]
 
@@ -34,10 +34,10 @@ VK_LAYOUT_LOCATION(3) out vec3 v_camera_pos;
 	layout(location = 7) in vec4 i_bone_indices;
 	mat4 skin_mat()
 	{
-		int index_0 = int(i_bone_indices.x);
-		int index_1 = int(i_bone_indices.y);
-		int index_2 = int(i_bone_indices.z);
-		int index_3 = int(i_bone_indices.w);
+		int index_0 = int(i_bone_indices.x * 255.0 + 0.5);
+		int index_1 = int(i_bone_indices.y * 255.0 + 0.5);
+		int index_2 = int(i_bone_indices.z * 255.0 + 0.5);
+		int index_3 = int(i_bone_indices.w * 255.0 + 0.5);
 		float weights_0 = i_bone_weights.x;
 		float weights_1 = i_bone_weights.y;
 		float weights_2 = i_bone_weights.z;
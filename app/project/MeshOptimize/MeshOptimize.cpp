@@ -0,0 +1,46 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "graphics/MeshOptimizer.h"
+
+using namespace Viry3D;
+
+int main(int argc, char* argv[])
+{
+    if (argc != 3 && argc != 4)
+    {
+        printf("Usage:\n");
+        printf("\tMeshOptimize.exe input.mesh output.mesh [lod_count]\n");
+        return 0;
+    }
+
+    String input = argv[1];
+    String output = argv[2];
+    int lod_count = 4;
+    if (argc == 4)
+    {
+        lod_count = atoi(argv[3]);
+    }
+
+    if (!MeshOptimizer::OptimizeFile(input, output, lod_count))
+    {
+        printf("optimize mesh failed: %s\n", input.CString());
+        return 1;
+    }
+
+    return 0;
+}
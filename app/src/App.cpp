@@ -40,6 +40,12 @@
 #include "physics/SpringCollider.h"
 #include "physics/SpringManager.h"
 #include "CameraSwitcher.h"
+#include "PhysicsBenchmark.h"
+#include "CrowdBenchmark.h"
+#include "NavigationBenchmark.h"
+#include "ImageDecodeBenchmark.h"
+#include "Mp3StreamBenchmark.h"
+#include "VoiceBenchmark.h"
 
 namespace Viry3D
 {
@@ -63,6 +69,31 @@ namespace Viry3D
             this->InitAudio();
             this->InitUI();
             
+            // cmake -DVIRY3D_APP_BENCHMARK=<name> adds one of the benchmarks below
+#if VR_APP_BENCHMARK_PHYSICS
+            this->InitPhysicsBenchmark();
+#endif
+            
+#if VR_APP_BENCHMARK_CROWD
+            this->InitCrowdBenchmark();
+#endif
+            
+#if VR_APP_BENCHMARK_NAVIGATION
+            this->InitNavigationBenchmark();
+#endif
+            
+#if VR_APP_BENCHMARK_IMAGEDECODE
+            this->InitImageDecodeBenchmark();
+#endif
+            
+#if VR_APP_BENCHMARK_MP3STREAM
+            this->InitMp3StreamBenchmark();
+#endif
+            
+#if VR_APP_BENCHMARK_VOICE
+            this->InitVoiceBenchmark();
+#endif
+            
 #if 0
             auto blit_camera = GameObject::Create("")->AddComponent<Camera>();
             blit_camera->SetClearFlags(CameraClearFlags::Nothing);
@@ -147,6 +178,43 @@ namespace Viry3D
 			bloom->SetDiffusion(3.93f);
         }
         
+        void InitPhysicsBenchmark()
+        {
+            auto benchmark = GameObject::Create("PhysicsBenchmark")->AddComponent<PhysicsBenchmark>();
+            benchmark->GetTransform()->SetPosition(Vector3(0, 0, -40));
+            benchmark->Init();
+        }
+        
+        void InitCrowdBenchmark()
+        {
+            auto benchmark = GameObject::Create("CrowdBenchmark")->AddComponent<CrowdBenchmark>();
+            benchmark->Init();
+        }
+        
+        void InitNavigationBenchmark()
+        {
+            auto benchmark = GameObject::Create("NavigationBenchmark")->AddComponent<NavigationBenchmark>();
+            benchmark->Init();
+        }
+        
+        void InitImageDecodeBenchmark()
+        {
+            auto benchmark = GameObject::Create("ImageDecodeBenchmark")->AddComponent<ImageDecodeBenchmark>();
+            benchmark->Init();
+        }
+        
+        void InitMp3StreamBenchmark()
+        {
+            auto benchmark = GameObject::Create("Mp3StreamBenchmark")->AddComponent<Mp3StreamBenchmark>();
+            benchmark->Init();
+        }
+        
+        void InitVoiceBenchmark()
+        {
+            auto benchmark = GameObject::Create("VoiceBenchmark")->AddComponent<VoiceBenchmark>();
+            benchmark->Init();
+        }
+        
         void InitBoneMapper(const Ref<GameObject>& model)
         {
             auto clip = Resources::LoadGameObject("Resources/res/model/CandyRockStar/Animations/Anim_NOT01.go");
@@ -0,0 +1,130 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+#include "Component.h"
+#include "Debug.h"
+#include "time/Time.h"
+#include "math/Mathf.h"
+#include "2d/Navigation2D.h"
+#include "2d/NavigationPolygon.h"
+#include "2d/Crowd2D.h"
+
+namespace Viry3D
+{
+	// walks ten thousand agents between random targets on a navmesh with pillars and logs the crowd step time
+	class CrowdBenchmark : public Component
+	{
+	public:
+        int count = 10000;
+        int pillars = 20;
+        float size = 2000.0f;
+        float radius = 2.0f;
+        float max_speed = 40.0f;
+        float log_interval = 2.0f;
+        std::shared_ptr<Navigation2D> navigation;
+        std::shared_ptr<Crowd2D> crowd;
+        Vector<int> agents;
+        float log_time = -1;
+        float step_time = 0;
+        int step_count = 0;
+        
+        void Init()
+        {
+            auto navpoly = std::make_shared<NavigationPolygon>();
+            navpoly->AddOutline({ Vector2(0, 0), Vector2(size, 0), Vector2(size, size), Vector2(0, size) });
+            
+            // square pillars on a regular grid, agents spawn in the lanes between them
+            float cell = size / pillars;
+            float half = cell * 0.2f;
+            for (int y = 0; y < pillars; ++y)
+            {
+                for (int x = 0; x < pillars; ++x)
+                {
+                    Vector2 c((x + 0.5f) * cell, (y + 0.5f) * cell);
+                    navpoly->AddOutline({ c + Vector2(-half, -half), c + Vector2(-half, half), c + Vector2(half, half), c + Vector2(half, -half) });
+                }
+            }
+            
+            float bake_start = Time::GetRealTimeSinceStartup();
+            navpoly->MakePolygonsFromOutlines();
+            float bake_time = Time::GetRealTimeSinceStartup() - bake_start;
+            
+            navigation = std::make_shared<Navigation2D>();
+            navigation->NavpolyAdd(navpoly, Transform2D());
+            crowd = std::make_shared<Crowd2D>(navigation);
+            
+            for (int i = 0; i < count; ++i)
+            {
+                int id = crowd->AddAgent(this->RandomLanePoint(), radius, max_speed);
+                crowd->SetAgentTarget(id, this->RandomLanePoint());
+                agents.Add(id);
+            }
+            
+            Log("CrowdBenchmark navmesh polygons:%d bake:%.2fms agents:%d", navpoly->GetPolygonCount(), bake_time * 1000, count);
+        }
+        
+        Vector2 RandomLanePoint() const
+        {
+            float cell = size / pillars;
+            float lane = Mathf::RandomRange(0.0f, size);
+            float across = (Mathf::RandomRange(0, pillars + 1) + Mathf::RandomRange(-0.25f, 0.25f)) * cell;
+            across = Mathf::Clamp(across, radius, size - radius);
+            
+            if (Mathf::RandomRange(0, 2) == 0)
+            {
+                return Vector2(lane, across);
+            }
+            return Vector2(across, lane);
+        }
+        
+        virtual void Update()
+        {
+            if (!crowd)
+            {
+                return;
+            }
+            
+            // arrived agents pick a new target, the path is requested on the next step
+            int arrived = 0;
+            for (auto id : agents)
+            {
+                if (crowd->IsAgentArrived(id))
+                {
+                    crowd->SetAgentTarget(id, this->RandomLanePoint());
+                    arrived += 1;
+                }
+            }
+            
+            float start = Time::GetRealTimeSinceStartup();
+            crowd->Update(Mathf::Min(Time::GetDeltaTime(), 0.05f));
+            step_time += Time::GetRealTimeSinceStartup() - start;
+            step_count += 1;
+            
+            if (log_time >= 0 && Time::GetTime() - log_time < log_interval)
+            {
+                return;
+            }
+            log_time = Time::GetTime();
+            
+            Log("CrowdBenchmark agents:%d retargeted:%d step:%.2fms fps:%d", crowd->GetAgentCount(), arrived, step_time * 1000 / step_count, Time::GetFPS());
+            step_time = 0;
+            step_count = 0;
+        }
+	};
+}
@@ -0,0 +1,110 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+#include "Component.h"
+#include "Engine.h"
+#include "Debug.h"
+#include "time/Time.h"
+#include "io/File.h"
+#include "io/Directory.h"
+#include "graphics/Image.h"
+#include "graphics/ImageDecoder.h"
+
+namespace Viry3D
+{
+	// decodes every png and jpg under the texture folder with the single threaded loaders,
+	// then with the decode service one by one and in one batch, and logs the times
+	class ImageDecodeBenchmark : public Component
+	{
+	public:
+        String folder = "texture";
+        int rounds = 4;
+        
+        void Init()
+        {
+            Vector<String> paths;
+            Vector<ByteBuffer> files;
+            int file_bytes = 0;
+            
+            // files are read up front, only decoding is measured
+            auto all = Directory::GetFiles(Engine::Instance()->GetDataPath() + "/" + folder, true);
+            for (const auto& path : all)
+            {
+                String lower = path.ToLower();
+                if (lower.EndsWith(".png") || lower.EndsWith(".jpg") || lower.EndsWith(".jpeg"))
+                {
+                    paths.Add(path);
+                    files.Add(File::ReadAllBytes(path));
+                    file_bytes += files[files.Size() - 1].Size();
+                }
+            }
+            
+            if (paths.Size() == 0)
+            {
+                Log("ImageDecodeBenchmark no images in %s", folder.CString());
+                return;
+            }
+            
+            int pixel_bytes = 0;
+            float start = Time::GetRealTimeSinceStartup();
+            for (int r = 0; r < rounds; ++r)
+            {
+                for (int i = 0; i < paths.Size(); ++i)
+                {
+                    Ref<Image> image = paths[i].ToLower().EndsWith(".png") ? Image::LoadPNG(files[i]) : Image::LoadJPEG(files[i]);
+                    if (image && r == 0)
+                    {
+                        pixel_bytes += image->data.Size();
+                    }
+                }
+            }
+            float loader_time = Time::GetRealTimeSinceStartup() - start;
+            
+            start = Time::GetRealTimeSinceStartup();
+            for (int r = 0; r < rounds; ++r)
+            {
+                for (int i = 0; i < paths.Size(); ++i)
+                {
+                    ImageDecodeRequest request;
+                    request.path = paths[i];
+                    request.file = files[i];
+                    ImageDecoder::Decode(request);
+                }
+            }
+            float decode_time = Time::GetRealTimeSinceStartup() - start;
+            
+            start = Time::GetRealTimeSinceStartup();
+            for (int r = 0; r < rounds; ++r)
+            {
+                Vector<ImageDecodeRequest> requests(paths.Size());
+                for (int i = 0; i < paths.Size(); ++i)
+                {
+                    requests[i].path = paths[i];
+                    requests[i].file = files[i];
+                }
+                ImageDecoder::DecodeAll(requests);
+            }
+            float batch_time = Time::GetRealTimeSinceStartup() - start;
+            
+            Log("ImageDecodeBenchmark images:%d file:%dKB decoded:%dKB loader:%.2fms decoder:%.2fms batched:%.2fms",
+                paths.Size(), file_bytes / 1024, pixel_bytes / 1024,
+                loader_time * 1000 / rounds, decode_time * 1000 / rounds, batch_time * 1000 / rounds);
+        }
+	};
+}
@@ -0,0 +1,103 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+#include "GameObject.h"
+#include "Engine.h"
+#include "Debug.h"
+#include "time/Time.h"
+#include "math/Mathf.h"
+#include "audio/AudioClip.h"
+#include "audio/AudioSource.h"
+
+namespace Viry3D
+{
+	// decodes an mp3 stream chunk by chunk without playing it for several chunk durations,
+	// logs decode speed against realtime and the cost of starting a muted stream source
+	class Mp3StreamBenchmark : public Component
+	{
+	public:
+        String path = "Resources/res/model/CandyRockStar/Unite In The Sky (full).mp3";
+        float durations[3] = { 0.05f, 0.1f, 0.25f };
+        float seconds = 30.0f;
+        
+        void Init()
+        {
+#if !VR_WASM
+            auto clip = AudioClip::LoadMp3FromFile(Engine::Instance()->GetDataPath() + "/" + path, AudioClipMode::Stream);
+            if (!clip)
+            {
+                Log("Mp3StreamBenchmark can not load %s", path.CString());
+                return;
+            }
+            clip->SetStreamLoop(false);
+            
+            auto source = this->GetGameObject()->AddComponent<AudioSource>();
+            source->SetClip(clip);
+            source->SetLoop(false);
+            source->SetVolume(0);
+            
+            for (int i = 0; i < 3; ++i)
+            {
+                float duration = durations[i];
+                clip->SetStreamChunkDuration(duration);
+                
+                if (!clip->RewindStream())
+                {
+                    return;
+                }
+                
+                // a null buffer decodes only, so no al upload is measured
+                int chunks = 0;
+                float total = 0;
+                float max = 0;
+                while (chunks * duration < seconds)
+                {
+                    float start = Time::GetRealTimeSinceStartup();
+                    bool decoded = clip->DecodeStreamChunk(nullptr);
+                    float time = Time::GetRealTimeSinceStartup() - start;
+                    if (!decoded)
+                    {
+                        break;
+                    }
+                    
+                    total += time;
+                    max = Mathf::Max(max, time);
+                    chunks += 1;
+                }
+                
+                if (chunks == 0)
+                {
+                    continue;
+                }
+                
+                // play decodes the first buffers on the calling thread
+                float start = Time::GetRealTimeSinceStartup();
+                source->Play();
+                float play_time = Time::GetRealTimeSinceStartup() - start;
+                source->Stop();
+                
+                Log("Mp3StreamBenchmark chunk:%.0fms chunks:%d realtime:%.1fx avg:%.3fms max:%.3fms play:%.3fms buffered:%.0fms",
+                    duration * 1000, chunks, chunks * duration / total,
+                    total * 1000 / chunks, max * 1000, play_time * 1000,
+                    STREAM_BUFFER_COUNT * duration * 1000);
+            }
+#endif
+        }
+	};
+}
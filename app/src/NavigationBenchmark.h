@@ -0,0 +1,118 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+#include "Component.h"
+#include "Debug.h"
+#include "time/Time.h"
+#include "math/Mathf.h"
+#include "2d/Navigation2D.h"
+#include "2d/NavigationPolygon.h"
+
+namespace Viry3D
+{
+	// bakes generated maps of growing size and logs the cost of short and cross map path queries,
+	// short queries should cost about the same on every map
+	class NavigationBenchmark : public Component
+	{
+	public:
+        int sizes[3] = { 32, 64, 128 };
+        float cell = 40.0f;
+        int queries = 1000;
+        float short_distance = 200.0f;
+        
+        void Init()
+        {
+            for (int size : sizes)
+            {
+                this->Run(size);
+            }
+        }
+        
+        void Run(int size)
+        {
+            float world = size * cell;
+            auto navpoly = std::make_shared<NavigationPolygon>();
+            navpoly->AddOutline({ Vector2(0, 0), Vector2(world, 0), Vector2(world, world), Vector2(0, world) });
+            
+            // a skewed obstacle in every third cell
+            for (int y = 0; y < size; ++y)
+            {
+                for (int x = 0; x < size; ++x)
+                {
+                    if ((x + y) % 3 != 0)
+                    {
+                        continue;
+                    }
+                    Vector2 c(x * cell + cell * 0.5f + (y % 2) * 7, y * cell + cell * 0.5f);
+                    navpoly->AddOutline({ c + Vector2(-6, -5), c + Vector2(6, -6), c + Vector2(7, 6), c + Vector2(-5, 5) });
+                }
+            }
+            
+            float start = Time::GetRealTimeSinceStartup();
+            navpoly->MakePolygonsFromOutlines();
+            float bake_time = Time::GetRealTimeSinceStartup() - start;
+            
+            auto navigation = std::make_shared<Navigation2D>();
+            start = Time::GetRealTimeSinceStartup();
+            navigation->NavpolyAdd(navpoly, Transform2D());
+            navigation->GetClosestPoint(Vector2(0, 0));
+            float link_time = Time::GetRealTimeSinceStartup() - start;
+            
+            std::vector<NavigationPathRequest> short_requests;
+            std::vector<NavigationPathRequest> long_requests;
+            for (int i = 0; i < queries; ++i)
+            {
+                Vector2 from(Mathf::RandomRange(0.0f, world), Mathf::RandomRange(0.0f, world));
+                Vector2 offset(Mathf::RandomRange(-short_distance, short_distance), Mathf::RandomRange(-short_distance, short_distance));
+                Vector2 to(Mathf::Clamp(from.x + offset.x, 0.0f, world), Mathf::Clamp(from.y + offset.y, 0.0f, world));
+                short_requests.push_back(NavigationPathRequest(from, to));
+                long_requests.push_back(NavigationPathRequest(Vector2(Mathf::RandomRange(0.0f, cell), from.y), Vector2(world - Mathf::RandomRange(0.0f, cell), world - from.y)));
+            }
+            
+            start = Time::GetRealTimeSinceStartup();
+            for (auto& request : short_requests)
+            {
+                request.path = navigation->GetSimplePath(request.start, request.end, request.optimize);
+            }
+            float short_time = Time::GetRealTimeSinceStartup() - start;
+            
+            start = Time::GetRealTimeSinceStartup();
+            for (auto& request : long_requests)
+            {
+                request.path = navigation->GetSimplePath(request.start, request.end, request.optimize);
+            }
+            float long_time = Time::GetRealTimeSinceStartup() - start;
+            
+            start = Time::GetRealTimeSinceStartup();
+            navigation->GetSimplePaths(long_requests);
+            float batch_time = Time::GetRealTimeSinceStartup() - start;
+            
+            start = Time::GetRealTimeSinceStartup();
+            for (auto& request : short_requests)
+            {
+                navigation->GetClosestPoint(request.end + Vector2(0.5f, 0.5f));
+            }
+            float closest_time = Time::GetRealTimeSinceStartup() - start;
+            
+            Log("NavigationBenchmark map:%dx%d polygons:%d bake:%.2fms link:%.2fms short:%.3fms long:%.3fms long batched:%.3fms closest:%.4fms",
+                size, size, navpoly->GetPolygonCount(), bake_time * 1000, link_time * 1000,
+                short_time * 1000 / queries, long_time * 1000 / queries, batch_time * 1000 / queries, closest_time * 1000 / queries);
+        }
+	};
+}
@@ -0,0 +1,129 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+#include "Component.h"
+#include "GameObject.h"
+#include "Debug.h"
+#include "time/Time.h"
+#include "math/Mathf.h"
+#include "graphics/MeshRenderer.h"
+#include "graphics/Material.h"
+#include "graphics/Shader.h"
+#include "physics/Physics.h"
+#include "physics/Rigidbody.h"
+#include "physics/Collider.h"
+
+namespace Viry3D
+{
+	// drops a few thousand boxes on a ground plane and logs how many are still awake
+	class PhysicsBenchmark : public Component
+	{
+	public:
+        int count = 4000;
+        int columns = 20;
+        float spacing = 1.5f;
+        float log_interval = 2.0f;
+        Vector<Rigidbody*> bodies;
+        float log_time = -1;
+        
+        void Init()
+        {
+            auto mesh = CreateCubeMesh();
+            auto material = RefMake<Material>(Shader::Find("Diffuse"));
+            
+            auto ground = GameObject::Create("Ground");
+            ground->GetTransform()->SetParent(this->GetTransform());
+            ground->GetTransform()->SetLocalPosition(Vector3(0, -0.5f, 0));
+            ground->GetTransform()->SetLocalScale(Vector3(columns * spacing * 2, 1, columns * spacing * 2));
+            auto ground_renderer = ground->AddComponent<MeshRenderer>();
+            ground_renderer->SetMesh(mesh);
+            ground_renderer->SetMaterial(material);
+            ground->AddComponent<BoxCollider>();
+            
+            float offset = (columns - 1) * spacing * 0.5f;
+            for (int i = 0; i < count; ++i)
+            {
+                int layer = i / (columns * columns);
+                int x = i % columns;
+                int z = (i / columns) % columns;
+                
+                auto box = GameObject::Create("Box");
+                box->GetTransform()->SetParent(this->GetTransform());
+                box->GetTransform()->SetLocalPosition(Vector3(x * spacing - offset, 2 + layer * spacing, z * spacing - offset));
+                box->GetTransform()->SetLocalRotation(Quaternion::Euler(Mathf::RandomRange(0.0f, 360.0f), Mathf::RandomRange(0.0f, 360.0f), 0));
+                auto renderer = box->AddComponent<MeshRenderer>();
+                renderer->SetMesh(mesh);
+                renderer->SetMaterial(material);
+                box->AddComponent<BoxCollider>();
+                bodies.Add(box->AddComponent<Rigidbody>().get());
+            }
+        }
+        
+        virtual void Update()
+        {
+            if (log_time >= 0 && Time::GetTime() - log_time < log_interval)
+            {
+                return;
+            }
+            log_time = Time::GetTime();
+            
+            int awake = 0;
+            for (auto body : bodies)
+            {
+                if (!body->IsSleeping())
+                {
+                    awake += 1;
+                }
+            }
+            Log("PhysicsBenchmark bodies:%d awake:%d fps:%d", bodies.Size(), awake, Time::GetFPS());
+        }
+        
+        static Ref<Mesh> CreateCubeMesh()
+        {
+            Vector<Mesh::Vertex> vertices;
+            Vector<unsigned int> indices;
+            
+            const Vector3 normals[] = {
+                Vector3(1, 0, 0), Vector3(-1, 0, 0),
+                Vector3(0, 1, 0), Vector3(0, -1, 0),
+                Vector3(0, 0, 1), Vector3(0, 0, -1),
+            };
+            for (int i = 0; i < 6; ++i)
+            {
+                const Vector3& n = normals[i];
+                Vector3 u = (i < 2) ? Vector3(0, 0, n.x) : (i < 4 ? Vector3(1, 0, 0) : Vector3(-n.z, 0, 0));
+                Vector3 v = (i < 2 || i >= 4) ? Vector3(0, 1, 0) : Vector3(0, 0, n.y);
+                
+                int first = vertices.Size();
+                const Vector2 uvs[] = { Vector2(0, 0), Vector2(1, 0), Vector2(1, 1), Vector2(0, 1) };
+                for (int j = 0; j < 4; ++j)
+                {
+                    Mesh::Vertex vertex;
+                    vertex.vertex = (n + u * (uvs[j].x * 2 - 1) + v * (uvs[j].y * 2 - 1)) * 0.5f;
+                    vertex.uv = uvs[j];
+                    vertex.normal = n;
+                    vertices.Add(vertex);
+                }
+                indices.AddRange({ (unsigned int) first, (unsigned int) first + 1, (unsigned int) first + 2, (unsigned int) first, (unsigned int) first + 2, (unsigned int) first + 3 });
+            }
+            
+            return RefMake<Mesh>(std::move(vertices), std::move(indices));
+        }
+	};
+}
@@ -0,0 +1,127 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+#include "GameObject.h"
+#include "Debug.h"
+#include "Engine.h"
+#include "time/Time.h"
+#include "math/Mathf.h"
+#include "audio/AudioManager.h"
+#include "audio/AudioClip.h"
+#include "audio/AudioSource.h"
+
+namespace Viry3D
+{
+	// plays thousands of looping clicks at random positions and priorities around the listener,
+	// moves them every frame and logs the real and virtual voice counts and the voice update time
+	class VoiceBenchmark : public Component
+	{
+	public:
+        String path = "audio/click.wav";
+        int count = 2000;
+        float radius = 50.0f;
+        float speed = 5.0f;
+        float log_interval = 2.0f;
+        Vector<AudioSource*> sources;
+        Vector<Vector3> velocities;
+        float log_time = -1;
+        float update_time = 0;
+        int update_count = 0;
+        
+        void Init()
+        {
+            auto clip = AudioClip::LoadWaveFromFile(Engine::Instance()->GetDataPath() + "/" + path);
+            if (!clip)
+            {
+                Log("VoiceBenchmark can not load %s", path.CString());
+                return;
+            }
+            
+            float start = Time::GetRealTimeSinceStartup();
+            for (int i = 0; i < count; ++i)
+            {
+                auto obj = GameObject::Create("");
+                obj->GetTransform()->SetParent(this->GetTransform());
+                obj->GetTransform()->SetPosition(this->RandomPoint());
+                
+                auto source = obj->AddComponent<AudioSource>();
+                source->SetClip(clip);
+                source->SetLoop(true);
+                source->SetVolume(0.01f);
+                source->SetPriority(Mathf::RandomRange(0, 256));
+                source->Play();
+                
+                sources.Add(source.get());
+                velocities.Add(this->RandomPoint().Normalized() * speed);
+            }
+            float play_time = Time::GetRealTimeSinceStartup() - start;
+            
+            Log("VoiceBenchmark sources:%d max voices:%d play:%.2fms", count, AudioManager::GetMaxVoices(), play_time * 1000);
+        }
+        
+        Vector3 RandomPoint() const
+        {
+            return Vector3(Mathf::RandomRange(-radius, radius), Mathf::RandomRange(-radius, radius), Mathf::RandomRange(-radius, radius));
+        }
+        
+        virtual void Update()
+        {
+            if (sources.Size() == 0)
+            {
+                return;
+            }
+            
+            // sources bounce inside the cube, so audibility order changes every frame
+            float delta_time = Mathf::Min(Time::GetDeltaTime(), 0.05f);
+            for (int i = 0; i < sources.Size(); ++i)
+            {
+                Vector3 pos = sources[i]->GetTransform()->GetPosition() + velocities[i] * delta_time;
+                if (fabsf(pos.x) > radius) velocities[i].x = -velocities[i].x;
+                if (fabsf(pos.y) > radius) velocities[i].y = -velocities[i].y;
+                if (fabsf(pos.z) > radius) velocities[i].z = -velocities[i].z;
+                sources[i]->GetTransform()->SetPosition(pos);
+            }
+            
+            // the engine runs the same pass again this frame, so virtual voices advance twice while measuring
+            float start = Time::GetRealTimeSinceStartup();
+            AudioSource::UpdateVoices();
+            update_time += Time::GetRealTimeSinceStartup() - start;
+            update_count += 1;
+            
+            if (log_time >= 0 && Time::GetTime() - log_time < log_interval)
+            {
+                return;
+            }
+            log_time = Time::GetTime();
+            
+            int virtual_count = 0;
+            for (auto i : sources)
+            {
+                if (i->IsVirtual())
+                {
+                    virtual_count += 1;
+                }
+            }
+            
+            Log("VoiceBenchmark real:%d virtual:%d update:%.3fms fps:%d", sources.Size() - virtual_count, virtual_count, update_time * 1000 / update_count, Time::GetFPS());
+            update_time = 0;
+            update_count = 0;
+        }
+	};
+}
@@ -0,0 +1,701 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "Crowd2D.h"
+#include "Navigation2D.h"
+#include "Engine.h"
+#include "thread/ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#define CROWD_EPSILON 0.00001f
+#define CROWD_CHUNK_SIZE 64
+
+namespace Viry3D
+{
+    static inline float det(float ax, float ay, float bx, float by)
+    {
+        return ax * by - ay * bx;
+    }
+
+    static inline int hash_cell(int x, int y)
+    {
+        return (int) (((uint32_t) x * 73856093u) ^ ((uint32_t) y * 19349663u));
+    }
+
+    // solve along one line under the constraints of the lines before it
+    template <class L>
+    static bool linear_program_1(const L& lines, int line_no, float radius, float opt_x, float opt_y, bool direction_opt, float& r_x, float& r_y)
+    {
+        const auto& line = lines[line_no];
+        float dot = line.px * line.dx + line.py * line.dy;
+        float discriminant = dot * dot + radius * radius - (line.px * line.px + line.py * line.py);
+        if (discriminant < 0)
+        {
+            // max speed circle fully invalidates this line
+            return false;
+        }
+
+        float sqrt_discriminant = sqrtf(discriminant);
+        float t_left = -dot - sqrt_discriminant;
+        float t_right = -dot + sqrt_discriminant;
+
+        for (int i = 0; i < line_no; i++)
+        {
+            const auto& other = lines[i];
+            float denominator = det(line.dx, line.dy, other.dx, other.dy);
+            float numerator = det(other.dx, other.dy, line.px - other.px, line.py - other.py);
+
+            if (fabs(denominator) <= CROWD_EPSILON)
+            {
+                // parallel lines
+                if (numerator < 0)
+                    return false;
+                continue;
+            }
+
+            float t = numerator / denominator;
+            if (denominator >= 0)
+                t_right = std::min(t_right, t);
+            else
+                t_left = std::max(t_left, t);
+
+            if (t_left > t_right)
+                return false;
+        }
+
+        float t;
+        if (direction_opt)
+        {
+            t = (opt_x * line.dx + opt_y * line.dy > 0) ? t_right : t_left;
+        }
+        else
+        {
+            t = line.dx * (opt_x - line.px) + line.dy * (opt_y - line.py);
+            t = std::min(std::max(t, t_left), t_right);
+        }
+
+        r_x = line.px + t * line.dx;
+        r_y = line.py + t * line.dy;
+        return true;
+    }
+
+    // returns the count of satisfied lines, equal to the line count on success
+    template <class L>
+    static int linear_program_2(const L& lines, float radius, float opt_x, float opt_y, bool direction_opt, float& r_x, float& r_y)
+    {
+        if (direction_opt)
+        {
+            r_x = opt_x * radius;
+            r_y = opt_y * radius;
+        }
+        else if (opt_x * opt_x + opt_y * opt_y > radius * radius)
+        {
+            float scale = radius / sqrtf(opt_x * opt_x + opt_y * opt_y);
+            r_x = opt_x * scale;
+            r_y = opt_y * scale;
+        }
+        else
+        {
+            r_x = opt_x;
+            r_y = opt_y;
+        }
+
+        int count = (int) lines.size();
+        for (int i = 0; i < count; i++)
+        {
+            const auto& line = lines[i];
+            if (det(line.dx, line.dy, line.px - r_x, line.py - r_y) > 0)
+            {
+                float temp_x = r_x;
+                float temp_y = r_y;
+                if (!linear_program_1(lines, i, radius, opt_x, opt_y, direction_opt, r_x, r_y))
+                {
+                    r_x = temp_x;
+                    r_y = temp_y;
+                    return i;
+                }
+            }
+        }
+
+        return count;
+    }
+
+    // infeasible, minimize the largest penetration into the failed lines
+    template <class L>
+    static void linear_program_3(const L& lines, L& projected, int begin_line, float radius, float& r_x, float& r_y)
+    {
+        float distance = 0;
+
+        for (int i = begin_line; i < (int) lines.size(); i++)
+        {
+            const auto& line = lines[i];
+            if (det(line.dx, line.dy, line.px - r_x, line.py - r_y) <= distance)
+                continue;
+
+            projected.clear();
+            for (int j = 0; j < i; j++)
+            {
+                const auto& other = lines[j];
+                typename L::value_type p;
+
+                float determinant = det(line.dx, line.dy, other.dx, other.dy);
+                if (fabs(determinant) <= CROWD_EPSILON)
+                {
+                    if (line.dx * other.dx + line.dy * other.dy > 0)
+                        continue;
+                    p.px = 0.5f * (line.px + other.px);
+                    p.py = 0.5f * (line.py + other.py);
+                }
+                else
+                {
+                    float t = det(other.dx, other.dy, line.px - other.px, line.py - other.py) / determinant;
+                    p.px = line.px + t * line.dx;
+                    p.py = line.py + t * line.dy;
+                }
+
+                float dx = other.dx - line.dx;
+                float dy = other.dy - line.dy;
+                float length = sqrtf(dx * dx + dy * dy);
+                if (length <= CROWD_EPSILON)
+                    continue;
+                p.dx = dx / length;
+                p.dy = dy / length;
+                projected.push_back(p);
+            }
+
+            float temp_x = r_x;
+            float temp_y = r_y;
+            if (linear_program_2(projected, radius, -line.dy, line.dx, true, r_x, r_y) < (int) projected.size())
+            {
+                // only possible through rounding, keep the last result
+                r_x = temp_x;
+                r_y = temp_y;
+            }
+
+            distance = det(line.dx, line.dy, line.px - r_x, line.py - r_y);
+        }
+    }
+
+    Crowd2D::Crowd2D(const std::shared_ptr<Navigation2D>& p_navigation):
+        m_navigation(p_navigation),
+        m_neighbor_distance(CROWD_2D_NEIGHBOR_DISTANCE),
+        m_max_neighbors(CROWD_2D_MAX_NEIGHBORS),
+        m_time_horizon(CROWD_2D_TIME_HORIZON),
+        m_hash_cell(CROWD_2D_NEIGHBOR_DISTANCE),
+        m_hash_mask(0)
+    {
+
+    }
+
+    int Crowd2D::AddAgent(const Vector2& p_position, float p_radius, float p_max_speed)
+    {
+        int id;
+        if (m_free_ids.size() > 0)
+        {
+            id = m_free_ids.back();
+            m_free_ids.pop_back();
+        }
+        else
+        {
+            id = (int) m_slots.size();
+            m_slots.push_back(-1);
+        }
+
+        m_slots[id] = (int) m_ids.size();
+        m_ids.push_back(id);
+        m_pos_x.push_back(p_position.x);
+        m_pos_y.push_back(p_position.y);
+        m_vel_x.push_back(0);
+        m_vel_y.push_back(0);
+        m_pref_x.push_back(0);
+        m_pref_y.push_back(0);
+        m_new_x.push_back(0);
+        m_new_y.push_back(0);
+        m_radius.push_back(p_radius);
+        m_max_speed.push_back(p_max_speed);
+        m_targets.push_back(p_position);
+        m_path_dirty.push_back(0);
+        m_paths.push_back(std::vector<Vector2>());
+        m_path_index.push_back(0);
+
+        return id;
+    }
+
+    void Crowd2D::RemoveAgent(int p_id)
+    {
+        int slot = m_slots[p_id];
+        int last = (int) m_ids.size() - 1;
+
+        // move the last agent into the hole
+        if (slot != last)
+        {
+            m_ids[slot] = m_ids[last];
+            m_slots[m_ids[slot]] = slot;
+            m_pos_x[slot] = m_pos_x[last];
+            m_pos_y[slot] = m_pos_y[last];
+            m_vel_x[slot] = m_vel_x[last];
+            m_vel_y[slot] = m_vel_y[last];
+            m_pref_x[slot] = m_pref_x[last];
+            m_pref_y[slot] = m_pref_y[last];
+            m_new_x[slot] = m_new_x[last];
+            m_new_y[slot] = m_new_y[last];
+            m_radius[slot] = m_radius[last];
+            m_max_speed[slot] = m_max_speed[last];
+            m_targets[slot] = m_targets[last];
+            m_path_dirty[slot] = m_path_dirty[last];
+            m_paths[slot].swap(m_paths[last]);
+            m_path_index[slot] = m_path_index[last];
+        }
+
+        m_ids.pop_back();
+        m_pos_x.pop_back();
+        m_pos_y.pop_back();
+        m_vel_x.pop_back();
+        m_vel_y.pop_back();
+        m_pref_x.pop_back();
+        m_pref_y.pop_back();
+        m_new_x.pop_back();
+        m_new_y.pop_back();
+        m_radius.pop_back();
+        m_max_speed.pop_back();
+        m_targets.pop_back();
+        m_path_dirty.pop_back();
+        m_paths.pop_back();
+        m_path_index.pop_back();
+
+        m_slots[p_id] = -1;
+        m_free_ids.push_back(p_id);
+    }
+
+    void Crowd2D::ClearAgents()
+    {
+        while (m_ids.size() > 0)
+        {
+            this->RemoveAgent(m_ids.back());
+        }
+    }
+
+    void Crowd2D::SetAgentTarget(int p_id, const Vector2& p_target)
+    {
+        int slot = m_slots[p_id];
+        m_targets[slot] = p_target;
+        m_path_dirty[slot] = 1;
+    }
+
+    void Crowd2D::StopAgent(int p_id)
+    {
+        int slot = m_slots[p_id];
+        m_path_dirty[slot] = 0;
+        m_paths[slot].clear();
+        m_path_index[slot] = 0;
+    }
+
+    bool Crowd2D::IsAgentArrived(int p_id) const
+    {
+        int slot = m_slots[p_id];
+        return m_path_dirty[slot] == 0 && m_path_index[slot] >= (int) m_paths[slot].size();
+    }
+
+    void Crowd2D::SetAgentPosition(int p_id, const Vector2& p_position)
+    {
+        int slot = m_slots[p_id];
+        m_pos_x[slot] = p_position.x;
+        m_pos_y[slot] = p_position.y;
+    }
+
+    Vector2 Crowd2D::GetAgentPosition(int p_id) const
+    {
+        int slot = m_slots[p_id];
+        return Vector2(m_pos_x[slot], m_pos_y[slot]);
+    }
+
+    Vector2 Crowd2D::GetAgentVelocity(int p_id) const
+    {
+        int slot = m_slots[p_id];
+        return Vector2(m_vel_x[slot], m_vel_y[slot]);
+    }
+
+    void Crowd2D::SetAgentRadius(int p_id, float p_radius)
+    {
+        m_radius[m_slots[p_id]] = p_radius;
+    }
+
+    void Crowd2D::SetAgentMaxSpeed(int p_id, float p_max_speed)
+    {
+        m_max_speed[m_slots[p_id]] = p_max_speed;
+    }
+
+    void Crowd2D::RequestPaths()
+    {
+        std::vector<NavigationPathRequest> requests;
+        std::vector<int> slots;
+
+        for (int i = 0; i < (int) m_ids.size(); i++)
+        {
+            if (m_path_dirty[i])
+            {
+                m_path_dirty[i] = 0;
+                m_path_index[i] = 0;
+
+                if (m_navigation)
+                {
+                    requests.push_back(NavigationPathRequest(Vector2(m_pos_x[i], m_pos_y[i]), m_targets[i]));
+                    slots.push_back(i);
+                }
+                else
+                {
+                    m_paths[i].assign(1, m_targets[i]);
+                }
+            }
+        }
+
+        if (requests.size() == 0)
+            return;
+
+        m_navigation->GetSimplePaths(requests);
+
+        for (int i = 0; i < (int) requests.size(); i++)
+        {
+            int slot = slots[i];
+            m_paths[slot].swap(requests[i].path);
+            // the first point is the start position
+            m_path_index[slot] = m_paths[slot].size() > 1 ? 1 : 0;
+        }
+    }
+
+    void Crowd2D::UpdateHash()
+    {
+        int count = (int) m_ids.size();
+        int size = 1;
+        while (size < count * 2)
+        {
+            size <<= 1;
+        }
+
+        m_hash_cell = std::max(m_neighbor_distance, CROWD_EPSILON);
+        m_hash_mask = size - 1;
+        m_hash_offsets.assign(size + 1, 0);
+        m_hash_slots.resize(count);
+        m_hash_buckets.resize(count);
+
+        float inv_cell = 1.0f / m_hash_cell;
+        for (int i = 0; i < count; i++)
+        {
+            int x = (int) floorf(m_pos_x[i] * inv_cell);
+            int y = (int) floorf(m_pos_y[i] * inv_cell);
+            int bucket = hash_cell(x, y) & m_hash_mask;
+            m_hash_buckets[i] = bucket;
+            m_hash_offsets[bucket + 1]++;
+        }
+
+        for (int i = 0; i < size; i++)
+        {
+            m_hash_offsets[i + 1] += m_hash_offsets[i];
+        }
+
+        // counting sort, m_hash_buckets is reused as the fill cursor
+        for (int i = 0; i < count; i++)
+        {
+            int bucket = m_hash_buckets[i];
+            m_hash_slots[m_hash_offsets[bucket]++] = i;
+        }
+        for (int i = size; i > 0; i--)
+        {
+            m_hash_offsets[i] = m_hash_offsets[i - 1];
+        }
+        m_hash_offsets[0] = 0;
+    }
+
+    void Crowd2D::UpdatePreferredVelocity(int p_slot, float p_delta_time)
+    {
+        const auto& path = m_paths[p_slot];
+        int& index = m_path_index[p_slot];
+        float x = m_pos_x[p_slot];
+        float y = m_pos_y[p_slot];
+        float radius = m_radius[p_slot];
+
+        // skip corners already reached
+        while (index < (int) path.size() - 1)
+        {
+            float dx = path[index].x - x;
+            float dy = path[index].y - y;
+            if (dx * dx + dy * dy > radius * radius)
+                break;
+            index++;
+        }
+
+        if (index >= (int) path.size())
+        {
+            m_pref_x[p_slot] = 0;
+            m_pref_y[p_slot] = 0;
+            return;
+        }
+
+        float dx = path[index].x - x;
+        float dy = path[index].y - y;
+        float dist = sqrtf(dx * dx + dy * dy);
+        float speed = m_max_speed[p_slot];
+        bool last = index == (int) path.size() - 1;
+
+        if (last && dist <= speed * p_delta_time)
+        {
+            // arrive this step
+            index++;
+            speed = dist / p_delta_time;
+        }
+
+        if (dist > CROWD_EPSILON)
+        {
+            m_pref_x[p_slot] = dx / dist * speed;
+            m_pref_y[p_slot] = dy / dist * speed;
+        }
+        else
+        {
+            m_pref_x[p_slot] = 0;
+            m_pref_y[p_slot] = 0;
+        }
+    }
+
+    void Crowd2D::ComputeVelocity(Scratch& p_scratch, int p_slot, float p_delta_time)
+    {
+        float px = m_pos_x[p_slot];
+        float py = m_pos_y[p_slot];
+        float vx = m_vel_x[p_slot];
+        float vy = m_vel_y[p_slot];
+        float radius = m_radius[p_slot];
+        float max_speed = m_max_speed[p_slot];
+        float range_sq = m_neighbor_distance * m_neighbor_distance;
+
+        // closest neighbors, kept sorted by distance
+        auto& neighbors = p_scratch.neighbors;
+        neighbors.clear();
+
+        if (m_max_neighbors > 0)
+        {
+            float inv_cell = 1.0f / m_hash_cell;
+            int cx = (int) floorf(px * inv_cell);
+            int cy = (int) floorf(py * inv_cell);
+            int visited[9];
+            int visited_count = 0;
+
+            for (int y = cy - 1; y <= cy + 1; y++)
+            {
+                for (int x = cx - 1; x <= cx + 1; x++)
+                {
+                    int bucket = hash_cell(x, y) & m_hash_mask;
+
+                    // different cells may share a bucket
+                    bool seen = false;
+                    for (int i = 0; i < visited_count; i++)
+                    {
+                        if (visited[i] == bucket)
+                        {
+                            seen = true;
+                            break;
+                        }
+                    }
+                    if (seen)
+                        continue;
+                    visited[visited_count++] = bucket;
+
+                    for (int i = m_hash_offsets[bucket]; i < m_hash_offsets[bucket + 1]; i++)
+                    {
+                        int other = m_hash_slots[i];
+                        if (other == p_slot)
+                            continue;
+
+                        float dx = m_pos_x[other] - px;
+                        float dy = m_pos_y[other] - py;
+                        float dist_sq = dx * dx + dy * dy;
+                        if (dist_sq >= range_sq)
+                            continue;
+
+                        if ((int) neighbors.size() < m_max_neighbors)
+                        {
+                            neighbors.push_back(Neighbor());
+                        }
+                        else if (dist_sq >= neighbors.back().dist_sq)
+                        {
+                            continue;
+                        }
+
+                        int j = (int) neighbors.size() - 1;
+                        while (j > 0 && neighbors[j - 1].dist_sq > dist_sq)
+                        {
+                            neighbors[j] = neighbors[j - 1];
+                            j--;
+                        }
+                        neighbors[j].dist_sq = dist_sq;
+                        neighbors[j].slot = other;
+                    }
+                }
+            }
+        }
+
+        // one half plane of permitted velocities per neighbor, each side takes half the avoidance
+        auto& lines = p_scratch.lines;
+        lines.clear();
+
+        float inv_time_horizon = 1.0f / m_time_horizon;
+        for (const auto& neighbor : neighbors)
+        {
+            int other = neighbor.slot;
+            float rel_px = m_pos_x[other] - px;
+            float rel_py = m_pos_y[other] - py;
+            float rel_vx = vx - m_vel_x[other];
+            float rel_vy = vy - m_vel_y[other];
+            float dist_sq = neighbor.dist_sq;
+            float combined_radius = radius + m_radius[other];
+            float combined_radius_sq = combined_radius * combined_radius;
+
+            Line line;
+            float ux, uy;
+
+            if (dist_sq > combined_radius_sq)
+            {
+                // vector from cutoff center to relative velocity
+                float wx = rel_vx - inv_time_horizon * rel_px;
+                float wy = rel_vy - inv_time_horizon * rel_py;
+                float w_length_sq = wx * wx + wy * wy;
+                float dot = wx * rel_px + wy * rel_py;
+
+                if (dot < 0 && dot * dot > combined_radius_sq * w_length_sq)
+                {
+                    // project on cut-off circle
+                    float w_length = sqrtf(w_length_sq);
+                    float unit_x = wx / w_length;
+                    float unit_y = wy / w_length;
+                    line.dx = unit_y;
+                    line.dy = -unit_x;
+                    ux = (combined_radius * inv_time_horizon - w_length) * unit_x;
+                    uy = (combined_radius * inv_time_horizon - w_length) * unit_y;
+                }
+                else
+                {
+                    // project on legs
+                    float leg = sqrtf(dist_sq - combined_radius_sq);
+                    if (det(rel_px, rel_py, wx, wy) > 0)
+                    {
+                        line.dx = (rel_px * leg - rel_py * combined_radius) / dist_sq;
+                        line.dy = (rel_px * combined_radius + rel_py * leg) / dist_sq;
+                    }
+                    else
+                    {
+                        line.dx = -(rel_px * leg + rel_py * combined_radius) / dist_sq;
+                        line.dy = -(-rel_px * combined_radius + rel_py * leg) / dist_sq;
+                    }
+
+                    float dot2 = rel_vx * line.dx + rel_vy * line.dy;
+                    ux = dot2 * line.dx - rel_vx;
+                    uy = dot2 * line.dy - rel_vy;
+                }
+            }
+            else
+            {
+                // already overlapping, resolve within this step
+                float inv_time_step = 1.0f / p_delta_time;
+                float wx = rel_vx - inv_time_step * rel_px;
+                float wy = rel_vy - inv_time_step * rel_py;
+                float w_length = sqrtf(wx * wx + wy * wy);
+                if (w_length <= CROWD_EPSILON)
+                    continue;
+                float unit_x = wx / w_length;
+                float unit_y = wy / w_length;
+                line.dx = unit_y;
+                line.dy = -unit_x;
+                ux = (combined_radius * inv_time_step - w_length) * unit_x;
+                uy = (combined_radius * inv_time_step - w_length) * unit_y;
+            }
+
+            line.px = vx + 0.5f * ux;
+            line.py = vy + 0.5f * uy;
+            lines.push_back(line);
+        }
+
+        float new_x, new_y;
+        int fail = linear_program_2(lines, max_speed, m_pref_x[p_slot], m_pref_y[p_slot], false, new_x, new_y);
+        if (fail < (int) lines.size())
+        {
+            linear_program_3(lines, p_scratch.projected, fail, max_speed, new_x, new_y);
+        }
+
+        m_new_x[p_slot] = new_x;
+        m_new_y[p_slot] = new_y;
+    }
+
+    void Crowd2D::Update(float p_delta_time)
+    {
+        int count = (int) m_ids.size();
+        if (count == 0 || p_delta_time <= 0)
+            return;
+
+        this->RequestPaths();
+        this->UpdateHash();
+
+        std::atomic<int> next(0);
+        auto job = [&](Scratch& scratch) {
+            while (true)
+            {
+                int begin = next.fetch_add(CROWD_CHUNK_SIZE);
+                if (begin >= count)
+                {
+                    break;
+                }
+                int end = std::min(begin + CROWD_CHUNK_SIZE, count);
+                for (int i = begin; i < end; i++)
+                {
+                    this->UpdatePreferredVelocity(i, p_delta_time);
+                    this->ComputeVelocity(scratch, i, p_delta_time);
+                }
+            }
+        };
+
+        ThreadPool* thread_pool = Engine::Instance() ? Engine::Instance()->GetThreadPool() : nullptr;
+        int chunk_count = (count + CROWD_CHUNK_SIZE - 1) / CROWD_CHUNK_SIZE;
+        int worker_count = thread_pool ? std::min(thread_pool->GetThreadCount() + 1, chunk_count) : 1;
+        if ((int) m_scratch.size() < worker_count)
+        {
+            m_scratch.resize(worker_count);
+        }
+        if (thread_pool)
+        {
+            thread_pool->ParallelRun(worker_count, [&](int worker) {
+                job(m_scratch[worker]);
+            });
+        }
+        else
+        {
+            job(m_scratch[0]);
+        }
+
+        float* pos_x = m_pos_x.data();
+        float* pos_y = m_pos_y.data();
+        float* vel_x = m_vel_x.data();
+        float* vel_y = m_vel_y.data();
+        const float* new_x = m_new_x.data();
+        const float* new_y = m_new_y.data();
+        for (int i = 0; i < count; i++)
+        {
+            vel_x[i] = new_x[i];
+            vel_y[i] = new_y[i];
+            pos_x[i] += vel_x[i] * p_delta_time;
+            pos_y[i] += vel_y[i] * p_delta_time;
+        }
+    }
+}
@@ -0,0 +1,122 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+#include "math/Vector2.h"
+#include <vector>
+#include <memory>
+
+#define CROWD_2D_NEIGHBOR_DISTANCE 100.0f
+#define CROWD_2D_MAX_NEIGHBORS 10
+#define CROWD_2D_TIME_HORIZON 1.0f
+
+namespace Viry3D
+{
+    class Navigation2D;
+
+    // local avoidance for agents walking Navigation2D paths (ORCA, reciprocal velocity obstacles),
+    // agent state is stored as parallel arrays indexed by slot, ids stay stable across removals
+    class Crowd2D
+    {
+    private:
+        struct Line
+        {
+            float px;
+            float py;
+            float dx;
+            float dy;
+        };
+
+        struct Neighbor
+        {
+            float dist_sq;
+            int slot;
+        };
+
+        struct Scratch
+        {
+            std::vector<Line> lines;
+            std::vector<Line> projected;
+            std::vector<Neighbor> neighbors;
+        };
+
+    public:
+        Crowd2D(const std::shared_ptr<Navigation2D>& p_navigation = std::shared_ptr<Navigation2D>());
+        int AddAgent(const Vector2& p_position, float p_radius, float p_max_speed);
+        void RemoveAgent(int p_id);
+        void ClearAgents();
+        int GetAgentCount() const { return (int) m_ids.size(); }
+        int GetAgentId(int p_slot) const { return m_ids[p_slot]; }
+        int GetAgentSlot(int p_id) const { return m_slots[p_id]; }
+        // path is requested from the navigation on the next update
+        void SetAgentTarget(int p_id, const Vector2& p_target);
+        void StopAgent(int p_id);
+        bool IsAgentArrived(int p_id) const;
+        void SetAgentPosition(int p_id, const Vector2& p_position);
+        Vector2 GetAgentPosition(int p_id) const;
+        Vector2 GetAgentVelocity(int p_id) const;
+        void SetAgentRadius(int p_id, float p_radius);
+        void SetAgentMaxSpeed(int p_id, float p_max_speed);
+        const std::vector<Vector2>& GetAgentPath(int p_id) const { return m_paths[m_slots[p_id]]; }
+        // slot ordered arrays, for bulk reads of positions
+        const float* GetPositionsX() const { return m_pos_x.data(); }
+        const float* GetPositionsY() const { return m_pos_y.data(); }
+        void SetNeighborDistance(float p_distance) { m_neighbor_distance = p_distance; }
+        void SetMaxNeighbors(int p_count) { m_max_neighbors = p_count; }
+        void SetTimeHorizon(float p_time) { m_time_horizon = p_time; }
+        void Update(float p_delta_time);
+
+    private:
+        void RequestPaths();
+        void UpdateHash();
+        void UpdatePreferredVelocity(int p_slot, float p_delta_time);
+        void ComputeVelocity(Scratch& p_scratch, int p_slot, float p_delta_time);
+
+    private:
+        std::shared_ptr<Navigation2D> m_navigation;
+        float m_neighbor_distance;
+        int m_max_neighbors;
+        float m_time_horizon;
+        // id -> slot, -1 when free
+        std::vector<int> m_slots;
+        std::vector<int> m_free_ids;
+        // per slot
+        std::vector<int> m_ids;
+        std::vector<float> m_pos_x;
+        std::vector<float> m_pos_y;
+        std::vector<float> m_vel_x;
+        std::vector<float> m_vel_y;
+        std::vector<float> m_pref_x;
+        std::vector<float> m_pref_y;
+        std::vector<float> m_new_x;
+        std::vector<float> m_new_y;
+        std::vector<float> m_radius;
+        std::vector<float> m_max_speed;
+        std::vector<Vector2> m_targets;
+        std::vector<char> m_path_dirty;
+        std::vector<std::vector<Vector2>> m_paths;
+        std::vector<int> m_path_index;
+        // spatial hash over agent positions, buckets index into m_hash_slots
+        float m_hash_cell;
+        int m_hash_mask;
+        std::vector<int> m_hash_offsets;
+        std::vector<int> m_hash_slots;
+        std::vector<int> m_hash_buckets;
+        std::vector<Scratch> m_scratch;
+    };
+}
@@ -18,6 +18,9 @@
 #include "Navigation2D.h"
 #include "NavigationPolygon.h"
 #include <algorithm>
+#include "Engine.h"
+#include "thread/ThreadPool.h"
+#include <atomic>
 
 #define USE_ENTRY_POINT
 
@@ -25,7 +28,12 @@ namespace Viry3D
 {
     Navigation2D::Navigation2D():
         m_cell_size(1), // one pixel
-        m_last_id(1)
+        m_last_id(1),
+        m_path_cache_enabled(false),
+        m_grid_dirty(true),
+        m_grid_cell(1),
+        m_grid_width(0),
+        m_grid_height(0)
     {
 
     }
@@ -49,176 +57,240 @@ namespace Viry3D
     {
         NavMesh& nm = m_navpoly_map[p_id];
 
+        // the whole grid is rebuilt once instead of patched per polygon
+        m_grid_dirty = true;
+
+        int count = nm.navpoly->GetPolygonCount();
+        nm.slots.assign(count, nm.polygons.end());
+        nm.versions.resize(count);
+
+        for (int i = 0; i < count; i++)
+        {
+            nm.versions[i] = nm.navpoly->GetPolygonVersion(i);
+            this->LinkPolygon(nm, i);
+        }
+
+        nm.linked = true;
+        m_path_cache.clear();
+    }
+
+    void Navigation2D::LinkPolygon(NavMesh& nm, int p_slot)
+    {
         auto& vertices = nm.navpoly->GetVertices();
         int len = (int) vertices.size();
         if (len == 0)
             return;
 
-        for (int i = 0; i < nm.navpoly->GetPolygonCount(); i++)
-        {
-            // build
+        // build
 
-            nm.polygons.push_back(Polygon());
-            Polygon& p = nm.polygons.back();
-            p.owner = &nm;
+        nm.polygons.push_back(Polygon());
+        Polygon& p = nm.polygons.back();
+        p.owner = &nm;
+        p.index = -1;
 
-            auto& poly = nm.navpoly->GetPolygon(i);
-            int plen = (int) poly.size();
-            const int* indices = poly.data();
-            bool valid = true;
-            p.edges.resize(plen);
+        auto& poly = nm.navpoly->GetPolygon(p_slot);
+        int plen = (int) poly.size();
+        const int* indices = poly.data();
+        bool valid = plen > 0;
+        p.edges.resize(plen);
 
-            Vector2 center;
-            float sum = 0;
+        Vector2 center;
+        float sum = 0;
 
-            for (int j = 0; j < plen; j++)
+        for (int j = 0; j < plen; j++)
+        {
+            int idx = indices[j];
+            if (idx < 0 || idx >= len)
             {
-                int idx = indices[j];
-                if (idx < 0 || idx >= len)
-                {
-                    valid = false;
-                    break;
-                }
-
-                Polygon::Edge e;
-                Vector2 ep = nm.xform.xform(vertices[idx]);
-                center += ep;
-                e.point = this->GetPoint(ep);
-                p.edges[j] = e;
-
-                int idxn = indices[(j + 1) % plen];
-                if (idxn < 0 || idxn >= len)
-                {
-                    valid = false;
-                    break;
-                }
+                valid = false;
+                break;
+            }
 
-                Vector2 epn = nm.xform.xform(vertices[idxn]);
+            Polygon::Edge e;
+            Vector2 ep = nm.xform.xform(vertices[idx]);
+            center += ep;
+            e.point = this->GetPoint(ep);
 
-                sum += (epn.x - ep.x) * (epn.y + ep.y);
+            // bounds of the snapped vertices, which is what the containment tests use
+            Vector2 v = this->GetVertex(e.point);
+            if (j == 0)
+            {
+                p.bounds_min = v;
+                p.bounds_max = v;
             }
+            else
+            {
+                p.bounds_min = Vector2(std::min(p.bounds_min.x, v.x), std::min(p.bounds_min.y, v.y));
+                p.bounds_max = Vector2(std::max(p.bounds_max.x, v.x), std::max(p.bounds_max.y, v.y));
+            }
+            p.edges[j] = e;
 
-            p.clockwise = sum > 0;
-
-            if (!valid)
+            int idxn = indices[(j + 1) % plen];
+            if (idxn < 0 || idxn >= len)
             {
-                nm.polygons.pop_back();
-                continue;
+                valid = false;
+                break;
             }
 
-            p.center = center * (1.0f / (float) plen);
+            Vector2 epn = nm.xform.xform(vertices[idxn]);
 
-            // connect
+            sum += (epn.x - ep.x) * (epn.y + ep.y);
+        }
 
-            for (int j = 0; j < plen; j++)
-            {
-                int next = (j + 1) % plen;
-                EdgeKey ek(p.edges[j].point, p.edges[next].point);
+        p.clockwise = sum > 0;
 
-                auto C = m_connections.find(ek);
-                if (C == m_connections.end())
+        if (!valid)
+        {
+            nm.polygons.pop_back();
+            return;
+        }
+
+        p.center = center * (1.0f / (float) plen);
+
+        if (m_free_indices.size() > 0)
+        {
+            p.index = m_free_indices.back();
+            m_free_indices.pop_back();
+            m_polygons[p.index] = &p;
+        }
+        else
+        {
+            p.index = (int) m_polygons.size();
+            m_polygons.push_back(&p);
+        }
+        nm.slots[p_slot] = --nm.polygons.end();
+
+        // connect
+
+        for (int j = 0; j < plen; j++)
+        {
+            int next = (j + 1) % plen;
+            EdgeKey ek(p.edges[j].point, p.edges[next].point);
+
+            auto C = m_connections.find(ek);
+            if (C == m_connections.end())
+            {
+                Connection c;
+                c.A = &p;
+                c.A_edge = j;
+                c.B = nullptr;
+                c.B_edge = -1;
+                m_connections[ek] = c;
+            }
+            else
+            {
+                if (C->second.B != nullptr)
                 {
-                    Connection c;
-                    c.A = &p;
-                    c.A_edge = j;
-                    c.B = nullptr;
-                    c.B_edge = -1;
-                    m_connections[ek] = c;
+                    ConnectionPending pending;
+                    pending.polygon = &p;
+                    pending.edge = j;
+                    C->second.pending.push_back(pending);
+                    p.edges[j].P = &C->second.pending.back();
+                    continue;
                 }
-                else
-                {
-                    if (C->second.B != nullptr)
-                    {
-                        ConnectionPending pending;
-                        pending.polygon = &p;
-                        pending.edge = j;
-                        C->second.pending.push_back(pending);
-                        p.edges[j].P = &C->second.pending.back();
-                        continue;
-                    }
 
-                    C->second.B = &p;
-                    C->second.B_edge = j;
-                    C->second.A->edges[C->second.A_edge].C = &p;
-                    C->second.A->edges[C->second.A_edge].C_edge = j;
-                    p.edges[j].C = C->second.A;
-                    p.edges[j].C_edge = C->second.A_edge;
-                    // connection successful.
-                }
+                C->second.B = &p;
+                C->second.B_edge = j;
+                C->second.A->edges[C->second.A_edge].C = &p;
+                C->second.A->edges[C->second.A_edge].C_edge = j;
+                p.edges[j].C = C->second.A;
+                p.edges[j].C_edge = C->second.A_edge;
+                // connection successful.
             }
         }
 
-        nm.linked = true;
+        this->GridInsert(&p);
     }
 
     void Navigation2D::NavpolyUnlink(int p_id)
     {
         NavMesh& nm = m_navpoly_map[p_id];
 
-        for (auto E = nm.polygons.begin(); E != nm.polygons.end(); ++E)
+        m_grid_dirty = true;
+
+        for (int i = 0; i < (int) nm.slots.size(); i++)
         {
-            Polygon& p = *E;
+            this->UnlinkPolygon(nm, i);
+        }
 
-            int ec = (int) p.edges.size();
-            Polygon::Edge* edges = p.edges.data();
+        nm.polygons.clear();
+        nm.slots.clear();
+        nm.versions.clear();
 
-            for (int i = 0; i < ec; i++)
-            {
-                int next = (i + 1) % ec;
+        nm.linked = false;
+        m_path_cache.clear();
+    }
 
-                EdgeKey ek(edges[i].point, edges[next].point);
-                auto C = m_connections.find(ek);
+    void Navigation2D::UnlinkPolygon(NavMesh& nm, int p_slot)
+    {
+        auto E = nm.slots[p_slot];
+        if (E == nm.polygons.end())
+            return;
+        nm.slots[p_slot] = nm.polygons.end();
 
-                if (edges[i].P)
-                {
-                    C->second.pending.remove_if([&](const ConnectionPending& ele) {
-                        return edges[i].P == &ele;
-                    });
-                    edges[i].P = nullptr;
-                }
-                else if (C->second.B)
-                {
-                    // disconnect
+        Polygon& p = *E;
 
-                    C->second.B->edges[C->second.B_edge].C = nullptr;
-                    C->second.B->edges[C->second.B_edge].C_edge = -1;
-                    C->second.A->edges[C->second.A_edge].C = nullptr;
-                    C->second.A->edges[C->second.A_edge].C_edge = -1;
+        int ec = (int) p.edges.size();
+        Polygon::Edge* edges = p.edges.data();
 
-                    if (C->second.A == &*E)
-                    {
-                        C->second.A = C->second.B;
-                        C->second.A_edge = C->second.B_edge;
-                    }
-                    C->second.B = nullptr;
-                    C->second.B_edge = -1;
+        for (int i = 0; i < ec; i++)
+        {
+            int next = (i + 1) % ec;
 
-                    if (C->second.pending.size())
-                    {
-                        // reconnect if something is pending
-                        ConnectionPending cp = C->second.pending.front();
-                        C->second.pending.pop_front();
-
-                        C->second.B = cp.polygon;
-                        C->second.B_edge = cp.edge;
-                        C->second.A->edges[C->second.A_edge].C = cp.polygon;
-                        C->second.A->edges[C->second.A_edge].C_edge = cp.edge;
-                        cp.polygon->edges[cp.edge].C = C->second.A;
-                        cp.polygon->edges[cp.edge].C_edge = C->second.A_edge;
-                        cp.polygon->edges[cp.edge].P = nullptr;
-                    }
+            EdgeKey ek(edges[i].point, edges[next].point);
+            auto C = m_connections.find(ek);
+
+            if (edges[i].P)
+            {
+                C->second.pending.remove_if([&](const ConnectionPending& ele) {
+                    return edges[i].P == &ele;
+                });
+                edges[i].P = nullptr;
+            }
+            else if (C->second.B)
+            {
+                // disconnect
+
+                C->second.B->edges[C->second.B_edge].C = nullptr;
+                C->second.B->edges[C->second.B_edge].C_edge = -1;
+                C->second.A->edges[C->second.A_edge].C = nullptr;
+                C->second.A->edges[C->second.A_edge].C_edge = -1;
+
+                if (C->second.A == &p)
+                {
+                    C->second.A = C->second.B;
+                    C->second.A_edge = C->second.B_edge;
                 }
-                else
+                C->second.B = nullptr;
+                C->second.B_edge = -1;
+
+                if (C->second.pending.size())
                 {
-                    m_connections.erase(C);
-                    // erase
+                    // reconnect if something is pending
+                    ConnectionPending cp = C->second.pending.front();
+                    C->second.pending.pop_front();
+
+                    C->second.B = cp.polygon;
+                    C->second.B_edge = cp.edge;
+                    C->second.A->edges[C->second.A_edge].C = cp.polygon;
+                    C->second.A->edges[C->second.A_edge].C_edge = cp.edge;
+                    cp.polygon->edges[cp.edge].C = C->second.A;
+                    cp.polygon->edges[cp.edge].C_edge = C->second.A_edge;
+                    cp.polygon->edges[cp.edge].P = nullptr;
                 }
             }
+            else
+            {
+                m_connections.erase(C);
+                // erase
+            }
         }
 
-        nm.polygons.clear();
+        this->GridRemove(&p);
+        m_polygons[p.index] = nullptr;
+        m_free_indices.push_back(p.index);
 
-        nm.linked = false;
+        nm.polygons.erase(E);
     }
 
     void Navigation2D::NavpolySetTransform(int p_id, const Transform2D& p_xform)
@@ -231,6 +303,47 @@ namespace Viry3D
         this->NavpolyLink(p_id);
     }
 
+    void Navigation2D::NavpolyUpdate(int p_id)
+    {
+        NavMesh& nm = m_navpoly_map[p_id];
+        if (!nm.linked)
+        {
+            this->NavpolyLink(p_id);
+            return;
+        }
+
+        int count = nm.navpoly->GetPolygonCount();
+        int old_count = (int) nm.slots.size();
+        std::vector<int> changed;
+
+        // unlink every changed slot before linking, so shared edges reconnect to the new polygons
+        for (int i = 0; i < old_count; i++)
+        {
+            if (i >= count || nm.versions[i] != nm.navpoly->GetPolygonVersion(i))
+            {
+                this->UnlinkPolygon(nm, i);
+                if (i < count)
+                    changed.push_back(i);
+            }
+        }
+
+        nm.slots.resize(count, nm.polygons.end());
+        nm.versions.resize(count);
+        for (int i = old_count; i < count; i++)
+        {
+            changed.push_back(i);
+        }
+
+        for (int i : changed)
+        {
+            nm.versions[i] = nm.navpoly->GetPolygonVersion(i);
+            this->LinkPolygon(nm, i);
+        }
+
+        if (changed.size() > 0 || count < old_count)
+            m_path_cache.clear();
+    }
+
     void Navigation2D::NavpolyRemove(int p_id)
     {
         this->NavpolyUnlink(p_id);
@@ -256,313 +369,390 @@ namespace Viry3D
             return p_segment[0] + n * d; // inside
     }
 
-    Vector2 Navigation2D::GetClosestPoint(const Vector2& p_point)
+    bool Navigation2D::GetGridRange(const Polygon* p_poly, int& r_x0, int& r_y0, int& r_x1, int& r_y1) const
     {
-        Vector2 closest_point = Vector2();
-        float closest_point_d = 1e20f;
+        r_x0 = int(floor((p_poly->bounds_min.x - m_grid_min.x) / m_grid_cell));
+        r_y0 = int(floor((p_poly->bounds_min.y - m_grid_min.y) / m_grid_cell));
+        r_x1 = int(floor((p_poly->bounds_max.x - m_grid_min.x) / m_grid_cell));
+        r_y1 = int(floor((p_poly->bounds_max.y - m_grid_min.y) / m_grid_cell));
+
+        return r_x0 >= 0 && r_y0 >= 0 && r_x1 < m_grid_width && r_y1 < m_grid_height;
+    }
+
+    void Navigation2D::GridInsert(Polygon* p_poly)
+    {
+        if (m_grid_dirty)
+            return;
 
-        for (auto& E : m_navpoly_map)
+        int x0, y0, x1, y1;
+        if (!this->GetGridRange(p_poly, x0, y0, x1, y1))
         {
-            if (!E.second.linked)
-                continue;
-            for (auto& F : E.second.polygons)
+            // outside the grid bounds, rebuild it on the next query
+            m_grid_dirty = true;
+            return;
+        }
+
+        for (int y = y0; y <= y1; y++)
+        {
+            for (int x = x0; x <= x1; x++)
             {
-                Polygon& p = F;
-                for (int i = 2; i < (int) p.edges.size(); i++)
-                {
-                    if (is_point_in_triangle(p_point, this->GetVertex(p.edges[0].point), this->GetVertex(p.edges[i - 1].point), this->GetVertex(p.edges[i].point)))
-                    {
-                        return p_point; //inside triangle, nothing else to discuss
-                    }
-                }
+                m_grid_cells[y * m_grid_width + x].push_back(p_poly);
             }
         }
+    }
+
+    void Navigation2D::GridRemove(Polygon* p_poly)
+    {
+        if (m_grid_dirty)
+            return;
+
+        int x0, y0, x1, y1;
+        this->GetGridRange(p_poly, x0, y0, x1, y1);
 
-        for (auto& E : m_navpoly_map)
+        for (int y = std::max(y0, 0); y <= std::min(y1, m_grid_height - 1); y++)
         {
-            if (!E.second.linked)
-                continue;
-            for (auto& F : E.second.polygons)
+            for (int x = std::max(x0, 0); x <= std::min(x1, m_grid_width - 1); x++)
             {
-                Polygon& p = F;
-                int es = (int) p.edges.size();
-                for (int i = 0; i < es; i++)
+                auto& cell = m_grid_cells[y * m_grid_width + x];
+                auto I = std::find(cell.begin(), cell.end(), p_poly);
+                if (I != cell.end())
                 {
-                    Vector2 edge[2] = {
-                        this->GetVertex(p.edges[i].point),
-                        this->GetVertex(p.edges[(i + 1) % es].point)
-                    };
-
-                    Vector2 spoint = get_closest_point_to_segment_2d(p_point, edge);
-                    float d = (spoint - p_point).SqrMagnitude();
-                    if (d < closest_point_d)
-                    {
-                        closest_point = spoint;
-                        closest_point_d = d;
-                    }
+                    *I = cell.back();
+                    cell.pop_back();
                 }
             }
         }
-
-        return closest_point;
     }
 
-    void* Navigation2D::GetClosestPointOwner(const Vector2& p_point)
+    void Navigation2D::UpdateGrid()
     {
-        void* owner = nullptr;
-        Vector2 closest_point = Vector2();
-        float closest_point_d = 1e20f;
+        if (!m_grid_dirty)
+            return;
+        m_grid_dirty = false;
 
-        for (auto& E : m_navpoly_map)
+        m_grid_cells.clear();
+        m_grid_width = 0;
+        m_grid_height = 0;
+
+        Vector2 bounds_min(1e20f, 1e20f);
+        Vector2 bounds_max(-1e20f, -1e20f);
+        float extent = 0;
+        int count = 0;
+
+        for (auto p : m_polygons)
         {
-            if (!E.second.linked)
+            if (p == nullptr)
                 continue;
-            for (auto& F : E.second.polygons)
+            bounds_min = Vector2(std::min(bounds_min.x, p->bounds_min.x), std::min(bounds_min.y, p->bounds_min.y));
+            bounds_max = Vector2(std::max(bounds_max.x, p->bounds_max.x), std::max(bounds_max.y, p->bounds_max.y));
+            extent += std::max(p->bounds_max.x - p->bounds_min.x, p->bounds_max.y - p->bounds_min.y);
+            count++;
+        }
+
+        if (count == 0)
+            return;
+
+        // cells about the size of an average polygon, coarser if the map is huge
+        m_grid_cell = std::max(extent / count, m_cell_size);
+        while (true)
+        {
+            m_grid_width = int((bounds_max.x - bounds_min.x) / m_grid_cell) + 1;
+            m_grid_height = int((bounds_max.y - bounds_min.y) / m_grid_cell) + 1;
+            if (m_grid_width * m_grid_height <= NAVIGATION_2D_GRID_MAX_CELLS)
+                break;
+            m_grid_cell *= 2;
+        }
+        m_grid_min = bounds_min;
+
+        m_grid_cells.resize(m_grid_width * m_grid_height);
+
+        for (auto p : m_polygons)
+        {
+            if (p == nullptr)
+                continue;
+
+            int x0, y0, x1, y1;
+            this->GetGridRange(p, x0, y0, x1, y1);
+
+            for (int y = std::max(y0, 0); y <= std::min(y1, m_grid_height - 1); y++)
             {
-                Polygon& p = F;
-                for (int i = 2; i < (int) p.edges.size(); i++)
+                for (int x = std::max(x0, 0); x <= std::min(x1, m_grid_width - 1); x++)
                 {
-                    if (is_point_in_triangle(p_point, this->GetVertex(p.edges[0].point), this->GetVertex(p.edges[i - 1].point), this->GetVertex(p.edges[i].point)))
-                    {
-                        return E.second.owner;
-                    }
+                    m_grid_cells[y * m_grid_width + x].push_back(p);
                 }
             }
         }
+    }
 
-        for (auto& E : m_navpoly_map)
+    void Navigation2D::BeginQuery(QueryContext& p_context) const
+    {
+        if (p_context.nodes.size() < m_polygons.size())
         {
-            if (!E.second.linked)
-                continue;
-            for (auto& F : E.second.polygons)
+            NodeState state;
+            state.stamp = 0;
+            p_context.nodes.resize(m_polygons.size(), state);
+        }
+
+        // node state is only valid when stamped with the current query, so nothing needs resetting
+        p_context.stamp++;
+        if (p_context.stamp == 0)
+        {
+            for (auto& node : p_context.nodes)
+                node.stamp = 0;
+            p_context.stamp = 1;
+        }
+
+        p_context.heap.clear();
+    }
+
+    bool Navigation2D::IsPointInPolygon(const Polygon& p_poly, const Vector2& p_point) const
+    {
+        if (p_point.x < p_poly.bounds_min.x || p_point.y < p_poly.bounds_min.y ||
+            p_point.x > p_poly.bounds_max.x || p_point.y > p_poly.bounds_max.y)
+            return false;
+
+        for (int i = 2; i < (int) p_poly.edges.size(); i++)
+        {
+            if (is_point_in_triangle(p_point, this->GetVertex(p_poly.edges[0].point), this->GetVertex(p_poly.edges[i - 1].point), this->GetVertex(p_poly.edges[i].point)))
             {
-                Polygon& p = F;
-                int es = (int) p.edges.size();
-                for (int i = 0; i < es; i++)
-                {
-                    Vector2 edge[2] = {
-                        this->GetVertex(p.edges[i].point),
-                        this->GetVertex(p.edges[(i + 1) % es].point)
-                    };
-
-                    Vector2 spoint = get_closest_point_to_segment_2d(p_point, edge);
-                    float d = (spoint - p_point).SqrMagnitude();
-                    if (d < closest_point_d)
-                    {
-                        closest_point = spoint;
-                        closest_point_d = d;
-                        owner = E.second.owner;
-                    }
-                }
+                return true;
             }
         }
 
-        return owner;
+        return false;
     }
 
-    std::vector<Vector2> Navigation2D::GetSimplePath(const Vector2& p_start, const Vector2& p_end, bool p_optimize)
+    Navigation2D::Polygon* Navigation2D::GetPolygonAt(const Vector2& p_point) const
     {
-        Polygon* begin_poly = nullptr;
-        Polygon* end_poly = nullptr;
-        Vector2 begin_point;
-        Vector2 end_point;
-        float begin_d = 1e20f;
-        float end_d = 1e20f;
+        if (m_grid_width == 0)
+            return nullptr;
 
-        //look for point inside triangle
+        int x = int(floor((p_point.x - m_grid_min.x) / m_grid_cell));
+        int y = int(floor((p_point.y - m_grid_min.y) / m_grid_cell));
+        if (x < 0 || y < 0 || x >= m_grid_width || y >= m_grid_height)
+            return nullptr;
 
-        for (auto& E : m_navpoly_map)
+        for (Polygon* p : m_grid_cells[y * m_grid_width + x])
         {
-            if (!E.second.linked)
-                continue;
-            for (auto& F : E.second.polygons)
-            {
-                Polygon& p = F;
-                if (begin_d || end_d)
-                {
-                    for (int i = 2; i < (int) p.edges.size(); i++)
-                    {
-                        if (begin_d > 0)
-                        {
-                            if (is_point_in_triangle(p_start, this->GetVertex(p.edges[0].point), this->GetVertex(p.edges[i - 1].point), this->GetVertex(p.edges[i].point)))
-                            {
-                                begin_poly = &p;
-                                begin_point = p_start;
-                                begin_d = 0;
-                                if (end_d == 0)
-                                    break;
-                            }
-                        }
+            if (this->IsPointInPolygon(*p, p_point))
+                return p;
+        }
 
-                        if (end_d > 0)
-                        {
-                            if (is_point_in_triangle(p_end, this->GetVertex(p.edges[0].point), this->GetVertex(p.edges[i - 1].point), this->GetVertex(p.edges[i].point)))
-                            {
-                                end_poly = &p;
-                                end_point = p_end;
-                                end_d = 0;
-                                if (begin_d == 0)
-                                    break;
-                            }
-                        }
-                    }
-                }
+        return nullptr;
+    }
 
-                p.prev_edge = -1;
-            }
+    static float get_rect_distance_squared(const Vector2& p_point, const Vector2& p_min, const Vector2& p_max)
+    {
+        float dx = std::max(std::max(p_min.x - p_point.x, p_point.x - p_max.x), 0.0f);
+        float dy = std::max(std::max(p_min.y - p_point.y, p_point.y - p_max.y), 0.0f);
+        return dx * dx + dy * dy;
+    }
+
+    Navigation2D::Polygon* Navigation2D::GetClosestPolygon(QueryContext& p_context, const Vector2& p_point, Vector2& r_closest) const
+    {
+        Polygon* inside = this->GetPolygonAt(p_point);
+        if (inside)
+        {
+            r_closest = p_point;
+            return inside;
         }
 
-        //start or end not inside triangle.. look for closest segment :|
-        if (begin_d || end_d)
+        if (m_grid_width == 0)
+            return nullptr;
+
+        Polygon* closest_poly = nullptr;
+        float closest_d = 1e20f;
+
+        // the stamp only dedupes polygons spanning several cells here
+        this->BeginQuery(p_context);
+        uint32_t stamp = p_context.stamp;
+
+        int cx = std::max(std::min(int(floor((p_point.x - m_grid_min.x) / m_grid_cell)), m_grid_width - 1), 0);
+        int cy = std::max(std::min(int(floor((p_point.y - m_grid_min.y) / m_grid_cell)), m_grid_height - 1), 0);
+        int max_ring = std::max(m_grid_width, m_grid_height);
+
+        // search rings of cells outwards until no closer cell can remain
+        for (int r = 0; r <= max_ring; r++)
         {
-            for (auto& E : m_navpoly_map)
+            float ring_d = 1e20f;
+
+            for (int y = cy - r; y <= cy + r; y++)
             {
-                if (!E.second.linked)
+                if (y < 0 || y >= m_grid_height)
                     continue;
-                for (auto& F : E.second.polygons)
+
+                int step = (y == cy - r || y == cy + r) ? 1 : std::max(2 * r, 1);
+                for (int x = cx - r; x <= cx + r; x += step)
                 {
-                    Polygon& p = F;
-                    int es = (int) p.edges.size();
-                    for (int i = 0; i < es; i++)
+                    if (x < 0 || x >= m_grid_width)
+                        continue;
+
+                    Vector2 cell_min = m_grid_min + Vector2((float) x, (float) y) * m_grid_cell;
+                    float cell_d = get_rect_distance_squared(p_point, cell_min, cell_min + Vector2(m_grid_cell, m_grid_cell));
+                    ring_d = std::min(ring_d, cell_d);
+                    if (cell_d >= closest_d)
+                        continue;
+
+                    for (Polygon* cell_poly : m_grid_cells[y * m_grid_width + x])
                     {
-                        Vector2 edge[2] = {
-                            this->GetVertex(p.edges[i].point),
-                            this->GetVertex(p.edges[(i + 1) % es].point)
-                        };
+                        Polygon& p = *cell_poly;
+                        NodeState& node = p_context.nodes[p.index];
+                        if (node.stamp == stamp)
+                            continue;
+                        node.stamp = stamp;
 
-                        if (begin_d > 0)
-                        {
-                            Vector2 spoint = get_closest_point_to_segment_2d(p_start, edge);
-                            float d = (spoint - p_start).SqrMagnitude();
-                            if (d < begin_d)
-                            {
-                                begin_poly = &p;
-                                begin_point = spoint;
-                                begin_d = d;
-                            }
-                        }
+                        if (get_rect_distance_squared(p_point, p.bounds_min, p.bounds_max) >= closest_d)
+                            continue;
 
-                        if (end_d > 0)
+                        int es = (int) p.edges.size();
+                        for (int j = 0; j < es; j++)
                         {
-                            Vector2 spoint = get_closest_point_to_segment_2d(p_end, edge);
-                            float d = (spoint - p_end).SqrMagnitude();
-                            if (d < end_d)
+                            Vector2 edge[2] = {
+                                this->GetVertex(p.edges[j].point),
+                                this->GetVertex(p.edges[(j + 1) % es].point)
+                            };
+
+                            Vector2 spoint = get_closest_point_to_segment_2d(p_point, edge);
+                            float d = (spoint - p_point).SqrMagnitude();
+                            if (d < closest_d)
                             {
-                                end_poly = &p;
-                                end_point = spoint;
-                                end_d = d;
+                                closest_poly = &p;
+                                r_closest = spoint;
+                                closest_d = d;
                             }
                         }
                     }
                 }
             }
-        }
 
-        if (!begin_poly || !end_poly)
-        {
-            return std::vector<Vector2>(); //no path
-        }
-
-        if (begin_poly == end_poly)
-        {
-            std::vector<Vector2> path;
-            path.resize(2);
-            path[0] = begin_point;
-            path[1] = end_point;
-            return path;
+            if (ring_d >= closest_d)
+                break;
         }
 
-        bool found_route = false;
+        return closest_poly;
+    }
 
-        std::list<Polygon*> open_list;
+    Vector2 Navigation2D::GetClosestPoint(const Vector2& p_point)
+    {
+        this->UpdateGrid();
 
-        begin_poly->entry = p_start;
+        Vector2 closest_point = Vector2();
+        this->GetClosestPolygon(m_query, p_point, closest_point);
+        return closest_point;
+    }
 
-        for (int i = 0; i < (int) begin_poly->edges.size(); i++)
-        {
-            if (begin_poly->edges[i].C)
-            {
-                begin_poly->edges[i].C->prev_edge = begin_poly->edges[i].C_edge;
-#ifdef USE_ENTRY_POINT
-                Vector2 edge[2] = {
-                    this->GetVertex(begin_poly->edges[i].point),
-                    this->GetVertex(begin_poly->edges[(i + 1) % begin_poly->edges.size()].point)
-                };
+    void* Navigation2D::GetClosestPointOwner(const Vector2& p_point)
+    {
+        this->UpdateGrid();
 
-                Vector2 entry = get_closest_point_to_segment_2d(begin_poly->entry, edge);
-                begin_poly->edges[i].C->distance = (begin_poly->entry - entry).Magnitude();
-                begin_poly->edges[i].C->entry = entry;
-#else
-                begin_poly->edges[i].C->distance = (begin_poly->center - begin_poly->edges[i].C->center).Magnitude();
-#endif
-                open_list.push_back(begin_poly->edges[i].C);
+        Vector2 closest_point;
+        Polygon* p = this->GetClosestPolygon(m_query, p_point, closest_point);
+        if (p)
+            return p->owner->owner;
+        return nullptr;
+    }
 
-                if (begin_poly->edges[i].C == end_poly)
-                {
-                    found_route = true;
-                }
-            }
-        }
+    void Navigation2D::HeapSiftUp(QueryContext& p_context, int p_heap_index) const
+    {
+        std::vector<int>& heap = p_context.heap;
+        std::vector<NodeState>& nodes = p_context.nodes;
+        int index = heap[p_heap_index];
+        float cost = nodes[index].cost;
 
-        while (!found_route)
+        while (p_heap_index > 0)
         {
-            if (open_list.size() == 0)
-            {
+            int parent = (p_heap_index - 1) / 2;
+            if (nodes[heap[parent]].cost <= cost)
                 break;
-            }
-            //check open list
-
-            Polygon* least_cost_poly = nullptr;
-            float least_cost = 1e30f;
+            heap[p_heap_index] = heap[parent];
+            nodes[heap[p_heap_index]].heap_index = p_heap_index;
+            p_heap_index = parent;
+        }
+        heap[p_heap_index] = index;
+        nodes[index].heap_index = p_heap_index;
+    }
 
-            //this could be faster (cache previous results)
-            for (auto& E : open_list)
-            {
-                Polygon* p = E;
+    void Navigation2D::HeapSiftDown(QueryContext& p_context, int p_heap_index) const
+    {
+        std::vector<int>& heap = p_context.heap;
+        std::vector<NodeState>& nodes = p_context.nodes;
+        int size = (int) heap.size();
+        int index = heap[p_heap_index];
+        float cost = nodes[index].cost;
 
-                float cost = p->distance;
+        while (true)
+        {
+            int child = p_heap_index * 2 + 1;
+            if (child >= size)
+                break;
+            if (child + 1 < size && nodes[heap[child + 1]].cost < nodes[heap[child]].cost)
+                child++;
+            if (cost <= nodes[heap[child]].cost)
+                break;
+            heap[p_heap_index] = heap[child];
+            nodes[heap[p_heap_index]].heap_index = p_heap_index;
+            p_heap_index = child;
+        }
+        heap[p_heap_index] = index;
+        nodes[index].heap_index = p_heap_index;
+    }
 
-#ifdef USE_ENTRY_POINT
-                int es = (int) p->edges.size();
+    void Navigation2D::HeapPush(QueryContext& p_context, int p_index) const
+    {
+        p_context.heap.push_back(p_index);
+        this->HeapSiftUp(p_context, (int) p_context.heap.size() - 1);
+    }
 
-                float shortest_distance = 1e30f;
+    int Navigation2D::HeapPop(QueryContext& p_context) const
+    {
+        std::vector<int>& heap = p_context.heap;
+        int top = heap[0];
+        p_context.nodes[top].heap_index = -1;
 
-                for (int i = 0; i < es; i++)
-                {
-                    Polygon::Edge& e = p->edges[i];
+        int last = heap.back();
+        heap.pop_back();
+        if (heap.size() > 0)
+        {
+            heap[0] = last;
+            this->HeapSiftDown(p_context, 0);
+        }
 
-                    if (!e.C)
-                        continue;
+        return top;
+    }
 
-                    Vector2 edge[2] = {
-                        this->GetVertex(p->edges[i].point),
-                        this->GetVertex(p->edges[(i + 1) % es].point)
-                    };
+    bool Navigation2D::FindCorridor(QueryContext& p_context, Polygon* p_begin, Polygon* p_end, const Vector2& p_start, const Vector2& p_end_point, std::vector<CorridorStep>& r_corridor) const
+    {
+        this->BeginQuery(p_context);
+        uint32_t stamp = p_context.stamp;
+        std::vector<NodeState>& nodes = p_context.nodes;
+
+        NodeState& begin = nodes[p_begin->index];
+        begin.stamp = stamp;
+        begin.prev_edge = -1;
+        begin.distance = 0;
+        begin.cost = 0;
+        begin.entry = p_start;
+        this->HeapPush(p_context, p_begin->index);
 
-                    Vector2 edge_point = get_closest_point_to_segment_2d(p->entry, edge);
-                    float dist = (p->entry - edge_point).Magnitude();
-                    if (dist < shortest_distance)
-                        shortest_distance = dist;
-                }
+        bool found_route = false;
 
-                cost += shortest_distance;
-#else
-                cost += (p->center - end_point).Magnitude();
-#endif
-                if (cost < least_cost)
-                {
-                    least_cost_poly = E;
-                    least_cost = cost;
-                }
+        while (p_context.heap.size() > 0)
+        {
+            Polygon* p = m_polygons[this->HeapPop(p_context)];
+            if (p == p_end)
+            {
+                found_route = true;
+                break;
             }
 
-            Polygon* p = least_cost_poly;
+            const NodeState& state = nodes[p->index];
+
             //open the neighbours for search
             int es = (int) p->edges.size();
 
             for (int i = 0; i < es; i++)
             {
-                Polygon::Edge& e = p->edges[i];
+                const Polygon::Edge& e = p->edges[i];
 
                 if (!e.C)
                     continue;
@@ -573,182 +763,284 @@ namespace Viry3D
                     this->GetVertex(p->edges[(i + 1) % es].point)
                 };
 
-                Vector2 edge_entry = get_closest_point_to_segment_2d(p->entry, edge);
-                float distance = (p->entry - edge_entry).Magnitude() + p->distance;
+                Vector2 edge_entry = get_closest_point_to_segment_2d(state.entry, edge);
+                float distance = (state.entry - edge_entry).Magnitude() + state.distance;
+                float estimate = (edge_entry - p_end_point).Magnitude();
 #else
-                float distance = (p->center - e.C->center).Magnitude() + p->distance;
+                float distance = (p->center - e.C->center).Magnitude() + state.distance;
+                float estimate = (e.C->center - p_end_point).Magnitude();
 #endif
 
-                if (e.C->prev_edge != -1)
-                {
-                    //oh this was visited already, can we win the cost?
+                NodeState& next = nodes[e.C->index];
+                bool visited = next.stamp == stamp;
+                if (visited && next.distance <= distance)
+                    continue;
 
-                    if (e.C->distance > distance)
-                    {
-                        e.C->prev_edge = e.C_edge;
-                        e.C->distance = distance;
+                next.prev_edge = e.C_edge;
+                next.distance = distance;
+                next.cost = distance + estimate;
 #ifdef USE_ENTRY_POINT
-                        e.C->entry = edge_entry;
+                next.entry = edge_entry;
 #endif
-                    }
+
+                if (visited && next.heap_index >= 0)
+                {
+                    this->HeapSiftUp(p_context, next.heap_index);
                 }
                 else
                 {
-                    //add to open neighbours
-
-                    e.C->prev_edge = e.C_edge;
-                    e.C->distance = distance;
-#ifdef USE_ENTRY_POINT
-                    e.C->entry = edge_entry;
-#endif
-
-                    open_list.push_back(e.C);
-
-                    if (e.C == end_poly)
-                    {
-                        //oh my reached end! stop algorithm
-                        found_route = true;
-                        break;
-                    }
+                    next.stamp = stamp;
+                    this->HeapPush(p_context, e.C->index);
                 }
             }
+        }
 
-            if (found_route)
-                break;
+        r_corridor.clear();
 
-            open_list.remove(least_cost_poly);
+        if (!found_route)
+            return false;
+
+        // walk back from the end, the last step is the begin polygon
+        Polygon* p = p_end;
+        while (p != p_begin)
+        {
+            CorridorStep step;
+            step.polygon = p;
+            step.prev_edge = nodes[p->index].prev_edge;
+            r_corridor.push_back(step);
+            p = p->edges[step.prev_edge].C;
         }
 
-        if (found_route)
+        CorridorStep step;
+        step.polygon = p_begin;
+        step.prev_edge = -1;
+        r_corridor.push_back(step);
+
+        return true;
+    }
+
+    std::vector<Vector2> Navigation2D::BuildPath(const std::vector<CorridorStep>& p_corridor, const Vector2& p_begin_point, const Vector2& p_end_point, bool p_optimize) const
+    {
+        std::vector<Vector2> path;
+        int begin = (int) p_corridor.size() - 1;
+
+        if (p_optimize)
         {
-            std::vector<Vector2> path;
+            //string pulling
+
+            Vector2 apex_point = p_end_point;
+            Vector2 portal_left = apex_point;
+            Vector2 portal_right = apex_point;
+            int left_step = 0;
+            int right_step = 0;
+            int k = 0;
 
-            if (p_optimize)
+            while (k >= 0)
             {
-                //string pulling
+                Vector2 left;
+                Vector2 right;
 
-                Vector2 apex_point = end_point;
-                Vector2 portal_left = apex_point;
-                Vector2 portal_right = apex_point;
-                Polygon* left_poly = end_poly;
-                Polygon* right_poly = end_poly;
-                Polygon* p = end_poly;
+#define CLOCK_TANGENT(m_a, m_b, m_c) ((((m_a).x - (m_c).x) * ((m_b).y - (m_c).y) - ((m_b).x - (m_c).x) * ((m_a).y - (m_c).y)))
 
-                while (p)
+                if (k == begin)
+                {
+                    left = p_begin_point;
+                    right = p_begin_point;
+                }
+                else
                 {
-                    Vector2 left;
-                    Vector2 right;
+                    const Polygon* p = p_corridor[k].polygon;
+                    int prev = p_corridor[k].prev_edge;
+                    int prev_n = (prev + 1) % p->edges.size();
+                    left = this->GetVertex(p->edges[prev].point);
+                    right = this->GetVertex(p->edges[prev_n].point);
 
-#define CLOCK_TANGENT(m_a, m_b, m_c) ((((m_a).x - (m_c).x) * ((m_b).y - (m_c).y) - ((m_b).x - (m_c).x) * ((m_a).y - (m_c).y)))
+                    if (p->clockwise)
+                    {
+                        std::swap(left, right);
+                    }
+                }
+
+                bool skip = false;
 
-                    if (p == begin_poly)
+                if (CLOCK_TANGENT(apex_point, portal_left, left) >= 0)
+                {
+                    //process
+                    if ((portal_left - apex_point).Magnitude() < CMP_EPSILON || CLOCK_TANGENT(apex_point, left, portal_right) > 0)
                     {
-                        left = begin_point;
-                        right = begin_point;
+                        left_step = k;
+                        portal_left = left;
                     }
                     else
                     {
-                        int prev = p->prev_edge;
-                        int prev_n = (p->prev_edge + 1) % p->edges.size();
-                        left = this->GetVertex(p->edges[prev].point);
-                        right = this->GetVertex(p->edges[prev_n].point);
-
-                        if (p->clockwise)
-                        {
-                            std::swap(left, right);
-                        }
+                        apex_point = portal_right;
+                        k = right_step;
+                        left_step = k;
+                        portal_left = apex_point;
+                        portal_right = apex_point;
+                        if (!path.size() || (path[path.size() - 1] - apex_point).Magnitude() > CMP_EPSILON)
+                            path.push_back(apex_point);
+                        skip = true;
                     }
+                }
 
-                    bool skip = false;
-
-                    if (CLOCK_TANGENT(apex_point, portal_left, left) >= 0)
+                if (!skip && CLOCK_TANGENT(apex_point, portal_right, right) <= 0)
+                {
+                    //process
+                    if ((portal_right - apex_point).Magnitude() < CMP_EPSILON || CLOCK_TANGENT(apex_point, right, portal_left) < 0)
                     {
-                        //process
-                        if ((portal_left - apex_point).Magnitude() < CMP_EPSILON || CLOCK_TANGENT(apex_point, left, portal_right) > 0)
-                        {
-                            left_poly = p;
-                            portal_left = left;
-                        }
-                        else
-                        {
-                            apex_point = portal_right;
-                            p = right_poly;
-                            left_poly = p;
-                            portal_left = apex_point;
-                            portal_right = apex_point;
-                            if (!path.size() || (path[path.size() - 1] - apex_point).Magnitude() > CMP_EPSILON)
-                                path.push_back(apex_point);
-                            skip = true;
-                        }
+                        right_step = k;
+                        portal_right = right;
                     }
-
-                    if (!skip && CLOCK_TANGENT(apex_point, portal_right, right) <= 0)
+                    else
                     {
-                        //process
-                        if ((portal_right - apex_point).Magnitude() < CMP_EPSILON || CLOCK_TANGENT(apex_point, right, portal_left) < 0)
-                        {
-                            right_poly = p;
-                            portal_right = right;
-                        }
-                        else
-                        {
-                            apex_point = portal_left;
-                            p = left_poly;
-                            right_poly = p;
-                            portal_right = apex_point;
-                            portal_left = apex_point;
-                            if (!path.size() || (path[path.size() - 1] - apex_point).Magnitude() > CMP_EPSILON)
-                                path.push_back(apex_point);
-                        }
+                        apex_point = portal_left;
+                        k = left_step;
+                        right_step = k;
+                        portal_right = apex_point;
+                        portal_left = apex_point;
+                        if (!path.size() || (path[path.size() - 1] - apex_point).Magnitude() > CMP_EPSILON)
+                            path.push_back(apex_point);
                     }
-
-                    if (p != begin_poly)
-                        p = p->edges[p->prev_edge].C;
-                    else
-                        p = nullptr;
                 }
 
+                if (k != begin)
+                    k++;
+                else
+                    k = -1;
             }
-            else
+        }
+        else
+        {
+            //midpoints
+            for (int k = 0; k < begin; k++)
             {
-                //midpoints
-                Polygon* p = end_poly;
-
-                while (true)
-                {
-                    int prev = p->prev_edge;
-                    int prev_n = (p->prev_edge + 1) % p->edges.size();
-                    Vector2 point = (this->GetVertex(p->edges[prev].point) + this->GetVertex(p->edges[prev_n].point)) * 0.5;
-                    path.push_back(point);
-                    p = p->edges[prev].C;
-                    if (p == begin_poly)
-                        break;
-                }
+                const Polygon* p = p_corridor[k].polygon;
+                int prev = p_corridor[k].prev_edge;
+                int prev_n = (prev + 1) % p->edges.size();
+                Vector2 point = (this->GetVertex(p->edges[prev].point) + this->GetVertex(p->edges[prev_n].point)) * 0.5;
+                path.push_back(point);
             }
+        }
+
+        if (!path.size() || (path[path.size() - 1] - p_begin_point).Magnitude() > CMP_EPSILON)
+        {
+            path.push_back(p_begin_point); // Add the begin point
+        }
+        else
+        {
+            path[path.size() - 1] = p_begin_point; // Replace first midpoint by the exact begin point
+        }
+
+        std::reverse(path.begin(), path.end());
+
+        if (path.size() <= 1 || (path[path.size() - 1] - p_end_point).Magnitude() > CMP_EPSILON)
+        {
+            path.push_back(p_end_point); // Add the end point
+        }
+        else
+        {
+            path[path.size() - 1] = p_end_point; // Replace last midpoint by the exact end point
+        }
 
-            if (!path.size() || (path[path.size() - 1] - begin_point).Magnitude() > CMP_EPSILON)
+        return path;
+    }
+
+    std::vector<Vector2> Navigation2D::GetSimplePath(QueryContext& p_context, const Vector2& p_start, const Vector2& p_end, bool p_optimize)
+    {
+        Vector2 begin_point;
+        Vector2 end_point;
+        Polygon* begin_poly = this->GetClosestPolygon(p_context, p_start, begin_point);
+        Polygon* end_poly = this->GetClosestPolygon(p_context, p_end, end_point);
+
+        if (!begin_poly || !end_poly)
+        {
+            return std::vector<Vector2>(); //no path
+        }
+
+        if (begin_poly == end_poly)
+        {
+            std::vector<Vector2> path;
+            path.resize(2);
+            path[0] = begin_point;
+            path[1] = end_point;
+            return path;
+        }
+
+        std::vector<CorridorStep> corridor;
+        uint64_t key = ((uint64_t) begin_poly->index << 32) | (uint64_t) end_poly->index;
+
+        if (m_path_cache_enabled)
+        {
+            std::lock_guard<std::mutex> lock(m_path_cache_mutex);
+            auto cached = m_path_cache.find(key);
+            if (cached != m_path_cache.end())
+                corridor = cached->second;
+        }
+
+        if (corridor.size() == 0)
+        {
+            if (!this->FindCorridor(p_context, begin_poly, end_poly, p_start, end_point, corridor))
             {
-                path.push_back(begin_point); // Add the begin point
+                return std::vector<Vector2>();
             }
-            else
+
+            if (m_path_cache_enabled)
             {
-                path[path.size() - 1] = begin_point; // Replace first midpoint by the exact begin point
+                std::lock_guard<std::mutex> lock(m_path_cache_mutex);
+                if (m_path_cache.size() >= NAVIGATION_2D_PATH_CACHE_SIZE)
+                    m_path_cache.clear();
+                m_path_cache[key] = corridor;
             }
+        }
 
-            std::reverse(path.begin(), path.end());
+        return this->BuildPath(corridor, begin_point, end_point, p_optimize);
+    }
 
-            if (path.size() <= 1 || (path[path.size() - 1] - end_point).Magnitude() > CMP_EPSILON)
-            {
-                path.push_back(end_point); // Add the end point
-            }
-            else
+    std::vector<Vector2> Navigation2D::GetSimplePath(const Vector2& p_start, const Vector2& p_end, bool p_optimize)
+    {
+        this->UpdateGrid();
+
+        return this->GetSimplePath(m_query, p_start, p_end, p_optimize);
+    }
+
+    void Navigation2D::GetSimplePaths(std::vector<NavigationPathRequest>& p_requests)
+    {
+        // the graph is only read from here on
+        this->UpdateGrid();
+
+        std::atomic<int> next(0);
+        auto job = [&](QueryContext& context) {
+            while (true)
             {
-                path[path.size() - 1] = end_point; // Replace last midpoint by the exact end point
+                int index = next++;
+                if (index >= (int) p_requests.size())
+                {
+                    break;
+                }
+                NavigationPathRequest& request = p_requests[index];
+                request.path = this->GetSimplePath(context, request.start, request.end, request.optimize);
             }
+        };
 
-            return path;
+        ThreadPool* thread_pool = Engine::Instance() ? Engine::Instance()->GetThreadPool() : nullptr;
+        if (thread_pool)
+        {
+            int worker_count = std::min(thread_pool->GetThreadCount() + 1, (int) p_requests.size());
+            std::vector<QueryContext> contexts(std::max(worker_count - 1, 0));
+            thread_pool->ParallelRun(worker_count, [&](int worker) {
+                job(worker == 0 ? m_query : contexts[worker - 1]);
+            });
+        }
+        else
+        {
+            job(m_query);
         }
+    }
 
-        return std::vector<Vector2>();
+    void Navigation2D::SetPathCacheEnabled(bool p_enabled)
+    {
+        m_path_cache_enabled = p_enabled;
+        m_path_cache.clear();
     }
 }
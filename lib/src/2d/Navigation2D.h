@@ -22,12 +22,32 @@
 #include <list>
 #include <vector>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
 #include <cmath>
 
+#define NAVIGATION_2D_GRID_MAX_CELLS 65536
+#define NAVIGATION_2D_PATH_CACHE_SIZE 4096
+
 namespace Viry3D
 {
     class NavigationPolygon;
 
+    struct NavigationPathRequest
+    {
+        Vector2 start;
+        Vector2 end;
+        bool optimize;
+        std::vector<Vector2> path;
+
+        NavigationPathRequest(const Vector2& p_start = Vector2(), const Vector2& p_end = Vector2(), bool p_optimize = true):
+            start(p_start),
+            end(p_end),
+            optimize(p_optimize)
+        {
+        }
+    };
+
     struct Transform2D
     {
         Vector2 elements[3];
@@ -94,6 +114,11 @@ namespace Viry3D
                 return (a.key == p_key.a.key) ? (b.key < p_key.b.key) : (a.key < p_key.a.key);
             }
 
+            bool operator ==(const EdgeKey& p_key) const
+            {
+                return a.key == p_key.a.key && b.key == p_key.b.key;
+            }
+
             EdgeKey(const Point& p_a = Point(), const Point& p_b = Point()):
                 a(p_a),
                 b(p_b)
@@ -105,6 +130,16 @@ namespace Viry3D
             }
         };
 
+        struct EdgeKeyHash
+        {
+            size_t operator ()(const EdgeKey& p_key) const
+            {
+                uint64_t h = p_key.a.key * 0x9E3779B97F4A7C15ULL;
+                h ^= p_key.b.key + 0x7F4A7C159E3779B9ULL + (h << 6) + (h >> 2);
+                return (size_t) (h ^ (h >> 32));
+            }
+        };
+
         struct Polygon;
         struct NavMesh;
 
@@ -133,9 +168,9 @@ namespace Viry3D
 
             std::vector<Edge> edges;
             Vector2 center;
-            Vector2 entry;
-            float distance;
-            int prev_edge;
+            Vector2 bounds_min;
+            Vector2 bounds_max;
+            int index;
             bool clockwise;
             NavMesh* owner;
         };
@@ -164,14 +199,51 @@ namespace Viry3D
             bool linked;
             std::shared_ptr<NavigationPolygon> navpoly;
             std::list<Polygon> polygons;
+            // linked polygon of each navpoly slot and the slot version it was built from
+            std::vector<std::list<Polygon>::iterator> slots;
+            std::vector<uint32_t> versions;
+        };
+
+        // per search state, kept out of the polygons so queries can run concurrently
+        struct NodeState
+        {
+            Vector2 entry;
+            float distance;
+            float cost;
+            int prev_edge;
+            int heap_index;
+            uint32_t stamp;
+        };
+
+        struct QueryContext
+        {
+            std::vector<NodeState> nodes;
+            std::vector<int> heap;
+            uint32_t stamp;
+
+            QueryContext():
+                stamp(0)
+            {
+            }
+        };
+
+        struct CorridorStep
+        {
+            Polygon* polygon;
+            int prev_edge;
         };
 
     public:
         Navigation2D();
         int NavpolyAdd(const std::shared_ptr<NavigationPolygon>& p_mesh, const Transform2D& p_xform, void* p_owner = nullptr);
         void NavpolySetTransform(int p_id, const Transform2D& p_xform);
+        // relink after the mesh was rebaked, only polygons whose version changed are relinked
+        void NavpolyUpdate(int p_id);
         void NavpolyRemove(int p_id);
         std::vector<Vector2> GetSimplePath(const Vector2& p_start, const Vector2& p_end, bool p_optimize = true);
+        // resolves all requests in parallel, each path is written back to its request
+        void GetSimplePaths(std::vector<NavigationPathRequest>& p_requests);
+        void SetPathCacheEnabled(bool p_enabled);
         Vector2 GetClosestPoint(const Vector2& p_point);
         void* GetClosestPointOwner(const Vector2& p_point);
 
@@ -195,11 +267,43 @@ namespace Viry3D
 
         void NavpolyLink(int p_id);
         void NavpolyUnlink(int p_id);
+        void LinkPolygon(NavMesh& nm, int p_slot);
+        void UnlinkPolygon(NavMesh& nm, int p_slot);
+        void GridInsert(Polygon* p_poly);
+        void GridRemove(Polygon* p_poly);
+        bool GetGridRange(const Polygon* p_poly, int& r_x0, int& r_y0, int& r_x1, int& r_y1) const;
+        void UpdateGrid();
+        void BeginQuery(QueryContext& p_context) const;
+        bool IsPointInPolygon(const Polygon& p_poly, const Vector2& p_point) const;
+        Polygon* GetPolygonAt(const Vector2& p_point) const;
+        Polygon* GetClosestPolygon(QueryContext& p_context, const Vector2& p_point, Vector2& r_closest) const;
+        void HeapPush(QueryContext& p_context, int p_index) const;
+        int HeapPop(QueryContext& p_context) const;
+        void HeapSiftUp(QueryContext& p_context, int p_heap_index) const;
+        void HeapSiftDown(QueryContext& p_context, int p_heap_index) const;
+        bool FindCorridor(QueryContext& p_context, Polygon* p_begin, Polygon* p_end, const Vector2& p_start, const Vector2& p_end_point, std::vector<CorridorStep>& r_corridor) const;
+        std::vector<Vector2> BuildPath(const std::vector<CorridorStep>& p_corridor, const Vector2& p_begin_point, const Vector2& p_end_point, bool p_optimize) const;
+        std::vector<Vector2> GetSimplePath(QueryContext& p_context, const Vector2& p_start, const Vector2& p_end, bool p_optimize);
 
     private:
-        std::map<EdgeKey, Connection> m_connections;
+        std::unordered_map<EdgeKey, Connection, EdgeKeyHash> m_connections;
         float m_cell_size;
         std::map<int, NavMesh> m_navpoly_map;
         int m_last_id;
+        QueryContext m_query;
+        // polygons by index, unlinked indices are null and reused
+        std::vector<Polygon*> m_polygons;
+        std::vector<int> m_free_indices;
+        // corridors keyed by begin and end polygon index, cleared whenever the graph changes
+        bool m_path_cache_enabled;
+        std::unordered_map<uint64_t, std::vector<CorridorStep>> m_path_cache;
+        std::mutex m_path_cache_mutex;
+        // uniform grid over polygon bounds, patched per polygon and only rebuilt when a polygon falls outside
+        bool m_grid_dirty;
+        Vector2 m_grid_min;
+        float m_grid_cell;
+        int m_grid_width;
+        int m_grid_height;
+        std::vector<std::vector<Polygon*>> m_grid_cells;
     };
 }
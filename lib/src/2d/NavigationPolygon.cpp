@@ -19,9 +19,14 @@
 #include "Navigation2D.h"
 #include "Debug.h"
 #include "math/Mathf.h"
+#include "Engine.h"
+#include "thread/ThreadPool.h"
 #include <list>
 #include <map>
+#include <unordered_map>
 #include <algorithm>
+#include <atomic>
+#include <climits>
 
 namespace Viry3D
 {
@@ -86,35 +91,6 @@ namespace Viry3D
         }
     }
 
-    static bool segment_intersects_segment_2d(const Vector2& p_from_a, const Vector2& p_to_a, const Vector2& p_from_b, const Vector2& p_to_b, Vector2* r_result)
-    {
-        Vector2 B = p_to_a - p_from_a;
-        Vector2 C = p_from_b - p_from_a;
-        Vector2 D = p_to_b - p_from_a;
-
-        float ABlen = B.Dot(B);
-        if (ABlen <= 0)
-            return false;
-        Vector2 Bn = B * (1.0f / ABlen);
-        C = Vector2(C.x * Bn.x + C.y * Bn.y, C.y * Bn.x - C.x * Bn.y);
-        D = Vector2(D.x * Bn.x + D.y * Bn.y, D.y * Bn.x - D.x * Bn.y);
-
-        if ((C.y < 0 && D.y < 0) || (C.y >= 0 && D.y >= 0))
-            return false;
-
-        float ABpos = D.x + (C.x - D.x) * D.y / (D.y - C.y);
-
-        //  Fail if segment C-D crosses line A-B outside of segment A-B.
-        if (ABpos < 0 || ABpos > 1.0)
-            return false;
-
-        //  (4) Apply the discovered position to line A-B in the original coordinate system.
-        if (r_result)
-            *r_result = p_from_a + B * ABpos;
-
-        return true;
-    }
-
     static bool snip(const std::vector<Vector2>& p_contour, int u, int v, int w, int n, const std::vector<int>& V, bool relaxed)
     {
         int p;
@@ -256,49 +232,236 @@ namespace Viry3D
         return false;
     }
 
+    static Rect2 get_outline_bounds(const std::vector<Vector2>& p_outline)
+    {
+        Rect2 bounds;
+        if (p_outline.size() > 0)
+        {
+            bounds.pos = p_outline[0];
+            for (int i = 1; i < (int) p_outline.size(); i++)
+                bounds.ExpandTo(p_outline[i]);
+        }
+        return bounds;
+    }
+
+    static bool is_rect_overlap(const Rect2& a, const Rect2& b)
+    {
+        return a.pos.x <= b.pos.x + b.size.x && b.pos.x <= a.pos.x + a.size.x &&
+            a.pos.y <= b.pos.y + b.size.y && b.pos.y <= a.pos.y + a.size.y;
+    }
+
+    // even odd crossing test, the same parity the outer outline test relies on
+    static bool is_point_in_outline(const Vector2& p_point, const std::vector<Vector2>& p_outline)
+    {
+        bool inside = false;
+        int count = (int) p_outline.size();
+        for (int i = 0, j = count - 1; i < count; j = i++)
+        {
+            const Vector2& a = p_outline[i];
+            const Vector2& b = p_outline[j];
+            if ((a.y > p_point.y) != (b.y > p_point.y) &&
+                p_point.x < (b.x - a.x) * (p_point.y - a.y) / (b.y - a.y) + a.x)
+                inside = !inside;
+        }
+        return inside;
+    }
+
+    static uint64_t get_tile_key(int x, int y)
+    {
+        return ((uint64_t) (uint32_t) x << 32) | (uint64_t) (uint32_t) y;
+    }
+
     NavigationPolygon::NavigationPolygon():
-        m_rect_cache_dirty(true)
+        m_rect_cache_dirty(true),
+        m_tile_size(NAVIGATION_POLYGON_TILE_SIZE),
+        m_bake_all(true),
+        m_version(0)
     {
 
     }
 
+    void NavigationPolygon::MarkTilesDirty(const Rect2& p_bounds)
+    {
+        if (m_bake_all)
+            return;
+
+        int x0 = (int) floor(p_bounds.pos.x / m_tile_size);
+        int y0 = (int) floor(p_bounds.pos.y / m_tile_size);
+        int x1 = (int) floor((p_bounds.pos.x + p_bounds.size.x) / m_tile_size);
+        int y1 = (int) floor((p_bounds.pos.y + p_bounds.size.y) / m_tile_size);
+
+        for (int y = y0; y <= y1; y++)
+        {
+            for (int x = x0; x <= x1; x++)
+            {
+                m_dirty_tiles.insert(get_tile_key(x, y));
+            }
+        }
+    }
+
     void NavigationPolygon::AddOutline(const std::vector<Vector2>& p_outline)
     {
         m_outlines.push_back(p_outline);
+        m_outline_bounds.push_back(get_outline_bounds(p_outline));
+        m_outline_holes.push_back(-1);
+        this->MarkTilesDirty(m_outline_bounds.back());
         m_rect_cache_dirty = true;
     }
 
     void NavigationPolygon::AddOutlineAtIndex(const std::vector<Vector2>& p_outline, int p_index)
     {
         m_outlines.insert(m_outlines.begin() + p_index, p_outline);
+        m_outline_bounds.insert(m_outline_bounds.begin() + p_index, get_outline_bounds(p_outline));
+        m_outline_holes.insert(m_outline_holes.begin() + p_index, -1);
+        this->MarkTilesDirty(m_outline_bounds[p_index]);
         m_rect_cache_dirty = true;
     }
 
     void NavigationPolygon::SetOutline(int p_idx, const std::vector<Vector2>& p_outline)
     {
+        this->MarkTilesDirty(m_outline_bounds[p_idx]);
         m_outlines[p_idx] = p_outline;
+        m_outline_bounds[p_idx] = get_outline_bounds(p_outline);
+        this->MarkTilesDirty(m_outline_bounds[p_idx]);
         m_rect_cache_dirty = true;
     }
 
     void NavigationPolygon::RemoveOutline(int p_idx)
     {
+        this->MarkTilesDirty(m_outline_bounds[p_idx]);
         m_outlines.erase(m_outlines.begin() + p_idx);
+        m_outline_bounds.erase(m_outline_bounds.begin() + p_idx);
+        m_outline_holes.erase(m_outline_holes.begin() + p_idx);
         m_rect_cache_dirty = true;
     }
 
     void NavigationPolygon::ClearOutlines()
     {
         m_outlines.clear();
+        m_outline_bounds.clear();
+        m_outline_holes.clear();
+        m_bake_all = true;
         m_rect_cache_dirty = true;
     }
 
+    void NavigationPolygon::SetOutlines(const std::vector<std::vector<Vector2>>& p_array)
+    {
+        m_outlines = p_array;
+        m_outline_bounds.resize(m_outlines.size());
+        for (int i = 0; i < (int) m_outlines.size(); i++)
+            m_outline_bounds[i] = get_outline_bounds(m_outlines[i]);
+        m_outline_holes.assign(m_outlines.size(), -1);
+        m_bake_all = true;
+        m_rect_cache_dirty = true;
+    }
+
+    void NavigationPolygon::SetTileSize(float p_size)
+    {
+        if (m_tile_size == p_size)
+            return;
+        m_tile_size = p_size;
+        m_bake_all = true;
+    }
+
+    void NavigationPolygon::SetVertices(const std::vector<Vector2>& p_vertices)
+    {
+        m_vertices = p_vertices;
+        m_rect_cache_dirty = true;
+        m_bake_all = true;
+
+        // every polygon may have moved
+        for (auto& polygon : m_polygons)
+        {
+            polygon.version = ++m_version;
+        }
+    }
+
     void NavigationPolygon::AddPolygon(const std::vector<int>& p_polygon)
     {
         Polygon polygon;
         polygon.indices = p_polygon;
+        polygon.version = ++m_version;
         m_polygons.push_back(polygon);
     }
 
+    void NavigationPolygon::SetPolygons(const std::vector<Polygon>& p_array)
+    {
+        m_polygons = p_array;
+        m_bake_all = true;
+
+        for (auto& polygon : m_polygons)
+        {
+            polygon.version = ++m_version;
+        }
+    }
+
+    int NavigationPolygon::AddPolygonSlot()
+    {
+        if (m_free_polygons.size() > 0)
+        {
+            int slot = m_free_polygons.back();
+            m_free_polygons.pop_back();
+            return slot;
+        }
+
+        m_polygons.push_back(Polygon());
+        return (int) m_polygons.size() - 1;
+    }
+
+    void NavigationPolygon::SetPolygonSlot(int p_slot, const std::vector<int>& p_indices)
+    {
+        Polygon& polygon = m_polygons[p_slot];
+        if (polygon.version != 0 && polygon.indices == p_indices)
+            return;
+
+        polygon.indices = p_indices;
+        polygon.version = ++m_version;
+    }
+
+    int NavigationPolygon::AddVertex(const Vector2& p_point)
+    {
+        // tiles cut shared edges at identical points, so vertices merge on exact bits
+        uint32_t bits[2];
+        memcpy(bits, &p_point, sizeof(bits));
+        uint64_t key = ((uint64_t) bits[0] << 32) | bits[1];
+
+        auto E = m_vertex_map.find(key);
+        if (E != m_vertex_map.end())
+        {
+            m_vertex_refs[E->second]++;
+            return E->second;
+        }
+
+        int index;
+        if (m_free_vertices.size() > 0)
+        {
+            index = m_free_vertices.back();
+            m_free_vertices.pop_back();
+            m_vertices[index] = p_point;
+            m_vertex_refs[index] = 1;
+        }
+        else
+        {
+            index = (int) m_vertices.size();
+            m_vertices.push_back(p_point);
+            m_vertex_refs.push_back(1);
+        }
+        m_vertex_map[key] = index;
+
+        return index;
+    }
+
+    void NavigationPolygon::ReleaseVertex(int p_index)
+    {
+        if (--m_vertex_refs[p_index] > 0)
+            return;
+
+        uint32_t bits[2];
+        memcpy(bits, &m_vertices[p_index], sizeof(bits));
+        m_vertex_map.erase(((uint64_t) bits[0] << 32) | bits[1]);
+        m_free_vertices.push_back(p_index);
+    }
+
 #define TRIANGULATOR_CCW 1
 #define TRIANGULATOR_CW -1
 
@@ -313,6 +476,14 @@ namespace Viry3D
         
         }
 
+        TriangulatorPoly(const TriangulatorPoly& src):
+            m_points(nullptr),
+            m_hole(false),
+            m_numpoints(0)
+        {
+            *this = src;
+        }
+
         ~TriangulatorPoly()
         {
             this->Clear();
@@ -918,76 +1089,173 @@ namespace Viry3D
         }
     };
     
-    static bool operator <(const Vector2& a, const Vector2& b) { return Mathf::FloatEqual(a.x, b.x) ? (a.y < b.y) : (a.x < b.x); }
-
-    void NavigationPolygon::MakePolygonsFromOutlines()
+    static float get_contour_area(const std::vector<Vector2>& p_contour)
     {
-        std::list<TriangulatorPoly> in_poly, out_poly;
+        float area = 0;
+        int count = (int) p_contour.size();
+        for (int i = 0; i < count; i++)
+        {
+            const Vector2& a = p_contour[i];
+            const Vector2& b = p_contour[(i + 1) % count];
+            area += a.x * b.y - a.y * b.x;
+        }
+        return area * 0.5f;
+    }
 
-        Vector2 outside_point(-1e10f, -1e10f);
+    // clip contours (outer ccw, holes cw) to the half plane n.p >= c,
+    // pieces cut open are reconnected along the line so holes crossing it merge into the boundary
+    static void clip_contours(std::vector<std::vector<Vector2>>& p_contours, const Vector2& n, float c)
+    {
+        std::vector<std::vector<Vector2>> result;
+        std::vector<std::vector<Vector2>> chains;
+        std::vector<float> sides;
 
-        for (int i = 0; i < (int) m_outlines.size(); i++)
+        for (auto& contour : p_contours)
         {
-            const auto& ol = m_outlines[i];
-            int olsize = (int) ol.size();
-            if (olsize < 3)
-                continue;
-            const auto& r = ol;
-            for (int j = 0; j < olsize; j++)
+            int count = (int) contour.size();
+            int inside = 0;
+            int first_out = -1;
+
+            sides.resize(count);
+            for (int i = 0; i < count; i++)
             {
-                outside_point.x = std::max(r[j].x, outside_point.x);
-                outside_point.y = std::max(r[j].y, outside_point.y);
+                sides[i] = n.Dot(contour[i]) - c;
+                if (sides[i] >= 0)
+                    inside++;
+                else if (first_out < 0)
+                    first_out = i;
             }
-        }
-
-        outside_point += Vector2(0.7239784f, 0.819238f); //avoid precision issues
 
-        for (int i = 0; i < (int) m_outlines.size(); i++)
-        {
-            const auto& ol = m_outlines[i];
-            int olsize = (int) ol.size();
-            if (olsize < 3)
+            if (inside == count)
+            {
+                result.push_back(contour);
+                continue;
+            }
+            if (inside == 0)
                 continue;
-            const auto& r = ol;
 
-            int interscount = 0;
-            //test if this is an outer outline
-            for (int k = 0; k < (int) m_outlines.size(); k++)
+            // start outside so every chain begins with an entry point on the line
+            for (int k = 0; k < count; k++)
             {
-                if (i == k)
-                    continue; //no self intersect
+                int a = (first_out + k) % count;
+                int b = (a + 1) % count;
+                bool a_in = sides[a] >= 0;
+                bool b_in = sides[b] >= 0;
 
-                const auto& ol2 = m_outlines[k];
-                int olsize2 = (int) ol2.size();
-                if (olsize2 < 3)
-                    continue;
-                const auto& r2 = ol2;
-
-                for (int l = 0; l < (int) olsize2; l++)
+                if (a_in && b_in)
+                {
+                    chains.back().push_back(contour[b]);
+                }
+                else if (a_in != b_in)
                 {
-                    if (segment_intersects_segment_2d(r[0], outside_point, r2[l], r2[(l + 1) % olsize2], nullptr))
+                    Vector2 cross = contour[a] + (contour[b] - contour[a]) * (sides[a] / (sides[a] - sides[b]));
+                    cross += n * (c - n.Dot(cross)); // land exactly on the tile border
+                    if (b_in)
+                    {
+                        chains.push_back(std::vector<Vector2>());
+                        chains.back().push_back(cross);
+                        chains.back().push_back(contour[b]);
+                    }
+                    else
                     {
-                        interscount++;
+                        chains.back().push_back(cross);
                     }
                 }
             }
+        }
 
-            bool outer = (interscount % 2) == 0;
-
-            TriangulatorPoly tp;
-            tp.Init(olsize);
-            for (int j = 0; j < olsize; j++)
+        // walking the line with the kept side on the left, each exit joins the next entry
+        Vector2 t(n.y, -n.x);
+        int chain_count = (int) chains.size();
+        std::vector<int> next(chain_count, -1);
+        for (int i = 0; i < chain_count; i++)
+        {
+            float exit = t.Dot(chains[i].back());
+            float best = 1e30f;
+            for (int j = 0; j < chain_count; j++)
             {
-                tp[j] = r[j];
+                float entry = t.Dot(chains[j].front());
+                if (entry >= exit && entry < best)
+                {
+                    best = entry;
+                    next[i] = j;
+                }
             }
+            if (next[i] < 0)
+                next[i] = i;
+        }
 
-            if (outer)
-                tp.SetOrientation(TRIANGULATOR_CCW);
-            else {
-                tp.SetOrientation(TRIANGULATOR_CW);
-                tp.SetHole(true);
+        std::vector<char> visited(chain_count, 0);
+        for (int i = 0; i < chain_count; i++)
+        {
+            if (visited[i])
+                continue;
+
+            std::vector<Vector2> contour;
+            int j = i;
+            while (!visited[j])
+            {
+                visited[j] = 1;
+                for (auto& point : chains[j])
+                {
+                    if (contour.size() == 0 || (contour.back() - point).SqrMagnitude() > CMP_EPSILON * CMP_EPSILON)
+                        contour.push_back(point);
+                }
+                j = next[j];
             }
 
+            while (contour.size() > 1 && (contour.back() - contour.front()).SqrMagnitude() <= CMP_EPSILON * CMP_EPSILON)
+                contour.pop_back();
+
+            if (contour.size() >= 3 && fabs(get_contour_area(contour)) > CMP_EPSILON)
+                result.push_back(contour);
+        }
+
+        p_contours.swap(result);
+    }
+
+    void NavigationPolygon::BakeTile(uint64_t p_key, const std::vector<int>& p_outlines, const std::vector<char>& p_holes, std::vector<std::vector<Vector2>>& r_polygons) const
+    {
+        r_polygons.clear();
+
+        int tile_x = (int) (uint32_t) (p_key >> 32);
+        int tile_y = (int) (uint32_t) (p_key & 0xffffffff);
+        float x0 = tile_x * m_tile_size;
+        float y0 = tile_y * m_tile_size;
+        float x1 = x0 + m_tile_size;
+        float y1 = y0 + m_tile_size;
+
+        std::vector<std::vector<Vector2>> contours;
+        for (int index : p_outlines)
+        {
+            const auto& ol = m_outlines[index];
+
+            // outer outlines ccw, holes cw, so the clip keeps the region on the left
+            std::vector<Vector2> contour = ol;
+            float area = get_contour_area(contour);
+            if ((area < 0) != (p_holes[index] == 1))
+                std::reverse(contour.begin(), contour.end());
+            contours.push_back(contour);
+        }
+
+        clip_contours(contours, Vector2(1, 0), x0);
+        clip_contours(contours, Vector2(-1, 0), -x1);
+        clip_contours(contours, Vector2(0, 1), y0);
+        clip_contours(contours, Vector2(0, -1), -y1);
+
+        if (contours.size() == 0)
+            return;
+
+        std::list<TriangulatorPoly> in_poly, out_poly;
+        for (auto& contour : contours)
+        {
+            TriangulatorPoly tp;
+            tp.Init((long) contour.size());
+            for (int j = 0; j < (int) contour.size(); j++)
+            {
+                tp[j] = contour[j];
+            }
+            tp.SetHole(tp.GetOrientation() == TRIANGULATOR_CW);
             in_poly.push_back(tp);
         }
 
@@ -995,32 +1263,328 @@ namespace Viry3D
         if (tpart.ConvexPartition_HM(&in_poly, &out_poly) == 0)
         {
             //failed!
-            Log("NavigationPolygon: Convex partition failed!");
+            Log("NavigationPolygon: Convex partition failed in tile %d %d!", tile_x, tile_y);
             return;
         }
 
-        m_polygons.clear();
-        m_vertices.resize(0);
-
-        std::map<Vector2, int> points;
         for (auto& I : out_poly)
         {
             TriangulatorPoly& tp = I;
-            struct Polygon p;
-
+            std::vector<Vector2> polygon(tp.GetNumPoints());
             for (int i = 0; i < (int) tp.GetNumPoints(); i++)
             {
-                auto E = points.find(tp[i]);
-                if (E == points.end())
+                polygon[i] = tp[i];
+            }
+            r_polygons.push_back(polygon);
+        }
+    }
+
+    void NavigationPolygon::MakePolygonsFromOutlines()
+    {
+        if (m_bake_all)
+        {
+            m_bake_all = false;
+            m_tiles.clear();
+            m_dirty_tiles.clear();
+            m_vertices.clear();
+            m_vertex_map.clear();
+            m_vertex_refs.clear();
+            m_free_vertices.clear();
+            m_free_polygons.clear();
+            m_outline_holes.assign(m_outlines.size(), -1);
+
+            // drop every slot, the versions of rebaked slots still change
+            for (int i = 0; i < (int) m_polygons.size(); i++)
+            {
+                m_free_polygons.push_back((int) m_polygons.size() - 1 - i);
+                this->SetPolygonSlot(i, std::vector<int>());
+            }
+
+            for (int i = 0; i < (int) m_outlines.size(); i++)
+            {
+                this->MarkTilesDirty(m_outline_bounds[i]);
+            }
+        }
+
+        if (m_dirty_tiles.size() == 0)
+            return;
+
+        // an outline is a hole when an odd number of other outlines contain it. only outlines
+        // starting inside a changed area can flip, and a flipped outline rebakes all its tiles
+        int outline_count = (int) m_outlines.size();
+        for (int i = 0; i < outline_count; i++)
+        {
+            if (m_outlines[i].size() < 3)
+                continue;
+
+            const Vector2& point = m_outlines[i][0];
+            uint64_t start_key = get_tile_key((int) floor(point.x / m_tile_size), (int) floor(point.y / m_tile_size));
+            if (m_outline_holes[i] >= 0 && m_dirty_tiles.count(start_key) == 0)
+                continue;
+
+            int count = 0;
+            for (int k = 0; k < outline_count; k++)
+            {
+                if (i == k || m_outlines[k].size() < 3)
+                    continue;
+
+                const Rect2& b = m_outline_bounds[k];
+                if (point.x < b.pos.x || point.y < b.pos.y || point.x > b.pos.x + b.size.x || point.y > b.pos.y + b.size.y)
+                    continue;
+
+                if (is_point_in_outline(point, m_outlines[k]))
+                    count++;
+            }
+
+            char hole = (count % 2) == 1;
+            if (hole != m_outline_holes[i])
+            {
+                m_outline_holes[i] = hole;
+                this->MarkTilesDirty(m_outline_bounds[i]);
+            }
+        }
+
+        std::vector<uint64_t> keys(m_dirty_tiles.begin(), m_dirty_tiles.end());
+        m_dirty_tiles.clear();
+
+        // outlines overlapping each dirty tile
+        std::vector<std::vector<int>> tile_outlines(keys.size());
+        for (int i = 0; i < (int) keys.size(); i++)
+        {
+            int tile_x = (int) (uint32_t) (keys[i] >> 32);
+            int tile_y = (int) (uint32_t) (keys[i] & 0xffffffff);
+            Rect2 rect(Vector2(tile_x * m_tile_size, tile_y * m_tile_size), Vector2(m_tile_size, m_tile_size));
+
+            for (int j = 0; j < outline_count; j++)
+            {
+                if (m_outlines[j].size() >= 3 && is_rect_overlap(rect, m_outline_bounds[j]))
+                {
+                    tile_outlines[i].push_back(j);
+                }
+            }
+        }
+
+        std::vector<std::vector<std::vector<Vector2>>> baked(keys.size());
+        std::atomic<int> next(0);
+        auto job = [&](int) {
+            while (true)
+            {
+                int index = next++;
+                if (index >= (int) keys.size())
+                {
+                    break;
+                }
+                this->BakeTile(keys[index], tile_outlines[index], m_outline_holes, baked[index]);
+            }
+        };
+
+        ThreadPool* thread_pool = Engine::Instance() ? Engine::Instance()->GetThreadPool() : nullptr;
+        if (thread_pool)
+        {
+            thread_pool->ParallelRun((int) keys.size(), job);
+        }
+        else
+        {
+            job(0);
+        }
+
+        // the rebaked tiles and their neighbours get restitched, their borders may have new vertices
+        std::set<uint64_t> stitch;
+        for (int i = 0; i < (int) keys.size(); i++)
+        {
+            Tile& tile = m_tiles[keys[i]];
+
+            // add the new vertices before releasing the old ones, so unchanged vertices keep their index
+            std::vector<std::vector<int>> polygons(baked[i].size());
+            for (int j = 0; j < (int) baked[i].size(); j++)
+            {
+                for (auto& point : baked[i][j])
+                {
+                    polygons[j].push_back(this->AddVertex(point));
+                }
+            }
+
+            for (auto& polygon : tile.polygons)
+            {
+                for (int index : polygon)
+                {
+                    this->ReleaseVertex(index);
+                }
+            }
+            tile.polygons.swap(polygons);
+
+            int tile_x = (int) (uint32_t) (keys[i] >> 32);
+            int tile_y = (int) (uint32_t) (keys[i] & 0xffffffff);
+            stitch.insert(keys[i]);
+            stitch.insert(get_tile_key(tile_x - 1, tile_y));
+            stitch.insert(get_tile_key(tile_x + 1, tile_y));
+            stitch.insert(get_tile_key(tile_x, tile_y - 1));
+            stitch.insert(get_tile_key(tile_x, tile_y + 1));
+        }
+
+        this->StitchTileBorders(stitch);
+
+        for (int i = 0; i < (int) keys.size(); i++)
+        {
+            auto T = m_tiles.find(keys[i]);
+            if (T->second.polygons.size() == 0)
+                m_tiles.erase(T);
+        }
+    }
+
+    // neighbour tiles partition independently, so an edge on a tile border may span several
+    // edges of the polygons across it. split such edges at every border vertex they contain
+    // and weld border vertices that differ by rounding, so every shared edge matches exactly.
+    // only the given tiles are restitched, their border vertices come from them and their neighbours.
+    void NavigationPolygon::StitchTileBorders(const std::set<uint64_t>& p_keys)
+    {
+        const float weld = 1e-3f;
+
+        auto get_border = [this](float v, int& r_line) {
+            float line = floorf(v / m_tile_size + 0.5f);
+            if (fabs(line * m_tile_size - v) > 1e-3f)
+                return false;
+            r_line = (int) line;
+            return true;
+        };
+
+        // vertices of the stitched tiles and the tiles across their borders
+        std::vector<int> sources;
+        for (uint64_t key : p_keys)
+        {
+            int tile_x = (int) (uint32_t) (key >> 32);
+            int tile_y = (int) (uint32_t) (key & 0xffffffff);
+            uint64_t around[5] = {
+                key,
+                get_tile_key(tile_x - 1, tile_y),
+                get_tile_key(tile_x + 1, tile_y),
+                get_tile_key(tile_x, tile_y - 1),
+                get_tile_key(tile_x, tile_y + 1),
+            };
+
+            for (uint64_t k : around)
+            {
+                auto T = m_tiles.find(k);
+                if (T == m_tiles.end())
+                    continue;
+                for (auto& polygon : T->second.polygons)
+                {
+                    sources.insert(sources.end(), polygon.begin(), polygon.end());
+                }
+            }
+        }
+        std::sort(sources.begin(), sources.end());
+        sources.erase(std::unique(sources.begin(), sources.end()), sources.end());
+
+        std::map<std::pair<int, int>, std::vector<std::pair<float, int>>> borders;
+        for (int i : sources)
+        {
+            int line;
+            if (get_border(m_vertices[i].x, line))
+                borders[std::make_pair(0, line)].push_back(std::make_pair(m_vertices[i].y, i));
+            if (get_border(m_vertices[i].y, line))
+                borders[std::make_pair(1, line)].push_back(std::make_pair(m_vertices[i].x, i));
+        }
+
+        std::unordered_map<int, int> remap;
+        auto get_remap = [&remap](int i) {
+            auto R = remap.find(i);
+            return R == remap.end() ? i : R->second;
+        };
+
+        for (auto& B : borders)
+        {
+            auto& list = B.second;
+            std::sort(list.begin(), list.end());
+            for (int i = 1; i < (int) list.size(); i++)
+            {
+                if (list[i].first - list[i - 1].first <= weld)
                 {
-                    points[tp[i]] = (int) m_vertices.size();
-                    E = points.find(tp[i]);
-                    m_vertices.push_back(tp[i]);
+                    int to = get_remap(list[i - 1].second);
+                    remap[list[i].second] = to;
+                    list[i].first = list[i - 1].first;
+                    list[i].second = to;
                 }
-                p.indices.push_back(E->second);
             }
+        }
+
+        for (uint64_t key : p_keys)
+        {
+            auto T = m_tiles.find(key);
+            if (T == m_tiles.end())
+                continue;
+            Tile& tile = T->second;
+
+            // one slot per polygon, surplus slots are emptied and reused later
+            while (tile.slots.size() < tile.polygons.size())
+            {
+                tile.slots.push_back(this->AddPolygonSlot());
+            }
+            while (tile.slots.size() > tile.polygons.size())
+            {
+                this->SetPolygonSlot(tile.slots.back(), std::vector<int>());
+                m_free_polygons.push_back(tile.slots.back());
+                tile.slots.pop_back();
+            }
+
+            for (int k = 0; k < (int) tile.polygons.size(); k++)
+            {
+                const auto& indices = tile.polygons[k];
+                int count = (int) indices.size();
+                std::vector<int> stitched;
+
+                for (int i = 0; i < count; i++)
+                {
+                    int a = get_remap(indices[i]);
+                    int b = get_remap(indices[(i + 1) % count]);
+                    if (a == b)
+                        continue;
+
+                    stitched.push_back(a);
 
-            m_polygons.push_back(p);
+                    const Vector2& va = m_vertices[a];
+                    const Vector2& vb = m_vertices[b];
+                    for (int axis = 0; axis < 2; axis++)
+                    {
+                        int line_a, line_b;
+                        float ca = axis == 0 ? va.x : va.y;
+                        float cb = axis == 0 ? vb.x : vb.y;
+                        if (!get_border(ca, line_a) || !get_border(cb, line_b) || line_a != line_b)
+                            continue;
+
+                        const auto& list = borders[std::make_pair(axis, line_a)];
+                        float from = axis == 0 ? va.y : va.x;
+                        float to = axis == 0 ? vb.y : vb.x;
+                        float lo = std::min(from, to) + weld;
+                        float hi = std::max(from, to) - weld;
+
+                        auto begin = std::upper_bound(list.begin(), list.end(), std::make_pair(lo, INT_MAX));
+                        auto end = std::lower_bound(list.begin(), list.end(), std::make_pair(hi, INT_MIN));
+                        int last = -1;
+                        if (from < to)
+                        {
+                            for (auto I = begin; I < end; ++I)
+                            {
+                                if (I->second != last)
+                                    stitched.push_back(I->second);
+                                last = I->second;
+                            }
+                        }
+                        else
+                        {
+                            for (auto I = end; I > begin; --I)
+                            {
+                                if ((I - 1)->second != last)
+                                    stitched.push_back((I - 1)->second);
+                                last = (I - 1)->second;
+                            }
+                        }
+                        break;
+                    }
+                }
+
+                this->SetPolygonSlot(tile.slots[k], stitched);
+            }
         }
     }
 
@@ -19,6 +19,12 @@
 
 #include "math/Vector2.h"
 #include <vector>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <memory>
+
+#define NAVIGATION_POLYGON_TILE_SIZE 256.0f
 
 namespace Viry3D
 {
@@ -64,12 +70,19 @@ namespace Viry3D
     public:
         NavigationPolygon();
         std::vector<Vector2>& GetVertices() { return m_vertices; }
-        void SetVertices(const std::vector<Vector2>& p_vertices) { m_vertices = p_vertices; m_rect_cache_dirty = true; }
+        void SetVertices(const std::vector<Vector2>& p_vertices);
+        // slots of removed polygons stay empty until reused
         int GetPolygonCount() const { return (int) m_polygons.size(); }
         std::vector<int>& GetPolygon(int index) { return m_polygons[index].indices; }
+        // bumped whenever the polygon in this slot changes
+        uint32_t GetPolygonVersion(int index) const { return m_polygons[index].version; }
         void AddPolygon(const std::vector<int>& p_polygon);
-        void ClearPolygons() { m_polygons.clear(); }
+        void ClearPolygons() { m_polygons.clear(); m_bake_all = true; }
+        // outlines are baked per tile in parallel, only tiles touched by outline edits since the last bake are rebuilt,
+        // and only polygons of those tiles and their neighbours change
         void MakePolygonsFromOutlines();
+        float GetTileSize() const { return m_tile_size; }
+        void SetTileSize(float p_size);
         void AddOutline(const std::vector<Vector2>& p_outline);
         void AddOutlineAtIndex(const std::vector<Vector2>& p_outline, int p_index);
         void SetOutline(int p_idx, const std::vector<Vector2>& p_outline);
@@ -82,19 +95,55 @@ namespace Viry3D
         struct Polygon
         {
             std::vector<int> indices;
+            uint32_t version;
+
+            Polygon():
+                version(0)
+            {
+            }
         };
 
-        void SetPolygons(const std::vector<Polygon>& p_array) { m_polygons = p_array; }
+        void SetPolygons(const std::vector<Polygon>& p_array);
         const std::vector<Polygon>& GetPolygons() const { return m_polygons; }
-        void SetOutlines(const std::vector<std::vector<Vector2>>& p_array) { m_outlines = p_array; m_rect_cache_dirty = true; }
+        void SetOutlines(const std::vector<std::vector<Vector2>>& p_array);
         const std::vector<std::vector<Vector2>>& GetOutlines() const { return m_outlines; }
 
+    private:
+        struct Tile
+        {
+            // vertex indices before stitching
+            std::vector<std::vector<int>> polygons;
+            // slots in m_polygons holding the stitched polygons
+            std::vector<int> slots;
+        };
+
+        void MarkTilesDirty(const Rect2& p_bounds);
+        void StitchTileBorders(const std::set<uint64_t>& p_keys);
+        void BakeTile(uint64_t p_key, const std::vector<int>& p_outlines, const std::vector<char>& p_holes, std::vector<std::vector<Vector2>>& r_polygons) const;
+        int AddVertex(const Vector2& p_point);
+        void ReleaseVertex(int p_index);
+        int AddPolygonSlot();
+        void SetPolygonSlot(int p_slot, const std::vector<int>& p_indices);
+
     private:
         std::vector<Vector2> m_vertices;
         std::vector<Polygon> m_polygons;
         std::vector<std::vector<Vector2>> m_outlines;
+        std::vector<Rect2> m_outline_bounds;
+        // 1 for holes, -1 until known
+        std::vector<char> m_outline_holes;
         mutable Rect2 m_item_rect;
         mutable bool m_rect_cache_dirty;
+        float m_tile_size;
+        bool m_bake_all;
+        std::set<uint64_t> m_dirty_tiles;
+        std::map<uint64_t, Tile> m_tiles;
+        uint32_t m_version;
+        std::vector<int> m_free_polygons;
+        // baked vertices are shared by exact bits and reference counted by the tiles using them
+        std::unordered_map<uint64_t, int> m_vertex_map;
+        std::vector<int> m_vertex_refs;
+        std::vector<int> m_free_vertices;
     };
 
     class Navigation2D;
@@ -27,12 +27,16 @@
 #include "Resources.h"
 #include "graphics/Shader.h"
 #include "graphics/Texture.h"
+#include "graphics/TextureStreamer.h"
 #include "graphics/RenderTarget.h"
 #include "graphics/Camera.h"
 #include "graphics/Light.h"
+#include "graphics/ShadowAtlas.h"
 #include "graphics/Renderer.h"
 #include "ui/Font.h"
 #include "audio/AudioManager.h"
+#include "physics/Physics.h"
+#include "physics/SpringSolver.h"
 #include "time/Time.h"
 #include <thread>
 
@@ -138,23 +142,29 @@ namespace Viry3D
             
             Shader::Init();
             Texture::Init();
+            TextureStreamer::Init();
 			RenderTarget::Init();
 			Camera::Init();
 			Mesh::Init();
 			Font::Init();
 			Resources::Init();
             AudioManager::Init();
+            Physics::Init();
 		}
 
 		void Shutdown()
 		{
             AudioManager::Done();
             m_scene.reset();
+            SpringSolver::Done();
+            Physics::Done();
 			Resources::Done();
 			Font::Done();
 			Mesh::Done();
 			Camera::Done();
+			ShadowAtlas::Done();
 			RenderTarget::Done();
+            TextureStreamer::Done();
             Texture::Done();
             Shader::Done();
             
@@ -251,6 +261,8 @@ namespace Viry3D
 			Renderer::PrepareAll();
 			Light::RenderShadowMaps();
 			Camera::RenderAll();
+			TextureStreamer::Update();
+			RenderTarget::Update();
 			this->Flush();
 		}
 
@@ -533,7 +545,11 @@ namespace Viry3D
         {
             m_private->m_scene = RefMake<Scene>();
         }
+        Physics::Sync();
         m_private->m_scene->Update();
+        SpringSolver::Update();
+        Physics::Simulate();
+        AudioManager::Update();
         
 		m_private->BeginFrame();
 		m_private->Render();
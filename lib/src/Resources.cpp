@@ -21,11 +21,14 @@
 #include "io/MemoryStream.h"
 #include "graphics/MeshRenderer.h"
 #include "graphics/SkinnedMeshRenderer.h"
+#include "graphics/LodGroup.h"
 #include "graphics/Mesh.h"
 #include "graphics/Material.h"
 #include "graphics/Shader.h"
 #include "graphics/Image.h"
+#include "graphics/ImageDecoder.h"
 #include "graphics/Texture.h"
+#include "graphics/TextureStreamer.h"
 #include "animation/Animation.h"
 #include "json/json.h"
 #include "physics/SpringBone.h"
@@ -52,6 +55,30 @@ namespace Viry3D
         return ms.ReadString(size);
     }
 
+    // prebuilt compressed mip chains are shipped next to the .tex as name.<family>.ktx,
+    // the best family supported by the backend wins
+    static Ref<Texture> ReadCompressedTexture(const String& full_path, FilterMode filter_mode, SamplerAddressMode wrap_mode)
+    {
+        Ref<Texture> texture;
+
+        String base_path = full_path.Substring(0, full_path.LastIndexOf("."));
+        Vector<String> families = Texture::GetCompressedFormatFamilies();
+        for (int i = 0; i < families.Size(); ++i)
+        {
+            String ktx_path = base_path + "." + families[i] + ".ktx";
+            if (File::Exist(ktx_path))
+            {
+                texture = Texture::LoadFromKTXFile(ktx_path, filter_mode, wrap_mode);
+                if (texture)
+                {
+                    break;
+                }
+            }
+        }
+
+        return texture;
+    }
+
     static Ref<Texture> ReadTexture(const String& path)
     {
         if (g_cache.Contains(path))
@@ -79,12 +106,27 @@ namespace Viry3D
                 FilterMode filter_mode = (FilterMode) root["filter_mode"].asInt();
                 String texture_type = root["type"].asCString();
 
-                if (texture_type == "Texture2D")
+                texture = ReadCompressedTexture(full_path, filter_mode, wrap_mode);
+                if (texture)
+                {
+                    texture->SetName(texture_name);
+                }
+                else if (texture_type == "Texture2D")
                 {
                     int mipmap_count = root["mipmap"].asInt();
                     String png_path = root["path"].asCString();
 
-                    texture = Texture::LoadTexture2DFromFile(Engine::Instance()->GetDataPath() + "/" + png_path, filter_mode, wrap_mode, mipmap_count > 1);
+                    String image_path = Engine::Instance()->GetDataPath() + "/" + png_path;
+                    if (mipmap_count > 1)
+                    {
+                        // color textures are srgb unless marked linear, e.g. normal maps
+                        bool srgb = !root["linear"].asBool();
+                        texture = TextureStreamer::LoadTexture2DFromFile(image_path, filter_mode, wrap_mode, srgb);
+                    }
+                    else
+                    {
+                        texture = Texture::LoadTexture2DFromFile(image_path, filter_mode, wrap_mode, false);
+                    }
                     texture->SetName(texture_name);
                 }
                 else if (texture_type == "Cubemap")
@@ -96,32 +138,52 @@ namespace Viry3D
                     
                     texture = Texture::CreateCubemap(width, TextureFormat::R8G8B8A8, filter_mode, wrap_mode, mipmap_count > 1);
 
+                    // decode all faces of all levels at once, each face straight into its slice of the level buffer
+                    Vector<ByteBuffer> buffers(mipmap_count);
+                    Vector<ImageDecodeRequest> requests(mipmap_count * 6);
+
                     for (int i = 0; i < mipmap_count; ++i)
                     {
                         Json::Value faces = levels[i];
-						ByteBuffer buffer;
-						Vector<int> offsets(6);
+                        int size = Mathf::Max(width >> i, 1);
+                        int face_size = size * size * 4;
+                        buffers[i] = ByteBuffer(face_size * 6);
 
                         for (int j = 0; j < 6; ++j)
                         {
-                            String face_path = faces[j].asCString();
-
-                            Ref<Image> image = Image::LoadFromFile(Engine::Instance()->GetDataPath() + "/" + face_path);
-							if (image)
-							{
-								if (buffer.Size() == 0)
-								{
-									buffer = ByteBuffer(image->data.Size() * 6);
-								}
-								Memory::Copy(&buffer[j * image->data.Size()], image->data.Bytes(), image->data.Size());
-								offsets[j] = j * image->data.Size();
-							}
+                            ImageDecodeRequest& request = requests[i * 6 + j];
+                            request.path = Engine::Instance()->GetDataPath() + "/" + faces[j].asCString();
+                            request.dest = &buffers[i][j * face_size];
+                            request.dest_size = face_size;
                         }
+                    }
 
-						if (buffer.Size() > 0)
-						{
-							texture->UpdateCubemap(buffer, i, offsets);
-						}
+                    ImageDecoder::DecodeAll(requests);
+
+                    for (int i = 0; i < mipmap_count; ++i)
+                    {
+                        int size = Mathf::Max(width >> i, 1);
+                        int face_size = size * size * 4;
+                        Vector<int> offsets(6);
+                        bool complete = true;
+
+                        for (int j = 0; j < 6; ++j)
+                        {
+                            const ImageDecodeRequest& request = requests[i * 6 + j];
+                            complete = complete && request.success &&
+                                request.image->width == size && request.image->height == size &&
+                                request.image->format == ImageFormat::R8G8B8A8;
+                            offsets[j] = j * face_size;
+                        }
+
+                        if (complete)
+                        {
+                            texture->UpdateCubemap(buffers[i], i, offsets);
+                        }
+                        else
+                        {
+                            Log("cubemap level %d faces not match: %s", i, path.CString());
+                        }
                     }
                 }
             }
@@ -265,7 +327,19 @@ namespace Viry3D
 			return RefCast<Mesh>(g_cache[path]);
 		}
 
-		Ref<Mesh> mesh = Mesh::LoadFromFile(Engine::Instance()->GetDataPath() + "/" + path);
+		Ref<Mesh> mesh;
+
+		// prefer the preconverted binary container when it is shipped next to the mesh
+		String full_path = Engine::Instance()->GetDataPath() + "/" + path;
+		String binary_path = full_path.Substring(0, full_path.LastIndexOf(".")) + ".vmesh";
+		if (File::Exist(binary_path))
+		{
+			mesh = Mesh::LoadFromBinaryFile(binary_path);
+		}
+		if (!mesh)
+		{
+			mesh = Mesh::LoadFromFile(full_path);
+		}
 
 		g_cache.Add(path, mesh);
 
@@ -281,6 +355,12 @@ namespace Viry3D
 		{
 			auto mesh = ReadMesh(mesh_path);
 			renderer->SetMesh(mesh);
+
+			// meshes carrying a lod chain pick their level by screen size
+			if (mesh && mesh->GetLods().Size() > 0 && !renderer->GetGameObject()->GetComponent<LodGroup>())
+			{
+				renderer->GetGameObject()->AddComponent<LodGroup>();
+			}
 		}
     }
 
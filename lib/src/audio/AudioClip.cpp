@@ -16,12 +16,15 @@
 */
 
 #include "AudioClip.h"
+#include "AudioManager.h"
 #include "Debug.h"
-#include "Engine.h"
 #include "io/File.h"
 #include "io/MemoryStream.h"
 #include "memory/Memory.h"
-#include "container/List.h"
+#include "math/Mathf.h"
+#include "container/Map.h"
+#include "thread/ThreadPool.h"
+#include "Engine.h"
 
 #if VR_MAC || VR_IOS
 #include <OpenAL/OpenAL.h>
@@ -50,30 +53,149 @@ namespace Viry3D
         short sample_bits;
     };
 
+    struct AudioDecodeEntry
+    {
+        // 0 while a worker decodes the clip
+        ALuint buffer;
+        int size;
+        int ref_count;
+        uint64_t tick;
+        int decode_id;
+    };
+
+    class AudioDecodeResult : public Object
+    {
+    public:
+        ByteBuffer pcm;
+    };
+
+    static Map<AudioClip*, AudioDecodeEntry> g_decode_cache;
+    static int g_decode_cache_size = 0;
+    static int g_decode_cache_budget = AUDIO_DECODE_CACHE_BUDGET;
+    static uint64_t g_decode_tick = 0;
+    static int g_decode_id = 0;
+
+    static const int IMA_INDEX_TABLE[16] = {
+        -1, -1, -1, -1, 2, 4, 6, 8,
+        -1, -1, -1, -1, 2, 4, 6, 8,
+    };
+
+    static const int IMA_STEP_TABLE[89] = {
+        7, 8, 9, 10, 11, 12, 13, 14, 16, 17,
+        19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+        50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+        130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+        337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+        876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+        2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358,
+        5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+        15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767,
+    };
+
+    struct ImaState
+    {
+        int predictor;
+        int index;
+    };
+
+    static int ImaDecodeNibble(ImaState& state, int code)
+    {
+        int step = IMA_STEP_TABLE[state.index];
+        int delta = step >> 3;
+        if (code & 4) delta += step;
+        if (code & 2) delta += step >> 1;
+        if (code & 1) delta += step >> 2;
+
+        state.predictor += (code & 8) ? -delta : delta;
+        state.predictor = Mathf::Clamp(state.predictor, -32768, 32767);
+        state.index = Mathf::Clamp(state.index + IMA_INDEX_TABLE[code], 0, 88);
+
+        return state.predictor;
+    }
+
+    static int ImaEncodeSample(ImaState& state, int sample)
+    {
+        int step = IMA_STEP_TABLE[state.index];
+        int diff = sample - state.predictor;
+        int code = 0;
+
+        if (diff < 0)
+        {
+            code = 8;
+            diff = -diff;
+        }
+        if (diff >= step)
+        {
+            code |= 4;
+            diff -= step;
+        }
+        if (diff >= step >> 1)
+        {
+            code |= 2;
+            diff -= step >> 1;
+        }
+        if (diff >= step >> 2)
+        {
+            code |= 1;
+        }
+
+        // run the decoder so both sides track the same predictor
+        ImaDecodeNibble(state, code);
+
+        return code;
+    }
+
+    // interleaved 16 bit pcm to a continuous 4 bit ima stream, low nibble first
+    static ByteBuffer EncodeAdpcm(const short* samples, int count, int channel)
+    {
+        ByteBuffer adpcm((count + 1) / 2);
+        Memory::Zero(adpcm.Bytes(), adpcm.Size());
+
+        ImaState states[2] = { { 0, 0 }, { 0, 0 } };
+        for (int i = 0; i < count; ++i)
+        {
+            int code = ImaEncodeSample(states[i % channel], samples[i]);
+            adpcm.Bytes()[i >> 1] |= (byte) (code << ((i & 1) * 4));
+        }
+
+        return adpcm;
+    }
+
+    static void DecodeAdpcm(const ByteBuffer& adpcm, short* samples, int count, int channel)
+    {
+        ImaState states[2] = { { 0, 0 }, { 0, 0 } };
+        for (int i = 0; i < count; ++i)
+        {
+            int code = (adpcm.Bytes()[i >> 1] >> ((i & 1) * 4)) & 0xf;
+            samples[i] = (short) ImaDecodeNibble(states[i % channel], code);
+        }
+    }
+
+#if !VR_WASM
+    struct Mp3Decoder
+    {
+        mad_stream stream;
+        mad_frame frame;
+        mad_synth synth;
+        int synth_pos;
+        bool end;
+    };
+#endif
+
     class AudioClipPrivate
     {
     public:
 #if !VR_WASM
-        mad_decoder* m_mp3_decoder;
         ByteBuffer m_mp3_buffer;
-        int m_mp3_write_size;
+        Mp3Decoder* m_mp3;
         ByteBuffer m_out_buffer;
-        List<ALuint> m_stream_buffers;
-        bool m_decoder_exit;
-        bool m_decoder_exited;
-        bool m_decoder_running;
 #endif
         ALuint m_buffer;
-        Mutex m_mutex;
         bool m_stream_loop;
 
         AudioClipPrivate():
 #if !VR_WASM
-            m_mp3_decoder(nullptr),
-            m_mp3_write_size(0),
-            m_decoder_exit(false),
-            m_decoder_exited(false),
-            m_decoder_running(false),
+            m_mp3(nullptr),
 #endif
             m_buffer(0),
             m_stream_loop(false)
@@ -84,21 +206,14 @@ namespace Viry3D
         ~AudioClipPrivate()
         {
 #if !VR_WASM
-            if (m_mp3_decoder)
-            {
-                this->StopMp3Decoder();
-
-                mad_decoder_finish(m_mp3_decoder);
-                delete m_mp3_decoder;
-                m_mp3_decoder = nullptr;
-            }
+            this->FinishMp3Decoder();
 #endif
 
-            if (m_buffer)
+            if (m_buffer && AudioManager::HasContext())
             {
                 alDeleteBuffers(1, &m_buffer);
-                m_buffer = 0;
             }
+            m_buffer = 0;
         }
 
         static void BufferData(ALuint buffer, int channel, int sample_bits, const void* data, int size, int frequency)
@@ -154,266 +269,210 @@ namespace Viry3D
         }
 
 #if !VR_WASM
-        void StopMp3Decoder()
+        void InitMp3Decoder(const ByteBuffer& buffer)
         {
-            if (m_decoder_running)
-            {
-                this->ExitMp3Decoder();
-                m_decoder_running = false;
-            }
-
-            for (auto i : m_stream_buffers)
-            {
-                alDeleteBuffers(1, &i);
-            }
-            m_stream_buffers.Clear();
+            // libmad needs guard bytes after the last frame
+            m_mp3_buffer = ByteBuffer(buffer.Size() + MAD_BUFFER_GUARD);
+            Memory::Copy(m_mp3_buffer.Bytes(), buffer.Bytes(), buffer.Size());
+            Memory::Zero(m_mp3_buffer.Bytes() + buffer.Size(), MAD_BUFFER_GUARD);
         }
 
-        void InitMp3Decoder(const ByteBuffer& buffer);
-
-        void RunMp3Decoder()
+        // read frame headers only, to size the decoded pcm without synthesis
+        bool ScanMp3(int& channel, int& sample_rate, int& sample_count)
         {
-            this->StopMp3Decoder();
-
-            if (!m_decoder_running)
-            {
-                m_decoder_running = true;
-                m_decoder_exit = false;
-                m_decoder_exited = false;
+            mad_stream stream;
+            mad_header header;
+            mad_stream_init(&stream);
+            mad_header_init(&header);
+            mad_stream_buffer(&stream, m_mp3_buffer.Bytes(), m_mp3_buffer.Size());
 
-                m_mp3_write_size = 0;
+            channel = 0;
+            sample_rate = 0;
+            sample_count = 0;
 
-                Thread::Task task;
-                task.job = [this]() {
-                    mad_decoder_run(m_mp3_decoder, MAD_DECODER_MODE_SYNC);
-
-                    m_mutex.lock();
-                    m_decoder_exited = true;
-                    m_mutex.unlock();
+            while (true)
+            {
+                if (mad_header_decode(&header, &stream) == -1)
+                {
+                    if (MAD_RECOVERABLE(stream.error))
+                    {
+                        continue;
+                    }
+                    break;
+                }
 
-                    return Ref<Object>();
-                };
-                Engine::Instance()->GetThreadPool()->AddTask(task);
+                if (channel == 0)
+                {
+                    channel = Mathf::Min((int) MAD_NCHANNELS(&header), 2);
+                    sample_rate = header.samplerate;
+                }
+                sample_count += 32 * MAD_NSBSAMPLES(&header);
             }
-        }
 
-        void ExitMp3Decoder()
-        {
-            m_mutex.lock();
-            m_decoder_exit = true;
-            m_mutex.unlock();
+            mad_header_finish(&header);
+            mad_stream_finish(&stream);
 
-            this->WaitMp3DecoderExit();
+            return channel > 0 && sample_count > 0;
         }
 
-        void WaitMp3DecoderExit()
+        void FinishMp3Decoder()
         {
-            bool exist = false;
-
-            while (!exist)
+            if (m_mp3)
             {
-                Thread::Sleep(1);
-
-                m_mutex.lock();
-                exist = m_decoder_exited;
-                m_mutex.unlock();
+                mad_synth_finish(&m_mp3->synth);
+                mad_frame_finish(&m_mp3->frame);
+                mad_stream_finish(&m_mp3->stream);
+                Memory::SafeDelete(m_mp3);
             }
         }
-#endif
-    };
-
-#if !VR_WASM
-    static bool is_decode_exit(void* data)
-    {
-        AudioClipPrivate* clip = (AudioClipPrivate*) data;
-
-        bool exit = false;
-
-        clip->m_mutex.lock();
-        exit = clip->m_decoder_exit;
-        clip->m_mutex.unlock();
 
-        return exit;
-    }
-
-    static mad_flow mp3_input(void* data, mad_stream* stream)
-    {
-        if (is_decode_exit(data))
-        {
-            return MAD_FLOW_STOP;
-        }
-
-        AudioClipPrivate* clip = (AudioClipPrivate*) data;
-
-        if (clip->m_mp3_write_size < clip->m_mp3_buffer.Size())
-        {
-            byte* buffer = clip->m_mp3_buffer.Bytes();
-            int size = clip->m_mp3_buffer.Size();
-
-            mad_stream_buffer(stream, &buffer[clip->m_mp3_write_size], size);
-
-            clip->m_mp3_write_size += size;
-
-            return MAD_FLOW_CONTINUE;
-        }
-        else
+        void RewindMp3Decoder()
         {
-            bool loop = false;
-
-            clip->m_mutex.lock();
-            loop = clip->m_stream_loop;
-            clip->m_mutex.unlock();
-
-            if (loop)
+            // decoder state is large, so it only lives while decoding
+            if (m_mp3 == nullptr)
             {
-                clip->m_mp3_write_size = 0;
-
-                return mp3_input(data, stream);
+                m_mp3 = Memory::New<Mp3Decoder>();
             }
             else
             {
-                return MAD_FLOW_STOP;
+                mad_synth_finish(&m_mp3->synth);
+                mad_frame_finish(&m_mp3->frame);
+                mad_stream_finish(&m_mp3->stream);
             }
-        }
-    }
 
-    static mad_flow mp3_header(void* data, mad_header const* header)
-    {
-        if (is_decode_exit(data))
-        {
-            return MAD_FLOW_STOP;
+            mad_stream_init(&m_mp3->stream);
+            mad_frame_init(&m_mp3->frame);
+            mad_synth_init(&m_mp3->synth);
+            mad_stream_buffer(&m_mp3->stream, m_mp3_buffer.Bytes(), m_mp3_buffer.Size());
+            m_mp3->synth.pcm.length = 0;
+            m_mp3->synth_pos = 0;
+            m_mp3->end = false;
         }
 
-        return MAD_FLOW_CONTINUE;
-    }
-
-    static mad_flow mp3_filter(void* data, mad_stream const* stream, mad_frame* frame)
-    {
-        if (is_decode_exit(data))
+        bool DecodeMp3Frame()
         {
-            return MAD_FLOW_STOP;
-        }
-
-        return MAD_FLOW_CONTINUE;
-    }
+            if (m_mp3 == nullptr || m_mp3->end)
+            {
+                return false;
+            }
 
-    static int mp3_scale_sample(mad_fixed_t sample)
-    {
-        /* round */
-        sample += (1L << (MAD_F_FRACBITS - 16));
+            bool restarted = false;
 
-        /* clip */
-        if (sample >= MAD_F_ONE)
-            sample = MAD_F_ONE - 1;
-        else if (sample < -MAD_F_ONE)
-            sample = -MAD_F_ONE;
+            while (true)
+            {
+                if (mad_frame_decode(&m_mp3->frame, &m_mp3->stream) == 0)
+                {
+                    mad_synth_frame(&m_mp3->synth, &m_mp3->frame);
+                    m_mp3->synth_pos = 0;
+                    return true;
+                }
 
-        /* quantize */
-        return sample >> (MAD_F_FRACBITS + 1 - 16);
-    }
+                if (MAD_RECOVERABLE(m_mp3->stream.error))
+                {
+                    continue;
+                }
 
-    static mad_flow mp3_output(void* data, mad_header const* header, mad_pcm* pcm)
-    {
-        if (is_decode_exit(data))
-        {
-            return MAD_FLOW_STOP;
-        }
+                // stop on a loop restart that yields nothing, so broken files can not spin
+                if (m_mp3->stream.error == MAD_ERROR_BUFLEN && m_stream_loop && !restarted)
+                {
+                    mad_stream_buffer(&m_mp3->stream, m_mp3_buffer.Bytes(), m_mp3_buffer.Size());
+                    restarted = true;
+                    continue;
+                }
 
-        AudioClipPrivate* clip = (AudioClipPrivate*) data;
-        
-        int bytes = (int) (header->bitrate / header->samplerate / pcm->channels);
-        if (bytes != 1 && bytes != 2)
-        {
-            bytes = 2;
+                m_mp3->end = true;
+                return false;
+            }
         }
 
-        const int max_sample = 1152;
-        int size = max_sample * bytes * pcm->channels;
-
-        if (clip->m_out_buffer.Size() == 0)
+        int DecodeMp3(short* out, int channel, int frame_count)
         {
-            clip->m_out_buffer = ByteBuffer(size);
-        }
+            int written = 0;
 
-        for (int i = 0; i < pcm->length; ++i)
-        {
-            for (int j = 0; j < pcm->channels; ++j)
+            while (m_mp3 && written < frame_count)
             {
-                int sample = mp3_scale_sample(pcm->samples[j][i]);
+                const mad_pcm& pcm = m_mp3->synth.pcm;
 
-                if (bytes == 1)
+                if (m_mp3->synth_pos >= pcm.length)
                 {
-                    byte* p = clip->m_out_buffer.Bytes();
-
-                    p[i * pcm->channels + j] = ((sample + 0x8000) >> 8) & 0xff;
+                    if (!this->DecodeMp3Frame())
+                    {
+                        break;
+                    }
+                    continue;
                 }
-                else if (bytes == 2)
-                {
-                    short* p = (short*) clip->m_out_buffer.Bytes();
 
-                    unsigned char bytes[2];
-                    bytes[0] = (sample >> 0) & 0xff;
-                    bytes[1] = (sample >> 8) & 0xff;
+                int count = Mathf::Min(pcm.length - m_mp3->synth_pos, frame_count - written);
+                for (int i = 0; i < channel; ++i)
+                {
+                    const mad_fixed_t* src = &pcm.samples[Mathf::Min(i, pcm.channels - 1)][m_mp3->synth_pos];
+                    short* dst = &out[written * channel + i];
 
-                    p[i * pcm->channels + j] = *(short*) bytes;
+                    for (int j = 0; j < count; ++j)
+                    {
+                        dst[j * channel] = (short) mp3_scale_sample(src[j]);
+                    }
                 }
+
+                m_mp3->synth_pos += count;
+                written += count;
             }
-        }
 
-        ALuint buffer = 0;
-        alGenBuffers(1, &buffer);
-        AudioClipPrivate::BufferData(buffer, pcm->channels, bytes * 8, clip->m_out_buffer.Bytes(), pcm->length * bytes * pcm->channels, header->samplerate);
+            return written;
+        }
 
-        bool exit = false;
-        int buffer_count = 0;
+        int DecodeMp3All(short* out, int channel, int frame_count)
+        {
+            this->RewindMp3Decoder();
+            int decoded = this->DecodeMp3(out, channel, frame_count);
+            this->FinishMp3Decoder();
 
-        clip->m_mutex.lock();
-        clip->m_stream_buffers.AddLast(buffer);
-        buffer_count = clip->m_stream_buffers.Size();
-        clip->m_mutex.unlock();
+            return decoded;
+        }
 
-        while (buffer_count >= STREAM_BUFFER_MAX)
+        static int mp3_scale_sample(mad_fixed_t sample)
         {
-            Thread::Sleep(100);
+            /* round */
+            sample += (1L << (MAD_F_FRACBITS - 16));
 
-            clip->m_mutex.lock();
-            exit = clip->m_decoder_exit;
-            buffer_count = clip->m_stream_buffers.Size();
-            clip->m_mutex.unlock();
+            /* clip */
+            if (sample >= MAD_F_ONE)
+                sample = MAD_F_ONE - 1;
+            else if (sample < -MAD_F_ONE)
+                sample = -MAD_F_ONE;
 
-            if (exit)
-            {
-                return MAD_FLOW_STOP;
-            }
+            /* quantize */
+            return sample >> (MAD_F_FRACBITS + 1 - 16);
         }
-        
-        return MAD_FLOW_CONTINUE;
-    }
-
-    static mad_flow mp3_error(void* data, mad_stream* stream, mad_frame* frame)
-    {
-        return MAD_FLOW_BREAK;
-    }
+#endif
+    };
 
-    static mad_flow mp3_message(void* data, void*, unsigned int*)
+    // evict unreferenced decoded clips, least recently used first, until incoming bytes fit the budget
+    static void TrimDecodeCache(int incoming)
     {
-        if (is_decode_exit(data))
+        while (g_decode_cache_size + incoming > g_decode_cache_budget)
         {
-            return MAD_FLOW_STOP;
-        }
+            auto lru = g_decode_cache.end();
+            for (auto i = g_decode_cache.begin(); i != g_decode_cache.end(); ++i)
+            {
+                if (i->second.buffer != 0 && i->second.ref_count == 0 && (lru == g_decode_cache.end() || i->second.tick < lru->second.tick))
+                {
+                    lru = i;
+                }
+            }
 
-        return MAD_FLOW_CONTINUE;
-    }
+            if (lru == g_decode_cache.end())
+            {
+                break;
+            }
 
-    void AudioClipPrivate::InitMp3Decoder(const ByteBuffer& buffer)
-    {
-        m_mp3_buffer = buffer;
-        m_mp3_decoder = new mad_decoder();
-        mad_decoder_init(m_mp3_decoder, this, mp3_input, mp3_header, mp3_filter, mp3_output, mp3_error, mp3_message);
+            alDeleteBuffers(1, &lru->second.buffer);
+            g_decode_cache_size -= lru->second.size;
+            g_decode_cache.Remove(lru);
+        }
     }
-#endif
 
-    Ref<AudioClip> AudioClip::LoadWaveFromFile(const String& path)
+    Ref<AudioClip> AudioClip::LoadWaveFromFile(const String& path, AudioClipMode mode)
     {
         Ref<AudioClip> clip;
 
@@ -480,14 +539,41 @@ namespace Viry3D
 
         if (clip)
         {
-            clip->m_private->BufferData(clip->m_channel, clip->m_sample_bits, clip->m_samples.Bytes(), clip->m_samples.Size(), clip->m_sample_rate);
+            if (mode == AudioClipMode::ADPCM || mode == AudioClipMode::Compressed)
+            {
+                int count = clip->m_sample_count * clip->m_channel;
+                const short* samples = (const short*) clip->m_samples.Bytes();
+
+                ByteBuffer pcm16;
+                if (clip->m_sample_bits == 8)
+                {
+                    pcm16 = ByteBuffer(count * 2);
+                    for (int i = 0; i < count; ++i)
+                    {
+                        ((short*) pcm16.Bytes())[i] = (short) ((clip->m_samples.Bytes()[i] - 128) << 8);
+                    }
+                    samples = (const short*) pcm16.Bytes();
+                }
+
+                clip->m_samples = EncodeAdpcm(samples, count, clip->m_channel);
+                clip->m_sample_bits = 16;
+                clip->m_byte_rate = clip->m_sample_rate * clip->m_channel * 2;
+                clip->m_mode = AudioClipMode::ADPCM;
+            }
+            else
+            {
+                // openal keeps its own copy
+                clip->m_private->BufferData(clip->m_channel, clip->m_sample_bits, clip->m_samples.Bytes(), clip->m_samples.Size(), clip->m_sample_rate);
+                clip->m_samples = ByteBuffer();
+                clip->m_mode = AudioClipMode::PCM;
+            }
         }
 
         return clip;
     }
 
 #if !VR_WASM
-    Ref<AudioClip> AudioClip::LoadMp3FromFile(const String& path)
+    Ref<AudioClip> AudioClip::LoadMp3FromFile(const String& path, AudioClipMode mode)
     {
         Ref<AudioClip> clip;
 
@@ -496,8 +582,47 @@ namespace Viry3D
             ByteBuffer buffer = File::ReadAllBytes(path);
             
             clip = Ref<AudioClip>(new AudioClip());
-            clip->m_stream = true;
             clip->m_private->InitMp3Decoder(buffer);
+            clip->m_mode = mode;
+
+            if (mode == AudioClipMode::Stream)
+            {
+                clip->m_stream = true;
+                return clip;
+            }
+
+            int channel = 0;
+            int sample_rate = 0;
+            int sample_count = 0;
+            if (!clip->m_private->ScanMp3(channel, sample_rate, sample_count))
+            {
+                Log("mp3 file decode failed: %s", path.CString());
+                return Ref<AudioClip>();
+            }
+
+            clip->m_channel = channel;
+            clip->m_sample_rate = sample_rate;
+            clip->m_sample_bits = 16;
+            clip->m_byte_rate = sample_rate * channel * 2;
+            clip->m_sample_count = sample_count;
+            clip->m_length = sample_count / (float) sample_rate;
+
+            if (mode != AudioClipMode::Compressed)
+            {
+                ByteBuffer pcm(sample_count * channel * 2);
+                clip->m_sample_count = clip->m_private->DecodeMp3All((short*) pcm.Bytes(), channel, sample_count);
+                clip->m_length = clip->m_sample_count / (float) sample_rate;
+                clip->m_private->m_mp3_buffer = ByteBuffer();
+
+                if (mode == AudioClipMode::ADPCM)
+                {
+                    clip->m_samples = EncodeAdpcm((const short*) pcm.Bytes(), clip->m_sample_count * channel, channel);
+                }
+                else
+                {
+                    clip->m_private->BufferData(channel, 16, pcm.Bytes(), clip->m_sample_count * channel * 2, sample_rate);
+                }
+            }
         }
         else
         {
@@ -516,13 +641,26 @@ namespace Viry3D
         m_sample_bits(0),
         m_length(0),
         m_sample_count(0),
-        m_stream(false)
+        m_stream(false),
+        m_stream_chunk_duration(STREAM_CHUNK_DURATION),
+        m_mode(AudioClipMode::PCM)
     {
         
     }
 
     AudioClip::~AudioClip()
     {
+        AudioDecodeEntry* entry;
+        if (g_decode_cache.TryGet(this, &entry))
+        {
+            if (AudioManager::HasContext())
+            {
+                alDeleteBuffers(1, &entry->buffer);
+            }
+            g_decode_cache_size -= entry->size;
+            g_decode_cache.Remove(this);
+        }
+
         Memory::SafeDelete(m_private);
     }
 
@@ -531,37 +669,198 @@ namespace Viry3D
         return (void*) (size_t) m_private->m_buffer;
     }
 
+    void* AudioClip::AcquireBuffer()
+    {
+        if (m_mode == AudioClipMode::PCM)
+        {
+            return this->GetBuffer();
+        }
+        if (m_mode == AudioClipMode::Stream)
+        {
+            return nullptr;
+        }
+
+        AudioDecodeEntry* entry;
+        if (g_decode_cache.TryGet(this, &entry))
+        {
+            entry->ref_count += 1;
+            entry->tick = ++g_decode_tick;
+            return (void*) (size_t) entry->buffer;
+        }
+
+        AudioDecodeEntry new_entry;
+        new_entry.buffer = 0;
+        new_entry.size = 0;
+        new_entry.ref_count = 1;
+        new_entry.tick = ++g_decode_tick;
+        new_entry.decode_id = ++g_decode_id;
+        g_decode_cache.Add(this, new_entry);
+
+        // the worker only reads copies of the source bytes, so the clip may go away while it decodes
+        AudioClip* clip = this;
+        int decode_id = new_entry.decode_id;
+        AudioClipMode mode = m_mode;
+        ByteBuffer samples = m_samples;
+#if !VR_WASM
+        ByteBuffer mp3_buffer = m_private->m_mp3_buffer;
+#endif
+        int channel = m_channel;
+        int sample_rate = m_sample_rate;
+        int sample_count = m_sample_count;
+
+        Thread::Task task;
+        task.job = [=]() {
+            auto result = RefMake<AudioDecodeResult>();
+            result->pcm = ByteBuffer(sample_count * channel * 2);
+            short* pcm = (short*) result->pcm.Bytes();
+
+            if (mode == AudioClipMode::ADPCM)
+            {
+                DecodeAdpcm(samples, pcm, sample_count * channel, channel);
+            }
+#if !VR_WASM
+            else if (mode == AudioClipMode::Compressed)
+            {
+                AudioClipPrivate decoder;
+                decoder.m_mp3_buffer = mp3_buffer;
+                int decoded = decoder.DecodeMp3All(pcm, channel, sample_count);
+                Memory::Zero(&pcm[decoded * channel], (sample_count - decoded) * channel * 2);
+            }
+#endif
+
+            return result;
+        };
+        task.complete = [=](const Ref<Object>& obj) {
+            // the clip is gone or was acquired again after a release dropped this decode
+            AudioDecodeEntry* entry;
+            if (!g_decode_cache.TryGet(clip, &entry) || entry->decode_id != decode_id || !AudioManager::HasContext())
+            {
+                return;
+            }
+
+            // openal copies the pcm on upload, the decoded bytes go with the result
+            const ByteBuffer& pcm = RefCast<AudioDecodeResult>(obj)->pcm;
+            TrimDecodeCache(pcm.Size());
+
+            alGenBuffers(1, &entry->buffer);
+            AudioClipPrivate::BufferData(entry->buffer, channel, 16, pcm.Bytes(), pcm.Size(), sample_rate);
+            entry->size = pcm.Size();
+            g_decode_cache_size += pcm.Size();
+        };
+
+        ThreadPool* thread_pool = Engine::Instance() ? Engine::Instance()->GetThreadPool() : nullptr;
+        if (thread_pool)
+        {
+            thread_pool->AddTask(task);
+        }
+        else
+        {
+            task.complete(task.job());
+        }
+
+        return this->GetDecodedBuffer();
+    }
+
+    void* AudioClip::GetDecodedBuffer() const
+    {
+        if (m_mode == AudioClipMode::PCM)
+        {
+            return this->GetBuffer();
+        }
+
+        const AudioDecodeEntry* entry;
+        if (g_decode_cache.TryGet((AudioClip*) this, &entry))
+        {
+            return (void*) (size_t) entry->buffer;
+        }
+        return nullptr;
+    }
+
+    void AudioClip::ReleaseBuffer()
+    {
+        AudioDecodeEntry* entry;
+        if (g_decode_cache.TryGet(this, &entry))
+        {
+            entry->ref_count -= 1;
+
+            // entries kept over budget while in use go once released
+            TrimDecodeCache(0);
+        }
+    }
+
+    void AudioClip::SetDecodeCacheBudget(int bytes)
+    {
+        g_decode_cache_budget = bytes;
+        TrimDecodeCache(0);
+    }
+
+    int AudioClip::GetDecodeCacheSize()
+    {
+        return g_decode_cache_size;
+    }
+
     void AudioClip::SetStreamLoop(bool loop)
     {
-        m_private->m_mutex.lock();
         m_private->m_stream_loop = loop;
-        m_private->m_mutex.unlock();
     }
 
 #if !VR_WASM
-    Vector<void*> AudioClip::GetStreamBuffers()
+    void AudioClip::SetStreamChunkDuration(float duration)
     {
-        Vector<void*> buffers;
+        m_stream_chunk_duration = Mathf::Max(duration, 0.01f);
+    }
 
-        m_private->m_mutex.lock();
-        for (auto i : m_private->m_stream_buffers)
+    bool AudioClip::RewindStream()
+    {
+        if (!m_stream)
         {
-            buffers.Add((void*) (size_t) i);
+            return false;
         }
-        m_private->m_stream_buffers.Clear();
-        m_private->m_mutex.unlock();
 
-        return buffers;
-    }
+        m_private->RewindMp3Decoder();
 
-    void AudioClip::RunMp3Decoder()
-    {
-        m_private->RunMp3Decoder();
+        // decode the first frame up front so the format is known before any chunk
+        if (!m_private->DecodeMp3Frame())
+        {
+            Log("mp3 stream decode failed");
+            return false;
+        }
+
+        const mad_pcm& pcm = m_private->m_mp3->synth.pcm;
+        m_channel = Mathf::Min((int) pcm.channels, 2);
+        m_sample_rate = pcm.samplerate;
+        m_sample_bits = 16;
+        m_byte_rate = m_sample_rate * m_channel * m_sample_bits / 8;
+
+        return true;
     }
 
-    void AudioClip::StopMp3Decoder()
+    bool AudioClip::DecodeStreamChunk(void* buffer)
     {
-        m_private->StopMp3Decoder();
+        if (m_channel == 0 || m_sample_rate == 0)
+        {
+            return false;
+        }
+
+        int frame_count = (int) (m_sample_rate * m_stream_chunk_duration);
+        int size = frame_count * m_channel * m_sample_bits / 8;
+        if (m_private->m_out_buffer.Size() != size)
+        {
+            m_private->m_out_buffer = ByteBuffer(size);
+        }
+
+        int decoded = m_private->DecodeMp3((short*) m_private->m_out_buffer.Bytes(), m_channel, frame_count);
+        if (decoded == 0)
+        {
+            return false;
+        }
+
+        if (buffer)
+        {
+            AudioClipPrivate::BufferData((ALuint) (size_t) buffer, m_channel, m_sample_bits, m_private->m_out_buffer.Bytes(), decoded * m_channel * m_sample_bits / 8, m_sample_rate);
+        }
+
+        return true;
     }
 #endif
 }
@@ -21,27 +21,49 @@
 #include "memory/ByteBuffer.h"
 #include <functional>
 
-#define STREAM_BUFFER_MAX 100
+#define STREAM_BUFFER_COUNT 4
+#define STREAM_CHUNK_DURATION 0.1f
+#define AUDIO_DECODE_CACHE_BUDGET (16 * 1024 * 1024)
 
 namespace Viry3D
 {
     class AudioClipPrivate;
 
+    enum class AudioClipMode
+    {
+        PCM,            // decoded at load into a resident buffer
+        ADPCM,          // ima adpcm in memory, decoded on play
+        Compressed,     // source bytes in memory, decoded on play
+        Stream,         // decoded chunk by chunk while playing
+    };
+
     class AudioClip : public Object
     {
     public:
-        static Ref<AudioClip> LoadWaveFromFile(const String& path);
+        // wave has no compressed form of its own, so Compressed means ADPCM there
+        static Ref<AudioClip> LoadWaveFromFile(const String& path, AudioClipMode mode = AudioClipMode::PCM);
 #if !VR_WASM
-        static Ref<AudioClip> LoadMp3FromFile(const String& path);
+        static Ref<AudioClip> LoadMp3FromFile(const String& path, AudioClipMode mode = AudioClipMode::Stream);
 #endif
+        static void SetDecodeCacheBudget(int bytes);
+        static int GetDecodeCacheSize();
         virtual ~AudioClip();
         void* GetBuffer() const;
+        // decoded pcm buffer for playing, shared through an lru cache for ADPCM and Compressed clips.
+        // those decode on a worker thread, the buffer is null until GetDecodedBuffer returns it
+        void* AcquireBuffer();
+        void* GetDecodedBuffer() const;
+        void ReleaseBuffer();
+        AudioClipMode GetMode() const { return m_mode; }
         bool IsStream() const { return m_stream; }
+        float GetLength() const { return m_length; }
         void SetStreamLoop(bool loop);
 #if !VR_WASM
-        Vector<void*> GetStreamBuffers();
-        void RunMp3Decoder();
-        void StopMp3Decoder();
+        float GetStreamChunkDuration() const { return m_stream_chunk_duration; }
+        void SetStreamChunkDuration(float duration);
+        bool RewindStream();
+        // decode next chunk into al buffer, a null buffer only decodes, false at end of stream
+        bool DecodeStreamChunk(void* buffer);
 #endif
 
     private:
@@ -57,5 +79,7 @@ namespace Viry3D
         float m_length;
         int m_sample_count;
         bool m_stream;
+        float m_stream_chunk_duration;
+        AudioClipMode m_mode;
     };
 }
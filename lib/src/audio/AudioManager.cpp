@@ -17,6 +17,8 @@
 
 #include "AudioManager.h"
 #include "AudioListener.h"
+#include "AudioSource.h"
+#include "container/Vector.h"
 #include "memory/Memory.h"
 #include "Debug.h"
 #include "GameObject.h"
@@ -49,6 +51,8 @@ namespace Viry3D
     static ALCdevice* g_device = nullptr;
     static ALCcontext* g_context = nullptr;
     static Ref<AudioListener> g_listener;
+    static Vector<ALuint> g_free_sources;
+    static int g_max_voices = AUDIO_MAX_VOICES;
 
     void AudioManager::Init()
     {
@@ -94,6 +98,12 @@ namespace Viry3D
     {
         g_listener.reset();
 
+        if (g_free_sources.Size() > 0)
+        {
+            alDeleteSources(g_free_sources.Size(), &g_free_sources[0]);
+            g_free_sources.Clear();
+        }
+
         alcMakeContextCurrent(nullptr);
         if (g_context)
         {
@@ -107,6 +117,11 @@ namespace Viry3D
         }
     }
 
+    bool AudioManager::HasContext()
+    {
+        return g_context != nullptr;
+    }
+
     const Ref<AudioListener>& AudioManager::GetListener()
     {
         if (!g_listener)
@@ -116,6 +131,47 @@ namespace Viry3D
         return g_listener;
     }
 
+    void AudioManager::Update()
+    {
+        AudioSource::UpdateVoices();
+    }
+
+    int AudioManager::GetMaxVoices()
+    {
+        return g_max_voices;
+    }
+
+    void AudioManager::SetMaxVoices(int count)
+    {
+        g_max_voices = count;
+    }
+
+    void* AudioManager::AcquireSource()
+    {
+        ALuint source = 0;
+
+        if (g_free_sources.Size() > 0)
+        {
+            source = g_free_sources[g_free_sources.Size() - 1];
+            g_free_sources.Resize(g_free_sources.Size() - 1);
+        }
+        else
+        {
+            alGenSources(1, &source);
+        }
+
+        return (void*) (size_t) source;
+    }
+
+    void AudioManager::ReleaseSource(void* source)
+    {
+        // without a context the source is already gone with it
+        if (g_context)
+        {
+            g_free_sources.Add((ALuint) (size_t) source);
+        }
+    }
+
 #if VR_WASM
     void AudioManager::PlayAudio(const String& url, bool loop)
     {
@@ -19,6 +19,10 @@
 
 #include "string/String.h"
 
+#define AUDIO_MAX_VOICES 32
+#define AUDIO_PRIORITY_DEFAULT 128
+#define AUDIO_MIN_AUDIBILITY 0.001f
+
 namespace Viry3D
 {
     class AudioListener;
@@ -28,7 +32,14 @@ namespace Viry3D
     public:
         static void Init();
         static void Done();
+        // false before Init and after Done, al objects are destroyed with the context
+        static bool HasContext();
         static const Ref<AudioListener>& GetListener();
+        static void Update();
+        static int GetMaxVoices();
+        static void SetMaxVoices(int count);
+        static void* AcquireSource();
+        static void ReleaseSource(void* source);
 #if VR_WASM
         static void PlayAudio(const String& url, bool loop);
         static void PauseAudio();
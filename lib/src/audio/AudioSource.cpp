@@ -17,8 +17,11 @@
 
 #include "AudioSource.h"
 #include "AudioClip.h"
+#include "AudioManager.h"
 #include "memory/Memory.h"
 #include "container/List.h"
+#include "time/Time.h"
+#include "math/Mathf.h"
 #include "Debug.h"
 #include "Transform.h"
 
@@ -30,151 +33,222 @@
 
 namespace Viry3D
 {
+    static List<AudioSource*> g_voices;
+
     class AudioSourcePrivate
     {
     public:
         ALuint m_source;
+        AudioClip* m_clip;
+        bool m_stream;
         bool m_loop;
-        List<ALuint> m_stream_buffers;
-        bool m_wait_for_play;
-        bool m_paused;
+        float m_volume;
+        int m_priority;
+        float m_length;
+        float m_time;
+        float m_audibility;
+        bool m_virtual;
+        AudioSource::State m_state;
+        Vector3 m_position;
+        Vector3 m_direction;
+        ALuint m_stream_buffers[STREAM_BUFFER_COUNT];
+        int m_stream_queued;
+        bool m_stream_end;
+        // the clip still decodes on a worker, the source waits without a buffer
+        bool m_buffer_pending;
 
         AudioSourcePrivate():
             m_source(0),
+            m_clip(nullptr),
+            m_stream(false),
             m_loop(false),
-            m_wait_for_play(false),
-            m_paused(false)
+            m_volume(1.0f),
+            m_priority(AUDIO_PRIORITY_DEFAULT),
+            m_length(0),
+            m_time(0),
+            m_audibility(0),
+            m_virtual(false),
+            m_state(AudioSource::State::Initial),
+            m_position(0, 0, 0),
+            m_direction(0, 0, 1),
+            m_stream_queued(0),
+            m_stream_end(true),
+            m_buffer_pending(false)
         {
-            alGenSources(1, &m_source);
-
-            alSourcef(m_source, AL_PITCH, 1.0f);
-            alSourcef(m_source, AL_GAIN, 1.0f);
-
-            this->SetLoop(false);
-            this->SetPosition(Vector3(0, 0, 0));
-            this->SetVelocity(Vector3(0, 0, 0));
-            this->SetDirection(Vector3(0, 0, 1));
+            Memory::Zero(m_stream_buffers, sizeof(m_stream_buffers));
         }
 
         ~AudioSourcePrivate()
         {
-            this->Stop();
-            this->ClearBuffers();
+            if (m_stream_buffers[0] && AudioManager::HasContext())
+            {
+                alDeleteBuffers(STREAM_BUFFER_COUNT, m_stream_buffers);
+            }
+        }
+
+        void ApplySource()
+        {
+            Vector3 velocity(0, 0, 0);
 
-            alDeleteSources(1, &m_source);
+            alSourcef(m_source, AL_PITCH, 1.0f);
+            alSourcef(m_source, AL_GAIN, m_volume);
+            alSourcei(m_source, AL_LOOPING, (m_loop && !m_stream) ? AL_TRUE : AL_FALSE);
+            alSourcefv(m_source, AL_POSITION, (const ALfloat*) &m_position);
+            alSourcefv(m_source, AL_VELOCITY, (const ALfloat*) &velocity);
+            alSourcefv(m_source, AL_DIRECTION, (const ALfloat*) &m_direction);
         }
 
-        void ClearBuffers()
+        // bind a pooled source and resume from the tracked time
+        void AttachSource(ALuint source)
         {
-            alSourcei(m_source, AL_BUFFER, 0);
+            m_source = source;
+            m_virtual = false;
 
-            if (m_stream_buffers.Size() > 0)
+            this->ApplySource();
+
+            if (!m_stream)
             {
-                Vector<ALuint> buffers(m_stream_buffers.Size());
-                for (int i = 0; i < buffers.Size(); ++i)
+                ALuint buffer = (ALuint) (size_t) m_clip->AcquireBuffer();
+                m_buffer_pending = buffer == 0;
+
+                if (!m_buffer_pending)
                 {
-                    buffers[i] = m_stream_buffers.First();
-                    m_stream_buffers.RemoveFirst();
+                    this->BindBuffer(buffer);
                 }
-
-                alDeleteBuffers(buffers.Size(), &buffers[0]);
             }
         }
 
-        void SourceBuffer(ALuint buffer)
+        void BindBuffer(ALuint buffer)
         {
             alSourcei(m_source, AL_BUFFER, buffer);
-        }
+            alSourcef(m_source, AL_SEC_OFFSET, m_time);
 
-        void SetLoop(bool loop)
-        {
-            alSourcei(m_source, AL_LOOPING, loop ? AL_TRUE : AL_FALSE);
+            if (m_state == AudioSource::State::Playing)
+            {
+                alSourcePlay(m_source);
+            }
         }
 
-        void SetPosition(const Vector3& pos)
+        void DetachSource()
         {
-            alSourcefv(m_source, AL_POSITION, (const ALfloat*) &pos);
-        }
+            if (m_source == 0)
+            {
+                return;
+            }
 
-        void SetVelocity(const Vector3& velocity)
-        {
-            alSourcefv(m_source, AL_VELOCITY, (const ALfloat*) &velocity);
+            // sources destroyed after AudioManager::Done have no al source left to touch
+            if (AudioManager::HasContext())
+            {
+                if (!m_stream && m_state != AudioSource::State::Stopped)
+                {
+                    alGetSourcef(m_source, AL_SEC_OFFSET, &m_time);
+                }
+
+                // detaching the buffer also drops any queued stream buffers
+                alSourceStop(m_source);
+                alSourcei(m_source, AL_BUFFER, 0);
+            }
+            m_stream_queued = 0;
+            m_stream_end = true;
+            m_buffer_pending = false;
+
+            if (!m_stream)
+            {
+                m_clip->ReleaseBuffer();
+            }
+
+            AudioManager::ReleaseSource((void*) (size_t) m_source);
+            m_source = 0;
         }
 
-        void SetDirection(const Vector3& dir)
+        bool IsSourceStopped() const
         {
-            alSourcefv(m_source, AL_DIRECTION, (const ALfloat*) &dir);
+            ALint state = 0;
+            alGetSourcei(m_source, AL_SOURCE_STATE, &state);
+            return state == AL_STOPPED;
         }
 
-        void Play()
+        // gain after the default inverse clamped distance model of openal
+        float ComputeAudibility(const Vector3& listener) const
         {
-            m_paused = false;
-            alSourcePlay(m_source);
+            const float reference_distance = 1.0f;
+            const float rolloff = 1.0f;
+
+            float distance = Mathf::Max(Vector3::Distance(m_position, listener), reference_distance);
+            float attenuation = reference_distance / (reference_distance + rolloff * (distance - reference_distance));
+
+            return m_volume * attenuation;
         }
 
-        void Pause()
+#if !VR_WASM
+        // buffers are generated once and recycled through the source queue
+        bool StartStream(const Ref<AudioClip>& clip)
         {
-            if (this->GetState() == AudioSource::State::Playing)
+            if (!clip->RewindStream())
             {
-                m_paused = true;
-                alSourcePause(m_source);
+                return false;
             }
-        }
 
-        void Stop()
-        {
-            m_paused = false;
-            alSourceStop(m_source);
-        }
+            if (m_stream_buffers[0] == 0)
+            {
+                alGenBuffers(STREAM_BUFFER_COUNT, m_stream_buffers);
+            }
 
-        AudioSource::State GetState() const
-        {
-            ALint state = 0;
-            alGetSourcei(m_source, AL_SOURCE_STATE, &state);
-            
-            switch (state)
+            m_stream_end = false;
+            for (int i = 0; i < STREAM_BUFFER_COUNT; ++i)
             {
-                case AL_INITIAL:
-                    return AudioSource::State::Initial;
-                case AL_PLAYING:
-                    return AudioSource::State::Playing;
-                case AL_PAUSED:
-                    return AudioSource::State::Paused;
-                case AL_STOPPED:
-                    return AudioSource::State::Stopped;
+                if (!this->QueueStreamBuffer(clip, m_stream_buffers[i]))
+                {
+                    break;
+                }
             }
 
-            return AudioSource::State::Unknown;
+            return m_stream_queued > 0;
         }
 
-        void QueueBuffers(const Vector<void*>& buffers)
+        bool QueueStreamBuffer(const Ref<AudioClip>& clip, ALuint buffer)
         {
-            for (int i = 0; i < buffers.Size(); ++i)
+            if (m_stream_end || !clip->DecodeStreamChunk((void*) (size_t) buffer))
             {
-                ALuint buffer = (ALuint) (size_t) buffers[i];
-                m_stream_buffers.AddLast(buffer);
-
-                alSourceQueueBuffers(m_source, 1, &buffer);
+                m_stream_end = true;
+                return false;
             }
+
+            alSourceQueueBuffers(m_source, 1, &buffer);
+            m_stream_queued += 1;
+
+            return true;
         }
 
-        void UnqueueBuffers()
+        // returns false when the stream has finished playing
+        bool UpdateStream(const Ref<AudioClip>& clip)
         {
             int processed = 0;
             alGetSourcei(m_source, AL_BUFFERS_PROCESSED, &processed);
-            if (processed > 0)
+
+            for (int i = 0; i < processed; ++i)
             {
-                Vector<ALuint> buffers_remove(processed);
-                for (int i = 0; i < buffers_remove.Size(); ++i)
-                {
-                    buffers_remove[i] = m_stream_buffers.First();
-                    m_stream_buffers.RemoveFirst();
-                }
+                ALuint buffer = 0;
+                alSourceUnqueueBuffers(m_source, 1, &buffer);
+                m_stream_queued -= 1;
+
+                this->QueueStreamBuffer(clip, buffer);
+            }
+
+            if (m_stream_queued == 0)
+            {
+                return false;
+            }
 
-                alSourceUnqueueBuffers(m_source, buffers_remove.Size(), &buffers_remove[0]);
-                alDeleteBuffers(buffers_remove.Size(), &buffers_remove[0]);
+            // restart after an underrun, the queue ran dry before refill
+            if (m_state == AudioSource::State::Playing && this->IsSourceStopped())
+            {
+                alSourcePlay(m_source);
             }
+
+            return true;
         }
+#endif
     };
 
     AudioSource::AudioSource():
@@ -185,6 +259,7 @@ namespace Viry3D
 
     AudioSource::~AudioSource()
     {
+        this->Stop();
         Memory::SafeDelete(m_private);
     }
 
@@ -193,22 +268,18 @@ namespace Viry3D
         this->Stop();
 
         m_clip = clip;
+        m_private->m_clip = m_clip.get();
+        m_private->m_stream = false;
+        m_private->m_length = 0;
 
         if (m_clip)
         {
-            if (!m_clip->IsStream())
-            {
-                ALuint buffer = (ALuint) (size_t) m_clip->GetBuffer();
-                m_private->SourceBuffer(buffer);
-            }
-            else
-            {
-                m_private->SetLoop(false);
+            m_private->m_stream = m_clip->IsStream();
+            m_private->m_length = m_clip->GetLength();
 
-                if (m_private->m_loop)
-                {
-                    m_clip->SetStreamLoop(true);
-                }
+            if (m_private->m_stream && m_private->m_loop)
+            {
+                m_clip->SetStreamLoop(true);
             }
         }
     }
@@ -221,100 +292,244 @@ namespace Viry3D
         {
             m_clip->SetStreamLoop(loop);
         }
-        else
+        else if (m_private->m_source)
+        {
+            alSourcei(m_private->m_source, AL_LOOPING, loop ? AL_TRUE : AL_FALSE);
+        }
+    }
+
+    void AudioSource::SetVolume(float volume)
+    {
+        m_private->m_volume = volume;
+
+        if (m_private->m_source)
         {
-            m_private->SetLoop(loop);
+            alSourcef(m_private->m_source, AL_GAIN, volume);
         }
     }
 
+    float AudioSource::GetVolume() const
+    {
+        return m_private->m_volume;
+    }
+
+    void AudioSource::SetPriority(int priority)
+    {
+        m_private->m_priority = priority;
+    }
+
+    int AudioSource::GetPriority() const
+    {
+        return m_private->m_priority;
+    }
+
+    bool AudioSource::IsVirtual() const
+    {
+        return m_private->m_virtual;
+    }
+
     void AudioSource::Play()
     {
-        if (m_clip)
+        if (!m_clip)
         {
-            if (m_clip->IsStream())
-            {
-#if !VR_WASM
-                if (m_private->m_paused)
-                {
-                    m_private->Play();
-                }
-                else
-                {
-                    this->Stop();
+            return;
+        }
 
-                    m_clip->RunMp3Decoder();
+        if (m_private->m_state == State::Paused)
+        {
+            m_private->m_state = State::Playing;
 
-                    m_private->m_wait_for_play = true;
-                }
-#endif
+            if (m_private->m_source)
+            {
+                alSourcePlay(m_private->m_source);
             }
-            else
+            return;
+        }
+
+        this->Stop();
+
+        if (m_clip->IsStream())
+        {
+#if !VR_WASM
+            // streams decode into the source queue, so they always hold a real voice
+            m_private->AttachSource((ALuint) (size_t) AudioManager::AcquireSource());
+
+            if (!m_private->StartStream(m_clip))
             {
-                m_private->Play();
+                m_private->DetachSource();
+                return;
             }
+
+            alSourcePlay(m_private->m_source);
+#else
+            return;
+#endif
         }
+
+        // other voices get a source on the next voice update
+        m_private->m_state = State::Playing;
+        m_private->m_time = 0;
+        g_voices.AddLast(this);
     }
 
     void AudioSource::Pause()
     {
-        m_private->Pause();
+        if (m_private->m_state == State::Playing)
+        {
+            m_private->m_state = State::Paused;
+
+            if (m_private->m_source)
+            {
+                alSourcePause(m_private->m_source);
+            }
+        }
     }
 
     void AudioSource::Stop()
     {
-        if (m_clip)
+        if (m_private->m_state == State::Playing || m_private->m_state == State::Paused)
         {
-            m_private->Stop();
-            m_private->ClearBuffers();
-
-            if (m_clip->IsStream())
-            {
-#if !VR_WASM
-                m_clip->StopMp3Decoder();
-
-                m_private->m_wait_for_play = false;
-#endif
-            }
+            g_voices.Remove(this);
         }
+
+        m_private->m_state = State::Stopped;
+        m_private->DetachSource();
+        m_private->m_time = 0;
+        m_private->m_virtual = false;
     }
 
     void AudioSource::OnTransformDirty()
     {
-        Vector3 pos = this->GetTransform()->GetPosition();
-        Vector3 forward = this->GetTransform()->GetForward();
+        m_private->m_position = this->GetTransform()->GetPosition();
+        m_private->m_direction = this->GetTransform()->GetForward();
 
-        m_private->SetPosition(pos);
-        m_private->SetDirection(forward);
+        if (m_private->m_source)
+        {
+            alSourcefv(m_private->m_source, AL_POSITION, (const ALfloat*) &m_private->m_position);
+            alSourcefv(m_private->m_source, AL_DIRECTION, (const ALfloat*) &m_private->m_direction);
+        }
     }
 
     AudioSource::State AudioSource::GetState() const
     {
-        return m_private->GetState();
+        return m_private->m_state;
     }
 
-    void AudioSource::Update()
+    void AudioSource::UpdateVoices()
     {
-#if !VR_WASM
-        if (m_clip && m_clip->IsStream())
+        if (g_voices.Size() == 0)
+        {
+            return;
+        }
+
+        float delta_time = Time::GetDeltaTime();
+        Vector3 listener;
+        alGetListenerfv(AL_POSITION, (ALfloat*) &listener);
+
+        List<AudioSource*> voices;
+        for (auto i : g_voices)
+        {
+            voices.AddLast(i);
+        }
+
+        List<AudioSource*> active;
+        for (auto i : voices)
         {
-            if (m_private->m_stream_buffers.Size() < STREAM_BUFFER_MAX)
+            AudioSourcePrivate* p = i->m_private;
+
+            if (p->m_source)
             {
-                m_private->QueueBuffers(m_clip->GetStreamBuffers());
+#if !VR_WASM
+                if (p->m_stream)
+                {
+                    if (!p->UpdateStream(i->m_clip))
+                    {
+                        i->Stop();
+                        continue;
+                    }
+                }
+                else
+#endif
+                if (p->m_buffer_pending)
+                {
+                    ALuint buffer = (ALuint) (size_t) i->m_clip->GetDecodedBuffer();
+                    if (buffer)
+                    {
+                        p->m_buffer_pending = false;
+                        p->BindBuffer(buffer);
+                    }
+                }
+                else if (p->m_state == State::Playing && p->IsSourceStopped())
+                {
+                    i->Stop();
+                    continue;
+                }
             }
-            else
+            else if (p->m_virtual && p->m_state == State::Playing)
             {
-                if (m_private->m_wait_for_play)
+                // virtual voices only track time
+                p->m_time += delta_time;
+
+                if (p->m_time >= p->m_length)
                 {
-                    m_private->m_wait_for_play = false;
-                    m_private->Play();
+                    if (p->m_loop && p->m_length > 0)
+                    {
+                        p->m_time = fmodf(p->m_time, p->m_length);
+                    }
+                    else
+                    {
+                        i->Stop();
+                        continue;
+                    }
                 }
             }
-            
-            if (!m_private->m_wait_for_play)
+
+            p->m_audibility = p->ComputeAudibility(listener);
+            active.AddLast(i);
+        }
+
+        active.Sort([](AudioSource* a, AudioSource* b) {
+            const AudioSourcePrivate* pa = a->m_private;
+            const AudioSourcePrivate* pb = b->m_private;
+
+            if (pa->m_stream != pb->m_stream)
+            {
+                return pa->m_stream;
+            }
+            if (pa->m_priority != pb->m_priority)
+            {
+                return pa->m_priority < pb->m_priority;
+            }
+            return pa->m_audibility > pb->m_audibility;
+        });
+
+        // release sources before handing them to promoted voices
+        int max_voices = AudioManager::GetMaxVoices();
+        int index = 0;
+        for (auto i : active)
+        {
+            AudioSourcePrivate* p = i->m_private;
+            bool real = p->m_stream || (index < max_voices && p->m_audibility >= AUDIO_MIN_AUDIBILITY);
+
+            if (!real)
             {
-                m_private->UnqueueBuffers();
+                p->DetachSource();
+                p->m_virtual = true;
             }
+            ++index;
+        }
+
+        index = 0;
+        for (auto i : active)
+        {
+            AudioSourcePrivate* p = i->m_private;
+            bool real = p->m_stream || (index < max_voices && p->m_audibility >= AUDIO_MIN_AUDIBILITY);
+
+            if (real && p->m_source == 0)
+            {
+                p->AttachSource((ALuint) (size_t) AudioManager::AcquireSource());
+            }
+            ++index;
         }
-#endif
     }
 }
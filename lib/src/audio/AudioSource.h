@@ -42,13 +42,20 @@ namespace Viry3D
         const Ref<AudioClip>& GetClip() const { return m_clip; }
         void SetClip(const Ref<AudioClip>& clip);
         void SetLoop(bool loop);
+        float GetVolume() const;
+        void SetVolume(float volume);
+        // lower value is more important, voices over the limit are virtualized by priority then audibility
+        int GetPriority() const;
+        void SetPriority(int priority);
+        bool IsVirtual() const;
         void Play();
         void Pause();
         void Stop();
         State GetState() const;
+        // called by AudioManager::Update
+        static void UpdateVoices();
 
     protected:
-		virtual void Update();
         virtual void OnTransformDirty();
 
     private:
@@ -306,9 +306,18 @@ namespace filament
 
 		DXGI_FORMAT D3D11Context::GetTextureFormat(TextureFormat format)
 		{
+			if (isETC2Compression(format) || isASTCCompression(format))
+			{
+				return DXGI_FORMAT_UNKNOWN;
+			}
+
 			switch (format)
 			{
 			case TextureFormat::RGBA8: return DXGI_FORMAT_R8G8B8A8_UNORM;
+			case TextureFormat::DXT1_RGB: return DXGI_FORMAT_BC1_UNORM;
+			case TextureFormat::DXT1_RGBA: return DXGI_FORMAT_BC1_UNORM;
+			case TextureFormat::DXT3_RGBA: return DXGI_FORMAT_BC2_UNORM;
+			case TextureFormat::DXT5_RGBA: return DXGI_FORMAT_BC3_UNORM;
 			case TextureFormat::DEPTH16: return DXGI_FORMAT_R16_TYPELESS;
 			case TextureFormat::DEPTH24: return DXGI_FORMAT_UNKNOWN;
 			case TextureFormat::DEPTH24_STENCIL8: return DXGI_FORMAT_R24G8_TYPELESS;
@@ -321,9 +330,18 @@ namespace filament
 
 		DXGI_FORMAT D3D11Context::GetTextureViewFormat(TextureFormat format)
 		{
+			if (isETC2Compression(format) || isASTCCompression(format))
+			{
+				return DXGI_FORMAT_UNKNOWN;
+			}
+
 			switch (format)
 			{
 			case TextureFormat::RGBA8: return DXGI_FORMAT_R8G8B8A8_UNORM;
+			case TextureFormat::DXT1_RGB: return DXGI_FORMAT_BC1_UNORM;
+			case TextureFormat::DXT1_RGBA: return DXGI_FORMAT_BC1_UNORM;
+			case TextureFormat::DXT3_RGBA: return DXGI_FORMAT_BC2_UNORM;
+			case TextureFormat::DXT5_RGBA: return DXGI_FORMAT_BC3_UNORM;
 			case TextureFormat::DEPTH16: return DXGI_FORMAT_R16_UNORM;
 			case TextureFormat::DEPTH24: return DXGI_FORMAT_UNKNOWN;
 			case TextureFormat::DEPTH24_STENCIL8: return DXGI_FORMAT_R24_UNORM_X8_TYPELESS;
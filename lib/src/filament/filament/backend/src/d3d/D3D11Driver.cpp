@@ -899,18 +899,19 @@ namespace filament
 
 			m_context->SetState(ps);
 
-			std::vector<ID3D11Buffer*> buffers;
-			std::vector<UINT> strides;
-			std::vector<UINT> offsets;
+			// input slot i always feeds attribute i, unused slots are bound to null
+			std::vector<ID3D11Buffer*> buffers(vertex_buffer->attributes.size(), nullptr);
+			std::vector<UINT> strides(vertex_buffer->attributes.size(), 0);
+			std::vector<UINT> offsets(vertex_buffer->attributes.size(), 0);
 
 			for (size_t i = 0; i < vertex_buffer->attributes.size(); ++i)
 			{
 				const auto& attribute = vertex_buffer->attributes[i];
-				if (attribute.buffer != 0XFF)
+				if (attribute.buffer != 0XFF && (primitive->enabled_attributes & (1 << i)))
 				{
-					buffers.push_back(vertex_buffer->buffers[attribute.buffer]);
-					strides.push_back(attribute.stride);
-					offsets.push_back(attribute.offset);
+					buffers[i] = vertex_buffer->buffers[attribute.buffer];
+					strides[i] = attribute.stride;
+					offsets[i] = attribute.offset;
 				}
 			}
 			
@@ -950,14 +951,36 @@ namespace filament
 			}
 			m_context->context->IASetPrimitiveTopology(primitive_type);
 
-			if (program->input_layout == nullptr)
+			std::string layout_key;
+			for (size_t i = 0; i < vertex_buffer->attributes.size(); ++i)
+			{
+				if (primitive->enabled_attributes & (1 << i))
+				{
+					const auto& attribute = vertex_buffer->attributes[i];
+					layout_key.push_back((char) i);
+					layout_key.push_back((char) attribute.type);
+					layout_key.push_back((char) attribute.flags);
+				}
+			}
+
+			ID3D11InputLayout*& input_layout = program->input_layouts[layout_key];
+			if (input_layout == nullptr)
 			{
-				auto get_format = [](ElementType type) {
+				auto get_format = [](ElementType type, uint8_t flags) {
+					bool normalized = (flags & Attribute::FLAG_NORMALIZED) != 0;
 					switch (type)
 					{
 					case ElementType::FLOAT2: return DXGI_FORMAT_R32G32_FLOAT;
 					case ElementType::FLOAT3: return DXGI_FORMAT_R32G32B32_FLOAT;
 					case ElementType::FLOAT4: return DXGI_FORMAT_R32G32B32A32_FLOAT;
+					case ElementType::HALF2: return DXGI_FORMAT_R16G16_FLOAT;
+					case ElementType::HALF4: return DXGI_FORMAT_R16G16B16A16_FLOAT;
+					case ElementType::UBYTE4: return normalized ? DXGI_FORMAT_R8G8B8A8_UNORM : DXGI_FORMAT_R8G8B8A8_UINT;
+					case ElementType::BYTE4: return normalized ? DXGI_FORMAT_R8G8B8A8_SNORM : DXGI_FORMAT_R8G8B8A8_SINT;
+					case ElementType::USHORT2: return normalized ? DXGI_FORMAT_R16G16_UNORM : DXGI_FORMAT_R16G16_UINT;
+					case ElementType::SHORT2: return normalized ? DXGI_FORMAT_R16G16_SNORM : DXGI_FORMAT_R16G16_SINT;
+					case ElementType::USHORT4: return normalized ? DXGI_FORMAT_R16G16B16A16_UNORM : DXGI_FORMAT_R16G16B16A16_UINT;
+					case ElementType::SHORT4: return normalized ? DXGI_FORMAT_R16G16B16A16_SNORM : DXGI_FORMAT_R16G16B16A16_SINT;
 					default: assert(false); return DXGI_FORMAT_UNKNOWN;
 					}
 				};
@@ -971,7 +994,7 @@ namespace filament
 						D3D11_INPUT_ELEMENT_DESC desc = { };
 						desc.SemanticName = "TEXCOORD";
 						desc.SemanticIndex = (UINT) i;
-						desc.Format = get_format(attribute.type);
+						desc.Format = get_format(attribute.type, attribute.flags);
 						desc.InputSlot = (UINT) i;
 						desc.InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
 
@@ -984,10 +1007,10 @@ namespace filament
 					(UINT) input_descs.size(),
 					program->vertex_binary->GetBufferPointer(),
 					program->vertex_binary->GetBufferSize(),
-					&program->input_layout);
+					&input_layout);
 				assert(SUCCEEDED(hr));
 			}
-			m_context->context->IASetInputLayout(program->input_layout);
+			m_context->context->IASetInputLayout(input_layout);
 
 			m_context->context->DrawIndexed(primitive->count, primitive->offset, 0);
 		}
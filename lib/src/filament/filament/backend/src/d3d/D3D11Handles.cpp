@@ -18,6 +18,7 @@
 #include "D3D11Handles.h"
 #include <d3dcompiler.h>
 #include <assert.h>
+#include <algorithm>
 
 #if VR_UWP
 namespace Viry3D
@@ -248,7 +249,11 @@ namespace filament
 			SAFE_RELEASE(pixel_binary);
 			SAFE_RELEASE(vertex_shader);
 			SAFE_RELEASE(pixel_shader);
-			SAFE_RELEASE(input_layout);
+			for (auto& i : input_layouts)
+			{
+				SAFE_RELEASE(i.second);
+			}
+			input_layouts.clear();
 		}
 
 		D3D11UniformBuffer::D3D11UniformBuffer(D3D11Context* context, size_t size, BufferUsage usage):
@@ -359,7 +364,8 @@ namespace filament
 				bind_flags |= D3D11_BIND_SHADER_RESOURCE;
 			}
 
-			if (levels > 1)
+			// block compressed textures come with their mip chain and can not be render targets
+			if (levels > 1 && !isS3TCCompression(format))
 			{
 				mip_levels = 0;
 				bind_flags |= D3D11_BIND_RENDER_TARGET;
@@ -429,6 +435,15 @@ namespace filament
 			D3D11_BOX box = { (UINT) x, (UINT) y, 0, (UINT) (x + w), (UINT) (y + h), 1 };
 			UINT row_pitch = (UINT) getTextureFormatSize(format) * w;
 
+			if (isS3TCCompression(format))
+			{
+				// rows of 4x4 blocks, the box covers whole blocks
+				UINT block_size = (format == TextureFormat::DXT1_RGB || format == TextureFormat::DXT1_RGBA) ? 8 : 16;
+				box.right = x + ((w + 3) & ~3);
+				box.bottom = y + ((h + 3) & ~3);
+				row_pitch = block_size * ((w + 3) / 4);
+			}
+
 			context->context->UpdateSubresource1(
 				texture,
 				subresource,
@@ -582,54 +597,41 @@ namespace filament
 			}
 			else
 			{
-				CD3D11_BUFFER_DESC buffer_desc((UINT) (offset + data.size), D3D11_BIND_VERTEX_BUFFER);
-
-				switch (usage)
+				// size the buffer for the whole vertex count, later updates may write sub ranges
+				uint32_t size = 0;
+				for (size_t i = 0; i < attributes.size(); ++i)
 				{
-				case BufferUsage::STATIC:
-					buffer_desc.Usage = D3D11_USAGE_DEFAULT;
-					break;
-				case BufferUsage::DYNAMIC:
-					buffer_desc.Usage = D3D11_USAGE_DYNAMIC;
-					buffer_desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-					break;
-				default:
-					assert(false);
-					break;
+					if (attributes[i].buffer == index)
+					{
+						size = std::max(size, attributes[i].offset + attributes[i].stride * vertexCount);
+					}
 				}
+				size = std::max(size, (uint32_t) (offset + data.size));
+
+				// dynamic buffers use default usage too, so partial updates are ordered with draws by the runtime
+				// instead of mapping memory the gpu may still read
+				CD3D11_BUFFER_DESC buffer_desc((UINT) size, D3D11_BIND_VERTEX_BUFFER);
+				buffer_desc.Usage = D3D11_USAGE_DEFAULT;
 
 				HRESULT hr = context->device->CreateBuffer(&buffer_desc, nullptr, &buffers[index]);
 				assert(SUCCEEDED(hr));
 			}
 
-			if (usage == BufferUsage::DYNAMIC)
-			{
-				D3D11_MAPPED_SUBRESOURCE res = { };
-				HRESULT hr = context->context->Map(
-					buffers[index],
-					0,
-					D3D11_MAP_WRITE_DISCARD,
-					0,
-					&res);
-				assert(SUCCEEDED(hr));
+			D3D11_BUFFER_DESC buffer_desc = { };
+			buffers[index]->GetDesc(&buffer_desc);
 
-				uint8_t* p = (uint8_t*) res.pData;
-				memcpy(&p[offset], data.buffer, data.size);
+			// a full update of a dynamic buffer may rename it, a partial one keeps the rest
+			bool discard = usage == BufferUsage::DYNAMIC && offset == 0 && data.size >= buffer_desc.ByteWidth;
 
-				context->context->Unmap(buffers[index], 0);
-			}
-			else
-			{
-				D3D11_BOX box = { offset, 0, 0, offset + (UINT) data.size, 1, 1 };
-				context->context->UpdateSubresource1(
-					buffers[index],
-					0,
-					&box,
-					data.buffer,
-					0,
-					0,
-					0);
-			}
+			D3D11_BOX box = { offset, 0, 0, offset + (UINT) data.size, 1, 1 };
+			context->context->UpdateSubresource1(
+				buffers[index],
+				0,
+				&box,
+				data.buffer,
+				0,
+				0,
+				discard ? D3D11_COPY_DISCARD : 0);
 		}
 
 		D3D11IndexBuffer::D3D11IndexBuffer(
@@ -640,21 +642,9 @@ namespace filament
 			HwIndexBuffer((uint8_t) D3D11Driver::getElementTypeSize(element_type), index_count),
 			usage(usage)
 		{
+			// default usage for dynamic buffers too, see D3D11VertexBuffer::Update
 			CD3D11_BUFFER_DESC buffer_desc((UINT) (elementSize * index_count), D3D11_BIND_INDEX_BUFFER);
-
-			switch (usage)
-			{
-			case BufferUsage::STATIC:
-				buffer_desc.Usage = D3D11_USAGE_DEFAULT;
-				break;
-			case BufferUsage::DYNAMIC:
-				buffer_desc.Usage = D3D11_USAGE_DYNAMIC;
-				buffer_desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-				break;
-			default:
-				assert(false);
-				break;
-			}
+			buffer_desc.Usage = D3D11_USAGE_DEFAULT;
 
 			HRESULT hr = context->device->CreateBuffer(&buffer_desc, nullptr, &buffer);
 			assert(SUCCEEDED(hr));
@@ -670,34 +660,20 @@ namespace filament
 			const BufferDescriptor& data,
 			uint32_t offset)
 		{
-			if (usage == BufferUsage::DYNAMIC)
-			{
-				D3D11_MAPPED_SUBRESOURCE res = { };
-				HRESULT hr = context->context->Map(
-					buffer,
-					0,
-					D3D11_MAP_WRITE_DISCARD,
-					0,
-					&res);
-				assert(SUCCEEDED(hr));
+			assert(offset + data.size <= elementSize * count);
 
-				uint8_t* p = (uint8_t*) res.pData;
-				memcpy(&p[offset], data.buffer, data.size);
+			// a full update of a dynamic buffer may rename it, a partial one keeps the rest
+			bool discard = usage == BufferUsage::DYNAMIC && offset == 0 && data.size >= elementSize * count;
 
-				context->context->Unmap(buffer, 0);
-			}
-			else
-			{
-				D3D11_BOX box = { offset, 0, 0, offset + (UINT) data.size, 1, 1 };
-				context->context->UpdateSubresource1(
-					buffer,
-					0,
-					&box,
-					data.buffer,
-					0,
-					0,
-					0);
-			}
+			D3D11_BOX box = { offset, 0, 0, offset + (UINT) data.size, 1, 1 };
+			context->context->UpdateSubresource1(
+				buffer,
+				0,
+				&box,
+				data.buffer,
+				0,
+				0,
+				discard ? D3D11_COPY_DISCARD : 0);
 		}
 
 		D3D11RenderPrimitive::D3D11RenderPrimitive(D3D11Context* context)
@@ -19,6 +19,7 @@
 
 #include "D3D11Driver.h"
 #include "D3D11Context.h"
+#include <string>
 
 namespace filament
 {
@@ -63,7 +64,8 @@ namespace filament
 			ID3DBlob* pixel_binary = nullptr;
 			ID3D11VertexShader* vertex_shader = nullptr;
 			ID3D11PixelShader* pixel_shader = nullptr;
-			ID3D11InputLayout* input_layout = nullptr;
+			// keyed by the vertex layout, meshes drawn with one program may use different vertex formats
+			std::unordered_map<std::string, ID3D11InputLayout*> input_layouts;
 		};
 
 		struct D3D11UniformBuffer : public HwUniformBuffer
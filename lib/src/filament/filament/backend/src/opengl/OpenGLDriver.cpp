@@ -273,7 +273,13 @@ bool OpenGLDriver::hasExtension(ExtentionSet const& map, utils::StaticString ext
 void OpenGLDriver::initExtensionsGLES(GLint major, GLint minor, ExtentionSet const& exts) {
     // figure out and initialize the extensions we need
     ext.texture_filter_anisotropic = hasExtension(exts, "GL_EXT_texture_filter_anisotropic");
+#if defined(__EMSCRIPTEN__)
+    ext.texture_compression_etc2 = hasExtension(exts, "WEBGL_compressed_texture_etc");
+    ext.texture_compression_astc = hasExtension(exts, "WEBGL_compressed_texture_astc");
+#else
     ext.texture_compression_etc2 = true;
+    ext.texture_compression_astc = hasExtension(exts, "GL_KHR_texture_compression_astc_ldr");
+#endif
     ext.QCOM_tiled_rendering = hasExtension(exts, "GL_QCOM_tiled_rendering");
     ext.OES_EGL_image_external_essl3 = hasExtension(exts, "GL_OES_EGL_image_external_essl3");
     ext.EXT_debug_marker = hasExtension(exts, "GL_EXT_debug_marker");
@@ -286,6 +292,7 @@ void OpenGLDriver::initExtensionsGL(GLint major, GLint minor, ExtentionSet const
     ext.texture_filter_anisotropic = hasExtension(exts, "GL_EXT_texture_filter_anisotropic");
     ext.texture_compression_etc2 = hasExtension(exts, "GL_ARB_ES3_compatibility");
     ext.texture_compression_s3tc = hasExtension(exts, "GL_EXT_texture_compression_s3tc");
+    ext.texture_compression_astc = hasExtension(exts, "GL_KHR_texture_compression_astc_ldr");
     ext.OES_EGL_image_external_essl3 = hasExtension(exts, "GL_OES_EGL_image_external_essl3");
     ext.EXT_debug_marker = hasExtension(exts, "GL_EXT_debug_marker");
     ext.EXT_color_buffer_half_float = true;  // Assumes core profile.
@@ -1696,6 +1703,9 @@ bool OpenGLDriver::isTextureFormatSupported(TextureFormat format) {
     if (isS3TCCompression(format)) {
         return ext.texture_compression_s3tc;
     }
+    if (isASTCCompression(format)) {
+        return ext.texture_compression_astc && getInternalFormat(format) != 0;
+    }
     return getInternalFormat(format) != 0;
 }
 
@@ -537,6 +537,7 @@ private:
     struct {
         bool texture_compression_s3tc = false;
         bool texture_compression_etc2 = false;
+        bool texture_compression_astc = false;
         bool texture_filter_anisotropic = false;
         bool QCOM_tiled_rendering = false;
         bool OES_EGL_image_external_essl3 = false;
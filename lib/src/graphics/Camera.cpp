@@ -19,11 +19,14 @@
 #include "GameObject.h"
 #include "Texture.h"
 #include "RenderTarget.h"
+#include "RenderGraph.h"
 #include "Engine.h"
 #include "Renderer.h"
 #include "Material.h"
 #include "SkinnedMeshRenderer.h"
 #include "Light.h"
+#include "LodGroup.h"
+#include "TextureStreamer.h"
 #include "time/Time.h"
 #include "postprocessing/PostProcessing.h"
 
@@ -100,6 +103,8 @@ namespace Viry3D
 
     void Camera::CullRenderers(const List<Renderer*>& renderers, List<Renderer*>& result)
     {
+        LodGroup::SelectAll(this);
+
         for (auto i : renderers)
         {
             int layer = i->GetGameObject()->GetLayer();
@@ -108,6 +113,7 @@ namespace Viry3D
                 result.AddLast(i);
             }
         }
+        TextureStreamer::RequestMipmaps(this, result);
         result.Sort([](Renderer* a, Renderer* b) {
             const auto& materials_a = a->GetMaterials();
             int queue_a = 0;
@@ -419,9 +425,9 @@ namespace Viry3D
 			{
 				if (i->IsShadowEnable())
 				{
-					if (i->GetViewUniformBuffer())
+					if (i->GetLightVertexUniformBuffer())
 					{
-						driver.bindUniformBuffer((size_t) Shader::BindingPoint::PerLightVertex, i->GetViewUniformBuffer());
+						driver.bindUniformBuffer((size_t) Shader::BindingPoint::PerLightVertex, i->GetLightVertexUniformBuffer());
 					}
 					
 					if (i->GetSamplerGroup())
@@ -461,127 +467,102 @@ namespace Viry3D
 		int target_width = this->GetTargetWidth();
 		int target_height = this->GetTargetHeight();
 
-		Ref<RenderTarget> post_processing_target_1;
-		Ref<RenderTarget> post_processing_target_2;
-		if (coms.Size() > 1)
+		Ref<RenderTarget> dst = RefMake<RenderTarget>();
+		dst->key.width = target_width;
+		dst->key.height = target_height;
+		dst->key.filter_mode = FilterMode::Nearest;
+		dst->key.wrap_mode = SamplerAddressMode::ClampToEdge;
+
+		if (m_render_target_color || m_render_target_depth)
 		{
-			post_processing_target_1 = RenderTarget::GetTemporaryRenderTarget(
-				target_width,
-				target_height,
-				TextureFormat::R8G8B8A8,
-				TextureFormat::None,
-				FilterMode::Linear,
-				SamplerAddressMode::ClampToEdge,
-				filament::backend::TargetBufferFlags::COLOR);
+			filament::backend::TargetBufferFlags target_flags = filament::backend::TargetBufferFlags::NONE;
+			TextureFormat color_format = TextureFormat::None;
+			TextureFormat depth_format = TextureFormat::None;
+
+			if (m_render_target_color)
+			{
+				target_flags |= filament::backend::TargetBufferFlags::COLOR;
+				color_format = m_render_target_color->GetFormat();
+			}
+			if (m_render_target_depth)
+			{
+				target_flags |= filament::backend::TargetBufferFlags::DEPTH;
+				depth_format = m_render_target_depth->GetFormat();
+			}
+
+			dst->key.color_format = color_format;
+			dst->key.depth_format = depth_format;
+			dst->key.flags = target_flags;
+
+			dst->target = m_render_target;
 		}
-		if (coms.Size() > 2)
+		else
 		{
-			post_processing_target_2 = RenderTarget::GetTemporaryRenderTarget(
-				target_width,
-				target_height,
-				TextureFormat::R8G8B8A8,
-				TextureFormat::None,
-				FilterMode::Linear,
-				SamplerAddressMode::ClampToEdge,
-				filament::backend::TargetBufferFlags::COLOR);
+			dst->key.color_format = TextureFormat::R8G8B8A8;
+			dst->key.depth_format = Texture::SelectDepthFormat();
+			dst->key.flags = filament::backend::TargetBufferFlags::COLOR_AND_DEPTH;
+
+			dst->target = *(filament::backend::RenderTargetHandle*) Engine::Instance()->GetDefaultRenderTarget();
 		}
 
-		Ref<RenderTarget> src = m_post_processing_target;
-		Ref<RenderTarget> dst = post_processing_target_1;
+		// effects are chained through transient targets of the graph
+		RenderGraph graph;
+		int src_texture = graph.Import(m_post_processing_target, false);
+		int dst_texture = graph.Import(dst, true);
 
 		for (int i = 0; i < coms.Size(); ++i)
 		{
-			if (i == coms.Size() - 1)
+			int write = dst_texture;
+			if (i < coms.Size() - 1)
 			{
-				dst = RefMake<RenderTarget>();
-				dst->key.width = target_width;
-				dst->key.height = target_height;
-				dst->key.filter_mode = FilterMode::Nearest;
-				dst->key.wrap_mode = SamplerAddressMode::ClampToEdge;
-
-				if (m_render_target_color || m_render_target_depth)
-				{
-					filament::backend::TargetBufferFlags target_flags = filament::backend::TargetBufferFlags::NONE;
-					TextureFormat color_format = TextureFormat::None;
-					TextureFormat depth_format = TextureFormat::None;
-
-					if (m_render_target_color)
-					{
-						target_flags |= filament::backend::TargetBufferFlags::COLOR;
-						color_format = m_render_target_color->GetFormat();
-					}
-					if (m_render_target_depth)
-					{
-						target_flags |= filament::backend::TargetBufferFlags::DEPTH;
-						depth_format = m_render_target_depth->GetFormat();
-					}
-
-					dst->key.color_format = color_format;
-					dst->key.depth_format = depth_format;
-					dst->key.flags = target_flags;
-
-					dst->target = m_render_target;
-				}
-				else
-				{
-					dst->key.color_format = TextureFormat::R8G8B8A8;
-					dst->key.depth_format = Texture::SelectDepthFormat();
-					dst->key.flags = filament::backend::TargetBufferFlags::COLOR_AND_DEPTH;
-
-					dst->target = *(filament::backend::RenderTargetHandle*) Engine::Instance()->GetDefaultRenderTarget();
-				}
+				write = graph.Create(target_width, target_height, TextureFormat::R8G8B8A8);
 			}
 
 			coms[i]->SetCameraDepthTexture(m_post_processing_target->depth);
-			coms[i]->OnRenderImage(src, dst);
+			coms[i]->OnRenderGraph(graph, src_texture, write);
 			coms[i]->SetCameraDepthTexture(Ref<Texture>());
 
-			// swap
-			if (i < coms.Size() - 1)
-			{
-				Ref<RenderTarget> temp = src;
-				src = dst;
-				dst = temp;
-
-				if (i == 0 && coms.Size() > 2)
-				{
-					dst = post_processing_target_2;
-				}
-			}
+			src_texture = write;
 		}
 
-		if (post_processing_target_1)
-		{
-			RenderTarget::ReleaseTemporaryRenderTarget(post_processing_target_1);
-			post_processing_target_1.reset();
-		}
-		if (post_processing_target_2)
-		{
-			RenderTarget::ReleaseTemporaryRenderTarget(post_processing_target_2);
-			post_processing_target_2.reset();
-		}
+		graph.Execute();
 
 		RenderTarget::ReleaseTemporaryRenderTarget(m_post_processing_target);
 		m_post_processing_target.reset();
 	}
 
 	void Camera::Blit(const Ref<RenderTarget>& src, const Ref<RenderTarget>& dst, const Ref<Material>& mat, int pass)
+	{
+		filament::backend::RenderPassFlags flags = { };
+		flags.clear = filament::backend::TargetBufferFlags::COLOR;
+		if (dst->target == m_current_camera->m_render_target ||
+			dst->target == *(filament::backend::RenderTargetHandle*) Engine::Instance()->GetDefaultRenderTarget())
+		{
+			flags.clear = dst->key.flags;
+		}
+
+		Blit(src, dst, mat, pass, flags);
+	}
+
+	void Camera::Blit(const Ref<RenderTarget>& src, const Ref<RenderTarget>& dst, const Ref<Material>& mat, int pass, const filament::backend::RenderPassFlags& flags)
 	{
 		int target_width = dst->key.width;
 		int target_height = dst->key.height;
 
 		filament::backend::RenderPassParams params;
-		params.flags.clear = filament::backend::TargetBufferFlags::COLOR;
-		if (dst->target == m_current_camera->m_render_target ||
-			dst->target == *(filament::backend::RenderTargetHandle*) Engine::Instance()->GetDefaultRenderTarget())
+		params.flags = flags;
+		if (dst->viewport.width > 0 && dst->viewport.height > 0)
 		{
-			params.flags.clear = dst->key.flags;
+			// sub rect of a larger pooled target
+			params.viewport = dst->viewport;
+		}
+		else
+		{
+			params.viewport.left = 0;
+			params.viewport.bottom = 0;
+			params.viewport.width = (uint32_t) target_width;
+			params.viewport.height = (uint32_t) target_height;
 		}
-
-		params.viewport.left = 0;
-		params.viewport.bottom = 0;
-		params.viewport.width = (uint32_t) target_width;
-		params.viewport.height = (uint32_t) target_height;
 		params.clearColor = filament::math::float4(0, 0, 0, 0);
 
 		// draw quad
@@ -613,7 +594,8 @@ namespace Viry3D
 				0, 1, 2, 0, 2, 3
 			};
 
-			m_quad_mesh = RefMake<Mesh>(std::move(vertices), std::move(indices));
+			m_quad_mesh = RefMake<Mesh>(std::move(vertices), std::move(indices), Vector<Mesh::Submesh>(), false, false,
+				(int) Mesh::VertexAttributeMask::Vertex | (int) Mesh::VertexAttributeMask::UV);
 		}
 		primitive = m_quad_mesh->GetPrimitives()[0];
 
@@ -627,6 +609,7 @@ namespace Viry3D
 			material = m_blit_material;
 
 			material->SetTexture(MaterialProperty::TEXTURE, src->color);
+			material->SetVector(MaterialProperty::TEXTURE_SCALE_OFFSET, src->GetUVScaleOffset());
 		}
 
 		if (primitive && material)
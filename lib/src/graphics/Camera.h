@@ -36,11 +36,13 @@ namespace Viry3D
     class Camera : public Component
     {
     public:
+		static const List<Camera*>& GetCameras() { return m_cameras; }
 		static void Init();
 		static void Done();
 		static void RenderAll();
         static void OnResizeAll(int width, int height);
 		static void Blit(const Ref<RenderTarget>& src, const Ref<RenderTarget>& dst, const Ref<Material>& mat = Ref<Material>(), int pass = -1);
+		static void Blit(const Ref<RenderTarget>& src, const Ref<RenderTarget>& dst, const Ref<Material>& mat, int pass, const filament::backend::RenderPassFlags& flags);
 		Camera();
         virtual ~Camera();
 		int GetDepth() const { return m_depth; }
@@ -16,15 +16,19 @@
 */
 
 #include "Image.h"
+#include "ImageDecoder.h"
 #include "io/File.h"
 #include "memory/Memory.h"
+#include "math/Mathf.h"
 #include "Debug.h"
+#include "Engine.h"
+#include "thread/ThreadPool.h"
+#include <functional>
+#include <atomic>
 
 extern "C"
 {
-#include "jpeg/jpeglib.h"
 #include "png/png.h"
-#include "png/pngstruct.h"
 }
 
 namespace Viry3D
@@ -37,115 +41,32 @@ namespace Viry3D
 
     Ref<Image> Image::LoadFromFile(const String& path)
     {
-        Ref<Image> image;
-        
-        if (File::Exist(path))
+        // R8G8B8 is expanded to R8G8B8A8 while decoding, vulkan not support R8G8B8
+        ImageDecodeRequest request;
+        request.path = path;
+        if (ImageDecoder::Decode(request))
         {
-            if (path.EndsWith(".png"))
-            {
-                ByteBuffer png = File::ReadAllBytes(path);
-                image = Image::LoadPNG(png);
-            }
-            else if (path.EndsWith(".jpg"))
-            {
-                ByteBuffer jpg = File::ReadAllBytes(path);
-                image = Image::LoadJPEG(jpg);
-            }
-            else
-            {
-                assert(!"image file format not support");
-            }
-            
-            // vulkan not support R8G8B8, convert to R8G8B8A8 always
-            if (image->format == ImageFormat::R8G8B8)
-            {
-                int pixel_count = image->data.Size() / 3;
-                ByteBuffer rgba(pixel_count * 4);
-                for (int i = 0; i < pixel_count; ++i)
-                {
-                    rgba[i * 4 + 0] = image->data[i * 3 + 0];
-                    rgba[i * 4 + 1] = image->data[i * 3 + 1];
-                    rgba[i * 4 + 2] = image->data[i * 3 + 2];
-                    rgba[i * 4 + 3] = 255;
-                }
-                image->data = rgba;
-                image->format = ImageFormat::R8G8B8A8;
-            }
+            return request.image;
         }
-        else
-        {
-            Log("image file not exist: %s", path.CString());
-        }
-        
-        return image;
+        return Ref<Image>();
     }
     
     Ref<Image> Image::LoadJPEG(const ByteBuffer& jpeg)
     {
-        Ref<Image> image = RefMake<Image>();
-
-        //use lib jpeg
-        jpeg_decompress_struct cinfo;
-        jpeg_error_mgr jerr;
-        JSAMPARRAY buffer;		/* Output row buffer */
-        int row_stride;		/* physical row width in output buffer */
-
-        cinfo.err = jpeg_std_error(&jerr);
-
-        jpeg_create_decompress(&cinfo);
-        jpeg_mem_src(&cinfo, jpeg.Bytes(), jpeg.Size());
-        jpeg_read_header(&cinfo, TRUE);
-        jpeg_start_decompress(&cinfo);
-        row_stride = cinfo.output_width * cinfo.output_components;
-        /* Make a one-row-high sample array that will go away when done with image */
-        buffer = (*cinfo.mem->alloc_sarray)
-            ((j_common_ptr) &cinfo, JPOOL_IMAGE, row_stride, 1);
-
-        image->width = cinfo.output_width;
-        image->height = cinfo.output_height;
-        int bpp = cinfo.output_components * 8;
-        switch (bpp)
-        {
-            case 8:
-                image->format = ImageFormat::R8;
-                break;
-            case 24:
-                image->format = ImageFormat::R8G8B8;
-                break;
-            case 32:
-                image->format = ImageFormat::R8G8B8A8;
-                break;
-        }
-
-        image->data = ByteBuffer(image->width * image->height * cinfo.output_components);
-
-        unsigned char* pPixel = image->data.Bytes();
-
-        while (cinfo.output_scanline < cinfo.output_height)
-        {
-            jpeg_read_scanlines(&cinfo, buffer, 1);
-
-            unsigned char *pixel_data = buffer[0];
-
-            for (int j = 0; j < image->width; ++j)
-            {
-                memcpy(pPixel, pixel_data, cinfo.output_components);
-
-                pPixel += cinfo.output_components;
-                pixel_data += cinfo.output_components;
-            }
-        }
-
-        jpeg_finish_decompress(&cinfo);
-        jpeg_destroy_decompress(&cinfo);
-
-        return image;
+        ImageDecodeRequest request;
+        request.file = jpeg;
+        request.rgba = false;
+        ImageDecoder::Decode(request);
+        return request.image;
     }
 
-    static void PngRead(png_structp png_ptr, png_bytep data, png_size_t length)
+    Ref<Image> Image::LoadPNG(const ByteBuffer& png)
     {
-        memcpy(data, png_ptr->io_ptr, length);
-        png_ptr->io_ptr = (char*) png_ptr->io_ptr + length;
+        ImageDecodeRequest request;
+        request.file = png;
+        request.rgba = false;
+        ImageDecoder::Decode(request);
+        return request.image;
     }
 
     static void PngWrite(png_structp png_ptr, png_bytep data, png_size_t length)
@@ -170,100 +91,6 @@ namespace Viry3D
 
     }
 
-    Ref<Image> Image::LoadPNG(const ByteBuffer& png)
-    {
-        Ref<Image> image = RefMake<Image>();
-
-        png_structp png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, 0, 0, 0);
-        png_infop info_ptr = png_create_info_struct(png_ptr);
-        setjmp(png_jmpbuf(png_ptr));
-
-        png_set_read_fn(png_ptr, png.Bytes(), PngRead);
-        png_read_png(png_ptr, info_ptr, PNG_TRANSFORM_EXPAND, 0);
-
-        image->width = png_get_image_width(png_ptr, info_ptr);
-        image->height = png_get_image_height(png_ptr, info_ptr);
-
-        int color_type = png_get_color_type(png_ptr, info_ptr);
-        if (color_type == PNG_COLOR_TYPE_RGBA)
-        {
-            png_bytep* row_pointers = png_get_rows(png_ptr, info_ptr);
-
-            image->data = ByteBuffer(image->width * image->height * 4);
-            image->format = ImageFormat::R8G8B8A8;
-
-            unsigned char* pPixel = image->data.Bytes();
-
-            for (int i = 0; i < image->height; ++i)
-            {
-                memcpy(pPixel, row_pointers[i], image->width * 4);
-                pPixel += image->width * 4;
-            }
-        }
-        else if (color_type == PNG_COLOR_TYPE_RGB)
-        {
-            png_bytep* row_pointers = png_get_rows(png_ptr, info_ptr);
-
-            image->data = ByteBuffer(image->width * image->height * 3);
-            image->format = ImageFormat::R8G8B8;
-
-            unsigned char* pPixel = image->data.Bytes();
-
-            for (int i = 0; i < image->height; ++i)
-            {
-                memcpy(pPixel, row_pointers[i], image->width * 3);
-                pPixel += image->width * 3;
-            }
-        }
-        else if (color_type == PNG_COLOR_TYPE_GRAY)
-        {
-            png_bytep* row_pointers = png_get_rows(png_ptr, info_ptr);
-
-            image->data = ByteBuffer(image->width * image->height);
-            image->format = ImageFormat::R8;
-
-            unsigned char* pPixel = image->data.Bytes();
-
-            for (int i = 0; i < image->height; ++i)
-            {
-                memcpy(pPixel, row_pointers[i], image->width * 1);
-                pPixel += image->width * 1;
-            }
-        }
-        else if (color_type == PNG_COLOR_TYPE_GRAY_ALPHA)
-        {
-            png_bytep* row_pointers = png_get_rows(png_ptr, info_ptr);
-
-            image->data = ByteBuffer(image->width * image->height * 4);
-            image->format = ImageFormat::R8G8B8A8;
-
-            byte* pPixel = image->data.Bytes();
-
-            for (int i = 0; i < image->height; ++i)
-            {
-                for (int j = 0; j < image->width; ++j)
-                {
-                    png_byte g = row_pointers[i][j * 2];
-                    png_byte a = row_pointers[i][j * 2 + 1];
-                    pPixel[0] = g;
-                    pPixel[1] = g;
-                    pPixel[2] = g;
-                    pPixel[3] = a;
-
-                    pPixel += 4;
-                }
-            }
-        }
-        else
-        {
-            assert(!"color type not support");
-        }
-
-        png_destroy_read_struct(&png_ptr, &info_ptr, 0);
-
-        return image;
-    }
-
     void Image::EncodeToPNG(const String& file)
     {
         int color_type = -1;
@@ -322,4 +149,283 @@ namespace Viry3D
 
         free(data);
     }
+
+    // float working copy of one mip level, color channels linear
+    struct MipmapLevel
+    {
+        int width;
+        int height;
+        int channels;
+        Vector<float> pixels;
+    };
+
+    // contribution of the source texels to one destination texel along an axis
+    struct MipmapTaps
+    {
+        Vector<int> first;
+        Vector<int> count;
+        Vector<float> weights;
+        int max_count;
+    };
+
+    static const float KAISER_RADIUS = 3.0f;
+    static const float KAISER_ALPHA = 4.0f;
+    static const int PARALLEL_MIN_ROWS = 64;
+
+    static float BesselI0(float x)
+    {
+        float sum = 1.0f;
+        float term = 1.0f;
+        for (int i = 1; i < 16; ++i)
+        {
+            term *= (x * 0.5f) / i;
+            sum += term * term;
+        }
+        return sum;
+    }
+
+    static float KaiserSinc(float t)
+    {
+        if (fabs(t) >= KAISER_RADIUS)
+        {
+            return 0.0f;
+        }
+
+        float sinc = 1.0f;
+        if (fabs(t) > 1e-5f)
+        {
+            sinc = sinf(Mathf::PI * t) / (Mathf::PI * t);
+        }
+        float r = t / KAISER_RADIUS;
+        return sinc * BesselI0(KAISER_ALPHA * sqrtf(1.0f - r * r)) / BesselI0(KAISER_ALPHA);
+    }
+
+    static MipmapTaps CalculateMipmapTaps(int src_size, int dst_size, MipmapFilter filter)
+    {
+        MipmapTaps taps;
+        taps.first.Resize(dst_size);
+        taps.count.Resize(dst_size);
+        taps.max_count = 0;
+
+        float scale = src_size / (float) dst_size;
+        float support = filter == MipmapFilter::Box ? scale * 0.5f : scale * KAISER_RADIUS;
+
+        Vector<float> weights;
+        for (int i = 0; i < dst_size; ++i)
+        {
+            float center = (i + 0.5f) * scale;
+            int first = (int) floor(center - support);
+            int last = (int) ceil(center + support);
+
+            weights.Clear();
+            float sum = 0.0f;
+            for (int j = first; j < last; ++j)
+            {
+                float t = (j + 0.5f - center) / scale;
+                float w;
+                if (filter == MipmapFilter::Box)
+                {
+                    w = Mathf::Max(0.0f, Mathf::Min(j + 1.0f, center + support) - Mathf::Max((float) j, center - support));
+                }
+                else
+                {
+                    w = KaiserSinc(t);
+                }
+                weights.Add(w);
+                sum += w;
+            }
+
+            taps.first[i] = first;
+            taps.count[i] = weights.Size();
+            taps.max_count = Mathf::Max(taps.max_count, weights.Size());
+            for (int j = 0; j < weights.Size(); ++j)
+            {
+                taps.weights.Add(weights[j] / sum);
+            }
+        }
+
+        return taps;
+    }
+
+    // splits rows into bands taken by the engine thread pool, the calling thread takes bands too
+    static void ParallelForRows(int rows, const std::function<void(int, int)>& job)
+    {
+        ThreadPool* thread_pool = Engine::Instance() ? Engine::Instance()->GetThreadPool() : nullptr;
+        if (rows < PARALLEL_MIN_ROWS || thread_pool == nullptr)
+        {
+            job(0, rows);
+            return;
+        }
+
+        int band = PARALLEL_MIN_ROWS / 2;
+        int band_count = (rows + band - 1) / band;
+        std::atomic<int> next(0);
+        thread_pool->ParallelRun(band_count, [&](int) {
+            while (true)
+            {
+                int index = next++;
+                if (index >= band_count)
+                {
+                    break;
+                }
+                job(index * band, Mathf::Min((index + 1) * band, rows));
+            }
+        });
+    }
+
+    static float SRGBToLinear(float c)
+    {
+        return c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+    }
+
+    static float LinearToSRGB(float c)
+    {
+        return c <= 0.0031308f ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+    }
+
+    static MipmapLevel DownsampleMipmapLevel(const MipmapLevel& src, MipmapFilter filter)
+    {
+        MipmapLevel dst;
+        dst.width = Mathf::Max(src.width / 2, 1);
+        dst.height = Mathf::Max(src.height / 2, 1);
+        dst.channels = src.channels;
+        dst.pixels.Resize(dst.width * dst.height * dst.channels);
+
+        MipmapTaps taps_x = CalculateMipmapTaps(src.width, dst.width, filter);
+        MipmapTaps taps_y = CalculateMipmapTaps(src.height, dst.height, filter);
+        int channels = src.channels;
+
+        // horizontal pass into src.height x dst.width, then vertical pass,
+        // the inner loops are plain float multiply-adds the compiler vectorizes
+        Vector<float> temp(src.height * dst.width * channels);
+        ParallelForRows(src.height, [&](int row_begin, int row_end) {
+            for (int y = row_begin; y < row_end; ++y)
+            {
+                const float* src_row = &src.pixels[y * src.width * channels];
+                float* temp_row = &temp[y * dst.width * channels];
+                int weight_index = 0;
+
+                for (int x = 0; x < dst.width; ++x)
+                {
+                    float sum[4] = { 0, 0, 0, 0 };
+                    for (int i = 0; i < taps_x.count[x]; ++i)
+                    {
+                        int sx = Mathf::Clamp(taps_x.first[x] + i, 0, src.width - 1);
+                        float w = taps_x.weights[weight_index + i];
+                        for (int c = 0; c < channels; ++c)
+                        {
+                            sum[c] += src_row[sx * channels + c] * w;
+                        }
+                    }
+                    weight_index += taps_x.count[x];
+
+                    for (int c = 0; c < channels; ++c)
+                    {
+                        temp_row[x * channels + c] = sum[c];
+                    }
+                }
+            }
+        });
+
+        Vector<int> weight_offsets(dst.height);
+        for (int y = 0, offset = 0; y < dst.height; ++y)
+        {
+            weight_offsets[y] = offset;
+            offset += taps_y.count[y];
+        }
+
+        int row_size = dst.width * channels;
+        ParallelForRows(dst.height, [&](int row_begin, int row_end) {
+            for (int y = row_begin; y < row_end; ++y)
+            {
+                float* dst_row = &dst.pixels[y * row_size];
+                Memory::Zero(dst_row, row_size * sizeof(float));
+
+                for (int i = 0; i < taps_y.count[y]; ++i)
+                {
+                    int sy = Mathf::Clamp(taps_y.first[y] + i, 0, src.height - 1);
+                    float w = taps_y.weights[weight_offsets[y] + i];
+                    const float* temp_row = &temp[sy * row_size];
+                    for (int j = 0; j < row_size; ++j)
+                    {
+                        dst_row[j] += temp_row[j] * w;
+                    }
+                }
+            }
+        });
+
+        return dst;
+    }
+
+    Vector<Ref<Image>> Image::GenerateMipmaps(const Ref<Image>& image, MipmapFilter filter, bool srgb)
+    {
+        Vector<Ref<Image>> mipmaps;
+
+        int channels;
+        switch (image->format)
+        {
+            case ImageFormat::R8:
+                channels = 1;
+                break;
+            case ImageFormat::R8G8B8A8:
+                channels = 4;
+                break;
+            default:
+                Log("mipmap generation only supports R8 and R8G8B8A8");
+                return mipmaps;
+        }
+        int color_channels = channels == 4 ? 3 : 1;
+
+        float to_linear[256];
+        for (int i = 0; i < 256; ++i)
+        {
+            to_linear[i] = srgb ? SRGBToLinear(i / 255.0f) : i / 255.0f;
+        }
+        const int to_byte_size = 4096;
+        byte to_byte[to_byte_size + 1];
+        for (int i = 0; i <= to_byte_size; ++i)
+        {
+            float c = i / (float) to_byte_size;
+            to_byte[i] = (byte) (Mathf::Clamp(srgb ? LinearToSRGB(c) : c, 0.0f, 1.0f) * 255.0f + 0.5f);
+        }
+
+        MipmapLevel level;
+        level.width = image->width;
+        level.height = image->height;
+        level.channels = channels;
+        level.pixels.Resize(level.width * level.height * channels);
+        for (int i = 0; i < level.pixels.Size(); ++i)
+        {
+            byte v = image->data[i];
+            level.pixels[i] = (i % channels) < color_channels ? to_linear[v] : v / 255.0f;
+        }
+
+        mipmaps.Add(image);
+
+        while (level.width > 1 || level.height > 1)
+        {
+            level = DownsampleMipmapLevel(level, filter);
+
+            Ref<Image> mipmap = RefMake<Image>();
+            mipmap->width = level.width;
+            mipmap->height = level.height;
+            mipmap->format = image->format;
+            mipmap->data = ByteBuffer(level.pixels.Size());
+            for (int i = 0; i < level.pixels.Size(); ++i)
+            {
+                float v = Mathf::Clamp(level.pixels[i], 0.0f, 1.0f);
+                if ((i % channels) < color_channels)
+                {
+                    mipmap->data[i] = to_byte[(int) (v * to_byte_size + 0.5f)];
+                }
+                else
+                {
+                    mipmap->data[i] = (byte) (v * 255.0f + 0.5f);
+                }
+            }
+            mipmaps.Add(mipmap);
+        }
+
+        return mipmaps;
+    }
 }
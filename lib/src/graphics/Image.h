@@ -18,6 +18,7 @@
 #pragma once
 
 #include "Object.h"
+#include "container/Vector.h"
 
 namespace Viry3D
 {
@@ -29,6 +30,12 @@ namespace Viry3D
         R8G8B8A8,
     };
 
+    enum class MipmapFilter
+    {
+        Box,
+        Kaiser,
+    };
+
 	class Image : public Object
 	{
 	public:
@@ -36,6 +43,10 @@ namespace Viry3D
 		static Ref<Image> LoadJPEG(const ByteBuffer& jpeg);
 		static Ref<Image> LoadPNG(const ByteBuffer& png);
 		void EncodeToPNG(const String& file);
+        // builds the mip chain down to 1x1 on cpu, level 0 is the source image.
+        // srgb filters the color channels in linear space, alpha is always linear.
+        // supports R8 and R8G8B8A8.
+        static Vector<Ref<Image>> GenerateMipmaps(const Ref<Image>& image, MipmapFilter filter, bool srgb);
 
         int width = 0;
         int height = 0;
@@ -0,0 +1,350 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "ImageDecoder.h"
+#include "io/File.h"
+#include "memory/Memory.h"
+#include "math/Mathf.h"
+#include "Debug.h"
+#include "Engine.h"
+#include "thread/ThreadPool.h"
+#include <atomic>
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+extern "C"
+{
+#include "jpeg/jpeglib.h"
+#include "png/png.h"
+}
+
+namespace Viry3D
+{
+    void ImageDecoder::ExpandRGBToRGBA(const byte* src, byte* dst, int pixel_count)
+    {
+        int i = 0;
+
+#if defined(__SSSE3__)
+        // 4 pixels per step, the 16 byte load reads 4 bytes ahead so stop 6 pixels early
+        const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+        const __m128i alpha = _mm_set1_epi32((int) 0xff000000);
+        for (; i + 6 <= pixel_count; i += 4)
+        {
+            __m128i rgb = _mm_loadu_si128((const __m128i*) &src[i * 3]);
+            __m128i rgba = _mm_or_si128(_mm_shuffle_epi8(rgb, shuffle), alpha);
+            _mm_storeu_si128((__m128i*) &dst[i * 4], rgba);
+        }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+        for (; i + 16 <= pixel_count; i += 16)
+        {
+            uint8x16x3_t rgb = vld3q_u8(&src[i * 3]);
+            uint8x16x4_t rgba;
+            rgba.val[0] = rgb.val[0];
+            rgba.val[1] = rgb.val[1];
+            rgba.val[2] = rgb.val[2];
+            rgba.val[3] = vdupq_n_u8(255);
+            vst4q_u8(&dst[i * 4], rgba);
+        }
+#endif
+
+        for (; i < pixel_count; ++i)
+        {
+            dst[i * 4 + 0] = src[i * 3 + 0];
+            dst[i * 4 + 1] = src[i * 3 + 1];
+            dst[i * 4 + 2] = src[i * 3 + 2];
+            dst[i * 4 + 3] = 255;
+        }
+    }
+
+    static byte* GetDecodeBuffer(ImageDecodeRequest& request, int size)
+    {
+        if (request.dest)
+        {
+            if (request.dest_size < size)
+            {
+                Log("image decode destination too small: %s", request.path.CString());
+                return nullptr;
+            }
+            return request.dest;
+        }
+
+        request.image->data = ByteBuffer(size);
+        return request.image->data.Bytes();
+    }
+
+    static bool DecodeJPEG(ImageDecodeRequest& request)
+    {
+        jpeg_decompress_struct cinfo;
+        jpeg_error_mgr jerr;
+
+        cinfo.err = jpeg_std_error(&jerr);
+
+        jpeg_create_decompress(&cinfo);
+        jpeg_mem_src(&cinfo, request.file.Bytes(), request.file.Size());
+        jpeg_read_header(&cinfo, TRUE);
+        jpeg_calc_output_dimensions(&cinfo);
+
+        int width = cinfo.output_width;
+        int height = cinfo.output_height;
+        int channels = cinfo.output_components;
+        bool expand = request.rgba && channels == 3;
+        int dst_channels = expand ? 4 : channels;
+
+        Ref<Image>& image = request.image;
+        image->width = width;
+        image->height = height;
+        switch (dst_channels)
+        {
+            case 1:
+                image->format = ImageFormat::R8;
+                break;
+            case 3:
+                image->format = ImageFormat::R8G8B8;
+                break;
+            case 4:
+                image->format = ImageFormat::R8G8B8A8;
+                break;
+        }
+
+        if (request.info_only)
+        {
+            jpeg_destroy_decompress(&cinfo);
+            return true;
+        }
+
+        byte* pixels = GetDecodeBuffer(request, width * height * dst_channels);
+        if (pixels == nullptr)
+        {
+            jpeg_destroy_decompress(&cinfo);
+            return false;
+        }
+
+        jpeg_start_decompress(&cinfo);
+
+        JSAMPROW rows[IMAGE_DECODE_ROWS];
+        ByteBuffer scratch;
+        if (expand)
+        {
+            scratch = ByteBuffer(width * channels * IMAGE_DECODE_ROWS);
+        }
+
+        // read several rows per call, straight into the destination unless rgb expands to rgba
+        while (cinfo.output_scanline < cinfo.output_height)
+        {
+            int first = cinfo.output_scanline;
+            int count = Mathf::Min(IMAGE_DECODE_ROWS, height - first);
+
+            for (int i = 0; i < count; ++i)
+            {
+                if (expand)
+                {
+                    rows[i] = &scratch[i * width * channels];
+                }
+                else
+                {
+                    rows[i] = &pixels[(first + i) * width * dst_channels];
+                }
+            }
+
+            int read = jpeg_read_scanlines(&cinfo, rows, count);
+
+            if (expand)
+            {
+                for (int i = 0; i < read; ++i)
+                {
+                    ImageDecoder::ExpandRGBToRGBA(rows[i], &pixels[(first + i) * width * 4], width);
+                }
+            }
+        }
+
+        jpeg_finish_decompress(&cinfo);
+        jpeg_destroy_decompress(&cinfo);
+
+        return true;
+    }
+
+    struct PNGReader
+    {
+        const byte* data;
+        int size;
+        int offset;
+    };
+
+    static void PNGReadData(png_structp png_ptr, png_bytep data, png_size_t length)
+    {
+        PNGReader* reader = (PNGReader*) png_get_io_ptr(png_ptr);
+        if (reader->offset + (int) length > reader->size)
+        {
+            png_error(png_ptr, "read past the end of png data");
+        }
+        Memory::Copy(data, &reader->data[reader->offset], (int) length);
+        reader->offset += (int) length;
+    }
+
+    static bool DecodePNG(ImageDecodeRequest& request)
+    {
+        PNGReader reader;
+        reader.data = request.file.Bytes();
+        reader.size = request.file.Size();
+        reader.offset = 0;
+
+        png_structp png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, 0, 0, 0);
+        png_infop info_ptr = png_create_info_struct(png_ptr);
+        Vector<png_bytep> rows;
+
+        if (setjmp(png_jmpbuf(png_ptr)))
+        {
+            Log("png decode failed: %s", request.path.CString());
+            png_destroy_read_struct(&png_ptr, &info_ptr, 0);
+            return false;
+        }
+
+        png_set_read_fn(png_ptr, &reader, PNGReadData);
+        png_read_info(png_ptr, info_ptr);
+
+        // let libpng convert rows while decoding, so no pass over the image is needed afterwards
+        int color_type = png_get_color_type(png_ptr, info_ptr);
+        bool transparent = png_get_valid(png_ptr, info_ptr, PNG_INFO_tRNS) != 0;
+        png_set_expand(png_ptr);
+        png_set_strip_16(png_ptr);
+        if (color_type == PNG_COLOR_TYPE_GRAY_ALPHA || (color_type == PNG_COLOR_TYPE_GRAY && transparent))
+        {
+            // gray with alpha becomes rgba
+            png_set_gray_to_rgb(png_ptr);
+        }
+        else if ((color_type == PNG_COLOR_TYPE_RGB || color_type == PNG_COLOR_TYPE_PALETTE) && !transparent && request.rgba)
+        {
+            png_set_filler(png_ptr, 0xff, PNG_FILLER_AFTER);
+        }
+        png_set_interlace_handling(png_ptr);
+        png_read_update_info(png_ptr, info_ptr);
+
+        int width = png_get_image_width(png_ptr, info_ptr);
+        int height = png_get_image_height(png_ptr, info_ptr);
+        int channels = png_get_channels(png_ptr, info_ptr);
+
+        Ref<Image>& image = request.image;
+        image->width = width;
+        image->height = height;
+        switch (channels)
+        {
+            case 1:
+                image->format = ImageFormat::R8;
+                break;
+            case 3:
+                image->format = ImageFormat::R8G8B8;
+                break;
+            case 4:
+                image->format = ImageFormat::R8G8B8A8;
+                break;
+            default:
+                png_error(png_ptr, "png channel count not support");
+                break;
+        }
+
+        if (request.info_only)
+        {
+            png_destroy_read_struct(&png_ptr, &info_ptr, 0);
+            return true;
+        }
+
+        byte* pixels = GetDecodeBuffer(request, width * height * channels);
+        if (pixels == nullptr)
+        {
+            png_destroy_read_struct(&png_ptr, &info_ptr, 0);
+            return false;
+        }
+
+        rows.Resize(height);
+        for (int i = 0; i < height; ++i)
+        {
+            rows[i] = &pixels[i * width * channels];
+        }
+
+        png_read_image(png_ptr, &rows[0]);
+        png_read_end(png_ptr, nullptr);
+        png_destroy_read_struct(&png_ptr, &info_ptr, 0);
+
+        return true;
+    }
+
+    bool ImageDecoder::Decode(ImageDecodeRequest& request)
+    {
+        request.success = false;
+        request.image = RefMake<Image>();
+
+        if (request.file.Size() == 0)
+        {
+            if (!File::Exist(request.path))
+            {
+                Log("image file not exist: %s", request.path.CString());
+                return false;
+            }
+            request.file = File::ReadAllBytes(request.path);
+        }
+
+        const byte* bytes = request.file.Bytes();
+        int size = request.file.Size();
+
+        if (size >= 8 && png_sig_cmp((png_const_bytep) bytes, 0, 8) == 0)
+        {
+            request.success = DecodePNG(request);
+        }
+        else if (size >= 2 && bytes[0] == 0xff && bytes[1] == 0xd8)
+        {
+            request.success = DecodeJPEG(request);
+        }
+        else
+        {
+            Log("image file format not support: %s", request.path.CString());
+        }
+
+        // the encoded bytes are not needed anymore
+        request.file = ByteBuffer();
+
+        return request.success;
+    }
+
+    void ImageDecoder::DecodeAll(Vector<ImageDecodeRequest>& requests)
+    {
+        std::atomic<int> next(0);
+        auto job = [&](int) {
+            while (true)
+            {
+                int index = next++;
+                if (index >= requests.Size())
+                {
+                    break;
+                }
+                ImageDecoder::Decode(requests[index]);
+            }
+        };
+
+        ThreadPool* thread_pool = Engine::Instance() ? Engine::Instance()->GetThreadPool() : nullptr;
+        if (thread_pool)
+        {
+            thread_pool->ParallelRun(requests.Size(), job);
+        }
+        else
+        {
+            job(0);
+        }
+    }
+}
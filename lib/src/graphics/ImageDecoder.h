@@ -0,0 +1,53 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+#include "Image.h"
+#include "string/String.h"
+
+#define IMAGE_DECODE_ROWS 16
+
+namespace Viry3D
+{
+    // one image to decode, straight into a caller buffer when dest is set,
+    // e.g. a face slice of a cubemap level or a staging buffer
+    struct ImageDecodeRequest
+    {
+        String path;
+        // encoded file bytes, read from path when empty
+        ByteBuffer file;
+        byte* dest = nullptr;
+        int dest_size = 0;
+        // expand R8G8B8 to R8G8B8A8, gray stays R8
+        bool rgba = true;
+        // only read the size and format from the header, no pixels are decoded
+        bool info_only = false;
+        // decoded size and format, data is empty when decoded into dest
+        Ref<Image> image;
+        bool success = false;
+    };
+
+    class ImageDecoder
+    {
+    public:
+        // decodes on worker threads and returns when all are done, the calling thread decodes too
+        static void DecodeAll(Vector<ImageDecodeRequest>& requests);
+        static bool Decode(ImageDecodeRequest& request);
+        static void ExpandRGBToRGBA(const byte* src, byte* dst, int pixel_count);
+    };
+}
@@ -22,12 +22,76 @@
 #include "Renderer.h"
 #include "SkinnedMeshRenderer.h"
 #include "Texture.h"
+#include "Camera.h"
+#include "Mesh.h"
+#include "math/Frustum.h"
+#include "time/Time.h"
 
 namespace Viry3D
 {
 	List<Light*> Light::m_lights;
 	Color Light::m_ambient_color(0, 0, 0, 0);
 
+	static bool is_caster_visible(const Frustum& frustum, Renderer* renderer)
+	{
+		// skinned bounds follow the bones, keep them
+		MeshRenderer* mesh_renderer = dynamic_cast<MeshRenderer*>(renderer);
+		if (mesh_renderer == nullptr || dynamic_cast<SkinnedMeshRenderer*>(renderer) || !mesh_renderer->GetMesh())
+		{
+			return true;
+		}
+
+		const auto& bounds = mesh_renderer->GetMesh()->GetBounds();
+		const Vector3& min = bounds.Min();
+		const Vector3& max = bounds.Max();
+		Vector3 corners[8];
+		corners[0] = max;
+		corners[1] = Vector3(min.x, max.y, max.z);
+		corners[2] = Vector3(max.x, min.y, max.z);
+		corners[3] = Vector3(max.x, max.y, min.z);
+		corners[4] = Vector3(min.x, min.y, max.z);
+		corners[5] = Vector3(min.x, max.y, min.z);
+		corners[6] = Vector3(max.x, min.y, min.z);
+		corners[7] = min;
+
+		return frustum.ContainsPoints(corners, 8, &renderer->GetTransform()->GetLocalToWorldMatrix()) != ContainsResult::Out;
+	}
+
+	static bool is_caster_in_range(Renderer* renderer, const Vector3& center, float radius)
+	{
+		MeshRenderer* mesh_renderer = dynamic_cast<MeshRenderer*>(renderer);
+		if (mesh_renderer == nullptr || dynamic_cast<SkinnedMeshRenderer*>(renderer) || !mesh_renderer->GetMesh())
+		{
+			return true;
+		}
+
+		const auto& bounds = mesh_renderer->GetMesh()->GetBounds();
+		const auto& transform = renderer->GetTransform();
+		const Vector3& scale = transform->GetScale();
+		float max_scale = Mathf::Max(fabs(scale.x), Mathf::Max(fabs(scale.y), fabs(scale.z)));
+		Vector3 bounds_center = transform->GetLocalToWorldMatrix().MultiplyPoint3x4((bounds.Min() + bounds.Max()) * 0.5f);
+		float bounds_radius = (bounds.Max() - bounds.Min()).Magnitude() * 0.5f * max_scale;
+
+		return (bounds_center - center).SqrMagnitude() <= (radius + bounds_radius) * (radius + bounds_radius);
+	}
+
+	static filament::backend::RenderTargetHandle create_depth_target(const Ref<Texture>& texture)
+	{
+		filament::backend::TargetBufferInfo color = { };
+		filament::backend::TargetBufferInfo depth = { };
+		filament::backend::TargetBufferInfo stencil = { };
+		depth.handle = texture->GetTexture();
+
+		return Engine::Instance()->GetDriverApi().createRenderTarget(
+			filament::backend::TargetBufferFlags::DEPTH,
+			texture->GetWidth(),
+			texture->GetHeight(),
+			1,
+			color,
+			depth,
+			stencil);
+	}
+
 	void Light::SetAmbientColor(const Color& color)
 	{
 		m_ambient_color = color;
@@ -39,18 +103,249 @@ namespace Viry3D
 
 	void Light::RenderShadowMaps()
 	{
+		List<Light*> atlas_lights;
+
 		for (auto i : m_lights)
 		{
-			if (i->GetGameObject()->IsActiveInTree() &&
-				(i->GetType() == LightType::Directional || i->GetType() == LightType::Spot) &&
-				i->IsShadowEnable())
+			if (i->GetGameObject()->IsActiveInTree() && i->IsShadowEnable())
+			{
+				if (i->GetType() == LightType::Directional)
+				{
+					List<Renderer*> renderers;
+					i->CullRenderers(Renderer::GetRenderers(), renderers);
+					i->UpdateShadowTexture();
+					i->UpdateCascades();
+					i->UpdateViewUniforms();
+					for (int j = 0; j < i->m_shadow_views.Size(); ++j)
+					{
+						i->DrawShadowView(j, renderers);
+					}
+				}
+				else
+				{
+					atlas_lights.AddLast(i);
+				}
+			}
+			else
 			{
-				List<Renderer*> renderers;
-				i->CullRenderers(Renderer::GetRenderers(), renderers);
-				i->UpdateViewUniforms();
-				i->Draw(renderers);
+				i->FreeShadowTiles();
 			}
 		}
+
+		if (atlas_lights.Size() > 0)
+		{
+			RenderShadowAtlas(atlas_lights);
+		}
+
+		Engine::Instance()->GetDriverApi().flush();
+	}
+
+	void Light::RenderShadowAtlas(List<Light*>& lights)
+	{
+		// a moved static caster may shadow any light
+		if (m_shadow_atlas_static_version != Renderer::GetStaticVersion())
+		{
+			m_shadow_atlas_static_version = Renderer::GetStaticVersion();
+			for (auto i : lights)
+			{
+				i->m_shadow_atlas_valid = false;
+			}
+		}
+
+		for (auto i : lights)
+		{
+			i->UpdateShadowTexture();
+			i->m_shadow_importance = i->GetShadowImportance();
+		}
+		lights.Sort([](Light* a, Light* b) {
+			return a->m_shadow_importance > b->m_shadow_importance;
+		});
+
+		// tile size follows the size of the light on screen, tiles grow at once and shrink two steps late
+		auto tile_size = [](Light* light) {
+			int max_size = Mathf::Min(SHADOW_ATLAS_MAX_TILE_SIZE, light->m_shadow_texture_size);
+			int size = SHADOW_ATLAS_MIN_TILE_SIZE;
+			while (size < max_size && size < light->m_shadow_importance * max_size)
+			{
+				size *= 2;
+			}
+			return size;
+		};
+
+		for (auto i : lights)
+		{
+			int size = tile_size(i);
+			int current = i->m_shadow_views[0].tile.size;
+			if (current > 0 && (size > current || size * 4 <= current))
+			{
+				i->FreeShadowTiles();
+			}
+		}
+
+		// more important lights allocate first, the others fall back to smaller tiles
+		for (auto i : lights)
+		{
+			if (i->m_shadow_views[0].tile.node < 0)
+			{
+				int size = tile_size(i);
+				while (size >= SHADOW_ATLAS_MIN_TILE_SIZE && !i->AllocShadowTiles(size))
+				{
+					size /= 2;
+				}
+			}
+		}
+
+		// lights with outdated tiles, or with moving casters in range, queue by importance
+		// and the frames since their last update, so every light gets its turn
+		int frame = Time::GetFrameCount();
+		int budget = SHADOW_ATLAS_UPDATE_BUDGET;
+		Vector<Light*> candidates;
+		Vector<List<Renderer*>> casters;
+		Vector<float> priorities;
+		List<int> order;
+
+		for (auto i : lights)
+		{
+			if (i->m_shadow_views[0].tile.node < 0 || i->m_shadow_importance <= 0)
+			{
+				continue;
+			}
+
+			List<Renderer*> renderers;
+			i->CullRenderers(Renderer::GetRenderers(), renderers);
+
+			bool update = !i->m_shadow_atlas_valid;
+			if (!update)
+			{
+				Vector3 position = i->GetTransform()->GetPosition();
+				for (auto j : renderers)
+				{
+					if (!j->IsStatic() && is_caster_in_range(j, position, i->m_range))
+					{
+						update = true;
+						break;
+					}
+				}
+			}
+
+			if (update)
+			{
+				order.AddLast(candidates.Size());
+				candidates.Add(i);
+				casters.Add(renderers);
+				priorities.Add(i->m_shadow_importance * (frame - i->m_shadow_atlas_frame + 1));
+			}
+		}
+
+		order.Sort([&](int a, int b) {
+			return priorities[a] > priorities[b];
+		});
+		for (int i : order)
+		{
+			Light* light = candidates[i];
+			if (budget < light->m_shadow_views.Size())
+			{
+				continue;
+			}
+			budget -= light->m_shadow_views.Size();
+
+			light->UpdateAtlasViews();
+			light->UpdateViewUniforms();
+			for (int j = 0; j < light->m_shadow_views.Size(); ++j)
+			{
+				light->DrawShadowView(j, casters[i]);
+			}
+			light->m_shadow_atlas_valid = true;
+			light->m_shadow_atlas_drawn = true;
+			light->m_shadow_atlas_frame = frame;
+		}
+
+		// tiles keep their last shadow until the redraw comes, only new tiles wait with shadows off
+		for (auto i : lights)
+		{
+			bool ready = i->m_shadow_views[0].tile.node >= 0 && i->m_shadow_atlas_drawn;
+			if (i->m_shadow_ready != ready)
+			{
+				i->m_shadow_ready = ready;
+				i->m_dirty = true;
+			}
+		}
+	}
+
+	float Light::GetShadowImportance()
+	{
+		Camera* camera = this->GetShadowCamera();
+		if (camera == nullptr)
+		{
+			return 1.0f;
+		}
+
+		Vector3 position = this->GetTransform()->GetPosition();
+		Frustum frustum(camera->GetProjectionMatrix() * camera->GetViewMatrix());
+		if (frustum.ContainsSphere(position, m_range) == ContainsResult::Out)
+		{
+			return 0.0f;
+		}
+
+		// height of the light range relative to the screen
+		float distance = (position - camera->GetTransform()->GetPosition()).Magnitude();
+		if (distance <= m_range)
+		{
+			return 1.0f;
+		}
+		if (camera->IsOrthographic())
+		{
+			return Mathf::Clamp01(m_range / camera->GetOrthographicSize());
+		}
+		return Mathf::Clamp01(m_range / (distance * tan(camera->GetFieldOfView() * Mathf::Deg2Rad * 0.5f)));
+	}
+
+	bool Light::AllocShadowTiles(int size)
+	{
+		for (int i = 0; i < m_shadow_views.Size(); ++i)
+		{
+			if (!ShadowAtlas::Alloc(size, m_shadow_views[i].tile))
+			{
+				this->FreeShadowTiles();
+				return false;
+			}
+		}
+
+		// new tiles go first in the update queue
+		m_shadow_atlas_valid = false;
+		m_shadow_atlas_drawn = false;
+		m_shadow_atlas_frame = 0;
+		m_dirty = true;
+		return true;
+	}
+
+	void Light::FreeShadowTiles()
+	{
+		for (int i = 0; i < m_shadow_views.Size(); ++i)
+		{
+			ShadowAtlas::Free(m_shadow_views[i].tile);
+		}
+		m_shadow_atlas_valid = false;
+		m_shadow_atlas_drawn = false;
+	}
+
+	Camera* Light::GetShadowCamera() const
+	{
+		auto camera = m_shadow_camera.lock();
+		if (camera)
+		{
+			return camera.get();
+		}
+
+		Camera* result = nullptr;
+		for (auto i : Camera::GetCameras())
+		{
+			if (i->GetGameObject()->IsActiveInTree() && (result == nullptr || i->GetDepth() < result->GetDepth()))
+			{
+				result = i;
+			}
+		}
+		return result;
 	}
 
 	void Light::CullRenderers(const List<Renderer*>& renderers, List<Renderer*>& result)
@@ -88,81 +383,394 @@ namespace Viry3D
 		});
 	}
 
-	void Light::UpdateViewUniforms()
+	void Light::UpdateShadowTexture()
 	{
+		if (!m_shadow_texture_dirty)
+		{
+			return;
+		}
+		m_shadow_texture_dirty = false;
+
 		auto& driver = Engine::Instance()->GetDriverApi();
-		if (!m_view_uniform_buffer)
+
+		// cascades are laid out side by side in a texture of the light, or in a grid when a row is too wide,
+		// spot and point lights take tiles of the shadow atlas
+		int view_count = 1;
+		if (m_type == LightType::Directional && m_shadow_cascade_count > 0)
+		{
+			view_count = m_shadow_cascade_count;
+		}
+		else if (m_type == LightType::Point)
+		{
+			view_count = 6;
+		}
+
+		this->FreeShadowTiles();
+		for (int i = view_count; i < m_shadow_views.Size(); ++i)
+		{
+			if (m_shadow_views[i].view_uniform_buffer)
+			{
+				driver.destroyUniformBuffer(m_shadow_views[i].view_uniform_buffer);
+			}
+		}
+		m_shadow_views.Resize(view_count);
+		for (int i = 0; i < m_shadow_views.Size(); ++i)
+		{
+			m_shadow_views[i].cache_valid = false;
+		}
+
+		if (m_type == LightType::Directional)
+		{
+			int columns = view_count;
+			int rows = 1;
+			if (m_shadow_texture_size * columns > SHADOW_TEXTURE_MAX_SIZE)
+			{
+				columns = (int) ceil(sqrt((float) view_count));
+				rows = (view_count + columns - 1) / columns;
+			}
+			m_shadow_view_columns = columns;
+			m_shadow_view_size = Mathf::Min(m_shadow_texture_size, SHADOW_TEXTURE_MAX_SIZE / Mathf::Max(columns, rows));
+
+			m_shadow_texture = Texture::CreateRenderTexture(
+				m_shadow_view_size * columns,
+				m_shadow_view_size * rows,
+				Texture::SelectDepthFormat(),
+				FilterMode::Linear,
+				SamplerAddressMode::ClampToEdge);
+		}
+		else
+		{
+			m_shadow_texture = ShadowAtlas::GetTexture();
+		}
+		m_shadow_cache_texture.reset();
+
+		if (!m_sampler_group)
+		{
+			m_sampler_group = driver.createSamplerGroup(1);
+		}
+
+		filament::backend::SamplerGroup samplers(1);
+		samplers.setSampler(0, m_shadow_texture->GetTexture(), m_shadow_texture->GetSampler());
+		driver.updateSamplerGroup(m_sampler_group, std::move(samplers));
+
+		if (m_render_target)
+		{
+			driver.destroyRenderTarget(m_render_target);
+			m_render_target.clear();
+		}
+		if (m_cache_render_target)
+		{
+			driver.destroyRenderTarget(m_cache_render_target);
+			m_cache_render_target.clear();
+		}
+
+		m_dirty = true;
+	}
+
+	void Light::UpdateCascades()
+	{
+		Camera* camera = this->GetShadowCamera();
+
+		if (m_shadow_cascade_count == 0 || camera == nullptr)
 		{
-			m_view_uniform_buffer = driver.createUniformBuffer(sizeof(ViewUniforms), filament::backend::BufferUsage::DYNAMIC);
+			m_shadow_view_matrix = this->GetViewMatrix();
+			m_shadow_views[0].projection_matrix = this->GetProjectionMatrix();
+			m_shadow_views[0].split = Mathf::MaxFloatValue;
+			m_shadow_views[0].viewport = { 0, 0, (uint32_t) m_shadow_view_size, (uint32_t) m_shadow_view_size };
+			for (int i = 1; i < m_shadow_views.Size(); ++i)
+			{
+				m_shadow_views[i].split = -1;
+			}
+			return;
 		}
 
-		ViewUniforms view_uniforms;
-		view_uniforms.view_matrix = this->GetViewMatrix();
-		view_uniforms.projection_matrix = this->GetProjectionMatrix();
-		view_uniforms.camera_pos = this->GetTransform()->GetPosition();
+		// the eye stays at the origin, so only the light rotation moves the cascades
+		m_shadow_view_matrix = Matrix4x4::LookTo(Vector3(0, 0, 0), this->GetTransform()->GetForward(), this->GetTransform()->GetUp());
+		Matrix4x4 camera_to_world = camera->GetViewMatrix().Inverse();
+
+		float near_clip = camera->GetNearClip();
+		float far_clip = Mathf::Max(Mathf::Min(camera->GetFarClip(), m_shadow_distance), near_clip);
+		float half_height = camera->GetOrthographicSize();
+		float tan_half_fov = tan(camera->GetFieldOfView() * Mathf::Deg2Rad * 0.5f);
+		float aspect = camera->GetAspect();
+
+		int view_size = m_shadow_view_size;
+		int snap_texels = Mathf::Min(SHADOW_CASCADE_SNAP_TEXELS, view_size / 8);
+		int count = m_shadow_views.Size();
+		float split_near = near_clip;
 
-		void* buffer = driver.allocate(sizeof(ViewUniforms));
-		Memory::Copy(buffer, &view_uniforms, sizeof(ViewUniforms));
-		driver.loadUniformBuffer(m_view_uniform_buffer, filament::backend::BufferDescriptor(buffer, sizeof(ViewUniforms)));
+		for (int i = 0; i < count; ++i)
+		{
+			// blend logarithmic and uniform splits
+			float t = (i + 1) / (float) count;
+			float split_log = near_clip * pow(far_clip / near_clip, t);
+			float split_uniform = near_clip + (far_clip - near_clip) * t;
+			float split_far = SHADOW_CASCADE_SPLIT_LAMBDA * split_log + (1 - SHADOW_CASCADE_SPLIT_LAMBDA) * split_uniform;
+
+			// bounding sphere of the frustum slice, worked out in view space so the size
+			// does not change when the camera moves or turns
+			float near_h = camera->IsOrthographic() ? half_height : split_near * tan_half_fov;
+			float far_h = camera->IsOrthographic() ? half_height : split_far * tan_half_fov;
+			float near_sqr = near_h * near_h * (1 + aspect * aspect);
+			float far_sqr = far_h * far_h * (1 + aspect * aspect);
+			float center = (split_far * split_far + far_sqr - split_near * split_near - near_sqr) / (2 * (split_far - split_near));
+			center = Mathf::Clamp(center, split_near, split_far);
+			float radius = sqrt(Mathf::Max((center - split_near) * (center - split_near) + near_sqr, (split_far - center) * (split_far - center) + far_sqr));
+
+			Vector3 world_center = camera_to_world.MultiplyPoint3x4(Vector3(0, 0, -center));
+			Vector3 light_center = m_shadow_view_matrix.MultiplyPoint3x4(world_center);
+
+			// snap the center to whole texel steps, padding the extent by one step keeps the slice inside
+			float half_size = radius * view_size / (float) (view_size - 2 * snap_texels);
+			float step = half_size * 2 / view_size * snap_texels;
+			float x = floor(light_center.x / step) * step;
+			float y = floor(light_center.y / step) * step;
+			float z = floor(light_center.z / step) * step;
+
+			// casters between the slice and the light are kept up to the far clip of the light
+			m_shadow_views[i].projection_matrix = Matrix4x4::Ortho(x - half_size, x + half_size, y - half_size, y + half_size, -z - half_size - m_far_clip, -z + half_size);
+			m_shadow_views[i].split = split_far;
+			int column = i % m_shadow_view_columns;
+			int row = i / m_shadow_view_columns;
+			m_shadow_views[i].viewport = { column * view_size, row * view_size, (uint32_t) view_size, (uint32_t) view_size };
+
+			split_near = split_far;
+		}
 	}
 
-	void Light::Draw(const List<Renderer*>& renderers)
+	void Light::UpdateAtlasViews()
+	{
+		float far_clip = Mathf::Max(m_range, m_near_clip + 0.01f);
+
+		if (m_type == LightType::Spot)
+		{
+			m_shadow_view_matrix = this->GetViewMatrix();
+			m_shadow_views[0].projection_matrix = Matrix4x4::Perspective(m_spot_angle, 1.0f, m_near_clip, far_clip);
+			m_shadow_views[0].split = Mathf::MaxFloatValue;
+		}
+		else
+		{
+			// faces share the translation, the face rotation goes into the projection
+			static const Vector3 directions[6] = {
+				Vector3(1, 0, 0), Vector3(-1, 0, 0),
+				Vector3(0, 1, 0), Vector3(0, -1, 0),
+				Vector3(0, 0, 1), Vector3(0, 0, -1),
+			};
+			static const Vector3 ups[6] = {
+				Vector3(0, 1, 0), Vector3(0, 1, 0),
+				Vector3(0, 0, -1), Vector3(0, 0, 1),
+				Vector3(0, 1, 0), Vector3(0, 1, 0),
+			};
+
+			int size = m_shadow_views[0].tile.size;
+			float fov = 2 * atan(size / (float) (size - 2 * SHADOW_POINT_GUARD_TEXELS)) * Mathf::Rad2Deg;
+			Matrix4x4 projection = Matrix4x4::Perspective(fov, 1.0f, m_near_clip, far_clip);
+
+			m_shadow_view_matrix = Matrix4x4::Translation(-this->GetTransform()->GetPosition());
+			for (int i = 0; i < 6; ++i)
+			{
+				m_shadow_views[i].projection_matrix = projection * Matrix4x4::LookTo(Vector3(0, 0, 0), directions[i], ups[i]);
+				m_shadow_views[i].split = Mathf::MaxFloatValue;
+			}
+		}
+
+		for (int i = 0; i < m_shadow_views.Size(); ++i)
+		{
+			const auto& tile = m_shadow_views[i].tile;
+			m_shadow_views[i].viewport = { tile.x, tile.y, (uint32_t) tile.size, (uint32_t) tile.size };
+		}
+	}
+
+	void Light::UpdateViewUniforms()
 	{
 		auto& driver = Engine::Instance()->GetDriverApi();
+		if (!m_light_vertex_uniform_buffer)
+		{
+			m_light_vertex_uniform_buffer = driver.createUniformBuffer(sizeof(LightVertexUniforms), filament::backend::BufferUsage::DYNAMIC);
+		}
 
-		int target_width = m_shadow_texture_size;
-		int target_height = m_shadow_texture_size;
+		LightVertexUniforms light_uniforms;
+		light_uniforms.view_matrix = m_shadow_view_matrix;
+		Vector4 splits(-1, -1, -1, -1);
 
-		filament::backend::RenderTargetHandle target;
-		filament::backend::RenderPassParams params;
-		params.flags.clear = filament::backend::TargetBufferFlags::NONE;
-		params.flags.discardStart = filament::backend::TargetBufferFlags::NONE;
-		params.flags.discardEnd = filament::backend::TargetBufferFlags::NONE;
+		float texture_width = (float) m_shadow_texture->GetWidth();
+		float texture_height = (float) m_shadow_texture->GetHeight();
+		// shaders flip v on backends other than gl
+		float flip_y = Engine::Instance()->GetBackend() == filament::backend::Backend::OPENGL ? 1.0f : -1.0f;
+
+		for (int i = 0; i < m_shadow_views.Size(); ++i)
+		{
+			auto& view = m_shadow_views[i];
+			if (view.split < 0)
+			{
+				continue;
+			}
+
+			if (!view.view_uniform_buffer)
+			{
+				view.view_uniform_buffer = driver.createUniformBuffer(sizeof(ViewUniforms), filament::backend::BufferUsage::DYNAMIC);
+			}
+
+			ViewUniforms view_uniforms;
+			view_uniforms.view_matrix = m_shadow_view_matrix;
+			view_uniforms.projection_matrix = view.projection_matrix;
+			view_uniforms.camera_pos = this->GetTransform()->GetPosition();
+
+			void* buffer = driver.allocate(sizeof(ViewUniforms));
+			Memory::Copy(buffer, &view_uniforms, sizeof(ViewUniforms));
+			driver.loadUniformBuffer(view.view_uniform_buffer, filament::backend::BufferDescriptor(buffer, sizeof(ViewUniforms)));
+
+			// receivers sample the tile of the view in the shadow texture
+			Matrix4x4 tile = Matrix4x4::Identity();
+			tile.m00 = view.viewport.width / texture_width;
+			tile.m03 = (2 * view.viewport.left + view.viewport.width) / texture_width - 1.0f;
+			tile.m11 = view.viewport.height / texture_height;
+			tile.m13 = ((2 * view.viewport.bottom + view.viewport.height) / texture_height - 1.0f) * flip_y;
+			light_uniforms.projection_matrices[i] = tile * view.projection_matrix;
+			if (i < SHADOW_CASCADE_MAX_COUNT)
+			{
+				(&splits.x)[i] = view.split;
+			}
+		}
+
+		void* buffer = driver.allocate(sizeof(LightVertexUniforms));
+		Memory::Copy(buffer, &light_uniforms, sizeof(LightVertexUniforms));
+		driver.loadUniformBuffer(m_light_vertex_uniform_buffer, filament::backend::BufferDescriptor(buffer, sizeof(LightVertexUniforms)));
+
+		if (Memory::Compare(&splits, &m_shadow_cascade_splits, sizeof(Vector4)) != 0)
+		{
+			m_shadow_cascade_splits = splits;
+			m_dirty = true;
+		}
+	}
+
+	void Light::DrawShadowView(int index, const List<Renderer*>& renderers)
+	{
+		auto& view = m_shadow_views[index];
+		if (view.split < 0)
+		{
+			return;
+		}
+
+		Matrix4x4 view_projection = view.projection_matrix * m_shadow_view_matrix;
+		Frustum frustum(view_projection);
+
+		Vector<Renderer*> static_renderers;
+		Vector<Renderer*> dynamic_renderers;
+		for (auto i : renderers)
+		{
+			if (is_caster_visible(frustum, i))
+			{
+				if (i->IsStatic() && m_type == LightType::Directional)
+				{
+					static_renderers.Add(i);
+				}
+				else
+				{
+					dynamic_renderers.Add(i);
+				}
+			}
+		}
+
+		if (m_type != LightType::Directional)
+		{
+			// atlas tiles are only redrawn when scheduled, so they need no cache
+			this->DrawRenderers(ShadowAtlas::GetRenderTarget(), m_shadow_texture, index, dynamic_renderers, false);
+			return;
+		}
 
 		if (!m_render_target)
 		{
-			filament::backend::TargetBufferFlags target_flags = filament::backend::TargetBufferFlags::NONE;
-			filament::backend::TargetBufferInfo color = { };
-			filament::backend::TargetBufferInfo depth = { };
-			filament::backend::TargetBufferInfo stencil = { };
+			m_render_target = create_depth_target(m_shadow_texture);
+		}
 
-			target_flags |= filament::backend::TargetBufferFlags::DEPTH;
-			depth.handle = m_shadow_texture->GetTexture();
+		if (static_renderers.Empty())
+		{
+			view.cache_valid = false;
+			this->DrawRenderers(m_render_target, m_shadow_texture, index, dynamic_renderers, false);
+			return;
+		}
 
-			m_render_target = driver.createRenderTarget(
-				target_flags,
-				target_width,
-				target_height,
-				1,
-				color,
-				depth,
-				stencil);
+		if (!m_shadow_cache_texture)
+		{
+			m_shadow_cache_texture = Texture::CreateRenderTexture(
+				m_shadow_texture->GetWidth(),
+				m_shadow_texture->GetHeight(),
+				Texture::SelectDepthFormat(),
+				FilterMode::Nearest,
+				SamplerAddressMode::ClampToEdge);
+			m_cache_render_target = create_depth_target(m_shadow_cache_texture);
+
+			for (int i = 0; i < m_shadow_views.Size(); ++i)
+			{
+				m_shadow_views[i].cache_valid = false;
+			}
 		}
-		target = m_render_target;
 
+		// static casters are drawn again only when the cascade, or one of them, has moved
+		bool cache_valid = view.cache_valid &&
+			view.cached_static_version == Renderer::GetStaticVersion() &&
+			Memory::Compare(&view.cached_view_projection, &view_projection, sizeof(Matrix4x4)) == 0 &&
+			view.cached_renderers.Size() == static_renderers.Size() &&
+			Memory::Compare(&view.cached_renderers[0], &static_renderers[0], sizeof(Renderer*) * static_renderers.Size()) == 0;
+		if (!cache_valid)
+		{
+			this->DrawRenderers(m_cache_render_target, m_shadow_cache_texture, index, static_renderers, false);
+
+			view.cached_renderers = static_renderers;
+			view.cached_view_projection = view_projection;
+			view.cached_static_version = Renderer::GetStaticVersion();
+			view.cache_valid = true;
+		}
+
+		this->DrawRenderers(m_render_target, m_shadow_texture, index, dynamic_renderers, true);
+	}
+
+	void Light::DrawRenderers(const filament::backend::RenderTargetHandle& target, const Ref<Texture>& texture, int index, const Vector<Renderer*>& renderers, bool copy_cache)
+	{
+		auto& driver = Engine::Instance()->GetDriverApi();
+
+		int target_width = texture->GetWidth();
+		int target_height = texture->GetHeight();
+
+		filament::backend::RenderPassParams params;
 		params.flags.clear = filament::backend::TargetBufferFlags::DEPTH;
-		params.flags.discardStart |= filament::backend::TargetBufferFlags::COLOR;
+		params.flags.discardStart = filament::backend::TargetBufferFlags::COLOR;
+		params.flags.discardEnd = filament::backend::TargetBufferFlags::NONE;
+		params.viewport = m_shadow_views[index].viewport;
 
-		params.viewport.left = 0;
-		params.viewport.bottom = 0;
-		params.viewport.width = (uint32_t) target_width;
-		params.viewport.height = (uint32_t) target_height;
+		if (copy_cache)
+		{
+			if (!m_shadow_copy_material)
+			{
+				m_shadow_copy_material = RefMake<Material>(Shader::Find("ShadowCopy"));
+			}
+			m_shadow_copy_material->SetTexture(MaterialProperty::TEXTURE, m_shadow_cache_texture);
+			m_shadow_copy_material->Prepare();
+		}
 
 		driver.beginRenderPass(target, params);
 
-		driver.bindUniformBuffer((size_t) Shader::BindingPoint::PerView, m_view_uniform_buffer);
+		if (copy_cache)
+		{
+			// depth of the static casters, dynamic casters are depth tested against it
+			const auto& shader = m_shadow_copy_material->GetShader();
+			m_shadow_copy_material->SetScissor(target_width, target_height);
+			m_shadow_copy_material->Bind(0);
+			driver.draw(shader->GetPass(0).pipeline, Mesh::GetSharedQuadMesh()->GetPrimitives()[0]);
+		}
+
+		driver.bindUniformBuffer((size_t) Shader::BindingPoint::PerView, m_shadow_views[index].view_uniform_buffer);
 
 		for (auto i : renderers)
 		{
-			this->DrawRenderer(i);
+			this->DrawRenderer(i, target_width, target_height);
 		}
 
 		driver.endRenderPass();
-
-		driver.flush();
 	}
 
-	void Light::DrawRenderer(Renderer* renderer)
+	void Light::DrawRenderer(Renderer* renderer, int target_width, int target_height)
 	{
 		auto& driver = Engine::Instance()->GetDriverApi();
 
@@ -196,7 +804,7 @@ namespace Viry3D
 				{
 					const auto& shader = material->GetShader();
 
-					material->SetScissor(m_shadow_texture_size, m_shadow_texture_size);
+					material->SetScissor(target_width, target_height);
 
 					for (int j = 0; j < shader->GetPassCount(); ++j)
 					{
@@ -233,6 +841,17 @@ namespace Viry3D
 		m_spot_angle(30.0f),
 		m_shadow_enable(false),
 		m_shadow_texture_size(0),
+		m_shadow_texture_dirty(true),
+		m_shadow_cascade_count(0),
+		m_shadow_view_size(0),
+		m_shadow_view_columns(1),
+		m_shadow_distance(100),
+		m_shadow_cascade_splits(-1, -1, -1, -1),
+		m_shadow_atlas_valid(false),
+		m_shadow_atlas_drawn(false),
+		m_shadow_atlas_frame(0),
+		m_shadow_importance(0),
+		m_shadow_ready(true),
 		m_shadow_strength(1.0f),
 		m_shadow_z_bias(0.0001f),
 		m_shadow_slope_bias(0.0001f),
@@ -252,10 +871,20 @@ namespace Viry3D
     {
 		auto& driver = Engine::Instance()->GetDriverApi();
 
-		if (m_view_uniform_buffer)
+		this->FreeShadowTiles();
+		for (int i = 0; i < m_shadow_views.Size(); ++i)
+		{
+			if (m_shadow_views[i].view_uniform_buffer)
+			{
+				driver.destroyUniformBuffer(m_shadow_views[i].view_uniform_buffer);
+			}
+		}
+		m_shadow_views.Clear();
+
+		if (m_light_vertex_uniform_buffer)
 		{
-			driver.destroyUniformBuffer(m_view_uniform_buffer);
-			m_view_uniform_buffer.clear();
+			driver.destroyUniformBuffer(m_light_vertex_uniform_buffer);
+			m_light_vertex_uniform_buffer.clear();
 		}
 
 		if (m_light_uniform_buffer)
@@ -276,6 +905,12 @@ namespace Viry3D
 			m_render_target.clear();
 		}
 
+		if (m_cache_render_target)
+		{
+			driver.destroyRenderTarget(m_cache_render_target);
+			m_cache_render_target.clear();
+		}
+
 		m_lights.Remove(this);
     }
 
@@ -283,6 +918,7 @@ namespace Viry3D
 	{
 		m_dirty = true;
 		m_view_matrix_dirty = true;
+		m_shadow_atlas_valid = false;
 	}
 
 	void Light::SetType(LightType type)
@@ -290,6 +926,7 @@ namespace Viry3D
 		m_type = type;
 		m_dirty = true;
 		m_projection_matrix_dirty = true;
+		m_shadow_texture_dirty = true;
 	}
 
 	void Light::SetColor(const Color& color)
@@ -308,6 +945,7 @@ namespace Viry3D
 	{
 		m_range = range;
 		m_dirty = true;
+		m_shadow_atlas_valid = false;
 	}
 
 	void Light::SetSpotAngle(float angle)
@@ -315,6 +953,7 @@ namespace Viry3D
 		m_spot_angle = angle;
 		m_dirty = true;
 		m_projection_matrix_dirty = true;
+		m_shadow_atlas_valid = false;
 	}
 
 	void Light::EnableShadow(bool enable)
@@ -324,33 +963,33 @@ namespace Viry3D
 
 	void Light::SetShadowTextureSize(int size)
 	{
-		auto& driver = Engine::Instance()->GetDriverApi();
-
 		if (m_shadow_texture_size != size)
 		{
 			m_shadow_texture_size = size;
-			m_shadow_texture = Texture::CreateRenderTexture(
-				m_shadow_texture_size,
-				m_shadow_texture_size,
-				Texture::SelectDepthFormat(),
-				FilterMode::Linear,
-				SamplerAddressMode::ClampToEdge);
+			m_shadow_texture_dirty = true;
+			m_shadow_atlas_valid = false;
+			m_projection_matrix_dirty = true;
+		}
+	}
 
-			if (!m_sampler_group)
-			{
-				m_sampler_group = driver.createSamplerGroup(1);
-			}
+	void Light::SetShadowCascadeCount(int count)
+	{
+		count = Mathf::Clamp(count, 0, SHADOW_CASCADE_MAX_COUNT);
+		if (m_shadow_cascade_count != count)
+		{
+			m_shadow_cascade_count = count;
+			m_shadow_texture_dirty = true;
+		}
+	}
 
-			filament::backend::SamplerGroup samplers(1);
-			samplers.setSampler(0, m_shadow_texture->GetTexture(), m_shadow_texture->GetSampler());
-			driver.updateSamplerGroup(m_sampler_group, std::move(samplers));
+	void Light::SetShadowDistance(float distance)
+	{
+		m_shadow_distance = distance;
+	}
 
-			if (m_render_target)
-			{
-				driver.destroyRenderTarget(m_render_target);
-				m_render_target.clear();
-			}
-		}
+	void Light::SetShadowCamera(const Ref<Camera>& camera)
+	{
+		m_shadow_camera = camera;
 	}
 
 	void Light::SetShadowStrength(float strength)
@@ -375,6 +1014,7 @@ namespace Viry3D
 	{
 		m_near_clip = clip;
 		m_projection_matrix_dirty = true;
+		m_shadow_atlas_valid = false;
 	}
 
 	void Light::SetFarClip(float clip)
@@ -472,7 +1112,24 @@ namespace Viry3D
 			light_uniforms.light_atten.y = 1.0f / (light_uniforms.light_atten.x - cos(this->GetSpotAngle() / 4 * Mathf::Deg2Rad));
 			light_uniforms.spot_light_dir = -this->GetTransform()->GetForward();
 		}
-		light_uniforms.shadow_params = Vector4(m_shadow_strength, m_shadow_z_bias, m_shadow_slope_bias, 1.0f / m_shadow_texture_size * 3);
+		// lights still waiting for their atlas tiles receive no shadow
+		light_uniforms.shadow_params = Vector4(m_shadow_ready ? m_shadow_strength : 0.0f, m_shadow_z_bias, m_shadow_slope_bias, 3.0f);
+		light_uniforms.shadow_cascade_splits = m_shadow_cascade_splits;
+		if (m_shadow_texture)
+		{
+			float texture_width = (float) m_shadow_texture->GetWidth();
+			float texture_height = (float) m_shadow_texture->GetHeight();
+			light_uniforms.shadow_texel_size = Vector4(1.0f / texture_width, 1.0f / texture_height, 0, 0);
+			for (int i = 0; i < m_shadow_views.Size(); ++i)
+			{
+				const auto& viewport = m_shadow_views[i].viewport;
+				light_uniforms.shadow_rects[i] = Vector4(
+					viewport.left / texture_width,
+					viewport.bottom / texture_height,
+					(viewport.left + viewport.width) / texture_width,
+					(viewport.bottom + viewport.height) / texture_height);
+			}
+		}
 
 		void* buffer = driver.allocate(sizeof(LightFragmentUniforms));
 		Memory::Copy(buffer, &light_uniforms, sizeof(LightFragmentUniforms));
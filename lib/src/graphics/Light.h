@@ -21,8 +21,18 @@
 #include "container/List.h"
 #include "Color.h"
 #include "math/Matrix4x4.h"
+#include "ShadowAtlas.h"
 #include "private/backend/DriverApi.h"
 
+#define SHADOW_CASCADE_MAX_COUNT 4
+#define SHADOW_CASCADE_SPLIT_LAMBDA 0.75f
+// cascades move in steps of this many texels, so the static caster cache survives small camera moves
+#define SHADOW_CASCADE_SNAP_TEXELS 16
+// largest side of a cascade texture, cascades wrap into a grid and shrink to stay within it
+#define SHADOW_TEXTURE_MAX_SIZE 4096
+// point light faces are widened by this many texels so filtering does not cross tile borders
+#define SHADOW_POINT_GUARD_TEXELS 4
+
 namespace Viry3D
 {
     enum class LightType
@@ -34,6 +44,8 @@ namespace Viry3D
 
 	class Renderer;
 	class Texture;
+	class Camera;
+	class Material;
     
     class Light : public Component
     {
@@ -58,6 +70,15 @@ namespace Viry3D
 		void EnableShadow(bool enable);
 		void SetShadowTextureSize(int size);
 		const Ref<Texture>& GetShadowTexture() const { return m_shadow_texture; }
+		// directional lights split the view of the shadow camera into cascades,
+		// 0 keeps the fixed orthographic projection
+		int GetShadowCascadeCount() const { return m_shadow_cascade_count; }
+		void SetShadowCascadeCount(int count);
+		float GetShadowDistance() const { return m_shadow_distance; }
+		void SetShadowDistance(float distance);
+		// camera the cascades are fitted to and the atlas tiles of spot and point lights are sized for,
+		// the camera with the lowest depth when not set
+		void SetShadowCamera(const Ref<Camera>& camera);
 		void SetShadowStrength(float strength);
 		void SetShadowZBias(float bias);
 		void SetShadowSlopeBias(float bias);
@@ -66,7 +87,7 @@ namespace Viry3D
 		void SetOrthographicSize(float size);
 		uint32_t GetCullingMask() const { return m_culling_mask; }
 		void SetCullingMask(uint32_t mask);
-		const filament::backend::UniformBufferHandle& GetViewUniformBuffer() const { return m_view_uniform_buffer; }
+		const filament::backend::UniformBufferHandle& GetLightVertexUniformBuffer() const { return m_light_vertex_uniform_buffer; }
 		const filament::backend::UniformBufferHandle& GetLightUniformBuffer() const { return m_light_uniform_buffer; }
 		const filament::backend::SamplerGroupHandle& GetSamplerGroup() const { return m_sampler_group; }
 
@@ -74,12 +95,36 @@ namespace Viry3D
 		virtual void OnTransformDirty();
 
 	private:
+		// a cascade of a directional light, or the tile of a spot light or point light face
+		struct ShadowView
+		{
+			Matrix4x4 projection_matrix;
+			float split;
+			filament::backend::Viewport viewport;
+			ShadowAtlas::Tile tile;
+			filament::backend::UniformBufferHandle view_uniform_buffer;
+			// static casters drawn into the cache tile, and what they were drawn with
+			Vector<Renderer*> cached_renderers;
+			Matrix4x4 cached_view_projection;
+			uint32_t cached_static_version;
+			bool cache_valid;
+		};
+
 		const Matrix4x4& GetViewMatrix();
 		const Matrix4x4& GetProjectionMatrix();
+		Camera* GetShadowCamera() const;
+		static void RenderShadowAtlas(List<Light*>& lights);
 		void CullRenderers(const List<Renderer*>& renderers, List<Renderer*>& result);
+		void UpdateCascades();
+		void UpdateAtlasViews();
 		void UpdateViewUniforms();
-		void Draw(const List<Renderer*>& renderers);
-		void DrawRenderer(Renderer* renderer);
+		void UpdateShadowTexture();
+		float GetShadowImportance();
+		bool AllocShadowTiles(int size);
+		void FreeShadowTiles();
+		void DrawShadowView(int index, const List<Renderer*>& renderers);
+		void DrawRenderers(const filament::backend::RenderTargetHandle& target, const Ref<Texture>& texture, int index, const Vector<Renderer*>& renderers, bool copy_cache);
+		void DrawRenderer(Renderer* renderer, int target_width, int target_height);
 		void Prepare();
 
 	private:
@@ -88,6 +133,7 @@ namespace Viry3D
     private:
 		static List<Light*> m_lights;
 		static Color m_ambient_color;
+		static uint32_t m_shadow_atlas_static_version;
 		bool m_dirty;
         LightType m_type;
 		Color m_color;
@@ -97,6 +143,24 @@ namespace Viry3D
 		bool m_shadow_enable;
 		int m_shadow_texture_size;
 		Ref<Texture> m_shadow_texture;
+		Ref<Texture> m_shadow_cache_texture;
+		bool m_shadow_texture_dirty;
+		int m_shadow_cascade_count;
+		// side and grid columns of the cascade views in the shadow texture of a directional light
+		int m_shadow_view_size;
+		int m_shadow_view_columns;
+		float m_shadow_distance;
+		WeakRef<Camera> m_shadow_camera;
+		Vector<ShadowView> m_shadow_views;
+		Matrix4x4 m_shadow_view_matrix;
+		Vector4 m_shadow_cascade_splits;
+		// atlas tiles hold the current shadows, and were drawn on that frame
+		bool m_shadow_atlas_valid;
+		bool m_shadow_atlas_drawn;
+		int m_shadow_atlas_frame;
+		float m_shadow_importance;
+		bool m_shadow_ready;
+		Ref<Material> m_shadow_copy_material;
 		float m_shadow_strength;
 		float m_shadow_z_bias;
 		float m_shadow_slope_bias;
@@ -108,9 +172,10 @@ namespace Viry3D
 		Matrix4x4 m_projection_matrix;
 		bool m_projection_matrix_dirty;
 		uint32_t m_culling_mask;
-		filament::backend::UniformBufferHandle m_view_uniform_buffer;
+		filament::backend::UniformBufferHandle m_light_vertex_uniform_buffer;
 		filament::backend::UniformBufferHandle m_light_uniform_buffer;
 		filament::backend::SamplerGroupHandle m_sampler_group;
 		filament::backend::RenderTargetHandle m_render_target;
+		filament::backend::RenderTargetHandle m_cache_render_target;
     };
 }
@@ -0,0 +1,114 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "LodGroup.h"
+#include "GameObject.h"
+#include "Camera.h"
+#include "MeshRenderer.h"
+#include "math/Mathf.h"
+
+namespace Viry3D
+{
+	List<LodGroup*> LodGroup::m_groups;
+
+	void LodGroup::SelectAll(Camera* camera)
+	{
+		for (auto i : m_groups)
+		{
+			if (i->GetGameObject()->IsActiveInTree())
+			{
+				i->Select(camera);
+			}
+		}
+	}
+
+	LodGroup::LodGroup():
+		m_lod_bias(1.0f),
+		m_force_lod(-1),
+		m_current_lod(0)
+	{
+		m_groups.AddLast(this);
+	}
+
+	LodGroup::~LodGroup()
+	{
+		m_groups.Remove(this);
+	}
+
+	void LodGroup::SetLodBias(float bias)
+	{
+		m_lod_bias = bias;
+	}
+
+	void LodGroup::SetForceLod(int lod)
+	{
+		m_force_lod = lod;
+	}
+
+	void LodGroup::Select(Camera* camera)
+	{
+		Ref<MeshRenderer> renderer = m_renderer.lock();
+		if (!renderer)
+		{
+			renderer = this->GetGameObject()->GetComponent<MeshRenderer>();
+			m_renderer = renderer;
+		}
+		if (!renderer || !renderer->GetMesh())
+		{
+			return;
+		}
+
+		const auto& mesh = renderer->GetMesh();
+		const auto& lods = mesh->GetLods();
+		int lod = 0;
+
+		if (m_force_lod >= 0)
+		{
+			lod = Mathf::Min(m_force_lod, lods.Size());
+		}
+		else if (lods.Size() > 0)
+		{
+			const auto& transform = this->GetTransform();
+			const auto& bounds = mesh->GetBounds();
+			const Vector3& scale = transform->GetScale();
+			float max_scale = Mathf::Max(fabs(scale.x), Mathf::Max(fabs(scale.y), fabs(scale.z)));
+			float size = (bounds.Max() - bounds.Min()).Magnitude() * max_scale;
+
+			// relative height of the bounding sphere on screen
+			float screen_size;
+			if (camera->IsOrthographic())
+			{
+				screen_size = size / (2.0f * camera->GetOrthographicSize());
+			}
+			else
+			{
+				Vector3 center = transform->GetLocalToWorldMatrix().MultiplyPoint3x4((bounds.Min() + bounds.Max()) * 0.5f);
+				float distance = Mathf::Max((center - camera->GetTransform()->GetPosition()).Magnitude(), camera->GetNearClip());
+				screen_size = size / (2.0f * distance * tanf(camera->GetFieldOfView() * Mathf::Deg2Rad * 0.5f));
+			}
+			screen_size *= m_lod_bias;
+
+			while (lod < lods.Size() && screen_size < lods[lod].screen_size)
+			{
+				++lod;
+			}
+		}
+
+		m_current_lod = lod;
+		renderer->SetLod(lod);
+	}
+}
@@ -0,0 +1,52 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+#include "Component.h"
+#include "container/List.h"
+
+namespace Viry3D
+{
+	class Camera;
+	class MeshRenderer;
+
+	// picks a level of the mesh lod chain for the mesh renderer on the same game object,
+	// from the height of the mesh bounds relative to the screen
+	class LodGroup : public Component
+	{
+	public:
+		static void SelectAll(Camera* camera);
+		LodGroup();
+		virtual ~LodGroup();
+		float GetLodBias() const { return m_lod_bias; }
+		void SetLodBias(float bias);
+		int GetForceLod() const { return m_force_lod; }
+		void SetForceLod(int lod);
+		int GetCurrentLod() const { return m_current_lod; }
+
+	private:
+		void Select(Camera* camera);
+
+	private:
+		static List<LodGroup*> m_groups;
+		float m_lod_bias;
+		int m_force_lod;
+		int m_current_lod;
+		WeakRef<MeshRenderer> m_renderer;
+	};
+}
@@ -303,6 +303,16 @@ namespace Viry3D
                 continue;
             }
             
+            // streamed textures recreate their gpu texture when the resident mips change
+            for (int j = 0; j < sampler_group.samplers.Size(); ++j)
+            {
+                const auto& sampler = sampler_group.samplers[j];
+                if (sampler.texture && sampler.texture->GetVersion() != sampler.version)
+                {
+                    sampler_group.dirty = true;
+                }
+            }
+            
             if (sampler_group.dirty)
             {
                 sampler_group.dirty = false;
@@ -310,8 +320,9 @@ namespace Viry3D
                 filament::backend::SamplerGroup samplers(sampler_group.samplers.Size());
                 for (int j = 0; j < sampler_group.samplers.Size(); ++j)
                 {
-                    const auto& sampler = sampler_group.samplers[j];
+                    auto& sampler = sampler_group.samplers[j];
 					samplers.setSampler(j, sampler.texture->GetTexture(), sampler.texture->GetSampler());
+                    sampler.version = sampler.texture->GetVersion();
                 }
                 driver.updateSamplerGroup(sampler_group.sampler_group, std::move(samplers));
             }
@@ -68,6 +68,17 @@ namespace Viry3D
 		Vector4 bones[BONES_VECTOR_MAX_COUNT];
 	};
 
+	// per light vertex uniforms for shadow receivers, set by light
+	struct LightVertexUniforms
+	{
+		static constexpr const char* LIGHT_VIEW_MATRIX = "u_light_view_matrix";
+		static constexpr const char* LIGHT_PROJECTION_MATRICES = "u_light_projection_matrices";
+		static constexpr const int SHADOW_VIEW_MAX_COUNT = 6;
+
+		Matrix4x4 view_matrix;
+		Matrix4x4 projection_matrices[SHADOW_VIEW_MAX_COUNT]; // mapped to the cascade or atlas tile of the shadow texture
+	};
+
 	// per light uniforms, set by light
 	struct LightFragmentUniforms
 	{
@@ -77,13 +88,19 @@ namespace Viry3D
 		static constexpr const char* LIGHT_ATTEN = "u_light_atten";
 		static constexpr const char* SPOT_LIGHT_DIR = "u_spot_light_dir";
 		static constexpr const char* SHADOW_PARAMS = "u_shadow_params";
+		static constexpr const char* SHADOW_CASCADE_SPLITS = "u_shadow_cascade_splits";
+		static constexpr const char* SHADOW_TEXEL_SIZE = "u_shadow_texel_size";
+		static constexpr const char* SHADOW_RECTS = "u_shadow_rects";
 
 		Color ambient_color;
 		Vector4 light_pos;
 		Color light_color; // light type in a
 		Vector4 light_atten;
 		Vector4 spot_light_dir;
-		Vector4 shadow_params; // strength, z_bias, slope_bias, filter_radius
+		Vector4 shadow_params; // strength, z_bias, slope_bias, filter_radius in texels
+		Vector4 shadow_cascade_splits; // far view depth of each cascade, -1 when not used
+		Vector4 shadow_texel_size; // 1 / shadow texture size in xy
+		Vector4 shadow_rects[LightVertexUniforms::SHADOW_VIEW_MAX_COUNT]; // uv rect of each shadow view, min in xy, max in zw
 	};
 
 	// per material uniforms, set by material
@@ -136,6 +153,7 @@ namespace Viry3D
     {
         int binding;
         Ref<Texture> texture;
+        int version = -1;   // texture version bound in the sampler group
     };
     
     struct SamplerGroup
@@ -165,6 +183,7 @@ namespace Viry3D
         void SetTexture(const String& name, const Ref<Texture>& texture);
         void SetVectorArray(const String& name, const Vector<Vector4>& array);
         void SetMatrixArray(const String& name, const Vector<Matrix4x4>& array);
+        const Map<String, MaterialProperty>& GetProperties() const { return m_properties; }
         const Rect& GetScissorRect() const { return m_scissor_rect; }
         void SetScissorRect(const Rect& rect);
 		void EnableKeyword(const String& keyword);
@@ -21,10 +21,1054 @@
 #include "Shader.h"
 #include "io/File.h"
 #include "io/MemoryStream.h"
+#include "io/MappedFile.h"
 #include "memory/Memory.h"
+#include "math/Mathf.h"
+#include "private/backend/Driver.h"
 
 namespace Viry3D
 {
+	// half positions are only used when the rounding error stays under these bounds
+	static const float HALF_POSITION_MAX_ERROR = 0.001f;
+	static const float HALF_POSITION_MAX_RELATIVE_ERROR = 0.001f;
+
+	static inline unsigned char PackUnorm8(float v)
+	{
+		return (unsigned char) (Mathf::Clamp01(v) * 255.0f + 0.5f);
+	}
+
+	static inline unsigned short PackUnorm16(float v)
+	{
+		return (unsigned short) (Mathf::Clamp01(v) * 65535.0f + 0.5f);
+	}
+
+	static inline short PackSnorm16(float v)
+	{
+		return (short) Mathf::RoundToInt(Mathf::Clamp(v, -1.0f, 1.0f) * 32767.0f);
+	}
+
+	static void PackBoneWeights(const Vector4& weights, unsigned char* dst)
+	{
+		int sum = 0;
+		int max_index = 0;
+		for (int i = 0; i < 4; ++i)
+		{
+			dst[i] = PackUnorm8(weights[i]);
+			sum += dst[i];
+			if (dst[i] > dst[max_index])
+			{
+				max_index = i;
+			}
+		}
+
+		// keep the quantized weights summing to one
+		if (sum > 0 && sum != 255)
+		{
+			dst[max_index] = (unsigned char) Mathf::Clamp(dst[max_index] + 255 - sum, 0, 255);
+		}
+	}
+
+	static void PackVertexAttribute(const Mesh::Vertex* vertices, int count, Shader::AttributeLocation location, const filament::backend::Attribute& attribute, unsigned char* dst)
+	{
+		using filament::backend::ElementType;
+
+		for (int i = 0; i < count; ++i)
+		{
+			const auto& v = vertices[i];
+			unsigned char* p = &dst[i * attribute.stride];
+
+			switch (location)
+			{
+				case Shader::AttributeLocation::Vertex:
+					if (attribute.type == ElementType::HALF4)
+					{
+						unsigned short* h = (unsigned short*) p;
+						h[0] = Mathf::FloatToHalf(v.vertex.x);
+						h[1] = Mathf::FloatToHalf(v.vertex.y);
+						h[2] = Mathf::FloatToHalf(v.vertex.z);
+						h[3] = Mathf::FloatToHalf(1.0f);
+					}
+					else
+					{
+						Memory::Copy(p, &v.vertex, sizeof(Vector3));
+					}
+					break;
+				case Shader::AttributeLocation::Color:
+					p[0] = PackUnorm8(v.color.r);
+					p[1] = PackUnorm8(v.color.g);
+					p[2] = PackUnorm8(v.color.b);
+					p[3] = PackUnorm8(v.color.a);
+					break;
+				case Shader::AttributeLocation::UV:
+				case Shader::AttributeLocation::UV2:
+				{
+					const Vector2& uv = location == Shader::AttributeLocation::UV ? v.uv : v.uv2;
+					if (attribute.type == ElementType::USHORT2)
+					{
+						unsigned short* s = (unsigned short*) p;
+						s[0] = PackUnorm16(uv.x);
+						s[1] = PackUnorm16(uv.y);
+					}
+					else
+					{
+						Memory::Copy(p, &uv, sizeof(Vector2));
+					}
+					break;
+				}
+				case Shader::AttributeLocation::Normal:
+				{
+					short* s = (short*) p;
+					s[0] = PackSnorm16(v.normal.x);
+					s[1] = PackSnorm16(v.normal.y);
+					s[2] = PackSnorm16(v.normal.z);
+					s[3] = 0;
+					break;
+				}
+				case Shader::AttributeLocation::Tangent:
+				{
+					short* s = (short*) p;
+					s[0] = PackSnorm16(v.tangent.x);
+					s[1] = PackSnorm16(v.tangent.y);
+					s[2] = PackSnorm16(v.tangent.z);
+					s[3] = PackSnorm16(v.tangent.w);
+					break;
+				}
+				case Shader::AttributeLocation::BoneWeights:
+					PackBoneWeights(v.bone_weights, p);
+					break;
+				case Shader::AttributeLocation::BoneIndices:
+					// unorm8, shaders scale back by 255
+					p[0] = (unsigned char) Mathf::Clamp((int) v.bone_indices.x, 0, 255);
+					p[1] = (unsigned char) Mathf::Clamp((int) v.bone_indices.y, 0, 255);
+					p[2] = (unsigned char) Mathf::Clamp((int) v.bone_indices.z, 0, 255);
+					p[3] = (unsigned char) Mathf::Clamp((int) v.bone_indices.w, 0, 255);
+					break;
+				default:
+					break;
+			}
+		}
+	}
+
+	static void PackVertexAttribute(const Vector<Mesh::Vertex>& vertices, Shader::AttributeLocation location, const filament::backend::Attribute& attribute, unsigned char* dst)
+	{
+		if (vertices.Size() > 0)
+		{
+			PackVertexAttribute(&vertices[0], vertices.Size(), location, attribute, dst);
+		}
+	}
+
+	static void UnpackVertexAttribute(const unsigned char* src, Shader::AttributeLocation location, const filament::backend::Attribute& attribute, Vector<Mesh::Vertex>& vertices)
+	{
+		using filament::backend::ElementType;
+
+		for (int i = 0; i < vertices.Size(); ++i)
+		{
+			auto& v = vertices[i];
+			const unsigned char* p = &src[i * attribute.stride];
+
+			switch (location)
+			{
+				case Shader::AttributeLocation::Vertex:
+					if (attribute.type == ElementType::HALF4)
+					{
+						const unsigned short* h = (const unsigned short*) p;
+						v.vertex = Vector3(Mathf::HalfToFloat(h[0]), Mathf::HalfToFloat(h[1]), Mathf::HalfToFloat(h[2]));
+					}
+					else
+					{
+						Memory::Copy(&v.vertex, p, sizeof(Vector3));
+					}
+					break;
+				case Shader::AttributeLocation::Color:
+					v.color = Color(p[0] / 255.0f, p[1] / 255.0f, p[2] / 255.0f, p[3] / 255.0f);
+					break;
+				case Shader::AttributeLocation::UV:
+				case Shader::AttributeLocation::UV2:
+				{
+					Vector2& uv = location == Shader::AttributeLocation::UV ? v.uv : v.uv2;
+					if (attribute.type == ElementType::USHORT2)
+					{
+						const unsigned short* s = (const unsigned short*) p;
+						uv = Vector2(s[0] / 65535.0f, s[1] / 65535.0f);
+					}
+					else
+					{
+						Memory::Copy(&uv, p, sizeof(Vector2));
+					}
+					break;
+				}
+				case Shader::AttributeLocation::Normal:
+				{
+					const short* s = (const short*) p;
+					v.normal = Vector3(s[0] / 32767.0f, s[1] / 32767.0f, s[2] / 32767.0f);
+					break;
+				}
+				case Shader::AttributeLocation::Tangent:
+				{
+					const short* s = (const short*) p;
+					v.tangent = Vector4(s[0] / 32767.0f, s[1] / 32767.0f, s[2] / 32767.0f, s[3] / 32767.0f);
+					break;
+				}
+				case Shader::AttributeLocation::BoneWeights:
+					v.bone_weights = Vector4(p[0] / 255.0f, p[1] / 255.0f, p[2] / 255.0f, p[3] / 255.0f);
+					break;
+				case Shader::AttributeLocation::BoneIndices:
+					v.bone_indices = Vector4(p[0], p[1], p[2], p[3]);
+					break;
+				default:
+					break;
+			}
+		}
+	}
+
+    static Bounds CalculateBounds(const Vector<Mesh::Vertex>& vertices)
+    {
+        if (vertices.Empty())
+        {
+            return Bounds();
+        }
+
+        Vector3 min = vertices[0].vertex;
+        Vector3 max = vertices[0].vertex;
+        for (int i = 1; i < vertices.Size(); ++i)
+        {
+            min = Vector3::Min(min, vertices[i].vertex);
+            max = Vector3::Max(max, vertices[i].vertex);
+        }
+
+        return Bounds(min, max);
+    }
+
+    static float CalculateUVDensity(const Vector<Mesh::Vertex>& vertices, const Vector<unsigned int>& indices)
+    {
+        double world_area = 0;
+        double uv_area = 0;
+        for (int i = 0; i + 2 < indices.Size(); i += 3)
+        {
+            const auto& a = vertices[indices[i + 0]];
+            const auto& b = vertices[indices[i + 1]];
+            const auto& c = vertices[indices[i + 2]];
+
+            world_area += ((b.vertex - a.vertex) * (c.vertex - a.vertex)).Magnitude() * 0.5f;
+
+            Vector2 uv_ab = b.uv - a.uv;
+            Vector2 uv_ac = c.uv - a.uv;
+            uv_area += fabs(uv_ab.x * uv_ac.y - uv_ab.y * uv_ac.x) * 0.5f;
+        }
+
+        if (world_area <= 0 || uv_area <= 0)
+        {
+            return 0;
+        }
+
+        return (float) sqrt(uv_area / world_area);
+    }
+
+    // zero_attributes gets the uv and normal attributes that are all zero, they share one small zero stream,
+    // so shaders reading them still find a bound stream
+    static int SetupVertexAttributes(const Vector<Mesh::Vertex>& vertices, bool dynamic, bool blend_shapes, uint32_t enabled_attributes, filament::backend::AttributeArray& attributes, uint32_t& zero_attributes)
+    {
+        using filament::backend::Attribute;
+        using filament::backend::ElementType;
+
+        // static meshes pick the smallest encoding that keeps their data lossless enough,
+        // dynamic meshes can not know their future data and keep full precision positions and uvs
+        bool half_position = false;
+        bool unorm_uv = false;
+        bool unorm_uv2 = false;
+        zero_attributes = 0;
+
+        if (!dynamic && vertices.Size() > 0)
+        {
+            Vector3 min = vertices[0].vertex;
+            Vector3 max = vertices[0].vertex;
+            float max_abs = 0;
+            bool skinned = false;
+            bool zero_uv = true;
+            bool zero_normal = true;
+            unorm_uv = true;
+            unorm_uv2 = true;
+
+            for (int i = 0; i < vertices.Size(); ++i)
+            {
+                const auto& v = vertices[i];
+
+                min = Vector3::Min(min, v.vertex);
+                max = Vector3::Max(max, v.vertex);
+                max_abs = Mathf::Max(max_abs, Mathf::Max(fabs(v.vertex.x), Mathf::Max(fabs(v.vertex.y), fabs(v.vertex.z))));
+
+                unorm_uv = unorm_uv && v.uv.x >= 0 && v.uv.x <= 1 && v.uv.y >= 0 && v.uv.y <= 1;
+                unorm_uv2 = unorm_uv2 && v.uv2.x >= 0 && v.uv2.x <= 1 && v.uv2.y >= 0 && v.uv2.y <= 1;
+                skinned = skinned || v.bone_weights != Vector4(0, 0, 0, 0);
+                zero_uv = zero_uv && v.uv == Vector2(0, 0);
+                zero_normal = zero_normal && v.normal == Vector3(0, 0, 0);
+            }
+            skinned = skinned && (enabled_attributes & (uint32_t) Mesh::VertexAttributeMask::BoneWeights);
+
+            // skinning and blend shapes move vertices away from the bind pose, only plain static meshes use half positions.
+            // half float keeps 11 significant bits, rounding error is at most max_abs / 4096
+            float half_error = max_abs / 4096.0f;
+            float extent = (max - min).Magnitude();
+            half_position = !skinned && !blend_shapes &&
+                half_error <= HALF_POSITION_MAX_ERROR && half_error <= extent * HALF_POSITION_MAX_RELATIVE_ERROR;
+
+            // blend shapes write normals at runtime, so they keep a real stream
+            if (zero_uv)
+            {
+                zero_attributes |= (uint32_t) Mesh::VertexAttributeMask::UV;
+            }
+            if (zero_normal && !blend_shapes)
+            {
+                zero_attributes |= (uint32_t) Mesh::VertexAttributeMask::Normal;
+            }
+            zero_attributes &= enabled_attributes;
+        }
+
+        int stream_count = 0;
+        int zero_stream = -1;
+
+        for (int i = 0; i < (int) Shader::AttributeLocation::Count; ++i)
+        {
+            attributes[i] = Attribute();
+
+            if ((enabled_attributes & (1 << i)) == 0)
+            {
+                continue;
+            }
+
+            if (zero_attributes & (1 << i))
+            {
+                if (zero_stream < 0)
+                {
+                    zero_stream = stream_count;
+                    stream_count += 1;
+                }
+
+                attributes[i].offset = 0;
+                attributes[i].stride = (uint8_t) filament::backend::Driver::getElementTypeSize(ElementType::UBYTE4);
+                attributes[i].buffer = (uint8_t) zero_stream;
+                attributes[i].type = ElementType::UBYTE4;
+                attributes[i].flags = Attribute::FLAG_NORMALIZED;
+                continue;
+            }
+
+            ElementType type = ElementType::FLOAT4;
+            uint8_t flags = 0;
+
+            switch ((Shader::AttributeLocation) i)
+            {
+                case Shader::AttributeLocation::Vertex:
+                    type = half_position ? ElementType::HALF4 : ElementType::FLOAT3;
+                    break;
+                case Shader::AttributeLocation::Color:
+                    type = ElementType::UBYTE4;
+                    flags = Attribute::FLAG_NORMALIZED;
+                    break;
+                case Shader::AttributeLocation::UV:
+                case Shader::AttributeLocation::UV2:
+                    if ((i == (int) Shader::AttributeLocation::UV && unorm_uv) ||
+                        (i == (int) Shader::AttributeLocation::UV2 && unorm_uv2))
+                    {
+                        type = ElementType::USHORT2;
+                        flags = Attribute::FLAG_NORMALIZED;
+                    }
+                    else
+                    {
+                        type = ElementType::FLOAT2;
+                    }
+                    break;
+                case Shader::AttributeLocation::Normal:
+                case Shader::AttributeLocation::Tangent:
+                    type = ElementType::SHORT4;
+                    flags = Attribute::FLAG_NORMALIZED;
+                    break;
+                case Shader::AttributeLocation::BoneWeights:
+                case Shader::AttributeLocation::BoneIndices:
+                    type = ElementType::UBYTE4;
+                    flags = Attribute::FLAG_NORMALIZED;
+                    break;
+                default:
+                    break;
+            }
+
+            // one tightly packed stream per attribute
+            attributes[i].offset = 0;
+            attributes[i].stride = (uint8_t) filament::backend::Driver::getElementTypeSize(type);
+            attributes[i].buffer = (uint8_t) stream_count;
+            attributes[i].type = type;
+            attributes[i].flags = flags;
+
+            stream_count += 1;
+        }
+
+        return stream_count;
+    }
+
+    template<class T>
+    static void WriteBinary(Vector<byte>& buffer, const T& t)
+    {
+        buffer.AddRange((const byte*) &t, sizeof(T));
+    }
+
+    template<class V>
+    static void WriteBinaryArray(Vector<byte>& buffer, const Vector<V>& vec)
+    {
+        if (vec.Size() > 0)
+        {
+            buffer.AddRange(vec.Bytes(), vec.SizeInBytes());
+        }
+    }
+
+    template<class V>
+    static void WriteBinaryVector(Vector<byte>& buffer, const Vector<V>& vec)
+    {
+        WriteBinary(buffer, vec.Size());
+        WriteBinaryArray(buffer, vec);
+    }
+
+    template<class V>
+    static void ReadBinaryVector(MemoryStream& ms, Vector<V>& vec)
+    {
+        vec.Resize(ms.Read<int>());
+        if (vec.Size() > 0)
+        {
+            ms.Read(vec.Bytes(), vec.SizeInBytes());
+        }
+    }
+
+    static void WriteBinaryString(Vector<byte>& buffer, const String& str)
+    {
+        WriteBinary(buffer, (int) str.Size());
+        buffer.AddRange((const byte*) str.CString(), str.Size());
+    }
+
+    bool Mesh::ReadFile(const String& path, FileData& data)
+    {
+        if (!File::Exist(path))
+        {
+            Log("mesh file not exist: %s", path.CString());
+            return false;
+        }
+
+        MemoryStream ms(File::ReadAllBytes(path));
+
+        int name_size = ms.Read<int>();
+        data.name = ms.ReadString(name_size);
+
+        int vertex_count = ms.Read<int>();
+        data.vertices.Resize(vertex_count);
+
+        for (int i = 0; i < vertex_count; ++i)
+        {
+            data.vertices[i].vertex = ms.Read<Vector3>();
+        }
+
+        int color_count = ms.Read<int>();
+        for (int i = 0; i < color_count; ++i)
+        {
+            float r = ms.Read<byte>() / 255.0f;
+            float g = ms.Read<byte>() / 255.0f;
+            float b = ms.Read<byte>() / 255.0f;
+            float a = ms.Read<byte>() / 255.0f;
+            data.vertices[i].color = Color(r, g, b, a);
+        }
+
+        int uv_count = ms.Read<int>();
+        for (int i = 0; i < uv_count; ++i)
+        {
+            data.vertices[i].uv = ms.Read<Vector2>();
+        }
+
+        int uv2_count = ms.Read<int>();
+        for (int i = 0; i < uv2_count; ++i)
+        {
+            data.vertices[i].uv2 = ms.Read<Vector2>();
+        }
+
+        int normal_count = ms.Read<int>();
+        for (int i = 0; i < normal_count; ++i)
+        {
+            data.vertices[i].normal = ms.Read<Vector3>();
+        }
+
+        int tangent_count = ms.Read<int>();
+        for (int i = 0; i < tangent_count; ++i)
+        {
+            data.vertices[i].tangent = ms.Read<Vector4>();
+        }
+
+        int bone_weight_count = ms.Read<int>();
+        for (int i = 0; i < bone_weight_count; ++i)
+        {
+            data.vertices[i].bone_weights = ms.Read<Vector4>();
+            float index0 = (float) ms.Read<byte>();
+            float index1 = (float) ms.Read<byte>();
+            float index2 = (float) ms.Read<byte>();
+            float index3 = (float) ms.Read<byte>();
+            data.vertices[i].bone_indices = Vector4(index0, index1, index2, index3);
+        }
+
+        int index_count = ms.Read<int>();
+        data.indices.Resize(index_count);
+        for (int i = 0; i < index_count; ++i)
+        {
+            data.indices[i] = ms.Read<unsigned short>();
+        }
+
+        int submesh_count = ms.Read<int>();
+        data.submeshes.Resize(submesh_count);
+        ms.Read(&data.submeshes[0], data.submeshes.SizeInBytes());
+
+        int bindpose_count = ms.Read<int>();
+        if (bindpose_count > 0)
+        {
+            data.bindposes.Resize(bindpose_count);
+            ms.Read(&data.bindposes[0], data.bindposes.SizeInBytes());
+        }
+        
+        int blend_shape_count = ms.Read<int>();
+        if (blend_shape_count > 0)
+        {
+            data.blend_shapes.Resize(blend_shape_count);
+            
+            for (int i = 0; i < blend_shape_count; ++i)
+            {
+                auto& shape = data.blend_shapes[i];
+                
+                int string_size = ms.Read<int>();
+                String shape_name = ms.ReadString(string_size);
+                int frame_count = ms.Read<int>();
+                
+                shape.name = shape_name;
+                shape.frames.Resize(frame_count);
+                
+                for (int j = 0; j < frame_count; ++j)
+                {
+                    auto& frame = shape.frames[j];
+                    
+                    float frame_weight = ms.Read<float>();
+                    
+                    frame.weight = frame_weight / 100.0f;
+                    frame.vertices.Resize(vertex_count);
+                    frame.normals.Resize(normal_count);
+                    frame.tangents.Resize(tangent_count);
+                    
+                    if (vertex_count > 0)
+                    {
+                        ms.Read(&frame.vertices[0], frame.vertices.SizeInBytes());
+                    }
+                    
+                    if (normal_count > 0)
+                    {
+                        ms.Read(&frame.normals[0], frame.normals.SizeInBytes());
+                    }
+                    
+                    if (tangent_count > 0)
+                    {
+                        ms.Read(&frame.tangents[0], frame.tangents.SizeInBytes());
+                    }
+                }
+            }
+        }
+        
+        // optional lod chain appended by the mesh optimizer
+        int lod_count = 0;
+        if (ms.Read(&lod_count, sizeof(lod_count)) == sizeof(lod_count) && lod_count > 0)
+        {
+            data.lods.Resize(lod_count);
+            for (int i = 0; i < lod_count; ++i)
+            {
+                data.lods[i].screen_size = ms.Read<float>();
+                ReadBinaryVector(ms, data.lods[i].submeshes);
+            }
+        }
+
+        // only upload the attributes the file actually contains, uv and normal are read by most shaders,
+        // so they stay enabled and fall back to a shared zero stream when missing
+        data.vertex_attributes = (int) Mesh::VertexAttributeMask::Vertex | (int) Mesh::VertexAttributeMask::UV | (int) Mesh::VertexAttributeMask::Normal;
+        if (color_count > 0)
+        {
+            data.vertex_attributes |= (int) Mesh::VertexAttributeMask::Color;
+        }
+        if (uv2_count > 0)
+        {
+            data.vertex_attributes |= (int) Mesh::VertexAttributeMask::UV2;
+        }
+        if (tangent_count > 0)
+        {
+            data.vertex_attributes |= (int) Mesh::VertexAttributeMask::Tangent;
+        }
+        if (bone_weight_count > 0)
+        {
+            data.vertex_attributes |= (int) Mesh::VertexAttributeMask::BoneWeights | (int) Mesh::VertexAttributeMask::BoneIndices;
+        }
+
+        return true;
+    }
+
+    bool Mesh::WriteFile(const String& path, const FileData& data)
+    {
+        int vertex_count = data.vertices.Size();
+        if (vertex_count > 65536)
+        {
+            Log("mesh file only supports 16 bit indices: %s", path.CString());
+            return false;
+        }
+
+        auto count = [&](VertexAttributeMask mask) {
+            return (data.vertex_attributes & (int) mask) ? vertex_count : 0;
+        };
+
+        Vector<byte> buffer;
+
+        WriteBinaryString(buffer, data.name);
+
+        WriteBinary(buffer, vertex_count);
+        for (int i = 0; i < vertex_count; ++i)
+        {
+            WriteBinary(buffer, data.vertices[i].vertex);
+        }
+
+        WriteBinary(buffer, count(VertexAttributeMask::Color));
+        for (int i = 0; i < count(VertexAttributeMask::Color); ++i)
+        {
+            const Color& c = data.vertices[i].color;
+            WriteBinary(buffer, PackUnorm8(c.r));
+            WriteBinary(buffer, PackUnorm8(c.g));
+            WriteBinary(buffer, PackUnorm8(c.b));
+            WriteBinary(buffer, PackUnorm8(c.a));
+        }
+
+        WriteBinary(buffer, count(VertexAttributeMask::UV));
+        for (int i = 0; i < count(VertexAttributeMask::UV); ++i)
+        {
+            WriteBinary(buffer, data.vertices[i].uv);
+        }
+
+        WriteBinary(buffer, count(VertexAttributeMask::UV2));
+        for (int i = 0; i < count(VertexAttributeMask::UV2); ++i)
+        {
+            WriteBinary(buffer, data.vertices[i].uv2);
+        }
+
+        WriteBinary(buffer, count(VertexAttributeMask::Normal));
+        for (int i = 0; i < count(VertexAttributeMask::Normal); ++i)
+        {
+            WriteBinary(buffer, data.vertices[i].normal);
+        }
+
+        WriteBinary(buffer, count(VertexAttributeMask::Tangent));
+        for (int i = 0; i < count(VertexAttributeMask::Tangent); ++i)
+        {
+            WriteBinary(buffer, data.vertices[i].tangent);
+        }
+
+        WriteBinary(buffer, count(VertexAttributeMask::BoneWeights));
+        for (int i = 0; i < count(VertexAttributeMask::BoneWeights); ++i)
+        {
+            const auto& v = data.vertices[i];
+            WriteBinary(buffer, v.bone_weights);
+            for (int j = 0; j < 4; ++j)
+            {
+                WriteBinary(buffer, (byte) Mathf::Clamp((int) v.bone_indices[j], 0, 255));
+            }
+        }
+
+        WriteBinary(buffer, data.indices.Size());
+        for (int i = 0; i < data.indices.Size(); ++i)
+        {
+            WriteBinary(buffer, (unsigned short) data.indices[i]);
+        }
+
+        WriteBinaryVector(buffer, data.submeshes);
+        WriteBinaryVector(buffer, data.bindposes);
+
+        WriteBinary(buffer, data.blend_shapes.Size());
+        for (int i = 0; i < data.blend_shapes.Size(); ++i)
+        {
+            const auto& shape = data.blend_shapes[i];
+
+            WriteBinaryString(buffer, shape.name);
+            WriteBinary(buffer, shape.frames.Size());
+
+            for (int j = 0; j < shape.frames.Size(); ++j)
+            {
+                const auto& frame = shape.frames[j];
+
+                WriteBinary(buffer, frame.weight * 100.0f);
+                WriteBinaryArray(buffer, frame.vertices);
+                WriteBinaryArray(buffer, frame.normals);
+                WriteBinaryArray(buffer, frame.tangents);
+            }
+        }
+
+        if (data.lods.Size() > 0)
+        {
+            WriteBinary(buffer, data.lods.Size());
+            for (int i = 0; i < data.lods.Size(); ++i)
+            {
+                WriteBinary(buffer, data.lods[i].screen_size);
+                WriteBinaryVector(buffer, data.lods[i].submeshes);
+            }
+        }
+
+        return File::WriteAllBytes(path, ByteBuffer(buffer.Bytes(), buffer.Size()));
+    }
+
+    // binary mesh container. vertex streams and indices are stored in their final gpu encoding,
+    // every section starts on a 16 byte boundary so the driver can read them straight from the mapped file.
+    static const char BINARY_MESH_MAGIC[4] = { 'V', 'M', 'S', 'H' };
+    static const uint32_t BINARY_MESH_VERSION = 4;
+    static const uint32_t BINARY_MESH_ALIGNMENT = 16;
+    static const uint32_t BINARY_MESH_FLAG_UINT32_INDEX = 1 << 0;
+
+    struct BinaryMeshSection
+    {
+        uint32_t offset;
+        uint32_t size;
+    };
+
+    struct BinaryMeshStream
+    {
+        BinaryMeshSection data;
+        uint8_t type;
+        uint8_t flags;
+        uint8_t stride;
+        uint8_t buffer;
+    };
+
+    struct BinaryMeshHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t header_size;
+        uint32_t flags;
+        uint32_t vertex_count;
+        uint32_t index_count;
+        uint32_t enabled_attributes;
+        uint32_t zero_attributes;   // enabled attributes sharing one zero filled stream
+        uint32_t stream_count;
+        float bounds_min[3];
+        float bounds_max[3];
+        float uv_density;
+        BinaryMeshSection indices;
+        BinaryMeshSection submeshes;
+        BinaryMeshSection bindposes;
+        BinaryMeshSection extra;    // name, blend shapes and lods, parsed on load
+        BinaryMeshStream streams[(int) Shader::AttributeLocation::Count];
+    };
+
+    static uint32_t AlignBinarySection(uint32_t offset)
+    {
+        return (offset + BINARY_MESH_ALIGNMENT - 1) & ~(BINARY_MESH_ALIGNMENT - 1);
+    }
+
+    static bool IsBinarySectionValid(const BinaryMeshSection& section, int file_size)
+    {
+        return (uint64_t) section.offset + section.size <= (uint64_t) file_size;
+    }
+
+    static bool IsSubmeshValid(const Mesh::Submesh& submesh, uint32_t index_count)
+    {
+        return submesh.index_first >= 0 && submesh.index_count >= 0 &&
+            (uint64_t) submesh.index_first + (uint64_t) submesh.index_count <= index_count;
+    }
+
+    // only the encodings SetupVertexAttributes writes can be unpacked
+    static bool IsBinaryStreamTypeValid(Shader::AttributeLocation location, filament::backend::ElementType type, bool zero)
+    {
+        using filament::backend::ElementType;
+
+        if (zero)
+        {
+            return (location == Shader::AttributeLocation::UV || location == Shader::AttributeLocation::Normal) && type == ElementType::UBYTE4;
+        }
+
+        switch (location)
+        {
+            case Shader::AttributeLocation::Vertex:
+                return type == ElementType::FLOAT3 || type == ElementType::HALF4;
+            case Shader::AttributeLocation::UV:
+            case Shader::AttributeLocation::UV2:
+                return type == ElementType::FLOAT2 || type == ElementType::USHORT2;
+            case Shader::AttributeLocation::Normal:
+            case Shader::AttributeLocation::Tangent:
+                return type == ElementType::SHORT4;
+            case Shader::AttributeLocation::Color:
+            case Shader::AttributeLocation::BoneWeights:
+            case Shader::AttributeLocation::BoneIndices:
+                return type == ElementType::UBYTE4;
+            default:
+                return false;
+        }
+    }
+
+    // the file is not trusted, every size, range and index is checked before anything reads through it
+    static bool IsBinaryMeshValid(const byte* bytes, int file_size)
+    {
+        const BinaryMeshHeader* header = (const BinaryMeshHeader*) bytes;
+
+        if (file_size < (int) sizeof(BinaryMeshHeader) ||
+            Memory::Compare(header->magic, BINARY_MESH_MAGIC, sizeof(header->magic)) != 0 ||
+            header->version != BINARY_MESH_VERSION ||
+            header->header_size != sizeof(BinaryMeshHeader) ||
+            (header->enabled_attributes & ~(uint32_t) Mesh::VertexAttributeMask::All) != 0 ||
+            (header->zero_attributes & ~header->enabled_attributes) != 0 ||
+            header->stream_count > (uint32_t) Shader::AttributeLocation::Count ||
+            !IsBinarySectionValid(header->indices, file_size) ||
+            !IsBinarySectionValid(header->submeshes, file_size) ||
+            !IsBinarySectionValid(header->bindposes, file_size) ||
+            !IsBinarySectionValid(header->extra, file_size))
+        {
+            return false;
+        }
+
+        for (int i = 0; i < (int) Shader::AttributeLocation::Count; ++i)
+        {
+            if (header->enabled_attributes & (1 << i))
+            {
+                const auto& stream = header->streams[i];
+                auto type = (filament::backend::ElementType) stream.type;
+                if (!IsBinaryStreamTypeValid((Shader::AttributeLocation) i, type, (header->zero_attributes & (1 << i)) != 0) ||
+                    stream.stride != filament::backend::Driver::getElementTypeSize(type) ||
+                    !IsBinarySectionValid(stream.data, file_size) ||
+                    (uint64_t) stream.data.size != (uint64_t) stream.stride * header->vertex_count ||
+                    stream.buffer >= header->stream_count)
+                {
+                    return false;
+                }
+            }
+        }
+
+        bool uint32_index = (header->flags & BINARY_MESH_FLAG_UINT32_INDEX) != 0;
+        uint64_t index_size = uint32_index ? sizeof(unsigned int) : sizeof(unsigned short);
+        if ((uint64_t) header->indices.size != index_size * header->index_count ||
+            header->submeshes.size % sizeof(Mesh::Submesh) != 0 ||
+            header->bindposes.size % sizeof(Matrix4x4) != 0)
+        {
+            return false;
+        }
+
+        for (uint32_t i = 0; i < header->index_count; ++i)
+        {
+            uint32_t index;
+            if (uint32_index)
+            {
+                Memory::Copy(&index, &bytes[header->indices.offset + i * 4], sizeof(index));
+            }
+            else
+            {
+                unsigned short index16;
+                Memory::Copy(&index16, &bytes[header->indices.offset + i * 2], sizeof(index16));
+                index = index16;
+            }
+            if (index >= header->vertex_count)
+            {
+                return false;
+            }
+        }
+
+        for (uint32_t i = 0; i < header->submeshes.size / sizeof(Mesh::Submesh); ++i)
+        {
+            Mesh::Submesh submesh;
+            Memory::Copy(&submesh, &bytes[header->submeshes.offset + i * sizeof(Mesh::Submesh)], sizeof(submesh));
+            if (!IsSubmeshValid(submesh, header->index_count))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    static void ReadBinaryCpuData(const byte* bytes, const BinaryMeshHeader* header, const filament::backend::AttributeArray& attributes, Vector<Mesh::Vertex>& vertices, Vector<unsigned int>& indices)
+    {
+        vertices.Resize(header->vertex_count);
+        for (int i = 0; i < (int) Shader::AttributeLocation::Count; ++i)
+        {
+            if ((header->enabled_attributes & ~header->zero_attributes) & (1 << i))
+            {
+                UnpackVertexAttribute(&bytes[header->streams[i].data.offset], (Shader::AttributeLocation) i, attributes[i], vertices);
+            }
+        }
+
+        bool uint32_index = (header->flags & BINARY_MESH_FLAG_UINT32_INDEX) != 0;
+        indices.Resize(header->index_count);
+        for (int i = 0; i < indices.Size(); ++i)
+        {
+            if (uint32_index)
+            {
+                indices[i] = ((const unsigned int*) &bytes[header->indices.offset])[i];
+            }
+            else
+            {
+                indices[i] = ((const unsigned short*) &bytes[header->indices.offset])[i];
+            }
+        }
+    }
+
+    static Vector<byte> WriteBinaryExtra(const Mesh::FileData& data)
+    {
+        Vector<byte> buffer;
+
+        WriteBinaryString(buffer, data.name);
+        WriteBinary(buffer, data.blend_shapes.Size());
+
+        for (int i = 0; i < data.blend_shapes.Size(); ++i)
+        {
+            const auto& shape = data.blend_shapes[i];
+
+            WriteBinaryString(buffer, shape.name);
+            WriteBinary(buffer, shape.frames.Size());
+
+            for (int j = 0; j < shape.frames.Size(); ++j)
+            {
+                const auto& frame = shape.frames[j];
+
+                WriteBinary(buffer, frame.weight);
+                WriteBinaryVector(buffer, frame.vertices);
+                WriteBinaryVector(buffer, frame.normals);
+                WriteBinaryVector(buffer, frame.tangents);
+            }
+        }
+
+        WriteBinary(buffer, data.lods.Size());
+        for (int i = 0; i < data.lods.Size(); ++i)
+        {
+            WriteBinary(buffer, data.lods[i].screen_size);
+            WriteBinaryVector(buffer, data.lods[i].submeshes);
+        }
+
+        return buffer;
+    }
+
+    // bounds checked reads of the extra section, counts are checked against the bytes left before anything is allocated
+    class BinaryExtraReader
+    {
+    public:
+        BinaryExtraReader(const byte* bytes, int size): m_bytes(bytes), m_size(size), m_offset(0) { }
+
+        bool Read(void* dst, int size)
+        {
+            if (size < 0 || size > m_size - m_offset)
+            {
+                return false;
+            }
+            Memory::Copy(dst, &m_bytes[m_offset], size);
+            m_offset += size;
+            return true;
+        }
+
+        template<class T>
+        bool Read(T& t)
+        {
+            return this->Read(&t, sizeof(T));
+        }
+
+        bool ReadCount(int& count, int element_size)
+        {
+            return this->Read(count) && count >= 0 && count <= (m_size - m_offset) / element_size;
+        }
+
+        bool ReadString(String& str)
+        {
+            int size;
+            if (!this->ReadCount(size, 1))
+            {
+                return false;
+            }
+            str = String((const char*) &m_bytes[m_offset], size);
+            m_offset += size;
+            return true;
+        }
+
+        template<class V>
+        bool ReadVector(Vector<V>& vec)
+        {
+            int count;
+            if (!this->ReadCount(count, sizeof(V)))
+            {
+                return false;
+            }
+            vec.Resize(count);
+            return count == 0 || this->Read(vec.Bytes(), vec.SizeInBytes());
+        }
+
+    private:
+        const byte* m_bytes;
+        int m_size;
+        int m_offset;
+    };
+
+    static bool ReadBinaryExtra(const byte* bytes, int size, const BinaryMeshHeader* header, String& name, Vector<Mesh::BlendShape>& blend_shapes, Vector<Mesh::Lod>& lods)
+    {
+        BinaryExtraReader reader(bytes, size);
+
+        int blend_shape_count;
+        if (!reader.ReadString(name) || !reader.ReadCount(blend_shape_count, sizeof(int) * 2))
+        {
+            return false;
+        }
+        blend_shapes.Resize(blend_shape_count);
+
+        // frames are applied per vertex, so each must cover the whole vertex buffer, normal and tangent deltas may be missing
+        for (int i = 0; i < blend_shape_count; ++i)
+        {
+            auto& shape = blend_shapes[i];
+
+            int frame_count;
+            if (!reader.ReadString(shape.name) || !reader.ReadCount(frame_count, sizeof(float) + sizeof(int) * 3))
+            {
+                return false;
+            }
+            shape.frames.Resize(frame_count);
+
+            for (int j = 0; j < frame_count; ++j)
+            {
+                auto& frame = shape.frames[j];
+
+                if (!reader.Read(frame.weight) ||
+                    !reader.ReadVector(frame.vertices) ||
+                    !reader.ReadVector(frame.normals) ||
+                    !reader.ReadVector(frame.tangents) ||
+                    frame.vertices.Size() != (int) header->vertex_count ||
+                    (frame.normals.Size() != (int) header->vertex_count && frame.normals.Size() != 0) ||
+                    (frame.tangents.Size() != (int) header->vertex_count && frame.tangents.Size() != 0))
+                {
+                    return false;
+                }
+            }
+        }
+
+        int lod_count;
+        if (!reader.ReadCount(lod_count, sizeof(float) + sizeof(int)))
+        {
+            return false;
+        }
+        lods.Resize(lod_count);
+        for (int i = 0; i < lod_count; ++i)
+        {
+            if (!reader.Read(lods[i].screen_size) || !reader.ReadVector(lods[i].submeshes))
+            {
+                return false;
+            }
+            for (int j = 0; j < lods[i].submeshes.Size(); ++j)
+            {
+                if (!IsSubmeshValid(lods[i].submeshes[j], header->index_count))
+                {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    static void ReleaseMappedFile(void*, size_t, void* user)
+    {
+        delete (Ref<MappedFile>*) user;
+    }
+
 	Ref<Mesh> Mesh::m_shared_quad_mesh;
 
 	void Mesh::Init()
@@ -63,159 +1107,308 @@ namespace Viry3D
     {
         Ref<Mesh> mesh;
 
-        if (File::Exist(path))
+        FileData data;
+        if (ReadFile(path, data))
         {
-            MemoryStream ms(File::ReadAllBytes(path));
+            mesh = Ref<Mesh>(new Mesh(std::move(data.vertices), std::move(data.indices), data.submeshes, false, false, data.vertex_attributes, data.blend_shapes.Size() > 0));
+            mesh->SetName(data.name);
+            mesh->SetBindposes(std::move(data.bindposes));
+            mesh->SetBlendShapes(std::move(data.blend_shapes));
+            mesh->SetLods(std::move(data.lods));
+        }
 
-            int name_size = ms.Read<int>();
-            String mesh_name = ms.ReadString(name_size);
+        return mesh;
+    }
 
-            Vector<Vertex>* vertices = new Vector<Vertex>();
-            Vector<unsigned int>* indices = new Vector<unsigned int>();
-            Vector<Submesh>* submeshes = new Vector<Submesh>();
-            Vector<Matrix4x4>* bindposes = new Vector<Matrix4x4>();
-            Vector<BlendShape>* blend_shapes = new Vector<BlendShape>();
-            
-            int vertex_count = ms.Read<int>();
-            vertices->Resize(vertex_count);
+    bool Mesh::ConvertToBinaryFile(const String& mesh_path, const String& binary_path)
+    {
+        FileData data;
+        if (!ReadFile(mesh_path, data))
+        {
+            return false;
+        }
 
-            for (int i = 0; i < vertex_count; ++i)
-            {
-                (*vertices)[i].vertex = ms.Read<Vector3>();
-            }
+        if (data.submeshes.Empty())
+        {
+            data.submeshes.Add(Submesh({ 0, data.indices.Size() }));
+        }
 
-            int color_count = ms.Read<int>();
-            for (int i = 0; i < color_count; ++i)
-            {
-                float r = ms.Read<byte>() / 255.0f;
-                float g = ms.Read<byte>() / 255.0f;
-                float b = ms.Read<byte>() / 255.0f;
-                float a = ms.Read<byte>() / 255.0f;
-                (*vertices)[i].color = Color(r, g, b, a);
-            }
+        uint32_t enabled_attributes = (uint32_t) (data.vertex_attributes | (int) VertexAttributeMask::Vertex) & (uint32_t) VertexAttributeMask::All;
+        filament::backend::AttributeArray attributes;
+        uint32_t zero_attributes;
+        int stream_count = SetupVertexAttributes(data.vertices, false, data.blend_shapes.Size() > 0, enabled_attributes, attributes, zero_attributes);
+        bool uint32_index = data.vertices.Size() > 65536;
+        int index_size = uint32_index ? sizeof(unsigned int) : sizeof(unsigned short);
+        Vector<byte> extra = WriteBinaryExtra(data);
 
-            int uv_count = ms.Read<int>();
-            for (int i = 0; i < uv_count; ++i)
-            {
-                (*vertices)[i].uv = ms.Read<Vector2>();
-            }
+        BinaryMeshHeader header;
+        Memory::Zero(&header, sizeof(header));
+        Memory::Copy(header.magic, BINARY_MESH_MAGIC, sizeof(header.magic));
+        header.version = BINARY_MESH_VERSION;
+        header.header_size = sizeof(BinaryMeshHeader);
+        header.flags = uint32_index ? BINARY_MESH_FLAG_UINT32_INDEX : 0;
+        header.vertex_count = data.vertices.Size();
+        header.index_count = data.indices.Size();
+        header.enabled_attributes = enabled_attributes;
+        header.zero_attributes = zero_attributes;
+        header.stream_count = stream_count;
 
-            int uv2_count = ms.Read<int>();
-            for (int i = 0; i < uv2_count; ++i)
-            {
-                (*vertices)[i].uv2 = ms.Read<Vector2>();
-            }
+        Bounds bounds = CalculateBounds(data.vertices);
+        Memory::Copy(header.bounds_min, &bounds.Min(), sizeof(header.bounds_min));
+        Memory::Copy(header.bounds_max, &bounds.Max(), sizeof(header.bounds_max));
+        header.uv_density = CalculateUVDensity(data.vertices, data.indices);
 
-            int normal_count = ms.Read<int>();
-            for (int i = 0; i < normal_count; ++i)
+        uint32_t offset = AlignBinarySection(sizeof(BinaryMeshHeader));
+        const BinaryMeshStream* zero_stream = nullptr;
+        for (int i = 0; i < (int) Shader::AttributeLocation::Count; ++i)
+        {
+            if (enabled_attributes & (1 << i))
             {
-                (*vertices)[i].normal = ms.Read<Vector3>();
+                auto& stream = header.streams[i];
+                stream.type = (uint8_t) attributes[i].type;
+                stream.flags = attributes[i].flags;
+                stream.stride = attributes[i].stride;
+                stream.buffer = attributes[i].buffer;
+
+                // zero attributes point at the same bytes
+                if ((zero_attributes & (1 << i)) && zero_stream)
+                {
+                    stream.data = zero_stream->data;
+                    continue;
+                }
+                if (zero_attributes & (1 << i))
+                {
+                    zero_stream = &stream;
+                }
+
+                stream.data.offset = offset;
+                stream.data.size = attributes[i].stride * data.vertices.Size();
+                offset = AlignBinarySection(offset + stream.data.size);
             }
+        }
 
-            int tangent_count = ms.Read<int>();
-            for (int i = 0; i < tangent_count; ++i)
+        header.indices = { offset, (uint32_t) (index_size * data.indices.Size()) };
+        offset = AlignBinarySection(offset + header.indices.size);
+        header.submeshes = { offset, (uint32_t) data.submeshes.SizeInBytes() };
+        offset = AlignBinarySection(offset + header.submeshes.size);
+        header.bindposes = { offset, (uint32_t) data.bindposes.SizeInBytes() };
+        offset = AlignBinarySection(offset + header.bindposes.size);
+        header.extra = { offset, (uint32_t) extra.Size() };
+        offset = AlignBinarySection(offset + header.extra.size);
+
+        ByteBuffer buffer(offset);
+        Memory::Zero(buffer.Bytes(), buffer.Size());
+        Memory::Copy(buffer.Bytes(), &header, sizeof(header));
+
+        // the buffer is zeroed, which already fills the zero stream
+        for (int i = 0; i < (int) Shader::AttributeLocation::Count; ++i)
+        {
+            if ((enabled_attributes & ~zero_attributes) & (1 << i))
             {
-                (*vertices)[i].tangent = ms.Read<Vector4>();
+                PackVertexAttribute(data.vertices, (Shader::AttributeLocation) i, attributes[i], &buffer[header.streams[i].data.offset]);
             }
+        }
 
-            int bone_weight_count = ms.Read<int>();
-            for (int i = 0; i < bone_weight_count; ++i)
+        for (int i = 0; i < data.indices.Size(); ++i)
+        {
+            byte* p = &buffer[header.indices.offset + i * index_size];
+            if (uint32_index)
             {
-                (*vertices)[i].bone_weights = ms.Read<Vector4>();
-                float index0 = (float) ms.Read<byte>();
-                float index1 = (float) ms.Read<byte>();
-                float index2 = (float) ms.Read<byte>();
-                float index3 = (float) ms.Read<byte>();
-                (*vertices)[i].bone_indices = Vector4(index0, index1, index2, index3);
+                *(unsigned int*) p = data.indices[i];
             }
-
-            int index_count = ms.Read<int>();
-            indices->Resize(index_count);
-            for (int i = 0; i < index_count; ++i)
+            else
             {
-                (*indices)[i] = ms.Read<unsigned short>();
+                *(unsigned short*) p = (unsigned short) data.indices[i];
             }
+        }
+
+        Memory::Copy(&buffer[header.submeshes.offset], data.submeshes.Bytes(), header.submeshes.size);
+        if (header.bindposes.size > 0)
+        {
+            Memory::Copy(&buffer[header.bindposes.offset], data.bindposes.Bytes(), header.bindposes.size);
+        }
+        Memory::Copy(&buffer[header.extra.offset], extra.Bytes(), header.extra.size);
+
+        return File::WriteAllBytes(binary_path, buffer);
+    }
+
+    Ref<Mesh> Mesh::LoadFromBinaryFile(const String& path, bool keep_cpu_data)
+    {
+        Ref<Mesh> mesh;
 
-            int submesh_count = ms.Read<int>();
-            submeshes->Resize(submesh_count);
-            ms.Read(&(*submeshes)[0], submeshes->SizeInBytes());
+        Ref<MappedFile> file = MappedFile::Open(path);
+        if (!file)
+        {
+            return mesh;
+        }
+
+        const byte* bytes = file->GetBytes();
+        const BinaryMeshHeader* header = (const BinaryMeshHeader*) bytes;
+
+        if (!IsBinaryMeshValid(bytes, file->GetSize()))
+        {
+            Log("invalid binary mesh file: %s", path.CString());
+            return mesh;
+        }
+
+        mesh = Ref<Mesh>(new Mesh());
+        mesh->m_buffer_vertex_count = header->vertex_count;
+        mesh->m_buffer_index_count = header->index_count;
+        mesh->m_uint32_index = (header->flags & BINARY_MESH_FLAG_UINT32_INDEX) != 0;
+        mesh->m_enabled_attributes = header->enabled_attributes;
+        mesh->m_zero_attributes = header->zero_attributes;
+        mesh->m_vertex_stream_count = header->stream_count;
+        mesh->m_bounds = Bounds(
+            Vector3(header->bounds_min[0], header->bounds_min[1], header->bounds_min[2]),
+            Vector3(header->bounds_max[0], header->bounds_max[1], header->bounds_max[2]));
+        mesh->m_uv_density = header->uv_density;
+
+        for (int i = 0; i < (int) Shader::AttributeLocation::Count; ++i)
+        {
+            auto& attribute = mesh->m_attributes[i];
+            attribute = filament::backend::Attribute();
 
-            int bindpose_count = ms.Read<int>();
-            if (bindpose_count > 0)
+            if (header->enabled_attributes & (1 << i))
             {
-                bindposes->Resize(bindpose_count);
-                ms.Read(&(*bindposes)[0], bindposes->SizeInBytes());
+                const auto& stream = header->streams[i];
+                attribute.offset = 0;
+                attribute.stride = stream.stride;
+                attribute.buffer = stream.buffer;
+                attribute.type = (filament::backend::ElementType) stream.type;
+                attribute.flags = stream.flags;
             }
-            
-            int blend_shape_count = ms.Read<int>();
-            if (blend_shape_count > 0)
+        }
+
+        mesh->m_submeshes.Resize(header->submeshes.size / sizeof(Submesh));
+        if (mesh->m_submeshes.Empty())
+        {
+            mesh->m_submeshes.Add(Submesh({ 0, (int) header->index_count }));
+        }
+        else
+        {
+            Memory::Copy(mesh->m_submeshes.Bytes(), &bytes[header->submeshes.offset], mesh->m_submeshes.SizeInBytes());
+        }
+        if (header->bindposes.size > 0)
+        {
+            mesh->m_bindposes.Resize(header->bindposes.size / sizeof(Matrix4x4));
+            Memory::Copy(mesh->m_bindposes.Bytes(), &bytes[header->bindposes.offset], mesh->m_bindposes.SizeInBytes());
+        }
+
+        String name;
+        if (!ReadBinaryExtra(&bytes[header->extra.offset], header->extra.size, header, name, mesh->m_blend_shapes, mesh->m_lods))
+        {
+            Log("invalid binary mesh file: %s", path.CString());
+            mesh.reset();
+            return mesh;
+        }
+        mesh->SetName(name);
+
+        auto& driver = Engine::Instance()->GetDriverApi();
+        filament::backend::ElementType index_type = mesh->m_uint32_index ? filament::backend::ElementType::UINT : filament::backend::ElementType::USHORT;
+
+        mesh->m_vb = driver.createVertexBuffer((uint8_t) mesh->m_vertex_stream_count, (uint8_t) Shader::AttributeLocation::Count, header->vertex_count, mesh->m_attributes, filament::backend::BufferUsage::STATIC);
+        mesh->m_ib = driver.createIndexBuffer(index_type, header->index_count, filament::backend::BufferUsage::STATIC);
+
+        // the driver reads straight from the mapping, each descriptor holds the file open until it is consumed.
+        // streams shared by several attributes upload once
+        uint32_t uploaded_streams = 0;
+        for (int i = 0; i < (int) Shader::AttributeLocation::Count; ++i)
+        {
+            const auto& stream = header->streams[i];
+            if ((header->enabled_attributes & (1 << i)) && stream.data.size > 0 && (uploaded_streams & (1 << stream.buffer)) == 0)
             {
-                blend_shapes->Resize(blend_shape_count);
-                
-                for (int i = 0; i < blend_shape_count; ++i)
-                {
-                    auto& shape = (*blend_shapes)[i];
-                    
-                    int string_size = ms.Read<int>();
-                    String shape_name = ms.ReadString(string_size);
-                    int frame_count = ms.Read<int>();
-                    
-                    shape.name = shape_name;
-                    shape.frames.Resize(frame_count);
-                    
-                    for (int j = 0; j < frame_count; ++j)
-                    {
-                        auto& frame = shape.frames[j];
-                        
-                        float frame_weight = ms.Read<float>();
-                        
-                        frame.weight = frame_weight / 100.0f;
-                        frame.vertices.Resize(vertex_count);
-                        frame.normals.Resize(normal_count);
-                        frame.tangents.Resize(tangent_count);
-                        
-                        if (vertex_count > 0)
-                        {
-                            ms.Read(&frame.vertices[0], frame.vertices.SizeInBytes());
-                        }
-                        
-                        if (normal_count > 0)
-                        {
-                            ms.Read(&frame.normals[0], frame.normals.SizeInBytes());
-                        }
-                        
-                        if (tangent_count > 0)
-                        {
-                            ms.Read(&frame.tangents[0], frame.tangents.SizeInBytes());
-                        }
-                    }
-                }
+                uploaded_streams |= 1 << stream.buffer;
+                driver.updateVertexBuffer(mesh->m_vb, stream.buffer, filament::backend::BufferDescriptor(&bytes[stream.data.offset], stream.data.size, ReleaseMappedFile, new Ref<MappedFile>(file)), 0);
             }
-            
-            mesh = RefMake<Mesh>(std::move(*vertices), std::move(*indices), *submeshes);
-            mesh->SetName(mesh_name);
-            mesh->SetBindposes(std::move(*bindposes));
-            mesh->SetBlendShapes(std::move(*blend_shapes));
-            
-            delete vertices;
-            delete indices;
-            delete submeshes;
-            delete bindposes;
-            delete blend_shapes;
+        }
+
+        if (header->indices.size > 0)
+        {
+            driver.updateIndexBuffer(mesh->m_ib, filament::backend::BufferDescriptor(&bytes[header->indices.offset], header->indices.size, ReleaseMappedFile, new Ref<MappedFile>(file)), 0);
+        }
+
+        // blend shapes are applied on the cpu, so they always need the vertices
+        if (keep_cpu_data || mesh->m_blend_shapes.Size() > 0)
+        {
+            ReadBinaryCpuData(bytes, header, mesh->m_attributes, mesh->m_vertices, mesh->m_indices);
         }
         else
         {
-            Log("mesh file not exist: %s", path.CString());
+            mesh->m_binary_path = path;
         }
 
+        mesh->CreatePrimitives(header->vertex_count);
+
         return mesh;
     }
 
-    Mesh::Mesh(Vector<Vertex>&& vertices, Vector<unsigned int>&& indices, const Vector<Submesh>& submeshes, bool uint32_index, bool dynamic):
+    bool Mesh::LoadCpuData() const
+    {
+        if (m_vertices.Size() > 0)
+        {
+            return true;
+        }
+        if (m_binary_path.Empty())
+        {
+            return false;
+        }
+
+        // a failed read is not retried
+        String path = m_binary_path;
+        m_binary_path = String();
+
+        Ref<MappedFile> file = MappedFile::Open(path);
+        if (!file)
+        {
+            return false;
+        }
+
+        const byte* bytes = file->GetBytes();
+        const BinaryMeshHeader* header = (const BinaryMeshHeader*) bytes;
+
+        // the buffers were filled from this file, it must still match them
+        bool valid = IsBinaryMeshValid(bytes, file->GetSize()) &&
+            (int) header->vertex_count == m_buffer_vertex_count &&
+            (int) header->index_count == m_buffer_index_count &&
+            header->enabled_attributes == m_enabled_attributes &&
+            header->zero_attributes == m_zero_attributes;
+        if (!valid)
+        {
+            Log("binary mesh file changed since it was loaded: %s", path.CString());
+            return false;
+        }
+
+        ReadBinaryCpuData(bytes, header, m_attributes, m_vertices, m_indices);
+
+        return true;
+    }
+
+    Mesh::Mesh():
+        m_buffer_vertex_count(0),
+        m_buffer_index_count(0),
+        m_uint32_index(false),
+        m_enabled_attributes(0),
+        m_zero_attributes(0),
+        m_vertex_stream_count(0),
+        m_uv_density(0)
+    {
+    
+    }
+
+    Mesh::Mesh(Vector<Vertex>&& vertices, Vector<unsigned int>&& indices, const Vector<Submesh>& submeshes, bool uint32_index, bool dynamic, int vertex_attributes):
+        Mesh(std::move(vertices), std::move(indices), submeshes, uint32_index, dynamic, vertex_attributes, false)
+    {
+    
+    }
+
+    Mesh::Mesh(Vector<Vertex>&& vertices, Vector<unsigned int>&& indices, const Vector<Submesh>& submeshes, bool uint32_index, bool dynamic, int vertex_attributes, bool blend_shapes):
         m_buffer_vertex_count(vertices.Size()),
         m_buffer_index_count(indices.Size()),
-        m_uint32_index(uint32_index),
-		m_enabled_attributes(0)
+        m_uint32_index(uint32_index && vertices.Size() > 65536),
+		m_enabled_attributes((uint32_t) (vertex_attributes | (int) Mesh::VertexAttributeMask::Vertex) & (uint32_t) VertexAttributeMask::All),
+        m_zero_attributes(0),
+        m_vertex_stream_count(0),
+        m_uv_density(0)
     {
         auto& driver = Engine::Instance()->GetDriverApi();
         
@@ -235,37 +1428,12 @@ namespace Viry3D
             usage = filament::backend::BufferUsage::STATIC;
         }
         
-        int sizes[] = {
-            sizeof(Vertex::vertex), sizeof(Vertex::color), sizeof(Vertex::uv), sizeof(Vertex::uv2),
-            sizeof(Vertex::normal), sizeof(Vertex::tangent), sizeof(Vertex::bone_weights), sizeof(Vertex::bone_indices)
-        };
-        filament::backend::ElementType types[] = {
-            filament::backend::ElementType::FLOAT3,
-            filament::backend::ElementType::FLOAT4,
-            filament::backend::ElementType::FLOAT2,
-            filament::backend::ElementType::FLOAT2,
-            filament::backend::ElementType::FLOAT3,
-            filament::backend::ElementType::FLOAT4,
-            filament::backend::ElementType::FLOAT4,
-            filament::backend::ElementType::FLOAT4
-        };
-        int offset = 0;
-        
-        for (int i = 0; i < (int) Shader::AttributeLocation::Count; ++i)
-        {
-			m_attributes[i].offset = offset;
-			m_attributes[i].stride = sizeof(Vertex);
-			m_attributes[i].buffer = 0;
-			m_attributes[i].type = types[i];
-			m_attributes[i].flags = 0;
-            
-            offset += sizes[i];
-        }
+        m_vertex_stream_count = SetupVertexAttributes(vertices, dynamic, blend_shapes, m_enabled_attributes, m_attributes, m_zero_attributes);
         
-        m_vb = driver.createVertexBuffer(1, (uint8_t) Shader::AttributeLocation::Count, vertices.Size(), m_attributes, usage);
+        m_vb = driver.createVertexBuffer((uint8_t) m_vertex_stream_count, (uint8_t) Shader::AttributeLocation::Count, vertices.Size(), m_attributes, usage);
 
         filament::backend::ElementType index_type;
-        if (uint32_index)
+        if (m_uint32_index)
         {
             index_type = filament::backend::ElementType::UINT;
         }
@@ -279,6 +1447,61 @@ namespace Viry3D
         Mesh::Update(std::move(vertices), std::move(indices), submeshes);
     }
     
+    int Mesh::GetVertexStride() const
+    {
+        int stride = 0;
+        uint32_t streams = 0;
+        for (int i = 0; i < (int) Shader::AttributeLocation::Count; ++i)
+        {
+            if ((m_enabled_attributes & (1 << i)) && (streams & (1 << m_attributes[i].buffer)) == 0)
+            {
+                streams |= 1 << m_attributes[i].buffer;
+                stride += m_attributes[i].stride;
+            }
+        }
+        return stride;
+    }
+
+    void Mesh::UpdateVertexStreams(const filament::backend::VertexBufferHandle& vb, const Vector<Vertex>& vertices) const
+    {
+        auto& driver = Engine::Instance()->GetDriverApi();
+
+        if (vertices.Empty())
+        {
+            return;
+        }
+
+        bool zero_uploaded = false;
+        for (int i = 0; i < (int) Shader::AttributeLocation::Count; ++i)
+        {
+            if ((m_enabled_attributes & (1 << i)) == 0)
+            {
+                continue;
+            }
+
+            const auto& attribute = m_attributes[i];
+            int size = attribute.stride * vertices.Size();
+            unsigned char* buffer;
+            if (m_zero_attributes & (1 << i))
+            {
+                if (zero_uploaded)
+                {
+                    continue;
+                }
+                zero_uploaded = true;
+
+                buffer = Memory::Alloc<unsigned char>(size);
+                Memory::Zero(buffer, size);
+            }
+            else
+            {
+                buffer = Memory::Alloc<unsigned char>(size);
+                PackVertexAttribute(vertices, (Shader::AttributeLocation) i, attribute, buffer);
+            }
+            driver.updateVertexBuffer(vb, attribute.buffer, filament::backend::BufferDescriptor(buffer, size, FreeBufferCallback), 0);
+        }
+    }
+
     Mesh::~Mesh()
     {
         auto& driver = Engine::Instance()->GetDriverApi();
@@ -289,12 +1512,7 @@ namespace Viry3D
 		driver.destroyIndexBuffer(m_ib);
 		m_ib.clear();
 
-		for (int i = 0; i < m_primitives.Size(); ++i)
-		{
-			driver.destroyRenderPrimitive(m_primitives[i]);
-			m_primitives[i].clear();
-		}
-		m_primitives.Clear();
+		this->DestroyPrimitives();
     }
 
     void Mesh::Update(Vector<Vertex>&& vertices, Vector<unsigned int>&& indices, const Vector<Submesh>& submeshes)
@@ -303,6 +1521,7 @@ namespace Viry3D
      
         m_vertices = std::move(vertices);
         m_indices = std::move(indices);
+        m_binary_path = String();
         
         assert(m_vertices.Size() <= m_buffer_vertex_count);
         assert(m_indices.Size() <= m_buffer_index_count);
@@ -312,14 +1531,17 @@ namespace Viry3D
         {
             m_submeshes.Add(Submesh({ 0, m_indices.Size() }));
         }
+
+        // new geometry invalidates the lod index ranges
+        m_lods.Clear();
+        m_bounds = CalculateBounds(m_vertices);
+        m_uv_density = CalculateUVDensity(m_vertices, m_indices);
         
-        void* buffer = Memory::Alloc<void>(m_vertices.SizeInBytes());
-        Memory::Copy(buffer, m_vertices.Bytes(), m_vertices.SizeInBytes());
-        driver.updateVertexBuffer(m_vb, 0, filament::backend::BufferDescriptor(buffer, m_vertices.SizeInBytes(), FreeBufferCallback), 0);
+        this->UpdateVertexStreams(m_vb, m_vertices);
     
         if (m_uint32_index)
         {
-            buffer = Memory::Alloc<void>(m_indices.SizeInBytes());
+            void* buffer = Memory::Alloc<void>(m_indices.SizeInBytes());
             Memory::Copy(buffer, m_indices.Bytes(), m_indices.SizeInBytes());
             driver.updateIndexBuffer(m_ib, filament::backend::BufferDescriptor(buffer, m_indices.SizeInBytes(), FreeBufferCallback), 0);
         }
@@ -334,30 +1556,145 @@ namespace Viry3D
             driver.updateIndexBuffer(m_ib, filament::backend::BufferDescriptor(indices_uint16, size, FreeBufferCallback), 0);
         }
         
-		m_enabled_attributes =
-            (1 << (int) Shader::AttributeLocation::Vertex) |
-            (1 << (int) Shader::AttributeLocation::Color) |
-            (1 << (int) Shader::AttributeLocation::UV) |
-            (1 << (int) Shader::AttributeLocation::UV2) |
-            (1 << (int) Shader::AttributeLocation::Normal) |
-            (1 << (int) Shader::AttributeLocation::Tangent) |
-            (1 << (int) Shader::AttributeLocation::BoneWeights) |
-            (1 << (int) Shader::AttributeLocation::BoneIndices);
-        
-        for (int i = 0; i < m_primitives.Size(); ++i)
+        this->CreatePrimitives(m_vertices.Size());
+    }
+
+    void Mesh::UpdateVertices(int first, const Vertex* vertices, int count, int vertex_attributes)
+    {
+        auto& driver = Engine::Instance()->GetDriverApi();
+
+        assert(first >= 0 && first + count <= m_vertices.Size());
+
+        if (count <= 0)
         {
-            driver.destroyRenderPrimitive(m_primitives[i]);
-			m_primitives[i].clear();
+            return;
         }
-        m_primitives.Clear();
-        
-        m_primitives.Resize(m_submeshes.Size());
-        for (int i = 0; i < m_primitives.Size(); ++i)
+
+        Memory::Copy(&m_vertices[first], vertices, sizeof(Vertex) * count);
+
+        for (int i = 0; i < (int) Shader::AttributeLocation::Count; ++i)
         {
-            m_primitives[i] = driver.createRenderPrimitive();
-            
-            driver.setRenderPrimitiveBuffer(m_primitives[i], m_vb, m_ib, m_enabled_attributes);
-            driver.setRenderPrimitiveRange(m_primitives[i], filament::backend::PrimitiveType::TRIANGLES, m_submeshes[i].index_first, 0, m_vertices.Size() - 1, m_submeshes[i].index_count);
+            if ((m_enabled_attributes & ~m_zero_attributes & vertex_attributes & (1 << i)) == 0)
+            {
+                continue;
+            }
+
+            // streams are not interleaved, so each one gets its own sub range upload
+            const auto& attribute = m_attributes[i];
+            int size = attribute.stride * count;
+            unsigned char* buffer = Memory::Alloc<unsigned char>(size);
+            PackVertexAttribute(vertices, count, (Shader::AttributeLocation) i, attribute, buffer);
+            driver.updateVertexBuffer(m_vb, attribute.buffer, filament::backend::BufferDescriptor(buffer, size, FreeBufferCallback), attribute.stride * first);
+        }
+    }
+
+    void Mesh::UpdateIndices(int first, const unsigned int* indices, int count)
+    {
+        auto& driver = Engine::Instance()->GetDriverApi();
+
+        assert(first >= 0 && first + count <= m_indices.Size());
+
+        if (count <= 0)
+        {
+            return;
+        }
+
+        Memory::Copy(&m_indices[first], indices, sizeof(unsigned int) * count);
+
+        if (m_uint32_index)
+        {
+            int size = sizeof(unsigned int) * count;
+            void* buffer = Memory::Alloc<void>(size);
+            Memory::Copy(buffer, indices, size);
+            driver.updateIndexBuffer(m_ib, filament::backend::BufferDescriptor(buffer, size, FreeBufferCallback), sizeof(unsigned int) * first);
+        }
+        else
+        {
+            int size = sizeof(unsigned short) * count;
+            unsigned short* indices_uint16 = Memory::Alloc<unsigned short>(size);
+            for (int i = 0; i < count; ++i)
+            {
+                indices_uint16[i] = indices[i];
+            }
+            driver.updateIndexBuffer(m_ib, filament::backend::BufferDescriptor(indices_uint16, size, FreeBufferCallback), sizeof(unsigned short) * first);
+        }
+    }
+
+    void Mesh::SetSubmeshes(const Vector<Submesh>& submeshes)
+    {
+        m_submeshes = submeshes;
+        if (m_submeshes.Empty())
+        {
+            m_submeshes.Add(Submesh({ 0, m_indices.Size() }));
+        }
+
+        m_lods.Clear();
+
+        this->CreatePrimitives(m_vertices.Size() > 0 ? m_vertices.Size() : m_buffer_vertex_count);
+    }
+
+    void Mesh::SetLods(Vector<Lod>&& lods)
+    {
+        m_lods = std::move(lods);
+
+        this->CreatePrimitives(m_vertices.Size() > 0 ? m_vertices.Size() : m_buffer_vertex_count);
+    }
+
+    const Vector<filament::backend::RenderPrimitiveHandle>& Mesh::GetLodPrimitives(int lod) const
+    {
+        if (lod <= 0 || m_lod_primitives.Empty())
+        {
+            return m_primitives;
+        }
+
+        return m_lod_primitives[Mathf::Min(lod, m_lod_primitives.Size()) - 1];
+    }
+
+    void Mesh::CreatePrimitives(int vertex_count)
+    {
+        auto& driver = Engine::Instance()->GetDriverApi();
+
+        this->DestroyPrimitives();
+
+        auto create = [&](const Vector<Submesh>& submeshes, Vector<filament::backend::RenderPrimitiveHandle>& primitives) {
+            primitives.Resize(submeshes.Size());
+            for (int i = 0; i < primitives.Size(); ++i)
+            {
+                primitives[i] = driver.createRenderPrimitive();
+
+                driver.setRenderPrimitiveBuffer(primitives[i], m_vb, m_ib, m_enabled_attributes);
+                driver.setRenderPrimitiveRange(primitives[i], filament::backend::PrimitiveType::TRIANGLES, submeshes[i].index_first, 0, vertex_count - 1, submeshes[i].index_count);
+            }
+        };
+
+        create(m_submeshes, m_primitives);
+
+        m_lod_primitives.Resize(m_lods.Size());
+        for (int i = 0; i < m_lods.Size(); ++i)
+        {
+            create(m_lods[i].submeshes, m_lod_primitives[i]);
+        }
+    }
+
+    void Mesh::DestroyPrimitives()
+    {
+        auto& driver = Engine::Instance()->GetDriverApi();
+
+        auto destroy = [&](Vector<filament::backend::RenderPrimitiveHandle>& primitives) {
+            for (int i = 0; i < primitives.Size(); ++i)
+            {
+                driver.destroyRenderPrimitive(primitives[i]);
+                primitives[i].clear();
+            }
+            primitives.Clear();
+        };
+
+        destroy(m_primitives);
+
+        for (int i = 0; i < m_lod_primitives.Size(); ++i)
+        {
+            destroy(m_lod_primitives[i]);
         }
+        m_lod_primitives.Clear();
     }
 }
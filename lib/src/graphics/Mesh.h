@@ -22,6 +22,7 @@
 #include "container/Vector.h"
 #include "math/Vector2.h"
 #include "math/Matrix4x4.h"
+#include "math/Bounds.h"
 #include "private/backend/DriverApi.h"
 
 namespace Viry3D
@@ -41,6 +42,20 @@ namespace Viry3D
             Vector4 bone_indices;
         };
         
+        enum class VertexAttributeMask
+        {
+            Vertex = 1 << 0,
+            Color = 1 << 1,
+            UV = 1 << 2,
+            UV2 = 1 << 3,
+            Normal = 1 << 4,
+            Tangent = 1 << 5,
+            BoneWeights = 1 << 6,
+            BoneIndices = 1 << 7,
+
+            All = 0xff
+        };
+
         struct Submesh
         {
             int index_first;
@@ -61,33 +76,86 @@ namespace Viry3D
             Vector<BlendShapeFrame> frames;
         };
 
+        // a coarser level sharing the vertex buffer, its submeshes index into the same index buffer.
+        // the level is used once the relative screen height drops below screen_size.
+        struct Lod
+        {
+            float screen_size;
+            Vector<Submesh> submeshes;
+        };
+
+        // cpu side content of a mesh file, used by the loaders and the offline tools
+        struct FileData
+        {
+            String name;
+            Vector<Vertex> vertices;
+            Vector<unsigned int> indices;
+            Vector<Submesh> submeshes;
+            Vector<Matrix4x4> bindposes;
+            Vector<BlendShape> blend_shapes;
+            Vector<Lod> lods;
+            int vertex_attributes = 0;
+        };
+
     public:
 		static void Init();
 		static void Done();
 		static const Ref<Mesh>& GetSharedQuadMesh();
         static Ref<Mesh> LoadFromFile(const String& path);
-        Mesh(Vector<Vertex>&& vertices, Vector<unsigned int>&& indices, const Vector<Submesh>& submeshes = Vector<Submesh>(), bool uint32_index = false, bool dynamic = false);
+        // binary meshes are uploaded straight from the mapped file, cpu side vertices are kept on request,
+        // otherwise they are read back from the file on first use
+        static Ref<Mesh> LoadFromBinaryFile(const String& path, bool keep_cpu_data = false);
+        static bool ConvertToBinaryFile(const String& mesh_path, const String& binary_path);
+        static bool ReadFile(const String& path, FileData& data);
+        static bool WriteFile(const String& path, const FileData& data);
+        Mesh(Vector<Vertex>&& vertices, Vector<unsigned int>&& indices, const Vector<Submesh>& submeshes = Vector<Submesh>(), bool uint32_index = false, bool dynamic = false, int vertex_attributes = (int) VertexAttributeMask::All);
         virtual ~Mesh();
         void Update(Vector<Vertex>&& vertices, Vector<unsigned int>&& indices, const Vector<Submesh>& submeshes = Vector<Submesh>());
-        const Vector<Vertex>& GetVertices() const { return m_vertices; }
-        const Vector<unsigned int>& GetIndices() const { return m_indices; }
+        // sub range updates for dynamic meshes, the range must lie inside the last Update data.
+        // bounds and uv density are not recalculated.
+        void UpdateVertices(int first, const Vertex* vertices, int count, int vertex_attributes = (int) VertexAttributeMask::All);
+        void UpdateIndices(int first, const unsigned int* indices, int count);
+        // replaces the submesh ranges without touching the buffers, clears lods
+        void SetSubmeshes(const Vector<Submesh>& submeshes);
+        const Vector<Vertex>& GetVertices() const { this->LoadCpuData(); return m_vertices; }
+        // reads the cpu side vertices and indices back from the binary file when they were not kept, false if there are none
+        bool LoadCpuData() const;
+        int GetVertexCount() const { return m_buffer_vertex_count; }
+        const Vector<unsigned int>& GetIndices() const { this->LoadCpuData(); return m_indices; }
         const Vector<Submesh>& GetSubmeshes() const { return m_submeshes; }
         const Vector<Matrix4x4>& GetBindposes() const { return m_bindposes; }
         const Vector<BlendShape>& GetBlendShapes() const { return m_blend_shapes; }
 		const filament::backend::AttributeArray& GetAttributes() const { return m_attributes; }
 		uint32_t GetEnabledAttributes() const { return m_enabled_attributes; }
+        int GetVertexStreamCount() const { return m_vertex_stream_count; }
+        int GetVertexStride() const;
+        void UpdateVertexStreams(const filament::backend::VertexBufferHandle& vb, const Vector<Vertex>& vertices) const;
 		const filament::backend::VertexBufferHandle& GetVertexBuffer() const { return m_vb; }
 		const filament::backend::IndexBufferHandle& GetIndexBuffer() const { return m_ib; }
 		const Vector<filament::backend::RenderPrimitiveHandle>& GetPrimitives() const { return m_primitives; }
+        const Vector<Lod>& GetLods() const { return m_lods; }
+        int GetLodCount() const { return m_lods.Size() + 1; }
+        const Vector<filament::backend::RenderPrimitiveHandle>& GetLodPrimitives(int lod) const;
+        const Bounds& GetBounds() const { return m_bounds; }
+        // average uv units per mesh space unit of the first uv channel, 0 without uvs
+        float GetUVDensity() const { return m_uv_density; }
 
     private:
+        Mesh();
+        // blend shapes keep full precision positions and a real normal stream
+        Mesh(Vector<Vertex>&& vertices, Vector<unsigned int>&& indices, const Vector<Submesh>& submeshes, bool uint32_index, bool dynamic, int vertex_attributes, bool blend_shapes);
+        void CreatePrimitives(int vertex_count);
+        void DestroyPrimitives();
         void SetBindposes(Vector<Matrix4x4>&& bindposes) { m_bindposes = std::move(bindposes); }
         void SetBlendShapes(Vector<BlendShape>&& blend_shapes) { m_blend_shapes = std::move(blend_shapes); }
+        void SetLods(Vector<Lod>&& lods);
         
     private:
 		static Ref<Mesh> m_shared_quad_mesh;
-        Vector<Vertex> m_vertices;
-        Vector<unsigned int> m_indices;
+        mutable Vector<Vertex> m_vertices;
+        mutable Vector<unsigned int> m_indices;
+        // set while the cpu data of a binary mesh was not kept
+        mutable String m_binary_path;
         int m_buffer_vertex_count;
         int m_buffer_index_count;
         Vector<Submesh> m_submeshes;
@@ -96,8 +164,14 @@ namespace Viry3D
         bool m_uint32_index;
 		filament::backend::AttributeArray m_attributes;
 		uint32_t m_enabled_attributes;
+        uint32_t m_zero_attributes;
+        int m_vertex_stream_count;
         filament::backend::VertexBufferHandle m_vb;
         filament::backend::IndexBufferHandle m_ib;
         Vector<filament::backend::RenderPrimitiveHandle> m_primitives;
+        Vector<Lod> m_lods;
+        Vector<Vector<filament::backend::RenderPrimitiveHandle>> m_lod_primitives;
+        Bounds m_bounds;
+        float m_uv_density;
     };
 }
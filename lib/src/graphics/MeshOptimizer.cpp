@@ -0,0 +1,780 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "MeshOptimizer.h"
+#include "Debug.h"
+#include "math/Mathf.h"
+#include "memory/Memory.h"
+#include <algorithm>
+
+namespace Viry3D
+{
+    static const int VERTEX_CACHE_SIZE = 32;
+    static const int OVERDRAW_CACHE_SIZE = 16;
+    static const float LOD_REDUCTION = 0.5f;
+    static const float LOD_TARGET_ERROR = 0.01f;
+    static const float LOD_SCREEN_SIZE = 0.5f;
+    // a level saving less than this is not worth its index memory
+    static const float LOD_MIN_REDUCTION = 0.9f;
+
+    struct Quadric
+    {
+        double a00, a01, a02, a11, a12, a22;
+        double b0, b1, b2;
+        double c;
+        double w;
+
+        Quadric():
+            a00(0), a01(0), a02(0), a11(0), a12(0), a22(0),
+            b0(0), b1(0), b2(0),
+            c(0),
+            w(0)
+        {
+        }
+
+        Quadric(const Vector3& n, float d, float weight):
+            a00(weight * n.x * n.x), a01(weight * n.x * n.y), a02(weight * n.x * n.z),
+            a11(weight * n.y * n.y), a12(weight * n.y * n.z), a22(weight * n.z * n.z),
+            b0(weight * n.x * d), b1(weight * n.y * d), b2(weight * n.z * d),
+            c(weight * d * d),
+            w(weight)
+        {
+        }
+
+        Quadric& operator +=(const Quadric& q)
+        {
+            a00 += q.a00; a01 += q.a01; a02 += q.a02; a11 += q.a11; a12 += q.a12; a22 += q.a22;
+            b0 += q.b0; b1 += q.b1; b2 += q.b2;
+            c += q.c;
+            w += q.w;
+            return *this;
+        }
+
+        // area weighted mean squared distance to the accumulated planes, comparable to a squared length
+        double EvaluateDistance(const Vector3& p) const
+        {
+            return w > 0 ? this->Evaluate(p) / w : 0;
+        }
+
+        double Evaluate(const Vector3& p) const
+        {
+            double x = p.x, y = p.y, z = p.z;
+            double r = a00 * x * x + a11 * y * y + a22 * z * z +
+                2 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+                2 * (b0 * x + b1 * y + b2 * z) +
+                c;
+            return r > 0 ? r : 0;
+        }
+    };
+
+    struct Collapse
+    {
+        unsigned int from;
+        unsigned int to;
+        double cost;
+    };
+
+    // forsyth, linear-speed vertex cache optimisation
+    static float VertexScore(int cache_position, int live_triangles)
+    {
+        if (live_triangles == 0)
+        {
+            return -1.0f;
+        }
+
+        float score = 0;
+        if (cache_position >= 0)
+        {
+            if (cache_position < 3)
+            {
+                score = 0.75f;
+            }
+            else
+            {
+                score = powf(1.0f - (cache_position - 3) / (float) (VERTEX_CACHE_SIZE - 3), 1.5f);
+            }
+        }
+        score += 2.0f * powf((float) live_triangles, -0.5f);
+
+        return score;
+    }
+
+    // vertex to triangle lists of an index range, offsets has vertex_count + 1 entries
+    static void BuildAdjacency(const unsigned int* indices, int index_count, int vertex_count, Vector<int>& counts, Vector<int>& offsets, Vector<int>& triangles)
+    {
+        counts.Clear();
+        counts.Resize(vertex_count, 0);
+        for (int i = 0; i < index_count; ++i)
+        {
+            counts[indices[i]] += 1;
+        }
+
+        offsets.Resize(vertex_count + 1);
+        offsets[0] = 0;
+        for (int i = 0; i < vertex_count; ++i)
+        {
+            offsets[i + 1] = offsets[i] + counts[i];
+        }
+
+        Vector<int> fill(vertex_count);
+        triangles.Resize(index_count);
+        for (int i = 0; i < vertex_count; ++i)
+        {
+            fill[i] = offsets[i];
+        }
+        for (int i = 0; i < index_count; ++i)
+        {
+            triangles[fill[indices[i]]++] = i / 3;
+        }
+    }
+
+    static Vector3 TriangleNormal(const Vector3& a, const Vector3& b, const Vector3& c)
+    {
+        return (b - a) * (c - a);
+    }
+
+    void MeshOptimizer::OptimizeVertexCache(Vector<unsigned int>& indices, int index_first, int index_count, int vertex_count)
+    {
+        int triangle_count = index_count / 3;
+        if (triangle_count < 2)
+        {
+            return;
+        }
+
+        const unsigned int* src = &indices[index_first];
+
+        Vector<int> live;
+        Vector<int> offsets;
+        Vector<int> adjacency;
+        BuildAdjacency(src, triangle_count * 3, vertex_count, live, offsets, adjacency);
+
+        Vector<int> cache_position(vertex_count, -1);
+        Vector<float> vertex_score(vertex_count);
+        for (int i = 0; i < vertex_count; ++i)
+        {
+            vertex_score[i] = VertexScore(-1, live[i]);
+        }
+
+        Vector<float> triangle_score(triangle_count);
+        for (int i = 0; i < triangle_count; ++i)
+        {
+            triangle_score[i] = vertex_score[src[i * 3 + 0]] + vertex_score[src[i * 3 + 1]] + vertex_score[src[i * 3 + 2]];
+        }
+
+        Vector<char> emitted(triangle_count, 0);
+        Vector<unsigned int> result(triangle_count * 3);
+        int cache[VERTEX_CACHE_SIZE + 3];
+        int cache_count = 0;
+        int cursor = 0;
+        int best = -1;
+
+        for (int out = 0; out < triangle_count; ++out)
+        {
+            if (best < 0)
+            {
+                // nothing in the cache has work left, continue with the next unused triangle
+                while (emitted[cursor])
+                {
+                    ++cursor;
+                }
+                best = cursor;
+            }
+
+            const unsigned int* tri = &src[best * 3];
+            emitted[best] = 1;
+            result[out * 3 + 0] = tri[0];
+            result[out * 3 + 1] = tri[1];
+            result[out * 3 + 2] = tri[2];
+
+            int new_cache[VERTEX_CACHE_SIZE + 3];
+            int new_cache_count = 0;
+
+            for (int k = 0; k < 3; ++k)
+            {
+                int v = tri[k];
+                new_cache[new_cache_count++] = v;
+
+                // remove the triangle from the live list of the vertex
+                int begin = offsets[v];
+                int end = begin + live[v];
+                for (int j = begin; j < end; ++j)
+                {
+                    if (adjacency[j] == best)
+                    {
+                        adjacency[j] = adjacency[end - 1];
+                        live[v] -= 1;
+                        break;
+                    }
+                }
+            }
+
+            for (int i = 0; i < cache_count; ++i)
+            {
+                int v = cache[i];
+                if (v != (int) tri[0] && v != (int) tri[1] && v != (int) tri[2])
+                {
+                    new_cache[new_cache_count++] = v;
+                }
+            }
+
+            for (int i = 0; i < new_cache_count; ++i)
+            {
+                int v = new_cache[i];
+                cache_position[v] = i < VERTEX_CACHE_SIZE ? i : -1;
+
+                float score = VertexScore(cache_position[v], live[v]);
+                float delta = score - vertex_score[v];
+                vertex_score[v] = score;
+
+                for (int j = offsets[v]; j < offsets[v] + live[v]; ++j)
+                {
+                    triangle_score[adjacency[j]] += delta;
+                }
+            }
+
+            cache_count = Mathf::Min(new_cache_count, VERTEX_CACHE_SIZE);
+            Memory::Copy(cache, new_cache, sizeof(int) * cache_count);
+
+            best = -1;
+            float best_score = -1;
+            for (int i = 0; i < cache_count; ++i)
+            {
+                int v = cache[i];
+                for (int j = offsets[v]; j < offsets[v] + live[v]; ++j)
+                {
+                    int t = adjacency[j];
+                    if (triangle_score[t] > best_score)
+                    {
+                        best_score = triangle_score[t];
+                        best = t;
+                    }
+                }
+            }
+        }
+
+        Memory::Copy(&indices[index_first], result.Bytes(), result.SizeInBytes());
+    }
+
+    void MeshOptimizer::OptimizeOverdraw(Vector<unsigned int>& indices, int index_first, int index_count, const Vector<Mesh::Vertex>& vertices)
+    {
+        int triangle_count = index_count / 3;
+        if (triangle_count < 2)
+        {
+            return;
+        }
+
+        const unsigned int* src = &indices[index_first];
+
+        // split where a triangle misses the cache with all three vertices,
+        // reordering whole clusters keeps the cache efficiency of the previous pass
+        Vector<int> cluster_starts;
+        Vector<int> cache_time(vertices.Size(), -OVERDRAW_CACHE_SIZE - 1);
+        int time = 0;
+
+        for (int i = 0; i < triangle_count; ++i)
+        {
+            int misses = 0;
+            for (int k = 0; k < 3; ++k)
+            {
+                int v = src[i * 3 + k];
+                if (time - cache_time[v] > OVERDRAW_CACHE_SIZE)
+                {
+                    cache_time[v] = ++time;
+                    misses += 1;
+                }
+            }
+
+            if (i == 0 || misses == 3)
+            {
+                cluster_starts.Add(i);
+            }
+        }
+        cluster_starts.Add(triangle_count);
+
+        int cluster_count = cluster_starts.Size() - 1;
+        if (cluster_count < 2)
+        {
+            return;
+        }
+
+        Vector3 mesh_center;
+        float mesh_area = 0;
+        Vector<Vector3> cluster_centers(cluster_count);
+        Vector<Vector3> cluster_normals(cluster_count);
+
+        for (int i = 0; i < cluster_count; ++i)
+        {
+            Vector3 center;
+            Vector3 normal;
+            float area = 0;
+
+            for (int t = cluster_starts[i]; t < cluster_starts[i + 1]; ++t)
+            {
+                const Vector3& a = vertices[src[t * 3 + 0]].vertex;
+                const Vector3& b = vertices[src[t * 3 + 1]].vertex;
+                const Vector3& c = vertices[src[t * 3 + 2]].vertex;
+                Vector3 n = TriangleNormal(a, b, c);
+                float w = n.Magnitude();
+
+                center += (a + b + c) * (w / 3.0f);
+                normal += n;
+                area += w;
+            }
+
+            mesh_center += center;
+            mesh_area += area;
+            cluster_centers[i] = area > 0 ? center / area : vertices[src[cluster_starts[i] * 3]].vertex;
+            cluster_normals[i] = normal.Normalized();
+        }
+
+        if (mesh_area > 0)
+        {
+            mesh_center /= mesh_area;
+        }
+
+        // clusters facing away from the center occlude the rest, draw them first
+        Vector<float> keys(cluster_count);
+        Vector<int> order(cluster_count);
+        for (int i = 0; i < cluster_count; ++i)
+        {
+            keys[i] = Vector3::Dot(cluster_centers[i] - mesh_center, cluster_normals[i]);
+            order[i] = i;
+        }
+
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+            return keys[a] > keys[b];
+        });
+
+        Vector<unsigned int> result;
+        for (int i = 0; i < cluster_count; ++i)
+        {
+            int c = order[i];
+            int first = cluster_starts[c] * 3;
+            int count = (cluster_starts[c + 1] - cluster_starts[c]) * 3;
+            result.AddRange(&src[first], count);
+        }
+
+        Memory::Copy(&indices[index_first], result.Bytes(), result.SizeInBytes());
+    }
+
+    Vector<int> MeshOptimizer::OptimizeVertexFetch(Vector<Mesh::Vertex>& vertices, Vector<unsigned int>& indices)
+    {
+        Vector<int> remap(vertices.Size(), -1);
+        int next = 0;
+
+        for (int i = 0; i < indices.Size(); ++i)
+        {
+            if (remap[indices[i]] < 0)
+            {
+                remap[indices[i]] = next++;
+            }
+        }
+
+        // unreferenced vertices go to the end
+        for (int i = 0; i < remap.Size(); ++i)
+        {
+            if (remap[i] < 0)
+            {
+                remap[i] = next++;
+            }
+        }
+
+        Vector<Mesh::Vertex> result(vertices.Size());
+        for (int i = 0; i < vertices.Size(); ++i)
+        {
+            result[remap[i]] = vertices[i];
+        }
+        vertices = std::move(result);
+
+        for (int i = 0; i < indices.Size(); ++i)
+        {
+            indices[i] = remap[indices[i]];
+        }
+
+        return remap;
+    }
+
+    Vector<unsigned int> MeshOptimizer::Simplify(const Vector<unsigned int>& indices, int index_first, int index_count, const Vector<Mesh::Vertex>& vertices, int target_index_count, float target_error)
+    {
+        Vector<unsigned int> result;
+        if (index_count > 0)
+        {
+            result.AddRange(&indices[index_first], index_count);
+        }
+
+        int vertex_count = vertices.Size();
+        if (index_count <= target_index_count || vertex_count == 0)
+        {
+            return result;
+        }
+
+        // vertices sharing a position across uv or normal seams get the same position id
+        Vector<int> position_ids(vertex_count);
+        {
+            Vector<int> order(vertex_count);
+            for (int i = 0; i < vertex_count; ++i)
+            {
+                order[i] = i;
+            }
+
+            std::sort(order.begin(), order.end(), [&](int a, int b) {
+                const Vector3& pa = vertices[a].vertex;
+                const Vector3& pb = vertices[b].vertex;
+                if (pa.x != pb.x) return pa.x < pb.x;
+                if (pa.y != pb.y) return pa.y < pb.y;
+                return pa.z < pb.z;
+            });
+
+            int id = -1;
+            for (int i = 0; i < vertex_count; ++i)
+            {
+                if (i == 0 || vertices[order[i]].vertex != vertices[order[i - 1]].vertex)
+                {
+                    ++id;
+                }
+                position_ids[order[i]] = id;
+            }
+        }
+
+        // seams and open borders are locked, collapsing them would tear the surface
+        Vector<char> locked(vertex_count, 0);
+        {
+            Vector<int> position_owner(vertex_count, -1);
+            Vector<char> position_locked(vertex_count, 0);
+
+            for (int i = 0; i < result.Size(); ++i)
+            {
+                int v = result[i];
+                int p = position_ids[v];
+                if (position_owner[p] < 0)
+                {
+                    position_owner[p] = v;
+                }
+                else if (position_owner[p] != v)
+                {
+                    position_locked[p] = 1;
+                }
+            }
+
+            Vector<uint64_t> edges;
+            for (int i = 0; i < result.Size(); i += 3)
+            {
+                for (int k = 0; k < 3; ++k)
+                {
+                    uint64_t a = position_ids[result[i + k]];
+                    uint64_t b = position_ids[result[i + (k + 1) % 3]];
+                    edges.Add(a < b ? (a << 32) | b : (b << 32) | a);
+                }
+            }
+            std::sort(edges.begin(), edges.end());
+
+            for (int i = 0; i < edges.Size(); )
+            {
+                int j = i + 1;
+                while (j < edges.Size() && edges[j] == edges[i])
+                {
+                    ++j;
+                }
+                if (j - i == 1)
+                {
+                    position_locked[(int) (edges[i] >> 32)] = 1;
+                    position_locked[(int) (edges[i] & 0xffffffff)] = 1;
+                }
+                i = j;
+            }
+
+            for (int i = 0; i < vertex_count; ++i)
+            {
+                locked[i] = position_locked[position_ids[i]];
+            }
+        }
+
+        Vector3 min = vertices[result[0]].vertex;
+        Vector3 max = min;
+        for (int i = 0; i < result.Size(); ++i)
+        {
+            min = Vector3::Min(min, vertices[result[i]].vertex);
+            max = Vector3::Max(max, vertices[result[i]].vertex);
+        }
+        double error_limit = target_error * (max - min).Magnitude();
+        error_limit *= error_limit;
+
+        Vector<Quadric> quadrics(vertex_count);
+        for (int i = 0; i < result.Size(); i += 3)
+        {
+            const Vector3& a = vertices[result[i + 0]].vertex;
+            const Vector3& b = vertices[result[i + 1]].vertex;
+            const Vector3& c = vertices[result[i + 2]].vertex;
+            Vector3 n = TriangleNormal(a, b, c);
+            float area = n.Magnitude();
+            if (area > 0)
+            {
+                n /= area;
+                Quadric q(n, -Vector3::Dot(n, a), area);
+                quadrics[result[i + 0]] += q;
+                quadrics[result[i + 1]] += q;
+                quadrics[result[i + 2]] += q;
+            }
+        }
+
+        Vector<int> live;
+        Vector<int> offsets;
+        Vector<int> adjacency;
+        Vector<Collapse> collapses;
+        Vector<unsigned int> remap(vertex_count);
+        Vector<char> touched(vertex_count);
+
+        while (result.Size() > target_index_count)
+        {
+            BuildAdjacency(&result[0], result.Size(), vertex_count, live, offsets, adjacency);
+
+            collapses.Clear();
+            for (int i = 0; i < result.Size(); i += 3)
+            {
+                for (int k = 0; k < 3; ++k)
+                {
+                    unsigned int v0 = result[i + k];
+                    unsigned int v1 = result[i + (k + 1) % 3];
+
+                    if (!locked[v0])
+                    {
+                        Quadric q = quadrics[v0];
+                        q += quadrics[v1];
+                        collapses.Add({ v0, v1, q.EvaluateDistance(vertices[v1].vertex) });
+                    }
+                    if (!locked[v1])
+                    {
+                        Quadric q = quadrics[v1];
+                        q += quadrics[v0];
+                        collapses.Add({ v1, v0, q.EvaluateDistance(vertices[v0].vertex) });
+                    }
+                }
+            }
+
+            std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) {
+                return a.cost < b.cost;
+            });
+
+            for (int i = 0; i < vertex_count; ++i)
+            {
+                remap[i] = i;
+                touched[i] = 0;
+            }
+
+            // every collapse removes about two triangles
+            int collapse_limit = (result.Size() - target_index_count) / 6 + 1;
+            int collapse_count = 0;
+
+            for (int i = 0; i < collapses.Size() && collapse_count < collapse_limit; ++i)
+            {
+                const Collapse& collapse = collapses[i];
+                if (collapse.cost > error_limit)
+                {
+                    break;
+                }
+                if (touched[collapse.from] || touched[collapse.to])
+                {
+                    continue;
+                }
+
+                // reject collapses flipping a remaining triangle
+                bool flip = false;
+                const Vector3& target = vertices[collapse.to].vertex;
+                for (int j = offsets[collapse.from]; j < offsets[collapse.from + 1] && !flip; ++j)
+                {
+                    const unsigned int* tri = &result[adjacency[j] * 3];
+                    if (tri[0] == collapse.to || tri[1] == collapse.to || tri[2] == collapse.to)
+                    {
+                        continue;
+                    }
+
+                    Vector3 p[3];
+                    Vector3 q[3];
+                    for (int k = 0; k < 3; ++k)
+                    {
+                        p[k] = vertices[tri[k]].vertex;
+                        q[k] = tri[k] == collapse.from ? target : p[k];
+                    }
+                    flip = Vector3::Dot(TriangleNormal(p[0], p[1], p[2]), TriangleNormal(q[0], q[1], q[2])) <= 0;
+                }
+                if (flip)
+                {
+                    continue;
+                }
+
+                remap[collapse.from] = collapse.to;
+                quadrics[collapse.to] += quadrics[collapse.from];
+                collapse_count += 1;
+
+                for (int j = offsets[collapse.from]; j < offsets[collapse.from + 1]; ++j)
+                {
+                    const unsigned int* tri = &result[adjacency[j] * 3];
+                    touched[tri[0]] = 1;
+                    touched[tri[1]] = 1;
+                    touched[tri[2]] = 1;
+                }
+            }
+
+            if (collapse_count == 0)
+            {
+                break;
+            }
+
+            int write = 0;
+            for (int i = 0; i < result.Size(); i += 3)
+            {
+                unsigned int a = remap[result[i + 0]];
+                unsigned int b = remap[result[i + 1]];
+                unsigned int c = remap[result[i + 2]];
+                if (a != b && b != c && c != a)
+                {
+                    result[write++] = a;
+                    result[write++] = b;
+                    result[write++] = c;
+                }
+            }
+            result.Resize(write);
+        }
+
+        return result;
+    }
+
+    void MeshOptimizer::Optimize(Mesh::FileData& data, int lod_count)
+    {
+        if (data.indices.Empty() || data.vertices.Empty())
+        {
+            return;
+        }
+
+        if (data.submeshes.Empty())
+        {
+            data.submeshes.Add(Mesh::Submesh({ 0, data.indices.Size() }));
+        }
+
+        // drop the levels of a previous run, they are stored behind the base submeshes
+        if (data.lods.Size() > 0)
+        {
+            int end = 0;
+            for (int i = 0; i < data.submeshes.Size(); ++i)
+            {
+                end = Mathf::Max(end, data.submeshes[i].index_first + data.submeshes[i].index_count);
+            }
+            data.indices.Resize(end);
+            data.lods.Clear();
+        }
+
+        Vector<Mesh::Submesh> previous = data.submeshes;
+        for (int lod = 1; lod < lod_count; ++lod)
+        {
+            Mesh::Lod level;
+            level.screen_size = LOD_SCREEN_SIZE * powf(LOD_REDUCTION, (float) (lod - 1));
+
+            int index_count_before = 0;
+            int index_count_after = 0;
+            int level_first = data.indices.Size();
+
+            for (int i = 0; i < previous.Size(); ++i)
+            {
+                const auto& submesh = previous[i];
+                int target = (int) (submesh.index_count * LOD_REDUCTION) / 3 * 3;
+                float error = LOD_TARGET_ERROR * (float) (1 << (lod - 1));
+
+                Vector<unsigned int> simplified = Simplify(data.indices, submesh.index_first, submesh.index_count, data.vertices, target, error);
+
+                level.submeshes.Add(Mesh::Submesh({ data.indices.Size(), simplified.Size() }));
+                data.indices.AddRange(simplified);
+
+                index_count_before += submesh.index_count;
+                index_count_after += simplified.Size();
+            }
+
+            if (index_count_after > index_count_before * LOD_MIN_REDUCTION)
+            {
+                data.indices.Resize(level_first);
+                break;
+            }
+
+            previous = level.submeshes;
+            data.lods.Add(level);
+        }
+
+        auto optimize = [&](const Vector<Mesh::Submesh>& submeshes) {
+            for (int i = 0; i < submeshes.Size(); ++i)
+            {
+                OptimizeVertexCache(data.indices, submeshes[i].index_first, submeshes[i].index_count, data.vertices.Size());
+                OptimizeOverdraw(data.indices, submeshes[i].index_first, submeshes[i].index_count, data.vertices);
+            }
+        };
+
+        optimize(data.submeshes);
+        for (int i = 0; i < data.lods.Size(); ++i)
+        {
+            optimize(data.lods[i].submeshes);
+        }
+
+        Vector<int> remap = OptimizeVertexFetch(data.vertices, data.indices);
+
+        // blend shape deltas follow their vertices
+        auto permute = [&](Vector<Vector3>& values) {
+            if (values.Size() == remap.Size())
+            {
+                Vector<Vector3> result(values.Size());
+                for (int i = 0; i < values.Size(); ++i)
+                {
+                    result[remap[i]] = values[i];
+                }
+                values = std::move(result);
+            }
+        };
+
+        for (int i = 0; i < data.blend_shapes.Size(); ++i)
+        {
+            for (int j = 0; j < data.blend_shapes[i].frames.Size(); ++j)
+            {
+                auto& frame = data.blend_shapes[i].frames[j];
+                permute(frame.vertices);
+                permute(frame.normals);
+                permute(frame.tangents);
+            }
+        }
+    }
+
+    bool MeshOptimizer::OptimizeFile(const String& input_path, const String& output_path, int lod_count)
+    {
+        Mesh::FileData data;
+        if (!Mesh::ReadFile(input_path, data))
+        {
+            return false;
+        }
+
+        int index_count = data.indices.Size();
+        Optimize(data, lod_count);
+
+        Log("mesh %s: %d triangles, %d lods", data.name.CString(), index_count / 3, data.lods.Size());
+        for (int i = 0; i < data.lods.Size(); ++i)
+        {
+            int lod_index_count = 0;
+            for (int j = 0; j < data.lods[i].submeshes.Size(); ++j)
+            {
+                lod_index_count += data.lods[i].submeshes[j].index_count;
+            }
+            Log("    lod %d: %d triangles, screen size %f", i + 1, lod_index_count / 3, data.lods[i].screen_size);
+        }
+
+        return Mesh::WriteFile(output_path, data);
+    }
+}
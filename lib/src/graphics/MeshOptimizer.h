@@ -0,0 +1,41 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+#include "Mesh.h"
+
+namespace Viry3D
+{
+    // offline mesh processing, run at import time before meshes are converted for shipping
+    class MeshOptimizer
+    {
+    public:
+        // reorders the triangles of one index range for post transform vertex cache reuse
+        static void OptimizeVertexCache(Vector<unsigned int>& indices, int index_first, int index_count, int vertex_count);
+        // sorts cache friendly triangle clusters front to back from the mesh center, to reduce overdraw
+        static void OptimizeOverdraw(Vector<unsigned int>& indices, int index_first, int index_count, const Vector<Mesh::Vertex>& vertices);
+        // reorders vertices by first use and remaps the indices, returns the new index of every old vertex
+        static Vector<int> OptimizeVertexFetch(Vector<Mesh::Vertex>& vertices, Vector<unsigned int>& indices);
+        // quadric error simplification of one index range, vertices are kept and only referenced less.
+        // target_error is relative to the mesh extent.
+        static Vector<unsigned int> Simplify(const Vector<unsigned int>& indices, int index_first, int index_count, const Vector<Mesh::Vertex>& vertices, int target_index_count, float target_error);
+        // runs the whole pipeline on a mesh file and appends a lod chain of at most lod_count levels
+        static void Optimize(Mesh::FileData& data, int lod_count);
+        static bool OptimizeFile(const String& input_path, const String& output_path, int lod_count);
+    };
+}
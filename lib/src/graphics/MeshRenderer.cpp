@@ -19,7 +19,8 @@
 
 namespace Viry3D
 {
-    MeshRenderer::MeshRenderer()
+    MeshRenderer::MeshRenderer():
+        m_lod(0)
     {
 
     }
@@ -40,7 +41,7 @@ namespace Viry3D
         
         if (m_mesh)
         {
-            primitives = m_mesh->GetPrimitives();
+            primitives = m_mesh->GetLodPrimitives(m_lod);
         }
         
         return primitives;
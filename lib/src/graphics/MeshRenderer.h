@@ -32,8 +32,11 @@ namespace Viry3D
         const Ref<Mesh>& GetMesh() const { return m_mesh; }
 		virtual void SetMesh(const Ref<Mesh>& mesh);
         virtual Vector<filament::backend::RenderPrimitiveHandle> GetPrimitives();
+        int GetLod() const { return m_lod; }
+        void SetLod(int lod) { m_lod = lod; }
         
 	private:
         Ref<Mesh> m_mesh;
+        int m_lod;
     };
 }
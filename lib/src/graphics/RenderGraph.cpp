@@ -0,0 +1,258 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "RenderGraph.h"
+#include "Camera.h"
+#include "Material.h"
+
+namespace Viry3D
+{
+	RenderGraph::RenderGraph():
+		m_culled_pass_count(0)
+	{
+	
+	}
+
+	RenderGraph::~RenderGraph()
+	{
+		for (int i = 0; i < m_textures.Size(); ++i)
+		{
+			auto& texture = m_textures[i];
+			if (!texture.imported && texture.target)
+			{
+				RenderTarget::ReleaseTemporaryRenderTarget(texture.target);
+			}
+		}
+	}
+
+	int RenderGraph::Import(const Ref<RenderTarget>& target, bool output)
+	{
+		VirtualTexture texture;
+		texture.key = target->key;
+		texture.target = target;
+		texture.imported = true;
+		texture.output = output;
+		texture.ref_count = 0;
+		texture.first_pass = -1;
+		texture.last_pass = -1;
+		texture.last_read = -1;
+		m_textures.Add(texture);
+
+		return m_textures.Size() - 1;
+	}
+
+	int RenderGraph::Create(int width, int height, TextureFormat color_format, FilterMode filter_mode)
+	{
+		VirtualTexture texture;
+		texture.key.width = width;
+		texture.key.height = height;
+		texture.key.color_format = color_format;
+		texture.key.depth_format = TextureFormat::None;
+		texture.key.filter_mode = filter_mode;
+		texture.key.wrap_mode = SamplerAddressMode::ClampToEdge;
+		texture.key.flags = filament::backend::TargetBufferFlags::COLOR;
+		texture.imported = false;
+		texture.output = false;
+		texture.ref_count = 0;
+		texture.first_pass = -1;
+		texture.last_pass = -1;
+		texture.last_read = -1;
+		m_textures.Add(texture);
+
+		return m_textures.Size() - 1;
+	}
+
+	void RenderGraph::AddPass(const Vector<int>& reads, int write, const Ref<Material>& material, int shader_pass, PassFunc setup)
+	{
+		Pass pass;
+		pass.reads = reads;
+		pass.write = write;
+		pass.material = material;
+		pass.shader_pass = shader_pass;
+		pass.setup = setup;
+		pass.culled = false;
+		m_passes.Add(pass);
+	}
+
+	void RenderGraph::AddPass(const Vector<int>& reads, int write, PassFunc execute)
+	{
+		Pass pass;
+		pass.reads = reads;
+		pass.write = write;
+		pass.shader_pass = -1;
+		pass.execute = execute;
+		pass.culled = false;
+		m_passes.Add(pass);
+	}
+
+	void RenderGraph::Compile()
+	{
+		m_culled_pass_count = 0;
+
+		for (int i = 0; i < m_passes.Size(); ++i)
+		{
+			for (int j : m_passes[i].reads)
+			{
+				m_textures[j].ref_count += 1;
+			}
+		}
+
+		// cull the writers of textures nobody reads, which may leave their inputs unread too
+		List<int> unread;
+		for (int i = 0; i < m_textures.Size(); ++i)
+		{
+			if (m_textures[i].ref_count == 0 && !m_textures[i].output)
+			{
+				unread.AddLast(i);
+			}
+		}
+		while (!unread.Empty())
+		{
+			int texture = unread.Last();
+			unread.RemoveLast();
+
+			for (int i = 0; i < m_passes.Size(); ++i)
+			{
+				auto& pass = m_passes[i];
+				if (pass.culled || pass.write != texture)
+				{
+					continue;
+				}
+
+				pass.culled = true;
+				m_culled_pass_count += 1;
+
+				for (int j : pass.reads)
+				{
+					m_textures[j].ref_count -= 1;
+					if (m_textures[j].ref_count == 0 && !m_textures[j].output)
+					{
+						unread.AddLast(j);
+					}
+				}
+			}
+		}
+
+		for (int i = 0; i < m_passes.Size(); ++i)
+		{
+			const auto& pass = m_passes[i];
+			if (pass.culled)
+			{
+				continue;
+			}
+
+			for (int j : pass.reads)
+			{
+				if (m_textures[j].first_pass < 0)
+				{
+					m_textures[j].first_pass = i;
+				}
+				m_textures[j].last_pass = i;
+				m_textures[j].last_read = i;
+			}
+			if (m_textures[pass.write].first_pass < 0)
+			{
+				m_textures[pass.write].first_pass = i;
+			}
+			m_textures[pass.write].last_pass = i;
+			if (pass.execute && m_textures[pass.write].first_pass != i)
+			{
+				m_textures[pass.write].last_read = i;
+			}
+		}
+	}
+
+	void RenderGraph::Execute()
+	{
+		this->Compile();
+
+		for (int i = 0; i < m_passes.Size(); ++i)
+		{
+			auto& pass = m_passes[i];
+			if (pass.culled)
+			{
+				continue;
+			}
+
+			auto& write = m_textures[pass.write];
+			if (!write.target)
+			{
+				// targets released by earlier passes come back here when the key matches
+				write.target = RenderTarget::GetTemporaryRenderTarget(
+					write.key.width,
+					write.key.height,
+					write.key.color_format,
+					write.key.depth_format,
+					write.key.filter_mode,
+					write.key.wrap_mode,
+					write.key.flags);
+			}
+
+			if (pass.execute)
+			{
+				pass.execute(*this);
+			}
+			else
+			{
+				// blits cover the whole target, so old contents of transient targets are never loaded,
+				// and contents no later pass reads are never stored, even if a later blit writes the target again
+				filament::backend::RenderPassFlags flags = { };
+				if (write.imported)
+				{
+					if (write.first_pass == i)
+					{
+						flags.clear = write.key.flags;
+					}
+				}
+				else
+				{
+					if (write.first_pass == i)
+					{
+						flags.discardStart = write.key.flags;
+					}
+					if (write.last_read <= i)
+					{
+						flags.discardEnd = write.key.flags;
+					}
+				}
+
+				if (pass.setup)
+				{
+					pass.setup(*this);
+				}
+				Camera::Blit(Ref<RenderTarget>(), write.target, pass.material, pass.shader_pass, flags);
+			}
+
+			for (int j : pass.reads)
+			{
+				auto& texture = m_textures[j];
+				if (!texture.imported && texture.last_pass == i && texture.target)
+				{
+					RenderTarget::ReleaseTemporaryRenderTarget(texture.target);
+					texture.target.reset();
+				}
+			}
+			if (!write.imported && write.last_pass == i)
+			{
+				RenderTarget::ReleaseTemporaryRenderTarget(write.target);
+				write.target.reset();
+			}
+		}
+
+		m_passes.Clear();
+	}
+}
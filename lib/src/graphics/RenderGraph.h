@@ -0,0 +1,81 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+#include "RenderTarget.h"
+#include <functional>
+
+namespace Viry3D
+{
+	class Material;
+
+	// full screen passes of a frame over virtual render targets,
+	// transient targets are taken from the temporary pool only between their first and last use
+	class RenderGraph
+	{
+	public:
+		typedef std::function<void(RenderGraph& graph)> PassFunc;
+
+		RenderGraph();
+		~RenderGraph();
+		int Import(const Ref<RenderTarget>& target, bool output);
+		int Create(int width, int height, TextureFormat color_format, FilterMode filter_mode = FilterMode::Linear);
+		// setup binds the inputs of material before the graph blits it to write
+		void AddPass(const Vector<int>& reads, int write, const Ref<Material>& material, int shader_pass, PassFunc setup);
+		// execute draws by itself, the graph only keeps write alive
+		void AddPass(const Vector<int>& reads, int write, PassFunc execute);
+		void Execute();
+		const Ref<RenderTarget>& GetTarget(int texture) const { return m_textures[texture].target; }
+		int GetWidth(int texture) const { return m_textures[texture].key.width; }
+		int GetHeight(int texture) const { return m_textures[texture].key.height; }
+		TextureFormat GetColorFormat(int texture) const { return m_textures[texture].key.color_format; }
+		int GetCulledPassCount() const { return m_culled_pass_count; }
+
+	private:
+		struct VirtualTexture
+		{
+			RenderTargetKey key;
+			Ref<RenderTarget> target;
+			bool imported;
+			bool output;
+			int ref_count;
+			int first_pass;
+			int last_pass;
+			// last pass needing the contents, a reader or an execute pass drawing over them
+			int last_read;
+		};
+
+		struct Pass
+		{
+			Vector<int> reads;
+			int write;
+			Ref<Material> material;
+			int shader_pass;
+			PassFunc setup;
+			PassFunc execute;
+			bool culled;
+		};
+
+		void Compile();
+
+	private:
+		Vector<VirtualTexture> m_textures;
+		Vector<Pass> m_passes;
+		int m_culled_pass_count;
+	};
+}
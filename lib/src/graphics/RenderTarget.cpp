@@ -17,11 +17,34 @@
 
 #include "RenderTarget.h"
 #include "Engine.h"
+#include "time/Time.h"
+#include "math/Mathf.h"
 
 namespace Viry3D
 {
 	Map<uint64_t, TemporaryRenderTargets> RenderTarget::m_temporary_render_targets_using;
 	Map<uint64_t, TemporaryRenderTargets> RenderTarget::m_temporary_render_targets_idle;
+	int RenderTarget::m_pool_max_idle_frames = RENDER_TARGET_POOL_MAX_IDLE_FRAMES;
+	int64_t RenderTarget::m_pool_memory_budget = RENDER_TARGET_POOL_MEMORY_BUDGET;
+	RenderTargetPoolStats RenderTarget::m_pool_stats;
+
+	static int get_pixel_size(TextureFormat format)
+	{
+		switch (format)
+		{
+		case TextureFormat::R8:
+		case TextureFormat::S8:
+			return 1;
+		case TextureFormat::R8G8:
+		case TextureFormat::D16:
+			return 2;
+		case TextureFormat::R16G16B16A16F:
+		case TextureFormat::D32S8:
+			return 8;
+		default:
+			return 4;
+		}
+	}
 
 	void RenderTarget::Init()
 	{
@@ -30,8 +53,6 @@ namespace Viry3D
 
 	void RenderTarget::Done()
 	{
-		auto& driver = Engine::Instance()->GetDriverApi();
-
 		for (const auto& i : m_temporary_render_targets_using)
 		{
 			const auto& targets = i.second.targets;
@@ -44,12 +65,12 @@ namespace Viry3D
 			const auto& targets = i.second.targets;
 			for (int j = 0; j < targets.Size(); ++j)
 			{
-				auto& target = targets[j]->target;
-				driver.destroyRenderTarget(target);
-				target.clear();
+				DestroyTarget(targets[j]);
 			}
 		}
 		m_temporary_render_targets_idle.Clear();
+
+		m_pool_stats = RenderTargetPoolStats();
 	}
 
 	Ref<RenderTarget> RenderTarget::GetTemporaryRenderTarget(
@@ -59,10 +80,9 @@ namespace Viry3D
 		TextureFormat depth_format,
 		FilterMode filter_mode,
 		SamplerAddressMode wrap_mode,
-		filament::backend::TargetBufferFlags flags)
+		filament::backend::TargetBufferFlags flags,
+		bool allow_sub_rect)
 	{
-		Ref<RenderTarget> target;
-
 		RenderTargetKey key;
 		key.width = width;
 		key.height = height;
@@ -72,28 +92,13 @@ namespace Viry3D
 		key.wrap_mode = wrap_mode;
 		key.flags = flags;
 
-		TemporaryRenderTargets* p;
-		bool create = false;
-		if (m_temporary_render_targets_idle.TryGet(key.u, &p))
-		{
-			if (p->targets.Size() > 0)
-			{
-				int index = p->targets.Size() - 1;
-				target = p->targets[index];
-				p->targets.Remove(index);
-			}
-			else
-			{
-				create = true;
-			}
-		}
-		else
-		{
-			create = true;
-		}
+		Ref<RenderTarget> target = TakeIdle(key, allow_sub_rect);
 
-		if (create)
+		if (!target)
 		{
+			// make room among idle targets before growing the pool
+			EvictIdle(GetMemorySize(key));
+
 			target = RefMake<RenderTarget>();
 			target->key = key;
 
@@ -133,19 +138,88 @@ namespace Viry3D
 				color,
 				depth,
 				stencil);
+
+			m_pool_stats.created_count += 1;
+		}
+		else
+		{
+			m_pool_stats.reused_count += 1;
 		}
 
-		if (m_temporary_render_targets_using.TryGet(key.u, &p))
+		target->viewport = { 0, 0, (uint32_t) width, (uint32_t) height };
+		target->m_last_used_frame = Time::GetFrameCount();
+
+		TemporaryRenderTargets* p;
+		if (m_temporary_render_targets_using.TryGet(target->key.u, &p))
 		{
 			p->targets.Add(target);
 		}
 		else
 		{
 			TemporaryRenderTargets targets;
-			targets.key = key;
+			targets.key = target->key;
 			targets.targets.Add(target);
 
-			m_temporary_render_targets_using.Add(key.u, targets);
+			m_temporary_render_targets_using.Add(target->key.u, targets);
+		}
+		m_pool_stats.using_count += 1;
+		m_pool_stats.using_memory += GetMemorySize(target->key);
+
+		return target;
+	}
+
+	Ref<RenderTarget> RenderTarget::TakeIdle(const RenderTargetKey& key, bool allow_sub_rect)
+	{
+		Ref<RenderTarget> target;
+
+		TemporaryRenderTargets* p;
+		if (m_temporary_render_targets_idle.TryGet(key.u, &p) && p->targets.Size() > 0)
+		{
+			// the most recently released one, the others may age out
+			int index = p->targets.Size() - 1;
+			target = p->targets[index];
+			p->targets.Remove(index);
+		}
+		else if (allow_sub_rect)
+		{
+			// the smallest larger target with the same formats
+			RenderTargetKey format_key = key;
+			format_key.width = 0;
+			format_key.height = 0;
+			int64_t max_area = (int64_t) key.width * key.height * RENDER_TARGET_POOL_MAX_SUB_RECT_WASTE;
+
+			TemporaryRenderTargets* best = nullptr;
+			int64_t best_area = 0;
+			for (auto& i : m_temporary_render_targets_idle)
+			{
+				RenderTargetKey idle_key = i.second.key;
+				int64_t area = (int64_t) idle_key.width * idle_key.height;
+				idle_key.width = 0;
+				idle_key.height = 0;
+
+				if (i.second.targets.Size() > 0 && idle_key.u == format_key.u &&
+					i.second.key.width >= key.width && i.second.key.height >= key.height &&
+					area <= max_area && (best == nullptr || area < best_area))
+				{
+					best = &i.second;
+					best_area = area;
+				}
+			}
+
+			if (best)
+			{
+				int index = best->targets.Size() - 1;
+				target = best->targets[index];
+				best->targets.Remove(index);
+
+				m_pool_stats.sub_rect_count += 1;
+			}
+		}
+
+		if (target)
+		{
+			m_pool_stats.idle_count -= 1;
+			m_pool_stats.idle_memory -= GetMemorySize(target->key);
 		}
 
 		return target;
@@ -160,6 +234,8 @@ namespace Viry3D
 		{
 			if (p->targets.Remove(target))
 			{
+				target->m_last_used_frame = Time::GetFrameCount();
+
 				if (m_temporary_render_targets_idle.TryGet(key.u, &p))
 				{
 					p->targets.Add(target);
@@ -172,7 +248,134 @@ namespace Viry3D
 
 					m_temporary_render_targets_idle.Add(key.u, targets);
 				}
+
+				int64_t size = GetMemorySize(key);
+				m_pool_stats.using_count -= 1;
+				m_pool_stats.using_memory -= size;
+				m_pool_stats.idle_count += 1;
+				m_pool_stats.idle_memory += size;
 			}
 		}
 	}
+
+	void RenderTarget::Update()
+	{
+		int frame = Time::GetFrameCount();
+
+		// targets left behind by a resize or a resolution change are never asked for again
+		for (auto i = m_temporary_render_targets_idle.begin(); i != m_temporary_render_targets_idle.end(); )
+		{
+			auto& targets = i->second.targets;
+			for (int j = targets.Size() - 1; j >= 0; --j)
+			{
+				if (frame - targets[j]->m_last_used_frame > m_pool_max_idle_frames)
+				{
+					DestroyTarget(targets[j]);
+					targets.Remove(j);
+					m_pool_stats.evicted_count += 1;
+				}
+			}
+
+			if (targets.Empty())
+			{
+				i = m_temporary_render_targets_idle.Remove(i);
+			}
+			else
+			{
+				++i;
+			}
+		}
+
+		EvictIdle(0);
+	}
+
+	void RenderTarget::SetPoolMaxIdleFrames(int frames)
+	{
+		m_pool_max_idle_frames = Mathf::Max(frames, 0);
+	}
+
+	void RenderTarget::SetPoolMemoryBudget(int64_t bytes)
+	{
+		m_pool_memory_budget = bytes;
+	}
+
+	Vector4 RenderTarget::GetUVScaleOffset() const
+	{
+		if (viewport.width == 0 || viewport.height == 0 || key.width <= 0 || key.height <= 0)
+		{
+			return Vector4(1, 1, 0, 0);
+		}
+
+		float width = (float) key.width;
+		float height = (float) key.height;
+		float bottom = (float) viewport.bottom;
+
+		// d3d11 flips the viewport to a top left origin, the uvs of the other backends start where the viewport does
+		if (Engine::Instance()->GetBackend() == filament::backend::Backend::D3D11)
+		{
+			bottom = height - (float) (viewport.bottom + viewport.height);
+		}
+
+		return Vector4(viewport.width / width, viewport.height / height, viewport.left / width, bottom / height);
+	}
+
+	int64_t RenderTarget::GetMemorySize(const RenderTargetKey& key)
+	{
+		int64_t pixels = (int64_t) key.width * key.height;
+		int64_t size = 0;
+		if (key.flags & filament::backend::TargetBufferFlags::COLOR)
+		{
+			size += pixels * get_pixel_size(key.color_format);
+		}
+		if (key.flags & filament::backend::TargetBufferFlags::DEPTH)
+		{
+			size += pixels * get_pixel_size(key.depth_format);
+		}
+		return size;
+	}
+
+	void RenderTarget::DestroyTarget(const Ref<RenderTarget>& target)
+	{
+		auto& driver = Engine::Instance()->GetDriverApi();
+		driver.destroyRenderTarget(target->target);
+		target->target.clear();
+		target->color.reset();
+		target->depth.reset();
+
+		m_pool_stats.idle_count -= 1;
+		m_pool_stats.idle_memory -= GetMemorySize(target->key);
+	}
+
+	bool RenderTarget::EvictIdle(int64_t required)
+	{
+		// least recently used first, targets in use are never evicted so the budget may still be exceeded
+		while (m_pool_stats.using_memory + m_pool_stats.idle_memory + required > m_pool_memory_budget)
+		{
+			TemporaryRenderTargets* oldest = nullptr;
+			int oldest_index = -1;
+			for (auto& i : m_temporary_render_targets_idle)
+			{
+				auto& targets = i.second.targets;
+				for (int j = 0; j < targets.Size(); ++j)
+				{
+					if (oldest == nullptr || targets[j]->m_last_used_frame < oldest->targets[oldest_index]->m_last_used_frame)
+					{
+						oldest = &i.second;
+						oldest_index = j;
+					}
+				}
+			}
+
+			if (oldest == nullptr)
+			{
+				return false;
+			}
+
+			DestroyTarget(oldest->targets[oldest_index]);
+			oldest->targets.Remove(oldest_index);
+			m_pool_stats.evicted_count += 1;
+		}
+
+		return true;
+	}
 }
@@ -19,8 +19,15 @@
 
 #include "Texture.h"
 #include "container/Map.h"
+#include "math/Vector4.h"
 #include "private/backend/DriverApi.h"
 
+// idle temporary targets are destroyed after this many frames without use
+#define RENDER_TARGET_POOL_MAX_IDLE_FRAMES 120
+#define RENDER_TARGET_POOL_MEMORY_BUDGET (256 * 1024 * 1024)
+// a larger idle target is lent out for a sub rect only up to this times the requested area
+#define RENDER_TARGET_POOL_MAX_SUB_RECT_WASTE 2
+
 namespace Viry3D
 {
 	class RenderTargetKey
@@ -45,6 +52,18 @@ namespace Viry3D
 
 	class RenderTarget;
 
+	struct RenderTargetPoolStats
+	{
+		int using_count = 0;
+		int idle_count = 0;
+		int64_t using_memory = 0;
+		int64_t idle_memory = 0;
+		int created_count = 0;
+		int reused_count = 0;
+		int sub_rect_count = 0;
+		int evicted_count = 0;
+	};
+
 	class TemporaryRenderTargets
 	{
 	public:
@@ -64,17 +83,41 @@ namespace Viry3D
 			TextureFormat depth_format,
 			FilterMode filter_mode,
 			SamplerAddressMode wrap_mode,
-			filament::backend::TargetBufferFlags flags);
+			filament::backend::TargetBufferFlags flags,
+			bool allow_sub_rect = false);
 		static void ReleaseTemporaryRenderTarget(const Ref<RenderTarget>& target);
+		// destroys idle targets that aged out or exceed the memory budget, once per frame
+		static void Update();
+		static int GetPoolMaxIdleFrames() { return m_pool_max_idle_frames; }
+		static void SetPoolMaxIdleFrames(int frames);
+		static int64_t GetPoolMemoryBudget() { return m_pool_memory_budget; }
+		static void SetPoolMemoryBudget(int64_t bytes);
+		static const RenderTargetPoolStats& GetPoolStats() { return m_pool_stats; }
 
 	public:
 		filament::backend::RenderTargetHandle target;
 		Ref<Texture> color;
 		Ref<Texture> depth;
 		RenderTargetKey key;
+		// area to draw to, smaller than key when lent out from a larger target, empty for non pooled targets
+		filament::backend::Viewport viewport = { };
+
+		// maps 0..1 uvs onto the viewport in the color texture, for MaterialProperty::TEXTURE_SCALE_OFFSET
+		// of materials sampling this target
+		Vector4 GetUVScaleOffset() const;
+
+	private:
+		static int64_t GetMemorySize(const RenderTargetKey& key);
+		static Ref<RenderTarget> TakeIdle(const RenderTargetKey& key, bool allow_sub_rect);
+		static void DestroyTarget(const Ref<RenderTarget>& target);
+		static bool EvictIdle(int64_t required);
 
 	private:
 		static Map<uint64_t, TemporaryRenderTargets> m_temporary_render_targets_using;
 		static Map<uint64_t, TemporaryRenderTargets> m_temporary_render_targets_idle;
+		static int m_pool_max_idle_frames;
+		static int64_t m_pool_memory_budget;
+		static RenderTargetPoolStats m_pool_stats;
+		int m_last_used_frame = 0;
 	};
 }
@@ -22,6 +22,7 @@
 namespace Viry3D
 {
     List<Renderer*> Renderer::m_renderers;
+	uint32_t Renderer::m_static_version = 0;
     
 	void Renderer::PrepareAll()
 	{
@@ -34,6 +35,7 @@ namespace Viry3D
     Renderer::Renderer():
 		m_cast_shadow(false),
 		m_recieve_shadow(false),
+		m_static(false),
         m_lightmap_scale_offset(1, 1, 0, 0),
         m_lightmap_index(-1)
     {
@@ -50,6 +52,11 @@ namespace Viry3D
 			m_transform_uniform_buffer.clear();
 		}
 
+		if (m_static)
+		{
+			++m_static_version;
+		}
+
         m_renderers.Remove(this);
     }
     
@@ -85,6 +92,23 @@ namespace Viry3D
 		m_recieve_shadow = enable;
 	}
 
+	void Renderer::SetStatic(bool is_static)
+	{
+		if (m_static != is_static)
+		{
+			m_static = is_static;
+			++m_static_version;
+		}
+	}
+
+	void Renderer::OnTransformDirty()
+	{
+		if (m_static)
+		{
+			++m_static_version;
+		}
+	}
+
     void Renderer::SetLightmapIndex(int index)
     {
         m_lightmap_index = index;
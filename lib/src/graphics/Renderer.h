@@ -41,6 +41,10 @@ namespace Viry3D
 		void EnableCastShadow(bool enable);
 		bool IsRecieveShadow() const { return m_recieve_shadow; }
 		void EnableRecieveShadow(bool enable);
+		// static renderers are expected not to move, their shadows are cached by lights
+		bool IsStatic() const { return m_static; }
+		void SetStatic(bool is_static);
+		static uint32_t GetStaticVersion() { return m_static_version; }
         int GetLightmapIndex() const { return m_lightmap_index; }
         void SetLightmapIndex(int index);
         const Vector4& GetLightmapScaleOffset() const { return m_lightmap_scale_offset; }
@@ -51,15 +55,18 @@ namespace Viry3D
 	protected:
 		virtual void Prepare();
 		virtual void OnResize(int width, int height) { }
+		virtual void OnTransformDirty();
 
 	private:
 		friend class Camera;
 
 	private:
         static List<Renderer*> m_renderers;
+		static uint32_t m_static_version;
         Vector<Ref<Material>> m_materials;
 		bool m_cast_shadow;
 		bool m_recieve_shadow;
+		bool m_static;
         Vector4 m_lightmap_scale_offset;
         int m_lightmap_index;
 		filament::backend::UniformBufferHandle m_transform_uniform_buffer;
@@ -0,0 +1,175 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "ShadowAtlas.h"
+#include "Engine.h"
+#include "Texture.h"
+#include "math/Mathf.h"
+
+namespace Viry3D
+{
+	enum
+	{
+		NODE_FREE = 0,
+		NODE_SPLIT = 1,
+		NODE_USED = 2,
+	};
+
+	Ref<Texture> ShadowAtlas::m_texture;
+	filament::backend::RenderTargetHandle ShadowAtlas::m_render_target;
+	Vector<char> ShadowAtlas::m_nodes;
+
+	void ShadowAtlas::Done()
+	{
+		if (m_render_target)
+		{
+			Engine::Instance()->GetDriverApi().destroyRenderTarget(m_render_target);
+			m_render_target.clear();
+		}
+		m_texture.reset();
+		m_nodes.Clear();
+	}
+
+	const Ref<Texture>& ShadowAtlas::GetTexture()
+	{
+		if (!m_texture)
+		{
+			m_texture = Texture::CreateRenderTexture(
+				SHADOW_ATLAS_SIZE,
+				SHADOW_ATLAS_SIZE,
+				Texture::SelectDepthFormat(),
+				FilterMode::Linear,
+				SamplerAddressMode::ClampToEdge);
+		}
+
+		return m_texture;
+	}
+
+	const filament::backend::RenderTargetHandle& ShadowAtlas::GetRenderTarget()
+	{
+		if (!m_render_target)
+		{
+			filament::backend::TargetBufferInfo color = { };
+			filament::backend::TargetBufferInfo depth = { };
+			filament::backend::TargetBufferInfo stencil = { };
+			depth.handle = GetTexture()->GetTexture();
+
+			m_render_target = Engine::Instance()->GetDriverApi().createRenderTarget(
+				filament::backend::TargetBufferFlags::DEPTH,
+				SHADOW_ATLAS_SIZE,
+				SHADOW_ATLAS_SIZE,
+				1,
+				color,
+				depth,
+				stencil);
+		}
+
+		return m_render_target;
+	}
+
+	bool ShadowAtlas::Alloc(int size, Tile& tile)
+	{
+		if (m_nodes.Empty())
+		{
+			int node_count = 0;
+			for (int i = SHADOW_ATLAS_SIZE; i >= SHADOW_ATLAS_MIN_TILE_SIZE; i /= 2)
+			{
+				node_count = node_count * 4 + 1;
+			}
+			m_nodes.Resize(node_count, NODE_FREE);
+		}
+
+		size = Mathf::Clamp(size, SHADOW_ATLAS_MIN_TILE_SIZE, SHADOW_ATLAS_SIZE);
+
+		// fill split nodes first, so free blocks stay whole for larger tiles
+		if (AllocNode(0, 0, 0, SHADOW_ATLAS_SIZE, size, false, tile) >= 0)
+		{
+			return true;
+		}
+		return AllocNode(0, 0, 0, SHADOW_ATLAS_SIZE, size, true, tile) >= 0;
+	}
+
+	int ShadowAtlas::AllocNode(int node, int x, int y, int node_size, int size, bool split, Tile& tile)
+	{
+		char state = m_nodes[node];
+
+		if (node_size == size)
+		{
+			if (state != NODE_FREE)
+			{
+				return -1;
+			}
+
+			m_nodes[node] = NODE_USED;
+			tile.x = x;
+			tile.y = y;
+			tile.size = size;
+			tile.node = node;
+			return node;
+		}
+
+		if (state == NODE_USED || node_size < size || (state == NODE_FREE && !split))
+		{
+			return -1;
+		}
+
+		int half = node_size / 2;
+		for (int i = 0; i < 4; ++i)
+		{
+			int result = AllocNode(node * 4 + 1 + i, x + (i & 1) * half, y + (i >> 1) * half, half, size, split, tile);
+			if (result >= 0)
+			{
+				m_nodes[node] = NODE_SPLIT;
+				return result;
+			}
+		}
+
+		return -1;
+	}
+
+	void ShadowAtlas::Free(Tile& tile)
+	{
+		if (tile.node < 0 || m_nodes.Empty())
+		{
+			return;
+		}
+
+		// merge back into the parent while all four children are free
+		int node = tile.node;
+		m_nodes[node] = NODE_FREE;
+		while (node > 0)
+		{
+			int parent = (node - 1) / 4;
+			for (int i = 0; i < 4; ++i)
+			{
+				if (m_nodes[parent * 4 + 1 + i] != NODE_FREE)
+				{
+					parent = -1;
+					break;
+				}
+			}
+			if (parent < 0)
+			{
+				break;
+			}
+			m_nodes[parent] = NODE_FREE;
+			node = parent;
+		}
+
+		tile = Tile();
+	}
+}
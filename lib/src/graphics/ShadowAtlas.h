@@ -0,0 +1,62 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+#include "memory/Ref.h"
+#include "container/Vector.h"
+#include "private/backend/DriverApi.h"
+
+#define SHADOW_ATLAS_SIZE 4096
+#define SHADOW_ATLAS_MIN_TILE_SIZE 128
+#define SHADOW_ATLAS_MAX_TILE_SIZE 1024
+// shadow atlas tiles redrawn per frame, a point light takes six
+#define SHADOW_ATLAS_UPDATE_BUDGET 12
+
+namespace Viry3D
+{
+	class Texture;
+
+	// depth texture shared by the shadows of spot and point lights,
+	// split into power of two tiles by a quadtree
+	class ShadowAtlas
+	{
+	public:
+		struct Tile
+		{
+			int x = 0;
+			int y = 0;
+			int size = 0;
+			int node = -1;
+		};
+
+		static void Done();
+		static const Ref<Texture>& GetTexture();
+		static const filament::backend::RenderTargetHandle& GetRenderTarget();
+		static bool Alloc(int size, Tile& tile);
+		static void Free(Tile& tile);
+
+	private:
+		static int AllocNode(int node, int x, int y, int node_size, int size, bool split, Tile& tile);
+
+	private:
+		static Ref<Texture> m_texture;
+		static filament::backend::RenderTargetHandle m_render_target;
+		// quadtree nodes, children of node i are 4 * i + 1 to 4 * i + 4
+		static Vector<char> m_nodes;
+	};
+}
@@ -196,8 +196,7 @@ namespace Viry3D
 
 			auto& driver = Engine::Instance()->GetDriverApi();
 
-			Mesh::Vertex* buffer = (Mesh::Vertex*) driver.allocate(vertices.SizeInBytes());
-			Memory::Copy(buffer, vertices.Bytes(), vertices.SizeInBytes());
+			Vector<Mesh::Vertex> buffer = vertices;
 
 			for (const auto& i : m_blend_shape_weights)
 			{
@@ -212,8 +211,14 @@ namespace Viry3D
 							const auto& frame = shape.frames[k];
 
 							buffer[j].vertex += frame.vertices[j] * frame.weight * i.second.weight;
-							buffer[j].normal += frame.normals[j] * frame.weight * i.second.weight;
-							buffer[j].tangent += frame.tangents[j] * frame.weight * i.second.weight;
+							if (frame.normals.Size() > 0)
+							{
+								buffer[j].normal += frame.normals[j] * frame.weight * i.second.weight;
+							}
+							if (frame.tangents.Size() > 0)
+							{
+								buffer[j].tangent += frame.tangents[j] * frame.weight * i.second.weight;
+							}
 						}
 					}
 				}
@@ -229,7 +234,7 @@ namespace Viry3D
 			}
 			if (!m_vb)
 			{
-				m_vb = driver.createVertexBuffer(1, (uint8_t) Shader::AttributeLocation::Count, vertices.Size(), mesh->GetAttributes(), filament::backend::BufferUsage::DYNAMIC);
+				m_vb = driver.createVertexBuffer((uint8_t) mesh->GetVertexStreamCount(), (uint8_t) Shader::AttributeLocation::Count, vertices.Size(), mesh->GetAttributes(), filament::backend::BufferUsage::DYNAMIC);
 				m_vb_vertex_count = vertices.Size();
 			}
 
@@ -257,7 +262,7 @@ namespace Viry3D
 				m_submeshes = submeshes;
 			}
 
-			driver.updateVertexBuffer(m_vb, 0, filament::backend::BufferDescriptor(buffer, vertices.SizeInBytes()), 0);
+			mesh->UpdateVertexStreams(m_vb, buffer);
 		}
     }
 
@@ -271,11 +276,7 @@ namespace Viry3D
 		}
 		else
 		{
-			const auto& mesh = this->GetMesh();
-			if (mesh)
-			{
-				primitives = mesh->GetPrimitives();
-			}
+			primitives = MeshRenderer::GetPrimitives();
 		}
         
         return primitives;
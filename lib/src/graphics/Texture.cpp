@@ -17,10 +17,23 @@
 
 #include "Texture.h"
 #include "Image.h"
+#include "TextureStreamer.h"
 #include "Engine.h"
+#include "Debug.h"
+#include "io/File.h"
+#include "io/MemoryStream.h"
 #include "math/Mathf.h"
 #include "memory/Memory.h"
 
+#define COMPRESSED_RGB_S3TC_DXT1 0x83F0
+#define COMPRESSED_RGBA_S3TC_DXT1 0x83F1
+#define COMPRESSED_RGBA_S3TC_DXT3 0x83F2
+#define COMPRESSED_RGBA_S3TC_DXT5 0x83F3
+#define COMPRESSED_RGB8_ETC2 0x9274
+#define COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2 0x9276
+#define COMPRESSED_RGBA8_ETC2_EAC 0x9278
+#define COMPRESSED_RGBA_ASTC_4x4 0x93B0
+
 namespace Viry3D
 {
 	Ref<Image> Texture::m_shared_white_image;
@@ -171,7 +184,8 @@ namespace Viry3D
         const String& path,
         FilterMode filter_mode,
         SamplerAddressMode wrap_mode,
-        bool gen_mipmap)
+        bool gen_mipmap,
+        bool srgb)
     {
         Ref<Texture> texture;
         
@@ -202,7 +216,8 @@ namespace Viry3D
                     format,
                     filter_mode,
                     wrap_mode,
-                    gen_mipmap);
+                    gen_mipmap,
+                    srgb);
             }
         }
         
@@ -216,7 +231,8 @@ namespace Viry3D
         TextureFormat format,
         FilterMode filter_mode,
         SamplerAddressMode wrap_mode,
-        bool gen_mipmap)
+        bool gen_mipmap,
+        bool srgb)
     {
         Ref<Texture> texture = Texture::CreateTexture2D(
             width,
@@ -230,7 +246,27 @@ namespace Viry3D
         
         if (gen_mipmap)
         {
-            texture->GenMipmaps();
+            auto& driver = Engine::Instance()->GetDriverApi();
+
+            if (driver.canGenerateMipmaps() || format != TextureFormat::R8G8B8A8)
+            {
+                texture->GenMipmaps();
+            }
+            else
+            {
+                // cpu fallback, filtered like the gpu path
+                Ref<Image> image = RefMake<Image>();
+                image->width = width;
+                image->height = height;
+                image->format = ImageFormat::R8G8B8A8;
+                image->data = pixels;
+
+                auto mipmaps = Image::GenerateMipmaps(image, MipmapFilter::Box, srgb);
+                for (int i = 1; i < mipmaps.Size() && i < texture->m_mipmap_level_count; ++i)
+                {
+                    texture->UpdateTexture(mipmaps[i]->data, 0, i, 0, 0, mipmaps[i]->width, mipmaps[i]->height);
+                }
+            }
         }
         
         return texture;
@@ -252,6 +288,22 @@ namespace Viry3D
 				return filament::backend::TextureFormat::DEPTH32F;
 			case TextureFormat::D32S8:
 				return filament::backend::TextureFormat::DEPTH32F_STENCIL8;
+			case TextureFormat::BC1_RGB:
+				return filament::backend::TextureFormat::DXT1_RGB;
+			case TextureFormat::BC1_RGBA:
+				return filament::backend::TextureFormat::DXT1_RGBA;
+			case TextureFormat::BC2:
+				return filament::backend::TextureFormat::DXT3_RGBA;
+			case TextureFormat::BC3:
+				return filament::backend::TextureFormat::DXT5_RGBA;
+			case TextureFormat::ETC2_R8G8B8:
+				return filament::backend::TextureFormat::ETC2_RGB8;
+			case TextureFormat::ETC2_R8G8B8A1:
+				return filament::backend::TextureFormat::ETC2_RGB8_A1;
+			case TextureFormat::ETC2_R8G8B8A8:
+				return filament::backend::TextureFormat::ETC2_EAC_RGBA8;
+			case TextureFormat::ASTC_4x4:
+				return filament::backend::TextureFormat::RGBA_ASTC_4x4;
             default:
 				assert(false);
 				break;
@@ -284,6 +336,215 @@ namespace Viry3D
         }
 		return filament::backend::PixelDataType::UBYTE;
     }
+
+	static filament::backend::CompressedPixelDataType GetCompressedPixelDataType(TextureFormat format)
+	{
+		switch (format)
+		{
+			case TextureFormat::BC1_RGB:
+				return filament::backend::CompressedPixelDataType::DXT1_RGB;
+			case TextureFormat::BC1_RGBA:
+				return filament::backend::CompressedPixelDataType::DXT1_RGBA;
+			case TextureFormat::BC2:
+				return filament::backend::CompressedPixelDataType::DXT3_RGBA;
+			case TextureFormat::BC3:
+				return filament::backend::CompressedPixelDataType::DXT5_RGBA;
+			case TextureFormat::ETC2_R8G8B8:
+				return filament::backend::CompressedPixelDataType::ETC2_RGB8;
+			case TextureFormat::ETC2_R8G8B8A1:
+				return filament::backend::CompressedPixelDataType::ETC2_RGB8_A1;
+			case TextureFormat::ETC2_R8G8B8A8:
+				return filament::backend::CompressedPixelDataType::ETC2_EAC_RGBA8;
+			case TextureFormat::ASTC_4x4:
+				return filament::backend::CompressedPixelDataType::RGBA_ASTC_4x4;
+			default:
+				assert(false);
+				break;
+		}
+		return filament::backend::CompressedPixelDataType::DXT1_RGB;
+	}
+
+	static filament::backend::PixelBufferDescriptor CreatePixelBuffer(TextureFormat format, const ByteBuffer& pixels, int image_size)
+	{
+		void* buffer = Memory::Alloc<void>(pixels.Size());
+		Memory::Copy(buffer, pixels.Bytes(), pixels.Size());
+
+		if (Texture::IsCompressedFormat(format))
+		{
+			return filament::backend::PixelBufferDescriptor(
+				buffer,
+				pixels.Size(),
+				GetCompressedPixelDataType(format),
+				image_size,
+				FreeBufferCallback);
+		}
+
+		return filament::backend::PixelBufferDescriptor(
+			buffer,
+			pixels.Size(),
+			GetPixelDataFormat(format),
+			GetPixelDataType(format),
+			FreeBufferCallback);
+	}
+    
+    struct KTXHeader
+    {
+        byte identifier[12];
+        uint32_t endianness;
+        uint32_t type;
+        uint32_t type_size;
+        uint32_t format;
+        uint32_t internal_format;
+        uint32_t base_internal_format;
+        uint32_t pixel_width;
+        uint32_t pixel_height;
+        uint32_t pixel_depth;
+        uint32_t array_size;
+        uint32_t face_count;
+        uint32_t level_count;
+        uint32_t key_value_data_size;
+    };
+
+    static TextureFormat GetKTXTextureFormat(uint32_t internal_format)
+    {
+        switch (internal_format)
+        {
+            case COMPRESSED_RGB_S3TC_DXT1:
+                return TextureFormat::BC1_RGB;
+            case COMPRESSED_RGBA_S3TC_DXT1:
+                return TextureFormat::BC1_RGBA;
+            case COMPRESSED_RGBA_S3TC_DXT3:
+                return TextureFormat::BC2;
+            case COMPRESSED_RGBA_S3TC_DXT5:
+                return TextureFormat::BC3;
+            case COMPRESSED_RGB8_ETC2:
+                return TextureFormat::ETC2_R8G8B8;
+            case COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2:
+                return TextureFormat::ETC2_R8G8B8A1;
+            case COMPRESSED_RGBA8_ETC2_EAC:
+                return TextureFormat::ETC2_R8G8B8A8;
+            case COMPRESSED_RGBA_ASTC_4x4:
+                return TextureFormat::ASTC_4x4;
+            default:
+                return TextureFormat::None;
+        }
+    }
+
+    Ref<Texture> Texture::LoadFromKTXFile(
+        const String& path,
+        FilterMode filter_mode,
+        SamplerAddressMode wrap_mode)
+    {
+        Ref<Texture> texture;
+
+        if (!File::Exist(path))
+        {
+            Log("ktx file not exist: %s", path.CString());
+            return texture;
+        }
+
+        ByteBuffer file_buffer = File::ReadAllBytes(path);
+        MemoryStream ms(file_buffer);
+
+        const int identifier_size = 12;
+        const byte IDENTIFIER[identifier_size] = {
+            0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A
+        };
+        const uint32_t ENDIAN = 0x04030201;
+
+        // files are written by our own encoder in native byte order, swapped files are rejected
+        KTXHeader header;
+        if (ms.Read(&header, sizeof(header)) != (int) sizeof(header) ||
+            Memory::Compare(header.identifier, IDENTIFIER, identifier_size) != 0 || header.endianness != ENDIAN)
+        {
+            Log("invalid ktx file: %s", path.CString());
+            return texture;
+        }
+
+        TextureFormat format = GetKTXTextureFormat(header.internal_format);
+        if (header.type != 0 || format == TextureFormat::None)
+        {
+            Log("ktx format not support: 0x%x", header.internal_format);
+            return texture;
+        }
+        if (SelectFormat({ format }, false) == TextureFormat::None)
+        {
+            return texture;
+        }
+        if (header.pixel_depth > 1 || header.array_size > 1 || (header.face_count != 1 && header.face_count != 6))
+        {
+            Log("ktx only supports 2d texture and cubemap: %s", path.CString());
+            return texture;
+        }
+
+        ms.Read(nullptr, header.key_value_data_size);
+
+        int width = (int) header.pixel_width;
+        int height = Mathf::Max((int) header.pixel_height, 1);
+        int level_count = Mathf::Max((int) header.level_count, 1);
+        bool cubemap = header.face_count == 6;
+
+        auto& driver = Engine::Instance()->GetDriverApi();
+
+        texture = Ref<Texture>(new Texture());
+        texture->m_width = width;
+        texture->m_height = height;
+        texture->m_mipmap_level_count = level_count;
+        texture->m_array_size = 1;
+        texture->m_cubemap = cubemap;
+        texture->m_format = format;
+        texture->m_filter_mode = filter_mode;
+        texture->m_wrap_mode = wrap_mode;
+        texture->m_texture = driver.createTexture(
+            cubemap ? filament::backend::SamplerType::SAMPLER_CUBEMAP : filament::backend::SamplerType::SAMPLER_2D,
+            texture->m_mipmap_level_count,
+            GetTextureFormat(texture->m_format),
+            1,
+            texture->m_width,
+            texture->m_height,
+            1,
+            filament::backend::TextureUsage::DEFAULT);
+
+        texture->UpdateSampler(false);
+
+        for (int i = 0; i < level_count; ++i)
+        {
+            int level_width = Mathf::Max(width >> i, 1);
+            int level_height = Mathf::Max(height >> i, 1);
+            int face_size = GetCompressedLevelSize(format, level_width, level_height);
+            int face_padding = 3 - ((face_size + 3) % 4);
+
+            ms.Read<uint32_t>();
+
+            ByteBuffer pixels(face_size * header.face_count);
+            Vector<int> offsets(header.face_count);
+            bool truncated = false;
+            for (int j = 0; j < (int) header.face_count; ++j)
+            {
+                offsets[j] = j * face_size;
+                truncated |= ms.Read(&pixels[offsets[j]], face_size) != face_size;
+                ms.Read(nullptr, face_padding);
+            }
+
+            if (truncated)
+            {
+                Log("ktx file truncated: %s", path.CString());
+                texture.reset();
+                break;
+            }
+
+            if (cubemap)
+            {
+                texture->UpdateCubemap(pixels, i, offsets);
+            }
+            else
+            {
+                texture->UpdateTexture(pixels, 0, i, 0, 0, level_width, level_height);
+            }
+        }
+
+        return texture;
+    }
     
     Ref<Texture> Texture::CreateTexture2D(
         int width,
@@ -467,6 +728,46 @@ namespace Viry3D
 		return Texture::SelectFormat({ TextureFormat::D24X8, TextureFormat::D24S8, TextureFormat::D32, TextureFormat::D32S8, TextureFormat::D16 }, true);
 	}
 
+	Vector<String> Texture::GetCompressedFormatFamilies()
+	{
+		Vector<String> families;
+		if (SelectFormat({ TextureFormat::ASTC_4x4 }, false) != TextureFormat::None)
+		{
+			families.Add("astc");
+		}
+		if (SelectFormat({ TextureFormat::ETC2_R8G8B8A8 }, false) != TextureFormat::None)
+		{
+			families.Add("etc2");
+		}
+		if (SelectFormat({ TextureFormat::BC3 }, false) != TextureFormat::None)
+		{
+			families.Add("bc");
+		}
+		return families;
+	}
+
+	bool Texture::IsCompressedFormat(TextureFormat format)
+	{
+		return format >= TextureFormat::BC1_RGB && format <= TextureFormat::ASTC_4x4;
+	}
+
+	int Texture::GetCompressedLevelSize(TextureFormat format, int width, int height)
+	{
+		int block_size = 16;
+		switch (format)
+		{
+			case TextureFormat::BC1_RGB:
+			case TextureFormat::BC1_RGBA:
+			case TextureFormat::ETC2_R8G8B8:
+			case TextureFormat::ETC2_R8G8B8A1:
+				block_size = 8;
+				break;
+			default:
+				break;
+		}
+		return ((width + 3) / 4) * ((height + 3) / 4) * block_size;
+	}
+
     Texture::Texture():
 		m_width(0),
 		m_height(0),
@@ -475,13 +776,21 @@ namespace Viry3D
         m_cubemap(false),
         m_format(TextureFormat::None),
         m_filter_mode(FilterMode::None),
-        m_wrap_mode(SamplerAddressMode::None)
+        m_wrap_mode(SamplerAddressMode::None),
+        m_streamed(false),
+        m_resident_level(0),
+        m_version(0)
     {
         
     }
     
     Texture::~Texture()
     {
+        if (m_streamed)
+        {
+            TextureStreamer::Unregister(this);
+        }
+
         auto& driver = Engine::Instance()->GetDriverApi();
         
         driver.destroyTexture(m_texture);
@@ -498,14 +807,8 @@ namespace Viry3D
             offsets.offsets[i] = face_offsets[i];
         }
         
-        void* buffer = Memory::Alloc<void>(pixels.Size());
-        Memory::Copy(buffer, pixels.Bytes(), pixels.Size());
-        auto data = filament::backend::PixelBufferDescriptor(
-            buffer,
-            pixels.Size(),
-            GetPixelDataFormat(m_format),
-            GetPixelDataType(m_format),
-            FreeBufferCallback);
+        // compressed faces are uploaded one by one, image size is per face
+        auto data = CreatePixelBuffer(m_format, pixels, pixels.Size() / 6);
         driver.updateCubeImage(m_texture, level, std::move(data), offsets);
     }
 
@@ -513,14 +816,7 @@ namespace Viry3D
 	{
 		auto& driver = Engine::Instance()->GetDriverApi();
 
-		void* buffer = Memory::Alloc<void>(pixels.Size());
-		Memory::Copy(buffer, pixels.Bytes(), pixels.Size());
-		auto data = filament::backend::PixelBufferDescriptor(
-			buffer,
-			pixels.Size(),
-			GetPixelDataFormat(m_format),
-			GetPixelDataType(m_format),
-			FreeBufferCallback);
+		auto data = CreatePixelBuffer(m_format, pixels, pixels.Size());
 		driver.updateTexture(m_texture, layer, level, x, y, w, h, std::move(data));
 	}
 
@@ -576,12 +872,95 @@ namespace Viry3D
     
     void Texture::GenMipmaps()
     {
+        // compressed textures ship their own mip chain
+        if (IsCompressedFormat(m_format))
+        {
+            return;
+        }
+
         auto& driver = Engine::Instance()->GetDriverApi();
         
         if (driver.canGenerateMipmaps())
         {
             driver.generateMipmaps(m_texture);
         }
+        else
+        {
+            Log("driver can not generate mipmaps, use Image::GenerateMipmaps instead");
+        }
+    }
+
+    void Texture::SetResidentMipmaps(const Vector<Ref<Image>>& mipmaps, int resident_level)
+    {
+        auto& driver = Engine::Instance()->GetDriverApi();
+
+        const auto& base = mipmaps[resident_level];
+        auto texture = driver.createTexture(
+            filament::backend::SamplerType::SAMPLER_2D,
+            m_mipmap_level_count - resident_level,
+            GetTextureFormat(m_format),
+            1,
+            base->width,
+            base->height,
+            1,
+            filament::backend::TextureUsage::DEFAULT);
+
+        for (int i = resident_level; i < m_mipmap_level_count && i < mipmaps.Size(); ++i)
+        {
+            auto data = CreatePixelBuffer(m_format, mipmaps[i]->data, mipmaps[i]->data.Size());
+            driver.updateTexture(texture, 0, i - resident_level, 0, 0, mipmaps[i]->width, mipmaps[i]->height, std::move(data));
+        }
+
+        if (m_texture)
+        {
+            driver.destroyTexture(m_texture);
+        }
+        m_texture = texture;
+        m_resident_level = resident_level;
+        ++m_version;
+    }
+
+    void Texture::DropResidentLevels(int resident_level)
+    {
+        if (resident_level <= m_resident_level || resident_level >= m_mipmap_level_count)
+        {
+            return;
+        }
+
+        auto& driver = Engine::Instance()->GetDriverApi();
+
+        int width = Mathf::Max(m_width >> resident_level, 1);
+        int height = Mathf::Max(m_height >> resident_level, 1);
+        auto texture = driver.createTexture(
+            filament::backend::SamplerType::SAMPLER_2D,
+            m_mipmap_level_count - resident_level,
+            GetTextureFormat(m_format),
+            1,
+            width,
+            height,
+            1,
+            filament::backend::TextureUsage::DEFAULT);
+
+        // the remaining levels are still on gpu, copy them instead of reloading
+        int offset = resident_level - m_resident_level;
+        for (int i = 0; i < m_mipmap_level_count - resident_level; ++i)
+        {
+            int w = Mathf::Max(width >> i, 1);
+            int h = Mathf::Max(height >> i, 1);
+            driver.copyTexture(
+                texture, 0, i,
+                filament::backend::Offset3D({ 0, 0, 0 }),
+                filament::backend::Offset3D({ w, h, 1 }),
+                m_texture, 0, i + offset,
+                filament::backend::Offset3D({ 0, 0, 0 }),
+                filament::backend::Offset3D({ w, h, 1 }),
+                filament::backend::SamplerMagFilter::NEAREST);
+        }
+
+        driver.destroyTexture(m_texture);
+        m_texture = texture;
+        m_resident_level = resident_level;
+        ++m_version;
     }
     
     void Texture::UpdateSampler(bool depth)
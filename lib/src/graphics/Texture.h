@@ -25,6 +25,7 @@ namespace Viry3D
 {
 	class ByteBuffer;
 	class Image;
+	class TextureStreamer;
 
 	enum class CubemapFace
 	{
@@ -94,7 +95,15 @@ namespace Viry3D
             const String& path,
             FilterMode filter_mode,
             SamplerAddressMode wrap_mode,
-            bool gen_mipmap);
+            bool gen_mipmap,
+            bool srgb = false);
+        // loads a prebuilt mip chain from a compressed ktx 1.1 file, 2d or cubemap,
+        // returns null when the format is not supported by the current backend
+        static Ref<Texture> LoadFromKTXFile(
+            const String& path,
+            FilterMode filter_mode,
+            SamplerAddressMode wrap_mode);
+        // srgb only affects mipmaps generated on the cpu when the driver can not generate them
         static Ref<Texture> CreateTexture2DFromMemory(
             const ByteBuffer& pixels,
             int width,
@@ -102,7 +111,8 @@ namespace Viry3D
             TextureFormat format,
             FilterMode filter_mode,
             SamplerAddressMode wrap_mode,
-            bool gen_mipmap);
+            bool gen_mipmap,
+            bool srgb = false);
         static Ref<Texture> CreateTexture2D(
             int width,
             int height,
@@ -124,6 +134,10 @@ namespace Viry3D
 			SamplerAddressMode wrap_mode);
 		static TextureFormat SelectFormat(const Vector<TextureFormat>& formats, bool render_texture);
 		static TextureFormat SelectDepthFormat();
+		// supported compressed families best first, used as ktx file suffix: astc, etc2, bc
+		static Vector<String> GetCompressedFormatFamilies();
+		static bool IsCompressedFormat(TextureFormat format);
+		static int GetCompressedLevelSize(TextureFormat format, int width, int height);
         virtual ~Texture();
 		void UpdateCubemap(const ByteBuffer& pixels, int level, const Vector<int>& face_offsets);
 		void UpdateTexture(const ByteBuffer& pixels, int layer, int level, int x, int y, int w, int h);
@@ -149,14 +163,22 @@ namespace Viry3D
         int GetMipmapLevelCount() const { return m_mipmap_level_count; }
         int GetArraySize() const { return m_array_size; }
         bool IsCubemap() const { return m_cubemap; }
+        // streamed textures keep only the levels from the resident level down on gpu,
+        // the version changes every time the gpu texture is recreated
+        bool IsStreamed() const { return m_streamed; }
+        int GetResidentLevel() const { return m_resident_level; }
+        int GetVersion() const { return m_version; }
         FilterMode GetFilterMode() const { return m_filter_mode; }
         SamplerAddressMode GetSamplerAddressMode() const { return m_wrap_mode; }
         const filament::backend::TextureHandle& GetTexture() const { return m_texture; }
         const filament::backend::SamplerParams& GetSampler() const { return m_sampler; }
 
     private:
+        friend class TextureStreamer;
         Texture();
         void UpdateSampler(bool depth);
+        void SetResidentMipmaps(const Vector<Ref<Image>>& mipmaps, int resident_level);
+        void DropResidentLevels(int resident_level);
         
 	private:
 		static Ref<Image> m_shared_white_image;
@@ -172,6 +194,9 @@ namespace Viry3D
         TextureFormat m_format;
         FilterMode m_filter_mode;
         SamplerAddressMode m_wrap_mode;
+        bool m_streamed;
+        int m_resident_level;
+        int m_version;
         filament::backend::TextureHandle m_texture;
         filament::backend::SamplerParams m_sampler;
     };
@@ -0,0 +1,685 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "TextureStreamer.h"
+#include "Image.h"
+#include "ImageDecoder.h"
+#include "Camera.h"
+#include "Material.h"
+#include "MeshRenderer.h"
+#include "Engine.h"
+#include "GameObject.h"
+#include "Debug.h"
+#include "io/File.h"
+#include "io/Directory.h"
+#include "io/MappedFile.h"
+#include "thread/ThreadPool.h"
+#include "memory/Memory.h"
+#include "time/Time.h"
+#include "math/Mathf.h"
+#include <functional>
+
+// ktx 1.1 values of an uncompressed rgba8 texture
+#define GL_UNSIGNED_BYTE 0x1401
+#define GL_RGBA 0x1908
+#define GL_RGBA8 0x8058
+
+namespace Viry3D
+{
+	class StreamedMipmaps : public Object
+	{
+	public:
+		Vector<Ref<Image>> mipmaps;
+		bool cached = false;
+	};
+
+	static const int MAX_LOADING_COUNT = 2;
+
+	Map<Texture*, TextureStreamer::StreamedTexture> TextureStreamer::m_textures;
+	bool TextureStreamer::m_enabled = true;
+	int64_t TextureStreamer::m_memory_budget = 256 * 1024 * 1024;
+	int64_t TextureStreamer::m_resident_memory = 0;
+	int64_t TextureStreamer::m_pending_memory = 0;
+	int TextureStreamer::m_min_resident_size = 64;
+	int TextureStreamer::m_load_id = 0;
+	int TextureStreamer::m_loading_count = 0;
+
+	// the mip chain of a source image is written once as an uncompressed ktx file,
+	// levels are read back from it on demand and freed after upload
+	struct MipmapCacheHeader
+	{
+		byte identifier[12];
+		uint32_t endianness;
+		uint32_t type;
+		uint32_t type_size;
+		uint32_t format;
+		uint32_t internal_format;
+		uint32_t base_internal_format;
+		uint32_t pixel_width;
+		uint32_t pixel_height;
+		uint32_t pixel_depth;
+		uint32_t array_size;
+		uint32_t face_count;
+		uint32_t level_count;
+		uint32_t key_value_data_size;
+	};
+
+	// one key value pair holding the source file size, so edited sources rebuild their cache
+	struct MipmapCacheSource
+	{
+		uint32_t size;
+		char key[12];
+		uint32_t source_size;
+	};
+
+	static const byte KTX_IDENTIFIER[12] = {
+		0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A
+	};
+	static const char CACHE_SOURCE_KEY[12] = "source_size";
+
+	static String GetMipmapCachePath(const String& path, bool srgb)
+	{
+		uint64_t hash = (uint64_t) std::hash<std::string>()(path.CString());
+		return String::Format("%s/texture_cache/%016llx%s.ktx", Engine::Instance()->GetSavePath().CString(), (unsigned long long) hash, srgb ? "_srgb" : "");
+	}
+
+	static int GetMipmapCacheLevelOffset(int width, int height, int level)
+	{
+		int offset = sizeof(MipmapCacheHeader) + sizeof(MipmapCacheSource);
+		for (int i = 0; i < level; ++i)
+		{
+			offset += 4 + Mathf::Max(width >> i, 1) * Mathf::Max(height >> i, 1) * 4;
+		}
+		return offset;
+	}
+
+	static bool ReadMipmapCacheInfo(const Ref<MappedFile>& file, int source_size, int& width, int& height, int& level_count)
+	{
+		if (!file || file->GetSize() < (int) (sizeof(MipmapCacheHeader) + sizeof(MipmapCacheSource)))
+		{
+			return false;
+		}
+
+		MipmapCacheHeader header;
+		MipmapCacheSource source;
+		Memory::Copy(&header, file->GetBytes(), sizeof(header));
+		Memory::Copy(&source, file->GetBytes() + sizeof(header), sizeof(source));
+
+		if (Memory::Compare(header.identifier, KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER)) != 0 || header.endianness != 0x04030201 ||
+			header.type != GL_UNSIGNED_BYTE || header.internal_format != GL_RGBA8 || header.face_count != 1 ||
+			header.key_value_data_size != sizeof(source) || Memory::Compare(source.key, CACHE_SOURCE_KEY, sizeof(source.key)) != 0 ||
+			(int) source.source_size != source_size ||
+			header.pixel_width == 0 || header.pixel_height == 0 || header.pixel_width > 16384 || header.pixel_height > 16384)
+		{
+			return false;
+		}
+
+		width = (int) header.pixel_width;
+		height = (int) header.pixel_height;
+		level_count = (int) header.level_count;
+
+		int full_count = 1;
+		while ((width >> full_count) > 0 || (height >> full_count) > 0)
+		{
+			++full_count;
+		}
+
+		return level_count == full_count && GetMipmapCacheLevelOffset(width, height, level_count) <= file->GetSize();
+	}
+
+	// levels below first stay null
+	static Vector<Ref<Image>> ReadMipmapCacheLevels(const Ref<MappedFile>& file, int width, int height, int level_count, int first)
+	{
+		Vector<Ref<Image>> mipmaps(level_count);
+		int offset = GetMipmapCacheLevelOffset(width, height, first);
+		for (int i = first; i < level_count; ++i)
+		{
+			Ref<Image> image = RefMake<Image>();
+			image->width = Mathf::Max(width >> i, 1);
+			image->height = Mathf::Max(height >> i, 1);
+			image->format = ImageFormat::R8G8B8A8;
+			image->data = ByteBuffer(image->width * image->height * 4);
+			Memory::Copy(image->data.Bytes(), file->GetBytes() + offset + 4, image->data.Size());
+			offset += 4 + image->data.Size();
+			mipmaps[i] = image;
+		}
+		return mipmaps;
+	}
+
+	static bool WriteMipmapCache(const String& cache_path, const Vector<Ref<Image>>& mipmaps, int source_size)
+	{
+		const auto& base = mipmaps[0];
+
+		MipmapCacheHeader header;
+		Memory::Zero(&header, sizeof(header));
+		Memory::Copy(header.identifier, KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER));
+		header.endianness = 0x04030201;
+		header.type = GL_UNSIGNED_BYTE;
+		header.type_size = 1;
+		header.format = GL_RGBA;
+		header.internal_format = GL_RGBA8;
+		header.base_internal_format = GL_RGBA;
+		header.pixel_width = base->width;
+		header.pixel_height = base->height;
+		header.face_count = 1;
+		header.level_count = mipmaps.Size();
+		header.key_value_data_size = sizeof(MipmapCacheSource);
+
+		MipmapCacheSource source;
+		source.size = sizeof(source.key) + sizeof(source.source_size);
+		Memory::Copy(source.key, CACHE_SOURCE_KEY, sizeof(source.key));
+		source.source_size = (uint32_t) source_size;
+
+		ByteBuffer buffer(GetMipmapCacheLevelOffset(base->width, base->height, mipmaps.Size()));
+		Memory::Copy(&buffer[0], &header, sizeof(header));
+		Memory::Copy(&buffer[sizeof(header)], &source, sizeof(source));
+
+		int offset = sizeof(header) + sizeof(source);
+		for (int i = 0; i < mipmaps.Size(); ++i)
+		{
+			uint32_t size = (uint32_t) mipmaps[i]->data.Size();
+			Memory::Copy(&buffer[offset], &size, sizeof(size));
+			Memory::Copy(&buffer[offset + 4], mipmaps[i]->data.Bytes(), size);
+			offset += 4 + size;
+		}
+
+		String dir = cache_path.Substring(0, cache_path.LastIndexOf("/"));
+		if (!Directory::Exist(dir))
+		{
+			Directory::Create(dir);
+		}
+		return File::WriteAllBytes(cache_path, buffer);
+	}
+
+	// flat gray levels shown until the chain is built the first time a source is seen
+	static Vector<Ref<Image>> CreatePlaceholderMipmaps(int width, int height, int level_count, int first)
+	{
+		Vector<Ref<Image>> mipmaps(level_count);
+		for (int i = first; i < level_count; ++i)
+		{
+			Ref<Image> image = RefMake<Image>();
+			image->width = Mathf::Max(width >> i, 1);
+			image->height = Mathf::Max(height >> i, 1);
+			image->format = ImageFormat::R8G8B8A8;
+			image->data = ByteBuffer(image->width * image->height * 4);
+			Memory::Set(image->data.Bytes(), 128, image->data.Size());
+			mipmaps[i] = image;
+		}
+		return mipmaps;
+	}
+
+	void TextureStreamer::Init()
+	{
+
+	}
+
+	void TextureStreamer::Done()
+	{
+		m_textures.Clear();
+		m_resident_memory = 0;
+		m_pending_memory = 0;
+		m_loading_count = 0;
+	}
+
+	Ref<Texture> TextureStreamer::LoadTexture2DFromFile(
+		const String& path,
+		FilterMode filter_mode,
+		SamplerAddressMode wrap_mode,
+		bool srgb)
+	{
+		Ref<Texture> texture;
+
+		if (!m_enabled)
+		{
+			return Texture::LoadTexture2DFromFile(path, filter_mode, wrap_mode, true, srgb);
+		}
+
+		auto source = MappedFile::Open(path);
+		if (!source)
+		{
+			Log("image file not exist: %s", path.CString());
+			return texture;
+		}
+		int source_size = source->GetSize();
+		source.reset();
+
+		// a valid cache gives the size and the tail without touching the source image,
+		// otherwise only the image header is read here
+		String cache_path = GetMipmapCachePath(path, srgb);
+		auto cache = MappedFile::Open(cache_path);
+		int width = 0;
+		int height = 0;
+		int level_count = 0;
+		bool cached = ReadMipmapCacheInfo(cache, source_size, width, height, level_count);
+		if (!cached)
+		{
+			ImageDecodeRequest request;
+			request.path = path;
+			request.info_only = true;
+			if (!ImageDecoder::Decode(request))
+			{
+				return texture;
+			}
+			if (request.image->format != ImageFormat::R8G8B8A8)
+			{
+				return Texture::LoadTexture2DFromFile(path, filter_mode, wrap_mode, true, srgb);
+			}
+
+			width = request.image->width;
+			height = request.image->height;
+			level_count = 1;
+			while ((width >> level_count) > 0 || (height >> level_count) > 0)
+			{
+				++level_count;
+			}
+		}
+
+		texture = Ref<Texture>(new Texture());
+		texture->m_width = width;
+		texture->m_height = height;
+		texture->m_mipmap_level_count = level_count;
+		texture->m_array_size = 1;
+		texture->m_cubemap = false;
+		texture->m_format = TextureFormat::R8G8B8A8;
+		texture->m_filter_mode = filter_mode;
+		texture->m_wrap_mode = wrap_mode;
+		texture->m_streamed = true;
+		texture->UpdateSampler(false);
+
+		StreamedTexture entry;
+		entry.texture = texture.get();
+		entry.path = path;
+		entry.cache_path = cache_path;
+		entry.srgb = srgb;
+		entry.cached = cached;
+		entry.tail_level = 0;
+		while (entry.tail_level < level_count - 1 &&
+			Mathf::Max(width >> entry.tail_level, height >> entry.tail_level) > m_min_resident_size)
+		{
+			++entry.tail_level;
+		}
+		entry.requested_level = entry.tail_level;
+		entry.last_request_frame = Time::GetFrameCount();
+		entry.load_id = 0;
+
+		if (cached)
+		{
+			texture->SetResidentMipmaps(ReadMipmapCacheLevels(cache, width, height, level_count, entry.tail_level), entry.tail_level);
+		}
+		else
+		{
+			texture->SetResidentMipmaps(CreatePlaceholderMipmaps(width, height, level_count, entry.tail_level), entry.tail_level);
+		}
+		m_resident_memory += GetMemorySize(entry, entry.tail_level);
+		m_textures.Add(entry.texture, entry);
+
+		if (!cached)
+		{
+			StreamedTexture* added;
+			m_textures.TryGet(entry.texture, &added);
+			BuildMipmapCache(*added, source_size);
+		}
+
+		return texture;
+	}
+
+	void TextureStreamer::BuildMipmapCache(StreamedTexture& entry, int source_size)
+	{
+		Texture* texture = entry.texture;
+		String path = entry.path;
+		String cache_path = entry.cache_path;
+		bool srgb = entry.srgb;
+		int tail_level = entry.tail_level;
+		int load_id = ++m_load_id;
+
+		entry.load_id = load_id;
+		m_loading_count += 1;
+
+		// decodes and filters once, the cache file keeps the chain so only the tail stays in memory
+		Thread::Task task;
+		task.job = [=]() {
+			auto result = RefMake<StreamedMipmaps>();
+			auto image = Image::LoadFromFile(path);
+			if (image && image->format == ImageFormat::R8G8B8A8)
+			{
+				result->mipmaps = Image::GenerateMipmaps(image, MipmapFilter::Kaiser, srgb);
+				result->cached = WriteMipmapCache(cache_path, result->mipmaps, source_size);
+				if (result->cached)
+				{
+					for (int i = 0; i < tail_level; ++i)
+					{
+						result->mipmaps[i].reset();
+					}
+				}
+			}
+			return result;
+		};
+		task.complete = [=](const Ref<Object>& result) {
+			m_loading_count -= 1;
+
+			StreamedTexture* current;
+			if (!m_textures.TryGet(texture, &current) || current->load_id != load_id)
+			{
+				return;
+			}
+			current->load_id = 0;
+
+			const auto& built = RefCast<StreamedMipmaps>(result);
+			if (built->mipmaps.Size() != texture->GetMipmapLevelCount())
+			{
+				Log("texture stream build failed: %s", path.CString());
+				return;
+			}
+
+			if (built->cached)
+			{
+				current->cached = true;
+				texture->SetResidentMipmaps(built->mipmaps, texture->GetResidentLevel());
+			}
+			else
+			{
+				// no writable cache, the texture keeps every level and leaves streaming
+				Log("texture stream cache write failed: %s", cache_path.CString());
+				m_resident_memory -= GetMemorySize(*current, texture->GetResidentLevel());
+				m_textures.Remove(texture);
+				texture->m_streamed = false;
+				texture->SetResidentMipmaps(built->mipmaps, 0);
+			}
+		};
+
+		ThreadPool* thread_pool = Engine::Instance()->GetThreadPool();
+		if (thread_pool)
+		{
+			thread_pool->AddTask(task);
+		}
+		else
+		{
+			task.complete(task.job());
+		}
+	}
+
+	void TextureStreamer::SetEnabled(bool enabled)
+	{
+		m_enabled = enabled;
+	}
+
+	void TextureStreamer::SetMemoryBudget(int64_t bytes)
+	{
+		m_memory_budget = bytes;
+	}
+
+	void TextureStreamer::SetMinResidentSize(int size)
+	{
+		m_min_resident_size = Mathf::Max(size, 1);
+	}
+
+	void TextureStreamer::Unregister(Texture* texture)
+	{
+		const StreamedTexture* entry;
+		if (m_textures.TryGet(texture, &entry))
+		{
+			m_resident_memory -= GetMemorySize(*entry, texture->GetResidentLevel());
+			m_textures.Remove(texture);
+		}
+	}
+
+	int64_t TextureStreamer::GetMemorySize(const StreamedTexture& entry, int resident_level)
+	{
+		int64_t size = 0;
+		for (int i = resident_level; i < entry.texture->GetMipmapLevelCount(); ++i)
+		{
+			int64_t width = Mathf::Max(entry.texture->GetWidth() >> i, 1);
+			int64_t height = Mathf::Max(entry.texture->GetHeight() >> i, 1);
+			size += width * height * 4;
+		}
+		return size;
+	}
+
+	void TextureStreamer::RequestMipmaps(Camera* camera, const List<Renderer*>& renderers)
+	{
+		if (m_textures.Empty())
+		{
+			return;
+		}
+
+		int frame = Time::GetFrameCount();
+		float target_height = (float) camera->GetTargetHeight();
+		float tan_half_fov = tanf(camera->GetFieldOfView() * Mathf::Deg2Rad * 0.5f);
+		const Vector3& camera_pos = camera->GetTransform()->GetPosition();
+
+		for (auto i : renderers)
+		{
+			// renderers without a mesh to measure, e.g. ui and skyboxes, ask for the full texture
+			float uv_per_pixel = 0;
+
+			auto renderer = dynamic_cast<MeshRenderer*>(i);
+			if (renderer && renderer->GetMesh())
+			{
+				const auto& mesh = renderer->GetMesh();
+				const auto& bounds = mesh->GetBounds();
+				const auto& transform = renderer->GetTransform();
+				const Vector3& scale = transform->GetScale();
+				float max_scale = Mathf::Max(fabs(scale.x), Mathf::Max(fabs(scale.y), fabs(scale.z)));
+
+				float pixels_per_unit;
+				if (camera->IsOrthographic())
+				{
+					pixels_per_unit = target_height / (2.0f * camera->GetOrthographicSize());
+				}
+				else
+				{
+					Vector3 center = transform->GetLocalToWorldMatrix().MultiplyPoint3x4((bounds.Min() + bounds.Max()) * 0.5f);
+					float radius = (bounds.Max() - bounds.Min()).Magnitude() * 0.5f * max_scale;
+					float distance = Mathf::Max((center - camera_pos).Magnitude() - radius, camera->GetNearClip());
+					pixels_per_unit = target_height / (2.0f * distance * tan_half_fov);
+				}
+
+				// meshes without uvs are assumed to map the texture once over their bounds
+				float uv_density = mesh->GetUVDensity();
+				if (uv_density <= 0)
+				{
+					uv_density = 1.0f / Mathf::Max((bounds.Max() - bounds.Min()).Magnitude(), 1e-5f);
+				}
+				uv_per_pixel = uv_density / Mathf::Max(max_scale * pixels_per_unit, 1e-5f);
+			}
+
+			const auto& materials = i->GetMaterials();
+			for (int j = 0; j < materials.Size(); ++j)
+			{
+				if (!materials[j])
+				{
+					continue;
+				}
+
+				for (const auto& k : materials[j]->GetProperties())
+				{
+					const auto& texture = k.second.texture;
+					StreamedTexture* entry;
+					if (k.second.type != MaterialProperty::Type::Texture || !texture || !texture->IsStreamed() ||
+						!m_textures.TryGet(texture.get(), &entry))
+					{
+						continue;
+					}
+
+					float texels_per_pixel = uv_per_pixel * Mathf::Max(texture->GetWidth(), texture->GetHeight());
+					int level = 0;
+					if (texels_per_pixel > 1.0f)
+					{
+						level = (int) floor(Mathf::Log2(texels_per_pixel));
+					}
+					level = Mathf::Clamp(level, 0, entry->tail_level);
+
+					if (entry->last_request_frame != frame)
+					{
+						entry->last_request_frame = frame;
+						entry->requested_level = level;
+					}
+					else
+					{
+						entry->requested_level = Mathf::Min(entry->requested_level, level);
+					}
+				}
+			}
+		}
+	}
+
+	void TextureStreamer::Update()
+	{
+		if (!m_enabled || m_textures.Empty())
+		{
+			return;
+		}
+
+		int frame = Time::GetFrameCount();
+
+		// textures on screen this frame missing finer levels, biggest gap first,
+		// textures whose cache is still being built wait for it
+		List<StreamedTexture*> wanted;
+		for (auto& i : m_textures)
+		{
+			auto& entry = i.second;
+			if (entry.cached && entry.load_id == 0 && entry.last_request_frame == frame && entry.requested_level < entry.texture->GetResidentLevel())
+			{
+				wanted.AddLast(&entry);
+			}
+		}
+		wanted.Sort([](StreamedTexture* a, StreamedTexture* b) {
+			return a->texture->GetResidentLevel() - a->requested_level > b->texture->GetResidentLevel() - b->requested_level;
+		});
+
+		for (auto i : wanted)
+		{
+			if (m_loading_count >= MAX_LOADING_COUNT)
+			{
+				break;
+			}
+
+			int64_t required = GetMemorySize(*i, i->requested_level) - GetMemorySize(*i, i->texture->GetResidentLevel());
+			if (m_resident_memory + m_pending_memory + required > m_memory_budget && !Evict(required, frame))
+			{
+				continue;
+			}
+
+			Load(*i, i->requested_level);
+		}
+	}
+
+	bool TextureStreamer::Evict(int64_t required, int frame)
+	{
+		// least recently used first, textures on screen this frame only give up levels they do not need
+		List<StreamedTexture*> candidates;
+		for (auto& i : m_textures)
+		{
+			auto& entry = i.second;
+			if (entry.load_id == 0 && entry.texture->GetResidentLevel() < entry.tail_level)
+			{
+				candidates.AddLast(&entry);
+			}
+		}
+		candidates.Sort([](StreamedTexture* a, StreamedTexture* b) {
+			return a->last_request_frame < b->last_request_frame;
+		});
+
+		for (auto i : candidates)
+		{
+			int resident_level = i->texture->GetResidentLevel();
+			int max_level = i->last_request_frame == frame ? i->requested_level : i->tail_level;
+			if (max_level <= resident_level)
+			{
+				continue;
+			}
+
+			int64_t resident_size = GetMemorySize(*i, resident_level);
+			int level = resident_level + 1;
+			while (level < max_level &&
+				m_resident_memory + m_pending_memory + required - resident_size + GetMemorySize(*i, level) > m_memory_budget)
+			{
+				++level;
+			}
+
+			i->texture->DropResidentLevels(level);
+			m_resident_memory += GetMemorySize(*i, level) - resident_size;
+
+			if (m_resident_memory + m_pending_memory + required <= m_memory_budget)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void TextureStreamer::Load(StreamedTexture& entry, int resident_level)
+	{
+		Texture* texture = entry.texture;
+		String cache_path = entry.cache_path;
+		int width = texture->GetWidth();
+		int height = texture->GetHeight();
+		int level_count = texture->GetMipmapLevelCount();
+		int load_id = ++m_load_id;
+		int64_t required = GetMemorySize(entry, resident_level) - GetMemorySize(entry, texture->GetResidentLevel());
+
+		entry.load_id = load_id;
+		m_loading_count += 1;
+		m_pending_memory += required;
+
+		// reads only the needed levels from the cache, they are freed once uploaded
+		Thread::Task task;
+		task.job = [=]() {
+			auto result = RefMake<StreamedMipmaps>();
+			auto file = MappedFile::Open(cache_path);
+			if (file && GetMipmapCacheLevelOffset(width, height, level_count) <= file->GetSize())
+			{
+				result->mipmaps = ReadMipmapCacheLevels(file, width, height, level_count, resident_level);
+			}
+			return result;
+		};
+		task.complete = [=](const Ref<Object>& result) {
+			m_loading_count -= 1;
+			m_pending_memory -= required;
+
+			// the texture may be gone, or a new one was created at the same address
+			StreamedTexture* current;
+			if (!m_textures.TryGet(texture, &current) || current->load_id != load_id)
+			{
+				return;
+			}
+			current->load_id = 0;
+
+			const auto& mipmaps = RefCast<StreamedMipmaps>(result)->mipmaps;
+			int old_level = texture->GetResidentLevel();
+			if (mipmaps.Size() != level_count || resident_level >= old_level)
+			{
+				return;
+			}
+
+			int64_t old_size = GetMemorySize(*current, old_level);
+			texture->SetResidentMipmaps(mipmaps, resident_level);
+			m_resident_memory += GetMemorySize(*current, resident_level) - old_size;
+		};
+
+		ThreadPool* thread_pool = Engine::Instance()->GetThreadPool();
+		if (thread_pool)
+		{
+			thread_pool->AddTask(task);
+		}
+		else
+		{
+			task.complete(task.job());
+		}
+	}
+}
@@ -0,0 +1,87 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+#include "Texture.h"
+#include "container/Map.h"
+#include "container/List.h"
+
+namespace Viry3D
+{
+	class Camera;
+	class Renderer;
+
+	// keeps only the mips of streamed textures that visible renderers need on gpu.
+	// the finest level wanted is derived from the uv density of the mesh and its size on screen,
+	// the mip chain is built once on the thread pool and cached on disk, finer levels are read from
+	// the cache on demand and the least recently used textures drop their top levels when the memory budget is exceeded.
+	class TextureStreamer
+	{
+	public:
+		static void Init();
+		static void Done();
+		// only the image header is read on the calling thread, the tail comes from the level cache
+		// or shows flat gray until the kaiser filtered chain is built on the thread pool
+		static Ref<Texture> LoadTexture2DFromFile(
+			const String& path,
+			FilterMode filter_mode,
+			SamplerAddressMode wrap_mode,
+			bool srgb);
+		static bool IsEnabled() { return m_enabled; }
+		static void SetEnabled(bool enabled);
+		static int64_t GetMemoryBudget() { return m_memory_budget; }
+		static void SetMemoryBudget(int64_t bytes);
+		static int64_t GetResidentMemory() { return m_resident_memory; }
+		static int GetMinResidentSize() { return m_min_resident_size; }
+		static void SetMinResidentSize(int size);
+		static void RequestMipmaps(Camera* camera, const List<Renderer*>& renderers);
+		static void Update();
+
+	private:
+		friend class Texture;
+
+		struct StreamedTexture
+		{
+			Texture* texture;
+			String path;
+			String cache_path;
+			bool srgb;
+			bool cached;            // the level cache is written
+			int tail_level;         // coarsest level that always stays resident
+			int requested_level;    // finest level wanted by the last request
+			int last_request_frame;
+			int load_id;            // build or load in flight, 0 when idle
+		};
+
+		static void Unregister(Texture* texture);
+		static int64_t GetMemorySize(const StreamedTexture& entry, int resident_level);
+		static void Load(StreamedTexture& entry, int resident_level);
+		static bool Evict(int64_t required, int frame);
+		static void BuildMipmapCache(StreamedTexture& entry, int source_size);
+
+	private:
+		static Map<Texture*, StreamedTexture> m_textures;
+		static bool m_enabled;
+		static int64_t m_memory_budget;
+		static int64_t m_resident_memory;
+		static int64_t m_pending_memory;
+		static int m_min_resident_size;
+		static int m_load_id;
+		static int m_loading_count;
+	};
+}
@@ -0,0 +1,124 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "MappedFile.h"
+#include "File.h"
+#include "Debug.h"
+
+#if VR_WINDOWS
+#include <Windows.h>
+#elif !VR_UWP && !VR_WASM
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define VR_MMAP 1
+#endif
+
+namespace Viry3D
+{
+	MappedFile::MappedFile():
+		m_bytes(nullptr),
+		m_size(0),
+		m_mapped(false)
+#if VR_WINDOWS
+		, m_file(INVALID_HANDLE_VALUE)
+		, m_mapping(nullptr)
+#endif
+	{
+	
+	}
+
+	MappedFile::~MappedFile()
+	{
+		if (m_mapped)
+		{
+#if VR_WINDOWS
+			UnmapViewOfFile(m_bytes);
+			CloseHandle((HANDLE) m_mapping);
+			CloseHandle((HANDLE) m_file);
+#elif VR_MMAP
+			munmap((void*) m_bytes, m_size);
+#endif
+		}
+	}
+
+	Ref<MappedFile> MappedFile::Open(const String& path)
+	{
+		Ref<MappedFile> file = Ref<MappedFile>(new MappedFile());
+
+#if VR_WINDOWS
+		HANDLE handle = CreateFile(path.CString(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (handle != INVALID_HANDLE_VALUE)
+		{
+			LARGE_INTEGER size;
+			if (GetFileSizeEx(handle, &size) && size.QuadPart > 0 && size.QuadPart < 0x7fffffff)
+			{
+				HANDLE mapping = CreateFileMapping(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+				if (mapping)
+				{
+					void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+					if (view)
+					{
+						file->m_file = handle;
+						file->m_mapping = mapping;
+						file->m_bytes = (const byte*) view;
+						file->m_size = (int) size.QuadPart;
+						file->m_mapped = true;
+						return file;
+					}
+					CloseHandle(mapping);
+				}
+			}
+			CloseHandle(handle);
+		}
+#elif VR_MMAP
+		int fd = open(path.CString(), O_RDONLY);
+		if (fd >= 0)
+		{
+			struct stat st;
+			if (fstat(fd, &st) == 0 && st.st_size > 0 && st.st_size < 0x7fffffff)
+			{
+				void* view = mmap(nullptr, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+				if (view != MAP_FAILED)
+				{
+					close(fd);
+
+					file->m_bytes = (const byte*) view;
+					file->m_size = (int) st.st_size;
+					file->m_mapped = true;
+					return file;
+				}
+			}
+			close(fd);
+		}
+#endif
+
+		// no mapping available, fall back to a plain read
+		file->m_buffer = File::ReadAllBytes(path);
+		if (file->m_buffer.Size() == 0)
+		{
+			Log("file open failed: %s", path.CString());
+			return Ref<MappedFile>();
+		}
+
+		file->m_bytes = file->m_buffer.Bytes();
+		file->m_size = file->m_buffer.Size();
+
+		return file;
+	}
+}
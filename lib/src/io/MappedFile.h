@@ -0,0 +1,49 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+#include "string/String.h"
+#include "memory/ByteBuffer.h"
+
+namespace Viry3D
+{
+	// read only view of a whole file, mapped into memory where the platform supports it,
+	// otherwise read into a heap buffer. the bytes stay valid while the object is alive.
+	class MappedFile
+	{
+	public:
+		static Ref<MappedFile> Open(const String& path);
+		~MappedFile();
+		const byte* GetBytes() const { return m_bytes; }
+		int GetSize() const { return m_size; }
+		bool IsMapped() const { return m_mapped; }
+
+	private:
+		MappedFile();
+
+	private:
+		const byte* m_bytes;
+		int m_size;
+		bool m_mapped;
+		ByteBuffer m_buffer;
+#if VR_WINDOWS
+		void* m_file;
+		void* m_mapping;
+#endif
+	};
+}
@@ -172,7 +172,7 @@ namespace Viry3D
 
 	ContainsResult Frustum::ContainsBounds(const Vector3& min, const Vector3& max) const
 	{
-		Vector<Vector3> corners(8);
+		Vector3 corners[8];
 		corners[0] = max;
 		corners[1] = Vector3(min.x, max.y, max.z);
 		corners[2] = Vector3(max.x, min.y, max.z);
@@ -182,45 +182,43 @@ namespace Viry3D
 		corners[6] = Vector3(max.x, min.y, min.z);
 		corners[7] = min;
 
-		return ContainsPoints(corners, nullptr);
+		return ContainsPoints(corners, 8, nullptr);
 	}
 
 	ContainsResult Frustum::ContainsPoints(const Vector<Vector3>& points, const Matrix4x4* matrix) const
 	{
-		Vector<Vector3> ps(points.Size());
-		for (int i = 0; i < points.Size(); ++i)
-		{
-			if (matrix != nullptr)
-			{
-				ps[i] = matrix->MultiplyPoint3x4(points[i]);
-			}
-			else
-			{
-				ps[i] = points[i];
-			}
-		}
+		return ContainsPoints(points.Size() > 0 ? &points[0] : nullptr, points.Size(), matrix);
+	}
 
-		int in_plane_count = 0;
+	ContainsResult Frustum::ContainsPoints(const Vector3* points, int count, const Matrix4x4* matrix) const
+	{
+		// transform each point once and count it against all planes
+		int in_counts[6] = { 0, 0, 0, 0, 0, 0 };
 
-		for (int i = 0; i < 6; ++i)
+		for (int j = 0; j < count; ++j)
 		{
-			int in_count = 0;
+			Vector3 p = matrix != nullptr ? matrix->MultiplyPoint3x4(points[j]) : points[j];
 
-			for (int j = 0; j < ps.Size(); ++j)
+			for (int i = 0; i < 6; ++i)
 			{
-				float dis = DistanceToPlane(ps[j], i);
+				float dis = DistanceToPlane(p, i);
 				if (dis >= 0)
 				{
-					in_count++;
+					in_counts[i]++;
 				}
 			}
+		}
 
+		int in_plane_count = 0;
+
+		for (int i = 0; i < 6; ++i)
+		{
 			// all points in same side to one plane
-			if (in_count == 0)
+			if (in_counts[i] == 0)
 			{
 				return ContainsResult::Out;
 			}
-			else if (in_count == ps.Size())
+			else if (in_counts[i] == count)
 			{
 				in_plane_count++;
 			}
@@ -58,6 +58,7 @@ namespace Viry3D
 		ContainsResult ContainsSphere(const Vector3& center, float radius) const;
 		ContainsResult ContainsBounds(const Vector3& min, const Vector3& max) const;
 		ContainsResult ContainsPoints(const Vector<Vector3>& points, const Matrix4x4* matrix) const;
+		ContainsResult ContainsPoints(const Vector3* points, int count, const Matrix4x4* matrix) const;
 		float DistanceToPlane(const Vector3& point, int plane_index) const;
 
 	private:
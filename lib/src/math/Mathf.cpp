@@ -17,6 +17,7 @@
 
 #include "Mathf.h"
 #include <stdlib.h>
+#include <string.h>
 
 namespace Viry3D
 {
@@ -62,6 +63,93 @@ namespace Viry3D
 		return (int) Round(f);
 	}
 
+	unsigned short Mathf::FloatToHalf(float f)
+	{
+		unsigned int bits;
+		memcpy(&bits, &f, sizeof(bits));
+
+		unsigned int sign = (bits >> 16) & 0x8000;
+		int exponent = (int) ((bits >> 23) & 0xff) - 127 + 15;
+		unsigned int mantissa = bits & 0x007fffff;
+
+		if (((bits >> 23) & 0xff) == 0xff)
+		{
+			// inf or nan
+			return (unsigned short) (sign | 0x7c00 | (mantissa != 0 ? 0x0200 : 0));
+		}
+		else if (exponent >= 31)
+		{
+			// overflow to inf
+			return (unsigned short) (sign | 0x7c00);
+		}
+		else if (exponent <= 0)
+		{
+			// denormal or zero
+			if (exponent < -10)
+			{
+				return (unsigned short) sign;
+			}
+			mantissa |= 0x00800000;
+			int shift = 14 - exponent;
+			unsigned int half_mantissa = mantissa >> shift;
+			if ((mantissa >> (shift - 1)) & 1)
+			{
+				half_mantissa += 1;
+			}
+			return (unsigned short) (sign | half_mantissa);
+		}
+		else
+		{
+			unsigned int half = sign | (exponent << 10) | (mantissa >> 13);
+			// round to nearest, a carry into the exponent is still correct
+			if (mantissa & 0x00001000)
+			{
+				half += 1;
+			}
+			return (unsigned short) half;
+		}
+	}
+
+	float Mathf::HalfToFloat(unsigned short h)
+	{
+		unsigned int sign = (h & 0x8000) << 16;
+		int exponent = (h >> 10) & 0x1f;
+		unsigned int mantissa = h & 0x03ff;
+		unsigned int bits;
+
+		if (exponent == 0)
+		{
+			if (mantissa == 0)
+			{
+				bits = sign;
+			}
+			else
+			{
+				// normalize denormal
+				exponent = 1;
+				while ((mantissa & 0x0400) == 0)
+				{
+					mantissa <<= 1;
+					exponent -= 1;
+				}
+				mantissa &= 0x03ff;
+				bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+			}
+		}
+		else if (exponent == 31)
+		{
+			bits = sign | 0x7f800000 | (mantissa << 13);
+		}
+		else
+		{
+			bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+		}
+
+		float f;
+		memcpy(&f, &bits, sizeof(f));
+		return f;
+	}
+
 	float Mathf::RandomRange(float min, float max)
 	{
 		long long rand_max = (long long) RAND_MAX + 1;
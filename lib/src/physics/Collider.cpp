@@ -0,0 +1,332 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "Collider.h"
+#include "Rigidbody.h"
+#include "Physics.h"
+#include "PhysicsUtil.h"
+#include "GameObject.h"
+#include "Debug.h"
+#include "graphics/Mesh.h"
+
+namespace Viry3D
+{
+    List<Collider*> Collider::m_colliders;
+
+    Collider::Collider():
+        m_trigger(false),
+        m_center(0, 0, 0),
+        m_friction(0.5f),
+        m_restitution(0),
+        m_shape(nullptr),
+        m_child_shape(nullptr),
+        m_object(nullptr),
+        m_rigidbody(nullptr),
+        m_shape_scale(1, 1, 1),
+        m_shape_dirty(false),
+        m_transform_dirty(true),
+        m_in_world(false)
+    {
+        m_colliders.AddLast(this);
+    }
+
+    Collider::~Collider()
+    {
+        this->Release();
+    }
+
+    void Collider::Release()
+    {
+        Physics::Wait();
+        Physics::OnColliderDestroy(this);
+
+        if (m_rigidbody)
+        {
+            m_rigidbody->DestroyBody();
+        }
+        this->DestroyStaticObject();
+        this->DestroyShape();
+
+        m_colliders.Remove(this);
+    }
+
+    void Collider::SetTrigger(bool trigger)
+    {
+        m_trigger = trigger;
+        this->MarkShapeDirty();
+    }
+
+    void Collider::SetCenter(const Vector3& center)
+    {
+        m_center = center;
+        this->MarkShapeDirty();
+    }
+
+    void Collider::SetFriction(float friction)
+    {
+        Physics::Wait();
+
+        m_friction = friction;
+        if (m_object)
+        {
+            this->ApplyMaterial(m_object);
+        }
+        if (m_rigidbody)
+        {
+            m_rigidbody->ApplyProperties();
+        }
+    }
+
+    void Collider::SetRestitution(float restitution)
+    {
+        Physics::Wait();
+
+        m_restitution = restitution;
+        if (m_object)
+        {
+            this->ApplyMaterial(m_object);
+        }
+        if (m_rigidbody)
+        {
+            m_rigidbody->ApplyProperties();
+        }
+    }
+
+    void Collider::OnTransformDirty()
+    {
+        if (!Physics::IsSyncing())
+        {
+            m_transform_dirty = true;
+        }
+    }
+
+    void Collider::MarkShapeDirty()
+    {
+        m_shape_dirty = true;
+    }
+
+    btCollisionShape* Collider::GetShape()
+    {
+        if (m_shape == nullptr)
+        {
+            m_child_shape = this->CreateShape();
+            if (m_child_shape == nullptr)
+            {
+                return nullptr;
+            }
+
+            if (m_center != Vector3::Zero())
+            {
+                auto compound = new btCompoundShape();
+                compound->addChildShape(btTransform(btQuaternion::getIdentity(), ToBullet(m_center)), m_child_shape);
+                m_shape = compound;
+            }
+            else
+            {
+                m_shape = m_child_shape;
+            }
+
+            m_shape_scale = this->GetTransform()->GetScale();
+            m_shape->setLocalScaling(ToBullet(m_shape_scale));
+        }
+
+        return m_shape;
+    }
+
+    void Collider::ApplyMaterial(btCollisionObject* object) const
+    {
+        object->setFriction(m_friction);
+        object->setRestitution(m_restitution);
+
+        int flags = object->getCollisionFlags();
+        if (m_trigger)
+        {
+            flags |= btCollisionObject::CF_NO_CONTACT_RESPONSE;
+        }
+        else
+        {
+            flags &= ~btCollisionObject::CF_NO_CONTACT_RESPONSE;
+        }
+        object->setCollisionFlags(flags);
+    }
+
+    void Collider::UpdateStaticObject()
+    {
+        auto world = (btDiscreteDynamicsWorld*) Physics::GetWorld();
+        auto obj = this->GetGameObject();
+        if (!obj)
+        {
+            return;
+        }
+        bool active = obj->IsActiveInTree();
+
+        if (m_object == nullptr)
+        {
+            if (!active)
+            {
+                return;
+            }
+
+            btCollisionShape* shape = this->GetShape();
+            if (shape == nullptr)
+            {
+                return;
+            }
+
+            m_object = new btCollisionObject();
+            m_object->setCollisionShape(shape);
+            m_object->setUserPointer(this);
+            m_object->setCollisionFlags(btCollisionObject::CF_STATIC_OBJECT);
+            this->ApplyMaterial(m_object);
+            m_transform_dirty = true;
+        }
+
+        if (m_transform_dirty)
+        {
+            const auto& transform = this->GetTransform();
+            m_object->setWorldTransform(ToBullet(transform->GetPosition(), transform->GetRotation()));
+            if (m_in_world)
+            {
+                world->updateSingleAabb(m_object);
+            }
+            m_transform_dirty = false;
+        }
+
+        if (active != m_in_world)
+        {
+            if (active)
+            {
+                world->addCollisionObject(m_object, btBroadphaseProxy::StaticFilter, btBroadphaseProxy::AllFilter ^ btBroadphaseProxy::StaticFilter);
+            }
+            else
+            {
+                world->removeCollisionObject(m_object);
+            }
+            m_in_world = active;
+        }
+    }
+
+    void Collider::DestroyStaticObject()
+    {
+        if (m_object)
+        {
+            auto world = (btDiscreteDynamicsWorld*) Physics::GetWorld();
+            if (m_in_world && world)
+            {
+                world->removeCollisionObject(m_object);
+            }
+            delete m_object;
+            m_object = nullptr;
+        }
+        m_in_world = false;
+    }
+
+    void Collider::DestroyShape()
+    {
+        if (m_shape != m_child_shape)
+        {
+            delete m_shape;
+        }
+        delete m_child_shape;
+        m_shape = nullptr;
+        m_child_shape = nullptr;
+    }
+
+    btCollisionShape* BoxCollider::CreateShape()
+    {
+        return new btBoxShape(ToBullet(m_size * 0.5f));
+    }
+
+    btCollisionShape* SphereCollider::CreateShape()
+    {
+        return new btSphereShape(m_radius);
+    }
+
+    btCollisionShape* CapsuleCollider::CreateShape()
+    {
+        float height = std::max(m_height - m_radius * 2, 0.0f);
+
+        switch (m_direction)
+        {
+            case 0:
+                return new btCapsuleShapeX(m_radius, height);
+            case 2:
+                return new btCapsuleShapeZ(m_radius, height);
+            default:
+                return new btCapsuleShape(m_radius, height);
+        }
+    }
+
+    MeshCollider::MeshCollider():
+        m_convex(false),
+        m_triangles(nullptr)
+    {
+
+    }
+
+    MeshCollider::~MeshCollider()
+    {
+        // the shape references the triangles, release it first
+        this->Release();
+
+        delete (btTriangleMesh*) m_triangles;
+    }
+
+    btCollisionShape* MeshCollider::CreateShape()
+    {
+        delete (btTriangleMesh*) m_triangles;
+        m_triangles = nullptr;
+
+        if (!m_mesh)
+        {
+            return nullptr;
+        }
+
+        // binary meshes drop their cpu data after upload, read it back for the shape
+        if (!m_mesh->LoadCpuData())
+        {
+            Log("MeshCollider needs the mesh vertices kept in memory");
+            return nullptr;
+        }
+
+        const auto& vertices = m_mesh->GetVertices();
+        const auto& indices = m_mesh->GetIndices();
+
+        if (m_convex)
+        {
+            auto hull = new btConvexHullShape();
+            for (int i = 0; i < vertices.Size(); ++i)
+            {
+                hull->addPoint(ToBullet(vertices[i].vertex), false);
+            }
+            hull->recalcLocalAabb();
+            return hull;
+        }
+
+        auto triangles = new btTriangleMesh(true, false);
+        for (int i = 0; i + 2 < indices.Size(); i += 3)
+        {
+            triangles->addTriangle(
+                ToBullet(vertices[indices[i]].vertex),
+                ToBullet(vertices[indices[i + 1]].vertex),
+                ToBullet(vertices[indices[i + 2]].vertex));
+        }
+        m_triangles = triangles;
+
+        return new btBvhTriangleMeshShape(triangles, true);
+    }
+}
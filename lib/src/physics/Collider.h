@@ -0,0 +1,156 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+#include "Component.h"
+#include "container/List.h"
+#include "math/Vector3.h"
+#include <functional>
+
+class btCollisionShape;
+class btCollisionObject;
+
+namespace Viry3D
+{
+    class Rigidbody;
+    class Mesh;
+
+    // shape of a physics object, static unless a Rigidbody is on the same game object
+    class Collider : public Component
+    {
+    public:
+        typedef std::function<void(Collider* other)> OnTrigger;
+
+        Collider();
+        virtual ~Collider();
+        bool IsTrigger() const { return m_trigger; }
+        void SetTrigger(bool trigger);
+        const Vector3& GetCenter() const { return m_center; }
+        void SetCenter(const Vector3& center);
+        float GetFriction() const { return m_friction; }
+        void SetFriction(float friction);
+        float GetRestitution() const { return m_restitution; }
+        void SetRestitution(float restitution);
+        Rigidbody* GetAttachedRigidbody() const { return m_rigidbody; }
+        void SetOnTriggerEnter(OnTrigger func) { m_on_trigger_enter = func; }
+        void SetOnTriggerExit(OnTrigger func) { m_on_trigger_exit = func; }
+
+    protected:
+        virtual btCollisionShape* CreateShape() = 0;
+        virtual bool IsStaticOnly() const { return false; }
+        virtual void OnTransformDirty();
+        void MarkShapeDirty();
+        void Release();
+
+    private:
+        friend class Physics;
+        friend class Rigidbody;
+        btCollisionShape* GetShape();
+        void ApplyMaterial(btCollisionObject* object) const;
+        void UpdateStaticObject();
+        void DestroyStaticObject();
+        void DestroyShape();
+
+    private:
+        static List<Collider*> m_colliders;
+        bool m_trigger;
+        Vector3 m_center;
+        float m_friction;
+        float m_restitution;
+        OnTrigger m_on_trigger_enter;
+        OnTrigger m_on_trigger_exit;
+        btCollisionShape* m_shape;
+        btCollisionShape* m_child_shape;
+        btCollisionObject* m_object;
+        Rigidbody* m_rigidbody;
+        Vector3 m_shape_scale;
+        bool m_shape_dirty;
+        bool m_transform_dirty;
+        bool m_in_world;
+    };
+
+    class BoxCollider : public Collider
+    {
+    public:
+        BoxCollider(): m_size(1, 1, 1) { }
+        const Vector3& GetSize() const { return m_size; }
+        void SetSize(const Vector3& size) { m_size = size; this->MarkShapeDirty(); }
+
+    protected:
+        virtual btCollisionShape* CreateShape();
+
+    private:
+        Vector3 m_size;
+    };
+
+    class SphereCollider : public Collider
+    {
+    public:
+        SphereCollider(): m_radius(0.5f) { }
+        float GetRadius() const { return m_radius; }
+        void SetRadius(float radius) { m_radius = radius; this->MarkShapeDirty(); }
+
+    protected:
+        virtual btCollisionShape* CreateShape();
+
+    private:
+        float m_radius;
+    };
+
+    // height includes both caps, direction is the axis index 0 x, 1 y, 2 z
+    class CapsuleCollider : public Collider
+    {
+    public:
+        CapsuleCollider(): m_radius(0.5f), m_height(2), m_direction(1) { }
+        float GetRadius() const { return m_radius; }
+        void SetRadius(float radius) { m_radius = radius; this->MarkShapeDirty(); }
+        float GetHeight() const { return m_height; }
+        void SetHeight(float height) { m_height = height; this->MarkShapeDirty(); }
+        int GetDirection() const { return m_direction; }
+        void SetDirection(int direction) { m_direction = direction; this->MarkShapeDirty(); }
+
+    protected:
+        virtual btCollisionShape* CreateShape();
+
+    private:
+        float m_radius;
+        float m_height;
+        int m_direction;
+    };
+
+    // triangle meshes only collide as static geometry, set convex to use the hull on rigidbodies
+    class MeshCollider : public Collider
+    {
+    public:
+        MeshCollider();
+        virtual ~MeshCollider();
+        const Ref<Mesh>& GetMesh() const { return m_mesh; }
+        void SetMesh(const Ref<Mesh>& mesh) { m_mesh = mesh; this->MarkShapeDirty(); }
+        bool IsConvex() const { return m_convex; }
+        void SetConvex(bool convex) { m_convex = convex; this->MarkShapeDirty(); }
+
+    protected:
+        virtual btCollisionShape* CreateShape();
+        virtual bool IsStaticOnly() const { return !m_convex; }
+
+    private:
+        Ref<Mesh> m_mesh;
+        bool m_convex;
+        void* m_triangles;
+    };
+}
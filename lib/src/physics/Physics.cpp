@@ -0,0 +1,478 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "Physics.h"
+#include "PhysicsUtil.h"
+#include "Collider.h"
+#include "Rigidbody.h"
+#include "GameObject.h"
+#include "time/Time.h"
+#include "thread/ThreadPool.h"
+#include "container/Vector.h"
+#include <algorithm>
+
+namespace Viry3D
+{
+    struct TriggerPair
+    {
+        Collider* trigger;
+        Collider* other;
+
+        bool operator <(const TriggerPair& pair) const
+        {
+            return trigger == pair.trigger ? other < pair.other : trigger < pair.trigger;
+        }
+
+        bool operator ==(const TriggerPair& pair) const
+        {
+            return trigger == pair.trigger && other == pair.other;
+        }
+    };
+
+    class RaycastCallback : public btCollisionWorld::ClosestRayResultCallback
+    {
+    public:
+        RaycastCallback(const btVector3& from, const btVector3& to, int layer_mask):
+            btCollisionWorld::ClosestRayResultCallback(from, to),
+            m_layer_mask(layer_mask)
+        {
+        }
+
+        virtual bool needsCollision(btBroadphaseProxy* proxy) const
+        {
+            if (!btCollisionWorld::ClosestRayResultCallback::needsCollision(proxy))
+            {
+                return false;
+            }
+
+            auto collider = (Collider*) ((btCollisionObject*) proxy->m_clientObject)->getUserPointer();
+            if (collider == nullptr || collider->IsTrigger())
+            {
+                return false;
+            }
+
+            return (m_layer_mask & (1 << collider->GetGameObject()->GetLayer())) != 0;
+        }
+
+    private:
+        int m_layer_mask;
+    };
+
+    static btDefaultCollisionConfiguration* g_config = nullptr;
+    static btCollisionDispatcher* g_dispatcher = nullptr;
+    static btBroadphaseInterface* g_broadphase = nullptr;
+    static btSequentialImpulseConstraintSolver* g_solver = nullptr;
+    static btDiscreteDynamicsWorld* g_world = nullptr;
+#if !VR_WASM
+    static Ref<Thread> g_thread;
+#endif
+    static float g_time_step = PHYSICS_FIXED_TIME_STEP;
+    static int g_max_sub_steps = PHYSICS_MAX_SUB_STEPS;
+    static float g_accumulator = 0;
+    static float g_alpha = 0;
+    static int g_steps = 0;
+    static bool g_syncing = false;
+    // dynamic bodies handed to the worker, entries of destroyed bodies are nulled
+    static Vector<Rigidbody*> g_bodies;
+    static Vector<TriggerPair> g_triggers;
+    static Vector<TriggerPair> g_last_triggers;
+
+    void Physics::Step()
+    {
+        for (int i = 0; i < g_steps; ++i)
+        {
+            if (i == g_steps - 1)
+            {
+                for (auto body : g_bodies)
+                {
+                    const btTransform& transform = body->m_body->getWorldTransform();
+                    body->m_previous_position = FromBullet(transform.getOrigin());
+                    body->m_previous_rotation = FromBullet(transform.getRotation());
+                }
+            }
+
+            // forces stay on for every step of this frame
+            for (auto body : g_bodies)
+            {
+                if (body->m_force != Vector3::Zero() || body->m_torque != Vector3::Zero())
+                {
+                    body->m_body->applyCentralForce(ToBullet(body->m_force));
+                    body->m_body->applyTorque(ToBullet(body->m_torque));
+                }
+            }
+
+            g_world->stepSimulation(g_time_step, 0, g_time_step);
+        }
+
+        for (auto body : g_bodies)
+        {
+            const btTransform& transform = body->m_body->getWorldTransform();
+            body->m_position = FromBullet(transform.getOrigin());
+            body->m_rotation = FromBullet(transform.getRotation());
+        }
+
+        g_triggers.Clear();
+        int manifold_count = g_dispatcher->getNumManifolds();
+        for (int i = 0; i < manifold_count; ++i)
+        {
+            btPersistentManifold* manifold = g_dispatcher->getManifoldByIndexInternal(i);
+
+            bool touching = false;
+            for (int j = 0; j < manifold->getNumContacts(); ++j)
+            {
+                if (manifold->getContactPoint(j).getDistance() <= 0)
+                {
+                    touching = true;
+                    break;
+                }
+            }
+            if (!touching)
+            {
+                continue;
+            }
+
+            auto a = (Collider*) manifold->getBody0()->getUserPointer();
+            auto b = (Collider*) manifold->getBody1()->getUserPointer();
+            if (a && b)
+            {
+                if (a->IsTrigger())
+                {
+                    g_triggers.Add({ a, b });
+                }
+                if (b->IsTrigger())
+                {
+                    g_triggers.Add({ b, a });
+                }
+            }
+        }
+        std::sort(g_triggers.begin(), g_triggers.end());
+    }
+
+    void Physics::Init()
+    {
+        g_config = new btDefaultCollisionConfiguration();
+        g_dispatcher = new btCollisionDispatcher(g_config);
+        g_broadphase = new btDbvtBroadphase();
+        g_solver = new btSequentialImpulseConstraintSolver();
+        g_world = new btDiscreteDynamicsWorld(g_dispatcher, g_broadphase, g_solver, g_config);
+        g_world->setGravity(btVector3(0, -9.81f, 0));
+
+#if !VR_WASM
+        g_thread = RefMake<Thread>(nullptr, nullptr);
+#endif
+    }
+
+    void Physics::Done()
+    {
+#if !VR_WASM
+        g_thread.reset();
+#endif
+
+        g_bodies.Clear();
+        g_triggers.Clear();
+        g_last_triggers.Clear();
+
+        delete g_world;
+        g_world = nullptr;
+        delete g_solver;
+        g_solver = nullptr;
+        delete g_broadphase;
+        g_broadphase = nullptr;
+        delete g_dispatcher;
+        g_dispatcher = nullptr;
+        delete g_config;
+        g_config = nullptr;
+    }
+
+    void Physics::Wait()
+    {
+#if !VR_WASM
+        if (g_thread)
+        {
+            g_thread->Wait();
+        }
+#endif
+    }
+
+    bool Physics::IsSyncing()
+    {
+        return g_syncing;
+    }
+
+    void Physics::Sync()
+    {
+        if (g_world == nullptr)
+        {
+            return;
+        }
+
+        Physics::Wait();
+
+        // one pass over the stepped bodies, writing the pose between the last two steps
+        g_syncing = true;
+        for (auto body : g_bodies)
+        {
+            if (body == nullptr || body->m_body == nullptr)
+            {
+                continue;
+            }
+
+            body->m_force = Vector3::Zero();
+            body->m_torque = Vector3::Zero();
+
+            if (!body->m_body->isActive())
+            {
+                if (body->m_synced)
+                {
+                    continue;
+                }
+                body->m_synced = true;
+            }
+            else
+            {
+                body->m_synced = false;
+            }
+
+            const auto& transform = body->GetTransform();
+            if (body->m_interpolate && !body->m_synced)
+            {
+                transform->SetPosition(Vector3::Lerp(body->m_previous_position, body->m_position, g_alpha));
+                transform->SetRotation(Quaternion::SLerp(body->m_previous_rotation, body->m_rotation, g_alpha));
+            }
+            else
+            {
+                transform->SetPosition(body->m_position);
+                transform->SetRotation(body->m_rotation);
+            }
+        }
+        g_syncing = false;
+
+        if (g_triggers.Size() == g_last_triggers.Size() && std::equal(g_triggers.begin(), g_triggers.end(), g_last_triggers.begin()))
+        {
+            return;
+        }
+
+        Vector<TriggerPair> enter;
+        Vector<TriggerPair> exit;
+        for (const auto& pair : g_triggers)
+        {
+            if (!std::binary_search(g_last_triggers.begin(), g_last_triggers.end(), pair))
+            {
+                enter.Add(pair);
+            }
+        }
+        for (const auto& pair : g_last_triggers)
+        {
+            if (!std::binary_search(g_triggers.begin(), g_triggers.end(), pair))
+            {
+                exit.Add(pair);
+            }
+        }
+        g_last_triggers = g_triggers;
+
+        for (const auto& pair : exit)
+        {
+            if (pair.trigger->m_on_trigger_exit)
+            {
+                pair.trigger->m_on_trigger_exit(pair.other);
+            }
+        }
+        for (const auto& pair : enter)
+        {
+            if (pair.trigger->m_on_trigger_enter)
+            {
+                pair.trigger->m_on_trigger_enter(pair.other);
+            }
+        }
+    }
+
+    void Physics::Simulate()
+    {
+        if (g_world == nullptr)
+        {
+            return;
+        }
+
+        Physics::Wait();
+
+        for (auto collider : Collider::m_colliders)
+        {
+            if (collider->m_shape_dirty)
+            {
+                if (collider->m_rigidbody)
+                {
+                    collider->m_rigidbody->DestroyBody();
+                }
+                collider->DestroyStaticObject();
+                collider->DestroyShape();
+                collider->m_shape_dirty = false;
+            }
+            else if (collider->m_shape && collider->m_transform_dirty && collider->GetGameObject())
+            {
+                Vector3 scale = collider->GetTransform()->GetScale();
+                if (scale != collider->m_shape_scale)
+                {
+                    collider->m_shape_scale = scale;
+                    collider->m_shape->setLocalScaling(ToBullet(scale));
+                    if (collider->m_rigidbody)
+                    {
+                        collider->m_rigidbody->ApplyProperties();
+                    }
+                }
+            }
+        }
+
+        for (auto rigidbody : Rigidbody::m_rigidbodies)
+        {
+            rigidbody->UpdateBody();
+        }
+
+        for (auto collider : Collider::m_colliders)
+        {
+            if (collider->m_rigidbody == nullptr)
+            {
+                collider->UpdateStaticObject();
+            }
+            collider->m_transform_dirty = false;
+        }
+
+        g_accumulator += Time::GetDeltaTime();
+        g_steps = (int) (g_accumulator / g_time_step);
+        g_accumulator -= g_steps * g_time_step;
+        if (g_steps > g_max_sub_steps)
+        {
+            // too far behind, drop the time instead of spiraling
+            g_steps = g_max_sub_steps;
+        }
+        g_alpha = g_accumulator / g_time_step;
+
+        g_bodies.Clear();
+        for (auto rigidbody : Rigidbody::m_rigidbodies)
+        {
+            if (rigidbody->m_body && rigidbody->m_in_world && !rigidbody->m_kinematic)
+            {
+                g_bodies.Add(rigidbody);
+            }
+        }
+
+        if (g_steps == 0)
+        {
+            return;
+        }
+
+#if !VR_WASM
+        Thread::Task task;
+        task.job = []() {
+            Physics::Step();
+            return Ref<Object>();
+        };
+        g_thread->AddTask(task);
+#else
+        Physics::Step();
+#endif
+    }
+
+    void Physics::OnColliderDestroy(Collider* collider)
+    {
+        auto match = [=](const TriggerPair& pair) {
+            return pair.trigger == collider || pair.other == collider;
+        };
+        for (int i = g_triggers.Size() - 1; i >= 0; --i)
+        {
+            if (match(g_triggers[i]))
+            {
+                g_triggers.Remove(i);
+            }
+        }
+        for (int i = g_last_triggers.Size() - 1; i >= 0; --i)
+        {
+            if (match(g_last_triggers[i]))
+            {
+                g_last_triggers.Remove(i);
+            }
+        }
+    }
+
+    void Physics::OnRigidbodyDestroy(Rigidbody* rigidbody)
+    {
+        for (int i = 0; i < g_bodies.Size(); ++i)
+        {
+            if (g_bodies[i] == rigidbody)
+            {
+                g_bodies[i] = nullptr;
+            }
+        }
+    }
+
+    Vector3 Physics::GetGravity()
+    {
+        return g_world ? FromBullet(g_world->getGravity()) : Vector3::Zero();
+    }
+
+    void Physics::SetGravity(const Vector3& gravity)
+    {
+        Physics::Wait();
+        g_world->setGravity(ToBullet(gravity));
+    }
+
+    float Physics::GetFixedTimeStep()
+    {
+        return g_time_step;
+    }
+
+    void Physics::SetFixedTimeStep(float step)
+    {
+        Physics::Wait();
+        g_time_step = step;
+    }
+
+    int Physics::GetMaxSubSteps()
+    {
+        return g_max_sub_steps;
+    }
+
+    void Physics::SetMaxSubSteps(int count)
+    {
+        g_max_sub_steps = count;
+    }
+
+    bool Physics::Raycast(RaycastHit& hit, const Vector3& origin, const Vector3& direction, float distance, int layer_mask)
+    {
+        Physics::Wait();
+
+        btVector3 from = ToBullet(origin);
+        btVector3 to = ToBullet(origin + Vector3::Normalize(direction) * distance);
+        RaycastCallback callback(from, to, layer_mask);
+        g_world->rayTest(from, to, callback);
+
+        if (!callback.hasHit())
+        {
+            return false;
+        }
+
+        hit.point = FromBullet(callback.m_hitPointWorld);
+        hit.normal = FromBullet(callback.m_hitNormalWorld);
+        hit.distance = callback.m_closestHitFraction * distance;
+        hit.collider = (Collider*) callback.m_collisionObject->getUserPointer();
+        return true;
+    }
+
+    void* Physics::GetWorld()
+    {
+        return g_world;
+    }
+}
@@ -0,0 +1,67 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+#include "math/Vector3.h"
+
+#define PHYSICS_FIXED_TIME_STEP (1.0f / 60)
+#define PHYSICS_MAX_SUB_STEPS 5
+
+namespace Viry3D
+{
+    class Collider;
+    class Rigidbody;
+
+    struct RaycastHit
+    {
+        Vector3 point;
+        Vector3 normal;
+        float distance;
+        Collider* collider;
+    };
+
+    // bullet world stepped at a fixed rate on a worker thread.
+    // Sync runs before the scene update and writes interpolated body transforms back,
+    // Simulate runs after it and kicks the next steps, which overlap with rendering.
+    class Physics
+    {
+    public:
+        static void Init();
+        static void Done();
+        static void Sync();
+        static void Simulate();
+        // blocks until the worker finished its steps, the world is safe to touch after it
+        static void Wait();
+        static bool IsSyncing();
+        static Vector3 GetGravity();
+        static void SetGravity(const Vector3& gravity);
+        static float GetFixedTimeStep();
+        static void SetFixedTimeStep(float step);
+        static int GetMaxSubSteps();
+        static void SetMaxSubSteps(int count);
+        static bool Raycast(RaycastHit& hit, const Vector3& origin, const Vector3& direction, float distance, int layer_mask = -1);
+        static void* GetWorld();
+
+    private:
+        friend class Collider;
+        friend class Rigidbody;
+        static void Step();
+        static void OnColliderDestroy(Collider* collider);
+        static void OnRigidbodyDestroy(Rigidbody* rigidbody);
+    };
+}
@@ -0,0 +1,50 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+#include "math/Vector3.h"
+#include "math/Quaternion.h"
+#include "btBulletDynamicsCommon.h"
+
+namespace Viry3D
+{
+    inline btVector3 ToBullet(const Vector3& v)
+    {
+        return btVector3(v.x, v.y, v.z);
+    }
+
+    inline btQuaternion ToBullet(const Quaternion& q)
+    {
+        return btQuaternion(q.x, q.y, q.z, q.w);
+    }
+
+    inline btTransform ToBullet(const Vector3& position, const Quaternion& rotation)
+    {
+        return btTransform(ToBullet(rotation), ToBullet(position));
+    }
+
+    inline Vector3 FromBullet(const btVector3& v)
+    {
+        return Vector3(v.x(), v.y(), v.z());
+    }
+
+    inline Quaternion FromBullet(const btQuaternion& q)
+    {
+        return Quaternion(q.x(), q.y(), q.z(), q.w());
+    }
+}
@@ -0,0 +1,349 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "Rigidbody.h"
+#include "Collider.h"
+#include "Physics.h"
+#include "PhysicsUtil.h"
+#include "GameObject.h"
+#include "Debug.h"
+
+namespace Viry3D
+{
+    List<Rigidbody*> Rigidbody::m_rigidbodies;
+
+    Rigidbody::Rigidbody():
+        m_mass(1),
+        m_kinematic(false),
+        m_use_gravity(true),
+        m_drag(0),
+        m_angular_drag(0.05f),
+        m_interpolate(true),
+        m_velocity(0, 0, 0),
+        m_angular_velocity(0, 0, 0),
+        m_body(nullptr),
+        m_collider(nullptr),
+        m_force(0, 0, 0),
+        m_torque(0, 0, 0),
+        m_transform_dirty(true),
+        m_in_world(false),
+        m_synced(false)
+    {
+        m_rigidbodies.AddLast(this);
+    }
+
+    Rigidbody::~Rigidbody()
+    {
+        Physics::Wait();
+        Physics::OnRigidbodyDestroy(this);
+
+        this->DestroyBody();
+
+        m_rigidbodies.Remove(this);
+    }
+
+    void Rigidbody::SetMass(float mass)
+    {
+        Physics::Wait();
+        m_mass = mass;
+        this->ApplyProperties();
+    }
+
+    void Rigidbody::SetKinematic(bool kinematic)
+    {
+        Physics::Wait();
+        m_kinematic = kinematic;
+        m_transform_dirty = true;
+        this->ApplyProperties();
+    }
+
+    void Rigidbody::SetUseGravity(bool use_gravity)
+    {
+        Physics::Wait();
+        m_use_gravity = use_gravity;
+        this->ApplyProperties();
+    }
+
+    void Rigidbody::SetDrag(float drag)
+    {
+        Physics::Wait();
+        m_drag = drag;
+        this->ApplyProperties();
+    }
+
+    void Rigidbody::SetAngularDrag(float drag)
+    {
+        Physics::Wait();
+        m_angular_drag = drag;
+        this->ApplyProperties();
+    }
+
+    Vector3 Rigidbody::GetVelocity() const
+    {
+        if (m_body)
+        {
+            Physics::Wait();
+            return FromBullet(m_body->getLinearVelocity());
+        }
+        return m_velocity;
+    }
+
+    void Rigidbody::SetVelocity(const Vector3& velocity)
+    {
+        Physics::Wait();
+        m_velocity = velocity;
+        if (m_body)
+        {
+            m_body->setLinearVelocity(ToBullet(velocity));
+            m_body->activate();
+        }
+    }
+
+    Vector3 Rigidbody::GetAngularVelocity() const
+    {
+        if (m_body)
+        {
+            Physics::Wait();
+            return FromBullet(m_body->getAngularVelocity());
+        }
+        return m_angular_velocity;
+    }
+
+    void Rigidbody::SetAngularVelocity(const Vector3& velocity)
+    {
+        Physics::Wait();
+        m_angular_velocity = velocity;
+        if (m_body)
+        {
+            m_body->setAngularVelocity(ToBullet(velocity));
+            m_body->activate();
+        }
+    }
+
+    void Rigidbody::AddForce(const Vector3& force)
+    {
+        Physics::Wait();
+        m_force += force;
+        this->WakeUp();
+    }
+
+    void Rigidbody::AddTorque(const Vector3& torque)
+    {
+        Physics::Wait();
+        m_torque += torque;
+        this->WakeUp();
+    }
+
+    void Rigidbody::AddForceAtPosition(const Vector3& force, const Vector3& position)
+    {
+        Physics::Wait();
+        m_force += force;
+        if (m_body)
+        {
+            Vector3 arm = position - FromBullet(m_body->getCenterOfMassPosition());
+            m_torque += Vector3(
+                arm.y * force.z - arm.z * force.y,
+                arm.z * force.x - arm.x * force.z,
+                arm.x * force.y - arm.y * force.x);
+        }
+        this->WakeUp();
+    }
+
+    void Rigidbody::WakeUp()
+    {
+        if (m_body)
+        {
+            m_body->activate();
+        }
+    }
+
+    bool Rigidbody::IsSleeping() const
+    {
+        return m_body == nullptr || !m_body->isActive();
+    }
+
+    void Rigidbody::OnTransformDirty()
+    {
+        if (!Physics::IsSyncing())
+        {
+            m_transform_dirty = true;
+        }
+    }
+
+    void Rigidbody::UpdateBody()
+    {
+        auto world = (btDiscreteDynamicsWorld*) Physics::GetWorld();
+        auto obj = this->GetGameObject();
+        if (!obj)
+        {
+            return;
+        }
+        bool active = obj->IsActiveInTree();
+
+        if (m_body == nullptr)
+        {
+            if (!active)
+            {
+                return;
+            }
+
+            auto collider = obj->GetComponent<Collider>();
+            if (!collider)
+            {
+                return;
+            }
+            if (collider->IsStaticOnly())
+            {
+                if (collider->m_object == nullptr)
+                {
+                    Log("Rigidbody can not use a concave MeshCollider, it stays static");
+                }
+                return;
+            }
+
+            btCollisionShape* shape = collider->GetShape();
+            if (shape == nullptr)
+            {
+                return;
+            }
+
+            // the collider was static until now
+            collider->DestroyStaticObject();
+
+            m_collider = collider.get();
+            m_collider->m_rigidbody = this;
+
+            btRigidBody::btRigidBodyConstructionInfo info(0, nullptr, shape);
+            m_body = new btRigidBody(info);
+            m_body->setUserPointer(m_collider);
+            m_body->setLinearVelocity(ToBullet(m_velocity));
+            m_body->setAngularVelocity(ToBullet(m_angular_velocity));
+            m_transform_dirty = true;
+
+            this->ApplyProperties();
+        }
+
+        if (m_transform_dirty)
+        {
+            const auto& transform = this->GetTransform();
+            m_position = transform->GetPosition();
+            m_rotation = transform->GetRotation();
+            m_previous_position = m_position;
+            m_previous_rotation = m_rotation;
+            m_synced = false;
+
+            btTransform world_transform = ToBullet(m_position, m_rotation);
+            m_body->setWorldTransform(world_transform);
+            m_body->setInterpolationWorldTransform(world_transform);
+            m_body->activate();
+            if (m_in_world)
+            {
+                world->updateSingleAabb(m_body);
+            }
+            m_transform_dirty = false;
+        }
+
+        if (active != m_in_world)
+        {
+            if (active)
+            {
+                world->addRigidBody(m_body);
+            }
+            else
+            {
+                world->removeRigidBody(m_body);
+            }
+            m_in_world = active;
+        }
+    }
+
+    void Rigidbody::ApplyProperties()
+    {
+        if (m_body == nullptr)
+        {
+            return;
+        }
+
+        // mass and flags decide the broadphase filter, so re-add the body
+        auto world = (btDiscreteDynamicsWorld*) Physics::GetWorld();
+        if (m_in_world)
+        {
+            world->removeRigidBody(m_body);
+        }
+
+        float mass = m_kinematic ? 0 : m_mass;
+        btVector3 inertia(0, 0, 0);
+        if (mass > 0)
+        {
+            m_body->getCollisionShape()->calculateLocalInertia(mass, inertia);
+        }
+        m_body->setMassProps(mass, inertia);
+        m_body->updateInertiaTensor();
+        m_body->setDamping(m_drag, m_angular_drag);
+
+        m_collider->ApplyMaterial(m_body);
+
+        int flags = m_body->getCollisionFlags() & ~(btCollisionObject::CF_KINEMATIC_OBJECT | btCollisionObject::CF_STATIC_OBJECT);
+        if (m_kinematic)
+        {
+            flags |= btCollisionObject::CF_KINEMATIC_OBJECT;
+            m_body->setActivationState(DISABLE_DEACTIVATION);
+        }
+        else if (m_body->getActivationState() == DISABLE_DEACTIVATION)
+        {
+            m_body->forceActivationState(ACTIVE_TAG);
+        }
+        m_body->setCollisionFlags(flags);
+
+        int body_flags = m_body->getFlags() & ~BT_DISABLE_WORLD_GRAVITY;
+        if (!m_use_gravity)
+        {
+            body_flags |= BT_DISABLE_WORLD_GRAVITY;
+            m_body->setGravity(btVector3(0, 0, 0));
+        }
+        m_body->setFlags(body_flags);
+
+        if (m_in_world)
+        {
+            world->addRigidBody(m_body);
+        }
+        m_body->activate();
+    }
+
+    void Rigidbody::DestroyBody()
+    {
+        if (m_body)
+        {
+            auto world = (btDiscreteDynamicsWorld*) Physics::GetWorld();
+            if (m_in_world && world)
+            {
+                world->removeRigidBody(m_body);
+            }
+            m_velocity = FromBullet(m_body->getLinearVelocity());
+            m_angular_velocity = FromBullet(m_body->getAngularVelocity());
+            delete m_body;
+            m_body = nullptr;
+        }
+        m_in_world = false;
+
+        if (m_collider)
+        {
+            m_collider->m_rigidbody = nullptr;
+            m_collider = nullptr;
+        }
+    }
+}
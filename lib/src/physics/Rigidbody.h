@@ -0,0 +1,92 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+#include "Component.h"
+#include "container/List.h"
+#include "math/Vector3.h"
+#include "math/Quaternion.h"
+
+class btRigidBody;
+
+namespace Viry3D
+{
+    class Collider;
+
+    // dynamic body using the first collider on the same game object
+    class Rigidbody : public Component
+    {
+    public:
+        Rigidbody();
+        virtual ~Rigidbody();
+        float GetMass() const { return m_mass; }
+        void SetMass(float mass);
+        bool IsKinematic() const { return m_kinematic; }
+        void SetKinematic(bool kinematic);
+        bool IsUseGravity() const { return m_use_gravity; }
+        void SetUseGravity(bool use_gravity);
+        float GetDrag() const { return m_drag; }
+        void SetDrag(float drag);
+        float GetAngularDrag() const { return m_angular_drag; }
+        void SetAngularDrag(float drag);
+        bool IsInterpolate() const { return m_interpolate; }
+        void SetInterpolate(bool interpolate) { m_interpolate = interpolate; }
+        Vector3 GetVelocity() const;
+        void SetVelocity(const Vector3& velocity);
+        Vector3 GetAngularVelocity() const;
+        void SetAngularVelocity(const Vector3& velocity);
+        void AddForce(const Vector3& force);
+        void AddTorque(const Vector3& torque);
+        void AddForceAtPosition(const Vector3& force, const Vector3& position);
+        void WakeUp();
+        bool IsSleeping() const;
+
+    protected:
+        virtual void OnTransformDirty();
+
+    private:
+        friend class Physics;
+        friend class Collider;
+        void UpdateBody();
+        void ApplyProperties();
+        void DestroyBody();
+
+    private:
+        static List<Rigidbody*> m_rigidbodies;
+        float m_mass;
+        bool m_kinematic;
+        bool m_use_gravity;
+        float m_drag;
+        float m_angular_drag;
+        bool m_interpolate;
+        Vector3 m_velocity;
+        Vector3 m_angular_velocity;
+        btRigidBody* m_body;
+        Collider* m_collider;
+        Vector3 m_force;
+        Vector3 m_torque;
+        bool m_transform_dirty;
+        bool m_in_world;
+        bool m_synced;
+        // body pose before and after the last fixed step, written by the physics worker
+        Vector3 m_previous_position;
+        Quaternion m_previous_rotation;
+        Vector3 m_position;
+        Quaternion m_rotation;
+    };
+}
@@ -19,6 +19,7 @@
 
 #include "Component.h"
 #include "SpringBone.h"
+#include "SpringSolver.h"
 #include "GameObject.h"
 #include "animation/AnimationCurve.h"
 
@@ -35,6 +36,11 @@ namespace Viry3D
         Vector<String> bone_paths;
         Vector<Ref<SpringBone>> spring_bones;
         
+        virtual ~SpringManager()
+        {
+            SpringSolver::RemoveManager(this);
+        }
+        
         void Init()
         {
             spring_bones.Resize(bone_paths.Size());
@@ -47,17 +53,9 @@ namespace Viry3D
                     spring_bones[i] = bone;
                 }
             }
-        }
-        
-        virtual void LateUpdate()
-        {
-            for (int i = 0; i < spring_bones.Size(); ++i)
-            {
-                if (dynamic_ratio > spring_bones[i]->threshold)
-                {
-                    spring_bones[i]->UpdateSpring();
-                }
-            }
+            
+            // bones are solved in batch with every other manager after the scene update
+            SpringSolver::AddManager(this);
         }
 	};
 }
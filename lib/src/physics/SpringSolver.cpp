@@ -0,0 +1,564 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "SpringSolver.h"
+#include "SpringManager.h"
+#include "SpringBone.h"
+#include "SpringCollider.h"
+#include "GameObject.h"
+#include "time/Time.h"
+#include "Engine.h"
+#include "thread/ThreadPool.h"
+#include "container/Map.h"
+#include <algorithm>
+#include <atomic>
+
+namespace Viry3D
+{
+    Vector<SpringSolver::Chain> SpringSolver::m_chains;
+
+    // frame arrays, one entry per bone of every chain
+    static Vector<int> g_parents;
+    static Vector<char> g_active;
+    static Vector<float> g_ratio;
+    static Vector<Vector3> g_base_position;
+    static Vector<Quaternion> g_base_rotation;
+    static Vector<Vector3> g_base_scale;
+    static Vector<Vector3> g_local_position;
+    static Vector<Quaternion> g_local_rotation;
+    static Vector<Vector3> g_local_scale;
+    static Vector<Vector3> g_bone_axis;
+    static Vector<float> g_stiffness;
+    static Vector<float> g_drag;
+    static Vector<Vector3> g_spring_force;
+    static Vector<float> g_radius;
+    static Vector<float> g_length;
+    static Vector<Vector3> g_curr_tip;
+    static Vector<Vector3> g_prev_tip;
+    static Vector<Vector3> g_world_position;
+    static Vector<Quaternion> g_world_rotation;
+    static Vector<Vector3> g_world_scale;
+    static Vector<Quaternion> g_result_rotation;
+    // collider positions and radii of every chain
+    static Vector<float> g_collider_x;
+    static Vector<float> g_collider_y;
+    static Vector<float> g_collider_z;
+    static Vector<float> g_collider_radius;
+    static std::atomic<int> g_next_chain;
+
+    static inline Vector3 scale_vector(const Vector3& a, const Vector3& b)
+    {
+        return Vector3(a.x * b.x, a.y * b.y, a.z * b.z);
+    }
+
+    static int get_depth(const Ref<Transform>& t)
+    {
+        int depth = 0;
+        auto parent = t->GetParent();
+        while (parent)
+        {
+            depth += 1;
+            parent = parent->GetParent();
+        }
+        return depth;
+    }
+
+    void SpringSolver::Done()
+    {
+        m_chains.Clear();
+    }
+
+    void SpringSolver::AddManager(SpringManager* manager)
+    {
+        for (auto& chain : m_chains)
+        {
+            if (chain.manager == manager)
+            {
+                BuildChain(chain);
+                return;
+            }
+        }
+
+        Chain chain;
+        chain.manager = manager;
+        chain.accumulator = 0;
+        chain.bone_begin = 0;
+        chain.collider_begin = 0;
+        chain.steps = 0;
+        BuildChain(chain);
+        m_chains.Add(chain);
+    }
+
+    void SpringSolver::RemoveManager(SpringManager* manager)
+    {
+        for (int i = 0; i < m_chains.Size(); ++i)
+        {
+            if (m_chains[i].manager == manager)
+            {
+                m_chains.Remove(i);
+                break;
+            }
+        }
+    }
+
+    void SpringSolver::BuildChain(Chain& chain)
+    {
+        chain.bones.Clear();
+        chain.parents.Clear();
+        chain.gaps.Clear();
+        chain.gap_offsets.Clear();
+        chain.colliders.Clear();
+        chain.bone_colliders.Clear();
+        chain.bone_collider_offsets.Clear();
+        chain.source_collider_counts.Clear();
+        chain.source_bone_count = chain.manager->spring_bones.Size();
+
+        Vector<Ref<SpringBone>> sources;
+        Vector<int> depths;
+        for (const auto& bone : chain.manager->spring_bones)
+        {
+            if (bone)
+            {
+                sources.Add(bone);
+                depths.Add(get_depth(bone->GetTransform()));
+            }
+        }
+
+        // stable order by depth puts every parent before its children
+        Vector<int> order(sources.Size());
+        for (int i = 0; i < order.Size(); ++i)
+        {
+            order[i] = i;
+        }
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+            return depths[a] < depths[b];
+        });
+        Vector<Ref<SpringBone>> bones;
+        for (int i = 0; i < order.Size(); ++i)
+        {
+            bones.Add(sources[order[i]]);
+        }
+
+        Map<Transform*, int> bone_indices;
+        for (int i = 0; i < bones.Size(); ++i)
+        {
+            bone_indices.Add(bones[i]->GetTransform().get(), i);
+        }
+
+        Transform* root = chain.manager->GetTransform().get();
+        Map<SpringCollider*, int> collider_indices;
+
+        for (int i = 0; i < bones.Size(); ++i)
+        {
+            const auto& bone = bones[i];
+            chain.bones.Add(bone);
+            chain.source_collider_counts.Add(bone->colliders.Size());
+
+            // walk up to the closest spring bone, remembering the transforms in between
+            int parent = -1;
+            Vector<Ref<Transform>> gap;
+            auto t = bone->GetTransform()->GetParent();
+            while (t && t.get() != root)
+            {
+                int* index;
+                if (bone_indices.TryGet(t.get(), &index))
+                {
+                    parent = *index;
+                    break;
+                }
+                gap.Add(t);
+                t = t->GetParent();
+            }
+
+            chain.parents.Add(parent);
+            chain.gap_offsets.Add(chain.gaps.Size());
+            if (parent >= 0)
+            {
+                for (int j = gap.Size() - 1; j >= 0; --j)
+                {
+                    chain.gaps.Add(gap[j]);
+                }
+            }
+
+            chain.bone_collider_offsets.Add(chain.bone_colliders.Size());
+            for (const auto& weak : bone->colliders)
+            {
+                auto collider = weak.lock();
+                if (!collider)
+                {
+                    continue;
+                }
+
+                int* index;
+                if (!collider_indices.TryGet(collider.get(), &index))
+                {
+                    collider_indices.Add(collider.get(), chain.colliders.Size());
+                    chain.colliders.Add(collider);
+                    collider_indices.TryGet(collider.get(), &index);
+                }
+                chain.bone_colliders.Add(*index);
+            }
+        }
+        chain.gap_offsets.Add(chain.gaps.Size());
+        chain.bone_collider_offsets.Add(chain.bone_colliders.Size());
+    }
+
+    bool SpringSolver::IsChainValid(const Chain& chain)
+    {
+        if (chain.source_bone_count != chain.manager->spring_bones.Size())
+        {
+            return false;
+        }
+
+        for (const auto& weak : chain.colliders)
+        {
+            if (weak.expired())
+            {
+                return false;
+            }
+        }
+
+        for (int i = 0; i < chain.bones.Size(); ++i)
+        {
+            auto bone = chain.bones[i].lock();
+            if (!bone || bone->colliders.Size() != chain.source_collider_counts[i])
+            {
+                return false;
+            }
+
+            // the transforms between the bone and its parent bone must still link up
+            int parent = chain.parents[i];
+            if (parent < 0)
+            {
+                continue;
+            }
+            auto parent_bone = chain.bones[parent].lock();
+            if (!parent_bone)
+            {
+                return false;
+            }
+            Transform* above = parent_bone->GetTransform().get();
+            for (int j = chain.gap_offsets[i]; j < chain.gap_offsets[i + 1]; ++j)
+            {
+                auto gap = chain.gaps[j].lock();
+                if (!gap || gap->GetParent().get() != above)
+                {
+                    return false;
+                }
+                above = gap.get();
+            }
+            if (bone->GetTransform()->GetParent().get() != above)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    void SpringSolver::Gather()
+    {
+        float delta_time = Time::GetDeltaTime();
+        int bone_count = 0;
+        int collider_count = 0;
+
+        for (auto& chain : m_chains)
+        {
+            // colliders or transforms destroyed or moved in the hierarchy since the chain was built
+            if (!IsChainValid(chain))
+            {
+                BuildChain(chain);
+            }
+
+            chain.bone_begin = bone_count;
+            chain.collider_begin = collider_count;
+            bone_count += chain.bones.Size();
+            collider_count += chain.colliders.Size();
+
+            // fixed steps keep the springs independent of the frame rate
+            chain.accumulator += delta_time;
+            chain.steps = (int) floorf(chain.accumulator / SPRING_TIME_STEP + 0.5f);
+            chain.accumulator -= chain.steps * SPRING_TIME_STEP;
+            if (chain.steps > SPRING_MAX_SUB_STEPS)
+            {
+                chain.steps = SPRING_MAX_SUB_STEPS;
+                chain.accumulator = 0;
+            }
+
+            auto obj = chain.manager->GetGameObject();
+            if (!obj || !obj->IsActiveInTree())
+            {
+                chain.steps = -1;
+            }
+        }
+
+        g_parents.Resize(bone_count);
+        g_active.Resize(bone_count);
+        g_ratio.Resize(bone_count);
+        g_base_position.Resize(bone_count);
+        g_base_rotation.Resize(bone_count);
+        g_base_scale.Resize(bone_count);
+        g_local_position.Resize(bone_count);
+        g_local_rotation.Resize(bone_count);
+        g_local_scale.Resize(bone_count);
+        g_bone_axis.Resize(bone_count);
+        g_stiffness.Resize(bone_count);
+        g_drag.Resize(bone_count);
+        g_spring_force.Resize(bone_count);
+        g_radius.Resize(bone_count);
+        g_length.Resize(bone_count);
+        g_curr_tip.Resize(bone_count);
+        g_prev_tip.Resize(bone_count);
+        g_world_position.Resize(bone_count);
+        g_world_rotation.Resize(bone_count);
+        g_world_scale.Resize(bone_count);
+        g_result_rotation.Resize(bone_count);
+        g_collider_x.Resize(collider_count);
+        g_collider_y.Resize(collider_count);
+        g_collider_z.Resize(collider_count);
+        g_collider_radius.Resize(collider_count);
+
+        for (const auto& chain : m_chains)
+        {
+            if (chain.steps < 0)
+            {
+                continue;
+            }
+
+            const SpringManager* manager = chain.manager;
+
+            for (int i = 0; i < chain.colliders.Size(); ++i)
+            {
+                auto collider = chain.colliders[i].lock();
+                const Vector3& position = collider->GetTransform()->GetPosition();
+                int index = chain.collider_begin + i;
+                g_collider_x[index] = position.x;
+                g_collider_y[index] = position.y;
+                g_collider_z[index] = position.z;
+                g_collider_radius[index] = collider->radius;
+            }
+
+            for (int i = 0; i < chain.bones.Size(); ++i)
+            {
+                auto bone = chain.bones[i].lock();
+                const auto& transform = bone->GetTransform();
+                int index = chain.bone_begin + i;
+                int parent = chain.parents[i];
+
+                g_parents[index] = parent >= 0 ? chain.bone_begin + parent : -1;
+                g_active[index] = manager->dynamic_ratio > bone->threshold;
+                g_ratio[index] = manager->dynamic_ratio;
+
+                if (parent >= 0)
+                {
+                    // transforms between the bones, relative to the parent bone
+                    Vector3 position(0, 0, 0);
+                    Quaternion rotation;
+                    Vector3 scale(1, 1, 1);
+                    for (int j = chain.gap_offsets[i]; j < chain.gap_offsets[i + 1]; ++j)
+                    {
+                        auto gap = chain.gaps[j].lock();
+                        position = position + rotation * scale_vector(scale, gap->GetLocalPosition());
+                        rotation = rotation * gap->GetLocalRotation();
+                        scale = scale_vector(scale, gap->GetLocalScale());
+                    }
+                    g_base_position[index] = position;
+                    g_base_rotation[index] = rotation;
+                    g_base_scale[index] = scale;
+                }
+                else
+                {
+                    auto transform_parent = transform->GetParent();
+                    if (transform_parent)
+                    {
+                        g_base_position[index] = transform_parent->GetPosition();
+                        g_base_rotation[index] = transform_parent->GetRotation();
+                        g_base_scale[index] = transform_parent->GetScale();
+                    }
+                    else
+                    {
+                        g_base_position[index] = Vector3(0, 0, 0);
+                        g_base_rotation[index] = Quaternion();
+                        g_base_scale[index] = Vector3(1, 1, 1);
+                    }
+                }
+
+                g_local_position[index] = transform->GetLocalPosition();
+                g_local_rotation[index] = g_active[index] ? bone->local_rotation : transform->GetLocalRotation();
+                g_local_scale[index] = transform->GetLocalScale();
+                g_bone_axis[index] = bone->bone_axis;
+                g_stiffness[index] = bone->stiffness_force;
+                g_drag[index] = bone->drag_force;
+                g_spring_force[index] = bone->spring_force;
+                g_radius[index] = bone->radius;
+                g_length[index] = bone->spring_length;
+                g_curr_tip[index] = bone->curr_tip_pos;
+                g_prev_tip[index] = bone->prev_tip_pos;
+            }
+        }
+    }
+
+    void SpringSolver::Solve(const Chain& chain)
+    {
+        if (chain.steps < 0)
+        {
+            return;
+        }
+
+        const float* collider_x = &g_collider_x[0];
+        const float* collider_y = &g_collider_y[0];
+        const float* collider_z = &g_collider_z[0];
+        const float* collider_radius = &g_collider_radius[0];
+
+        for (int i = 0; i < chain.bones.Size(); ++i)
+        {
+            int index = chain.bone_begin + i;
+            int parent = g_parents[index];
+
+            Vector3 parent_position = g_base_position[index];
+            Quaternion parent_rotation = g_base_rotation[index];
+            Vector3 parent_scale = g_base_scale[index];
+            if (parent >= 0)
+            {
+                parent_position = g_world_position[parent] + g_world_rotation[parent] * scale_vector(g_world_scale[parent], parent_position);
+                parent_rotation = g_world_rotation[parent] * parent_rotation;
+                parent_scale = scale_vector(g_world_scale[parent], parent_scale);
+            }
+
+            Vector3 position = parent_position + parent_rotation * scale_vector(parent_scale, g_local_position[index]);
+            Quaternion rotation = parent_rotation * g_local_rotation[index];
+            Vector3 scale = scale_vector(parent_scale, g_local_scale[index]);
+
+            g_world_position[index] = position;
+            g_world_scale[index] = scale;
+
+            if (!g_active[index])
+            {
+                g_world_rotation[index] = rotation;
+                continue;
+            }
+
+            Vector3 curr = g_curr_tip[index];
+            Vector3 prev = g_prev_tip[index];
+            Vector3 stiffness = rotation * (g_bone_axis[index] * g_stiffness[index]);
+            float drag = g_drag[index];
+            const Vector3& spring_force = g_spring_force[index];
+            float radius = g_radius[index];
+            float length = g_length[index];
+
+            for (int step = 0; step < chain.steps; ++step)
+            {
+                Vector3 force = stiffness + (prev - curr) * drag + spring_force;
+                Vector3 temp = curr;
+
+                // verlet, then keep the tip on the bone length
+                curr = (curr - prev) + curr + force;
+                curr = Vector3::Normalize(curr - position) * length + position;
+
+                for (int j = chain.bone_collider_offsets[i]; j < chain.bone_collider_offsets[i + 1]; ++j)
+                {
+                    int c = chain.collider_begin + chain.bone_colliders[j];
+                    float dx = curr.x - collider_x[c];
+                    float dy = curr.y - collider_y[c];
+                    float dz = curr.z - collider_z[c];
+                    float r = radius + collider_radius[c];
+                    float dist_sq = dx * dx + dy * dy + dz * dz;
+                    if (dist_sq <= r * r)
+                    {
+                        Vector3 center(collider_x[c], collider_y[c], collider_z[c]);
+                        curr = center + Vector3::Normalize(Vector3(dx, dy, dz)) * r;
+                        curr = Vector3::Normalize(curr - position) * length + position;
+                    }
+                }
+
+                prev = temp;
+            }
+
+            g_curr_tip[index] = curr;
+            g_prev_tip[index] = prev;
+
+            Vector3 aim_vector = rotation * scale_vector(scale, g_bone_axis[index]);
+            Quaternion aim_rotation = Quaternion::FromToRotation(aim_vector, curr - position);
+            Quaternion secondary_rotation = aim_rotation * rotation;
+            Quaternion target_rotation = Quaternion::Lerp(rotation, secondary_rotation, g_ratio[index]);
+
+            g_world_rotation[index] = target_rotation;
+            g_result_rotation[index] = Quaternion::Inverse(parent_rotation) * target_rotation;
+        }
+    }
+
+    void SpringSolver::WriteBack()
+    {
+        for (const auto& chain : m_chains)
+        {
+            if (chain.steps < 0)
+            {
+                continue;
+            }
+
+            for (int i = 0; i < chain.bones.Size(); ++i)
+            {
+                int index = chain.bone_begin + i;
+                if (!g_active[index])
+                {
+                    continue;
+                }
+
+                auto bone = chain.bones[i].lock();
+                bone->curr_tip_pos = g_curr_tip[index];
+                bone->prev_tip_pos = g_prev_tip[index];
+                bone->GetTransform()->SetLocalRotation(g_result_rotation[index]);
+            }
+        }
+    }
+
+    void SpringSolver::Update()
+    {
+        if (m_chains.Empty())
+        {
+            return;
+        }
+
+        Gather();
+
+        g_next_chain = 0;
+        auto job = [](int) {
+            while (true)
+            {
+                int index = g_next_chain++;
+                if (index >= m_chains.Size())
+                {
+                    break;
+                }
+                Solve(m_chains[index]);
+            }
+        };
+
+        // the calling thread takes chains too
+        ThreadPool* thread_pool = Engine::Instance() ? Engine::Instance()->GetThreadPool() : nullptr;
+        if (thread_pool)
+        {
+            thread_pool->ParallelRun(m_chains.Size(), job);
+        }
+        else
+        {
+            job(0);
+        }
+
+        WriteBack();
+    }
+}
@@ -0,0 +1,79 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+#include "math/Vector3.h"
+#include "math/Quaternion.h"
+#include "container/Vector.h"
+#include "memory/Ref.h"
+
+#define SPRING_TIME_STEP (1.0f / 60)
+#define SPRING_MAX_SUB_STEPS 4
+
+namespace Viry3D
+{
+    class SpringManager;
+    class SpringBone;
+    class SpringCollider;
+    class Transform;
+
+    // solves the spring bones of every SpringManager once per frame.
+    // bones are gathered into flat arrays, each character is integrated on a worker
+    // at a fixed step, and local rotations are written back in one pass.
+    class SpringSolver
+    {
+    public:
+        static void Done();
+        static void AddManager(SpringManager* manager);
+        static void RemoveManager(SpringManager* manager);
+        static void Update();
+
+    private:
+        struct Chain
+        {
+            SpringManager* manager;
+            // parents come before children
+            Vector<WeakRef<SpringBone>> bones;
+            // index of the parent spring bone in the chain, -1 when the parent is not a spring bone
+            Vector<int> parents;
+            // transforms between a bone and its parent spring bone, flattened
+            Vector<WeakRef<Transform>> gaps;
+            Vector<int> gap_offsets;
+            Vector<WeakRef<SpringCollider>> colliders;
+            Vector<int> bone_colliders;
+            Vector<int> bone_collider_offsets;
+            // sizes of the lists the chain was built from, a change means a rebuild
+            int source_bone_count;
+            Vector<int> source_collider_counts;
+            float accumulator;
+            // ranges in the frame arrays
+            int bone_begin;
+            int collider_begin;
+            int steps;
+        };
+
+        static void BuildChain(Chain& chain);
+        static bool IsChainValid(const Chain& chain);
+        static void Gather();
+        static void Solve(const Chain& chain);
+        static void WriteBack();
+
+    private:
+        static Vector<Chain> m_chains;
+    };
+}
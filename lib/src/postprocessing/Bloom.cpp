@@ -19,6 +19,7 @@
 #include "graphics/Camera.h"
 #include "graphics/Material.h"
 #include "graphics/RenderTarget.h"
+#include "graphics/RenderGraph.h"
 
 namespace Viry3D
 {
@@ -132,4 +133,91 @@ namespace Viry3D
 			RenderTarget::ReleaseTemporaryRenderTarget(levels[i].up);
 		}
 	}
+
+	void Bloom::OnRenderGraph(RenderGraph& graph, int src, int dst)
+	{
+		const int MAX_PYRAMID_SIZE = 16;
+
+		enum Pass
+		{
+			Prefilter13,
+			Downsample13,
+			UpsampleTent,
+			Uber,
+		};
+
+		float ratio = Mathf::Clamp(m_anamorphic_ratio, -1.0f, 1.0f);
+		float rw = ratio < 0 ? -ratio : 0;
+		float rh = ratio > 0 ?  ratio : 0;
+
+		// half res
+		int tw = Mathf::FloorToInt(graph.GetWidth(dst) / (2 - rw));
+		int th = Mathf::FloorToInt(graph.GetHeight(dst) / (2 - rh));
+
+		// determine the iteration count
+		int s = Mathf::Max(tw, th);
+		float logs = Mathf::Log2((float) s) + Mathf::Min(m_diffusion, 10.0f) - 10;
+		int logs_i = Mathf::FloorToInt(logs);
+		int iterations = Mathf::Clamp(logs_i, 1, MAX_PYRAMID_SIZE);
+		float sample_scale = 0.5f + logs - logs_i;
+		m_material->SetFloat("_SampleScale", sample_scale);
+
+		// prefiltering parameters
+		float lthresh = m_threshold;
+		float knee = lthresh * m_soft_knee + 1e-5f;
+		m_material->SetVector("_Threshold", Vector4(lthresh, lthresh - knee, knee * 2, 0.25f / knee));
+		float lclamp = m_clamp;
+		m_material->SetVector("_Params", Vector4(lclamp, 0, 0, 0));
+
+		// each level only lives until the upsample reading it, so the graph can reuse its target
+		auto material = m_material;
+		TextureFormat color_format = graph.GetColorFormat(src);
+
+		// downsample
+		int downs[MAX_PYRAMID_SIZE];
+		int last_down = src;
+		for (int i = 0; i < iterations; i++)
+		{
+			int pass = i == 0 ? (int) Pass::Prefilter13 : (int) Pass::Downsample13;
+
+			downs[i] = graph.Create(tw, th, color_format);
+			graph.AddPass({ last_down }, downs[i], material, pass, [=](RenderGraph& graph) {
+				const auto& texture = graph.GetTarget(last_down)->color;
+				material->SetTexture(MaterialProperty::TEXTURE, texture);
+				material->SetVector("u_texel_size", Vector4(1.0f / texture->GetWidth(), 1.0f / texture->GetHeight(), 0, 0));
+			});
+
+			last_down = downs[i];
+			tw = Mathf::Max(tw / 2, 1);
+			th = Mathf::Max(th / 2, 1);
+		}
+
+		// upsample
+		int last_up = downs[iterations - 1];
+		for (int i = iterations - 2; i >= 0; i--)
+		{
+			int down = downs[i];
+			int up = graph.Create(graph.GetWidth(down), graph.GetHeight(down), color_format);
+			graph.AddPass({ last_up, down }, up, material, (int) Pass::UpsampleTent, [=](RenderGraph& graph) {
+				const auto& texture = graph.GetTarget(last_up)->color;
+				material->SetTexture(MaterialProperty::TEXTURE, texture);
+				material->SetVector("u_texel_size", Vector4(1.0f / texture->GetWidth(), 1.0f / texture->GetHeight(), 0, 0));
+				material->SetTexture("_BloomTex", graph.GetTarget(down)->color);
+			});
+
+			last_up = up;
+		}
+
+		// uber
+		Vector4 settings(sample_scale, m_intensity, 0, (float) iterations);
+		Color color = m_color;
+		graph.AddPass({ src, last_up }, dst, material, (int) Pass::Uber, [=](RenderGraph& graph) {
+			const auto& texture = graph.GetTarget(last_up)->color;
+			material->SetTexture(MaterialProperty::TEXTURE, graph.GetTarget(src)->color);
+			material->SetVector("_Bloom_Settings", settings);
+			material->SetColor("_Bloom_Color", color);
+			material->SetTexture("_BloomTex", texture);
+			material->SetVector("u_texel_size", Vector4(1.0f / texture->GetWidth(), 1.0f / texture->GetHeight(), 0, 0));
+		});
+	}
 }
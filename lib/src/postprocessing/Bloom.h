@@ -30,6 +30,7 @@ namespace Viry3D
 		Bloom();
 		virtual ~Bloom();
 		virtual void OnRenderImage(const Ref<RenderTarget>& src, const Ref<RenderTarget>& dst);
+		virtual void OnRenderGraph(RenderGraph& graph, int src, int dst);
 		void SetIntensity(float intensity) { m_intensity = intensity; }
 		void SetThreshold(float threshold) { m_threshold = threshold; }
 		void SetSoftKnee(float soft_knee) { m_soft_knee = soft_knee; }
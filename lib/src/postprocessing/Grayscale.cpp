@@ -19,6 +19,7 @@
 #include "graphics/Camera.h"
 #include "graphics/Material.h"
 #include "graphics/RenderTarget.h"
+#include "graphics/RenderGraph.h"
 
 namespace Viry3D
 {
@@ -37,4 +38,12 @@ namespace Viry3D
 		m_material->SetTexture(MaterialProperty::TEXTURE, src->color);
 		Camera::Blit(src, dst, m_material);
 	}
+
+	void Grayscale::OnRenderGraph(RenderGraph& graph, int src, int dst)
+	{
+		auto material = m_material;
+		graph.AddPass({ src }, dst, material, -1, [=](RenderGraph& graph) {
+			material->SetTexture(MaterialProperty::TEXTURE, graph.GetTarget(src)->color);
+		});
+	}
 }
@@ -29,6 +29,7 @@ namespace Viry3D
 		Grayscale();
 		virtual ~Grayscale();
 		virtual void OnRenderImage(const Ref<RenderTarget>& src, const Ref<RenderTarget>& dst);
+		virtual void OnRenderGraph(RenderGraph& graph, int src, int dst);
 
 	private:
 		Ref<Material> m_material;
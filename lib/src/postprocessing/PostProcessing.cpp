@@ -17,6 +17,7 @@
 
 #include "PostProcessing.h"
 #include "graphics/Camera.h"
+#include "graphics/RenderGraph.h"
 
 namespace Viry3D
 {
@@ -34,4 +35,14 @@ namespace Viry3D
 	{
 		Camera::Blit(src, dst);
 	}
+
+	void PostProcessing::OnRenderGraph(RenderGraph& graph, int src, int dst)
+	{
+		Ref<Texture> depth = this->GetCameraDepthTexture();
+		graph.AddPass({ src }, dst, [=](RenderGraph& graph) {
+			this->SetCameraDepthTexture(depth);
+			this->OnRenderImage(graph.GetTarget(src), graph.GetTarget(dst));
+			this->SetCameraDepthTexture(Ref<Texture>());
+		});
+	}
 }
@@ -22,6 +22,7 @@
 namespace Viry3D
 {
 	class RenderTarget;
+	class RenderGraph;
 	class Texture;
 
 	class PostProcessing : public Component
@@ -30,6 +31,8 @@ namespace Viry3D
 		PostProcessing();
 		virtual ~PostProcessing();
 		virtual void OnRenderImage(const Ref<RenderTarget>& src, const Ref<RenderTarget>& dst);
+		// adds the passes from src to dst, by default one pass running OnRenderImage
+		virtual void OnRenderGraph(RenderGraph& graph, int src, int dst);
 
 	protected:
 		friend class Camera;
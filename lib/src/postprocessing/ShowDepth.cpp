@@ -20,6 +20,7 @@
 #include "graphics/Camera.h"
 #include "graphics/Material.h"
 #include "graphics/RenderTarget.h"
+#include "graphics/RenderGraph.h"
 
 namespace Viry3D
 {
@@ -34,6 +35,21 @@ namespace Viry3D
 	}
 
 	void ShowDepth::OnRenderImage(const Ref<RenderTarget>& src, const Ref<RenderTarget>& dst)
+	{
+		this->SetMaterialParams();
+
+		Camera::Blit(src, dst, m_material);
+	}
+
+	void ShowDepth::OnRenderGraph(RenderGraph& graph, int, int dst)
+	{
+		// only the camera depth is shown, so the passes writing src get culled
+		this->SetMaterialParams();
+
+		graph.AddPass({ }, dst, m_material, -1, RenderGraph::PassFunc());
+	}
+
+	void ShowDepth::SetMaterialParams()
 	{
 		m_material->SetTexture(MaterialProperty::TEXTURE, this->GetCameraDepthTexture());
 
@@ -43,7 +59,5 @@ namespace Viry3D
 		float zc0 = (1.0f - far_clip / near_clip) / 2.0f;
 		float zc1 = (1.0f + far_clip / near_clip) / 2.0f;
 		m_material->SetVector("_ZBufferParams", Vector4(zc0, zc1, zc0 / far_clip, zc1 / far_clip));
-
-		Camera::Blit(src, dst, m_material);
 	}
 }
@@ -29,6 +29,10 @@ namespace Viry3D
 		ShowDepth();
 		virtual ~ShowDepth();
 		virtual void OnRenderImage(const Ref<RenderTarget>& src, const Ref<RenderTarget>& dst);
+		virtual void OnRenderGraph(RenderGraph& graph, int src, int dst);
+
+	private:
+		void SetMaterialParams();
 
 	private:
 		Ref<Material> m_material;
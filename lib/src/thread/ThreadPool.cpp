@@ -18,6 +18,7 @@
 #include "ThreadPool.h"
 #include "Object.h"
 #include "Engine.h"
+#include "math/Mathf.h"
 
 namespace Viry3D
 {
@@ -140,6 +141,61 @@ namespace Viry3D
 		}
 	}
 
+	void ThreadPool::ParallelRun(int worker_count, const std::function<void(int worker)>& job)
+	{
+		struct ParallelState
+		{
+			std::function<void(int)> job;
+			Mutex mutex;
+			std::condition_variable condition;
+			int running = 0;
+			bool closed = false;
+		};
+
+		worker_count = Mathf::Min(worker_count, m_threads.Size() + 1);
+		if (worker_count <= 1)
+		{
+			job(0);
+			return;
+		}
+
+		auto state = RefMake<ParallelState>();
+		state->job = job;
+
+		for (int i = 1; i < worker_count; ++i)
+		{
+			Thread::Task task;
+			task.job = [=]() {
+				{
+					std::lock_guard<Mutex> lock(state->mutex);
+					if (state->closed)
+					{
+						return Ref<Object>();
+					}
+					state->running += 1;
+				}
+
+				state->job(i);
+
+				std::lock_guard<Mutex> lock(state->mutex);
+				state->running -= 1;
+				state->condition.notify_one();
+				return Ref<Object>();
+			};
+			this->AddTask(task, i - 1);
+		}
+
+		job(0);
+
+		// the work is taken by now, so only wait for workers already running it,
+		// queued ones may sit behind long jobs of other users of the pool
+		std::unique_lock<Mutex> lock(state->mutex);
+		state->closed = true;
+		state->condition.wait(lock, [&]() {
+			return state->running == 0;
+		});
+	}
+
     void ThreadPool::AddTask(const Thread::Task& task, int thread_index)
     {
         if (thread_index >= 0 && thread_index < m_threads.Size())
@@ -69,6 +69,9 @@ namespace Viry3D
 		void WaitAll();
 		int GetThreadCount() const { return m_threads.Size(); }
         void AddTask(const Thread::Task& task, int thread_index = -1);
+		// runs job on the calling thread as worker 0 and on up to worker_count - 1 pool threads,
+		// jobs must take their work from a shared counter, workers starting after the calling thread's job returns are skipped
+		void ParallelRun(int worker_count, const std::function<void(int worker)>& job);
 
 	private:
 		Vector<Ref<Thread>> m_threads;
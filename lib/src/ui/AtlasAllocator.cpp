@@ -0,0 +1,245 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "AtlasAllocator.h"
+#include <assert.h>
+
+// shelf heights are rounded up so glyphs of similar size share shelves
+#define SHELF_HEIGHT_ALIGN 4
+// a rect may use a shelf up to this much taller than itself, in percent
+#define SHELF_HEIGHT_WASTE 50
+
+namespace Viry3D
+{
+    AtlasAllocator::AtlasAllocator(int width, int height, int padding):
+        m_width(width),
+        m_height(height),
+        m_padding(padding),
+        m_shelves_bottom(0),
+        m_used_area(0)
+    {
+    
+    }
+
+    void AtlasAllocator::Clear()
+    {
+        m_shelves.Clear();
+        m_shelves_bottom = 0;
+        m_used_area = 0;
+    }
+
+    int AtlasAllocator::GetAllocatedArea() const
+    {
+        return m_shelves_bottom * m_width;
+    }
+
+    int AtlasAllocator::FindShelf(int w, int h, int& span_index) const
+    {
+        int best_shelf = -1;
+        int best_score = 0x7fffffff;
+
+        for (int i = 0; i < m_shelves.Size(); ++i)
+        {
+            const auto& shelf = m_shelves[i];
+
+            // empty shelves take any rect that fits, the others only rects of a similar height
+            bool empty = shelf.used_w == 0;
+            if (shelf.h < h || (!empty && shelf.h * 100 > h * (100 + SHELF_HEIGHT_WASTE)))
+            {
+                continue;
+            }
+
+            for (int j = 0; j < shelf.free_spans.Size(); ++j)
+            {
+                const auto& span = shelf.free_spans[j];
+                if (span.w < w)
+                {
+                    continue;
+                }
+
+                // best fit on wasted height first, then on the remaining span width
+                int score = (shelf.h - h) * m_width + (span.w - w);
+                if (score < best_score)
+                {
+                    best_score = score;
+                    best_shelf = i;
+                    span_index = j;
+                }
+            }
+        }
+
+        return best_shelf;
+    }
+
+    bool AtlasAllocator::Allocate(int w, int h, Recti& rect)
+    {
+        int padded_w = w + m_padding;
+        int padded_h = h + m_padding;
+
+        if (w <= 0 || h <= 0 || padded_w > m_width || padded_h > m_height)
+        {
+            return false;
+        }
+
+        int span_index = -1;
+        int shelf_index = this->FindShelf(padded_w, padded_h, span_index);
+
+        int shelf_h = (padded_h + SHELF_HEIGHT_ALIGN - 1) / SHELF_HEIGHT_ALIGN * SHELF_HEIGHT_ALIGN;
+
+        if (shelf_index >= 0)
+        {
+            // cut a reused empty shelf down to size, the rest stays an empty shelf
+            auto& shelf = m_shelves[shelf_index];
+            if (shelf.used_w == 0 && shelf.h > shelf_h)
+            {
+                Shelf rest;
+                rest.y = shelf.y + shelf_h;
+                rest.h = shelf.h - shelf_h;
+                rest.used_w = 0;
+                rest.free_spans.Add({ 0, m_width });
+
+                shelf.h = shelf_h;
+                m_shelves.Add(rest);
+            }
+        }
+        else
+        {
+            if (m_shelves_bottom + shelf_h > m_height)
+            {
+                shelf_h = padded_h;
+            }
+            if (m_shelves_bottom + shelf_h > m_height)
+            {
+                return false;
+            }
+
+            Shelf shelf;
+            shelf.y = m_shelves_bottom;
+            shelf.h = shelf_h;
+            shelf.used_w = 0;
+            shelf.free_spans.Add({ 0, m_width });
+            m_shelves.Add(shelf);
+            m_shelves_bottom += shelf_h;
+
+            shelf_index = m_shelves.Size() - 1;
+            span_index = 0;
+        }
+
+        auto& shelf = m_shelves[shelf_index];
+        auto& span = shelf.free_spans[span_index];
+
+        rect = Recti(span.x, shelf.y, w, h);
+
+        span.x += padded_w;
+        span.w -= padded_w;
+        if (span.w == 0)
+        {
+            shelf.free_spans.Remove(span_index);
+        }
+
+        shelf.used_w += padded_w;
+        m_used_area += w * h;
+
+        return true;
+    }
+
+    void AtlasAllocator::Free(const Recti& rect)
+    {
+        int padded_w = rect.w + m_padding;
+
+        for (int i = 0; i < m_shelves.Size(); ++i)
+        {
+            auto& shelf = m_shelves[i];
+            if (shelf.y != rect.y)
+            {
+                continue;
+            }
+
+            Span freed = { rect.x, padded_w };
+
+            // merge with the neighbour spans
+            for (int j = shelf.free_spans.Size() - 1; j >= 0; --j)
+            {
+                const auto& span = shelf.free_spans[j];
+                if (span.x + span.w == freed.x)
+                {
+                    freed.x = span.x;
+                    freed.w += span.w;
+                    shelf.free_spans.Remove(j);
+                }
+                else if (freed.x + freed.w == span.x)
+                {
+                    freed.w += span.w;
+                    shelf.free_spans.Remove(j);
+                }
+            }
+            shelf.free_spans.Add(freed);
+
+            shelf.used_w -= padded_w;
+            m_used_area -= rect.w * rect.h;
+
+            assert(shelf.used_w >= 0);
+
+            if (shelf.used_w == 0)
+            {
+                this->MergeEmptyShelves();
+            }
+            return;
+        }
+
+        assert(false);
+    }
+
+    void AtlasAllocator::MergeEmptyShelves()
+    {
+        // shelves are not kept in y order, join empty shelves touching each other
+        // so they can hold taller rects again
+        bool merged = true;
+        while (merged)
+        {
+            merged = false;
+
+            for (int i = 0; i < m_shelves.Size() && !merged; ++i)
+            {
+                if (m_shelves[i].used_w != 0)
+                {
+                    continue;
+                }
+
+                // give an empty bottom shelf back to the free area
+                if (m_shelves[i].y + m_shelves[i].h == m_shelves_bottom)
+                {
+                    m_shelves_bottom = m_shelves[i].y;
+                    m_shelves.Remove(i);
+                    merged = true;
+                    break;
+                }
+
+                for (int j = 0; j < m_shelves.Size(); ++j)
+                {
+                    if (m_shelves[j].used_w == 0 && m_shelves[i].y + m_shelves[i].h == m_shelves[j].y)
+                    {
+                        m_shelves[i].h += m_shelves[j].h;
+                        m_shelves.Remove(j);
+                        merged = true;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,66 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+#include "container/Vector.h"
+#include "math/Recti.h"
+
+namespace Viry3D
+{
+    // shelf packer for the ui atlas, freed rects go back to their shelf and are reused
+    class AtlasAllocator
+    {
+    public:
+        AtlasAllocator(int width, int height, int padding);
+        bool Allocate(int w, int h, Recti& rect);
+        void Free(const Recti& rect);
+        void Clear();
+        int GetWidth() const { return m_width; }
+        int GetHeight() const { return m_height; }
+        // area covered by shelves, including the free spans inside them
+        int GetAllocatedArea() const;
+        // area of the live rects, padding excluded
+        int GetUsedArea() const { return m_used_area; }
+
+    private:
+        struct Span
+        {
+            int x;
+            int w;
+        };
+
+        struct Shelf
+        {
+            int y;
+            int h;
+            int used_w;
+            Vector<Span> free_spans;
+        };
+
+        int FindShelf(int w, int h, int& span_index) const;
+        void MergeEmptyShelves();
+
+    private:
+        int m_width;
+        int m_height;
+        int m_padding;
+        int m_shelves_bottom;
+        int m_used_area;
+        Vector<Shelf> m_shelves;
+    };
+}
@@ -32,38 +32,44 @@
 
 #define ATLAS_SIZE 2048
 #define PADDING_SIZE 1
+#define SLOT_HEADROOM_QUADS 4
+#define ATLAS_MAX_PAGES 4
+// minimum canvas updates between two background atlas compactions
+#define ATLAS_COMPACT_INTERVAL 600
+// entries copied into the new texture of a compacting page per frame
+#define ATLAS_COMPACT_STEP_ENTRIES 32
+#define HIT_GRID_CELL_SIZE 64
 
 namespace Viry3D
 {
 	CanvasRenderer::CanvasRenderer(FilterMode filter_mode):
 		m_canvas_dirty(true),
-        m_atlas_array_size(0),
+        m_structure_dirty(true),
+        m_batches_dirty(false),
+        m_atlas_frame(0),
+        m_atlas_compact_frame(0),
+        m_atlas_eviction_count(0),
+        m_atlas_compaction_count(0),
+        m_atlas_remapped(false),
+        m_compact_page(-1),
+        m_compact_allocator(ATLAS_SIZE, ATLAS_SIZE, PADDING_SIZE),
+        m_vertex_capacity(0),
+        m_index_capacity(0),
+        m_hit_grid_width(0),
+        m_hit_grid_height(0),
+        m_hit_grid_dirty(true),
         m_filter_mode(filter_mode)
 	{
 		this->CreateMaterial();
-        this->NewAtlasTextureLayer();
+        this->AddAtlasPage();
+        this->GetMaterial()->SetTexture(MaterialProperty::TEXTURE, m_atlas_pages[0].texture);
 	}
 
 	CanvasRenderer::~CanvasRenderer()
 	{
-        for (int i = 0; i < m_atlas_tree.Size(); ++i)
-        {
-            this->ReleaseAtlasTreeNode(m_atlas_tree[i]);
-            delete m_atlas_tree[i];
-        }
-        m_atlas_tree.Clear();
+	
 	}
 
-    void CanvasRenderer::ReleaseAtlasTreeNode(AtlasTreeNode* node)
-    {
-        for (int i = 0; i < node->children.Size(); ++i)
-        {
-            this->ReleaseAtlasTreeNode(node->children[i]);
-            delete node->children[i];
-        }
-        node->children.Clear();
-    }
-
     void CanvasRenderer::CreateMaterial()
     {
         auto material = RefMake<Material>(Shader::Find("UI"));
@@ -72,42 +78,28 @@ namespace Viry3D
         this->SetMaterial(material);
     }
 
-    void CanvasRenderer::NewAtlasTextureLayer()
+    Ref<Texture> CanvasRenderer::CreateAtlasTexture() const
     {
         ByteBuffer buffer(ATLAS_SIZE * ATLAS_SIZE * 4);
         Memory::Set(&buffer[0], 0, buffer.Size());
 
-        if (!m_atlas)
-        {
-            m_atlas_array_size = 1;
-
-			m_atlas = Texture::CreateTexture2DFromMemory(
-				buffer,
-				ATLAS_SIZE,
-				ATLAS_SIZE,
-				TextureFormat::R8G8B8A8,
-				m_filter_mode,
-				SamplerAddressMode::ClampToEdge,
-				false);
-        }
-        else
-        {
-            assert(false);
-        }
-
-        AtlasTreeNode* layer = new AtlasTreeNode();
-        layer->rect.x = 0;
-        layer->rect.y = 0;
-        layer->rect.w = ATLAS_SIZE;
-        layer->rect.h = ATLAS_SIZE;
-        layer->layer = m_atlas_tree.Size();
-        m_atlas_tree.Add(layer);
+        return Texture::CreateTexture2DFromMemory(
+            buffer,
+            ATLAS_SIZE,
+            ATLAS_SIZE,
+            TextureFormat::R8G8B8A8,
+            m_filter_mode,
+            SamplerAddressMode::ClampToEdge,
+            false);
+    }
 
-        const auto& materials = this->GetMaterials();
-        for (auto& i : materials)
-        {
-            i->SetTexture(MaterialProperty::TEXTURE, m_atlas);
-        }
+    void CanvasRenderer::AddAtlasPage()
+    {
+        AtlasPage page = {
+            this->CreateAtlasTexture(),
+            AtlasAllocator(ATLAS_SIZE, ATLAS_SIZE, PADDING_SIZE)
+        };
+        m_atlas_pages.Add(page);
     }
 
 	void CanvasRenderer::Prepare()
@@ -119,6 +111,9 @@ namespace Viry3D
             m_views[i]->Update();
         }
 
+        // a compaction moves a few entries per frame, the page swap sets m_atlas_remapped
+        this->StepAtlasCompaction();
+
 		if (m_canvas_dirty)
 		{
 			m_canvas_dirty = false;
@@ -146,6 +141,11 @@ namespace Viry3D
 
             this->UpdateCanvas();
 		}
+        else if (m_atlas_remapped)
+        {
+            // upload the remapped uvs of a compacted page
+            this->LayoutSlots();
+        }
 
 		this->HandleTouchEvent();
 	}
@@ -186,147 +186,147 @@ namespace Viry3D
 	void CanvasRenderer::MarkCanvasDirty()
 	{
 		m_canvas_dirty = true;
+        m_structure_dirty = true;
 	}
 
+    void CanvasRenderer::MarkViewDirty()
+    {
+        m_canvas_dirty = true;
+    }
+
+    static int GetSlotCapacity(int count, int quad_size)
+    {
+        // some quads of headroom, so a label changing a few characters keeps its slot
+        if (count > 0)
+        {
+            return count + Mathf::Max(count / 2, SLOT_HEADROOM_QUADS * quad_size);
+        }
+        return 0;
+    }
+
     void CanvasRenderer::UpdateCanvas()
     {
-        m_view_meshes.Clear();
+        bool rebuild = m_structure_dirty;
+        m_structure_dirty = false;
+        m_hit_grid_dirty = true;
+
+        ++m_atlas_frame;
+
+        if (rebuild)
+        {
+            for (auto& i : m_slots)
+            {
+                this->ReleaseAtlasEntries(i.atlas_entries);
+            }
+            m_slots.Clear();
+        }
+
+        Vector<View*> filled_views;
+        Vector<View*> colored_views;
 
         for (int i = 0; i < m_views.Size(); ++i)
         {
-            m_views[i]->UpdateLayout();
-            m_views[i]->FillMeshes(m_view_meshes, Rect(0, 0, 1, 1));
+            this->UpdateView(m_views[i].get(), Rect(0, 0, 1, 1), false, rebuild, filled_views, colored_views);
         }
 
         List<ViewMesh*> mesh_list;
 
-        for (int i = 0; i < m_view_meshes.Size(); ++i)
+        for (auto i : filled_views)
         {
-            mesh_list.AddLast(&m_view_meshes[i]);
+            for (auto& j : i->m_meshes)
+            {
+                if (j.HasTextureOrImage())
+                {
+                    mesh_list.AddLast(&j);
+                }
+            }
         }
 
+        // tallest first packs the shelves tighter
         mesh_list.Sort([](const ViewMesh* a, const ViewMesh* b) {
-            if (!a->HasTextureOrImage() && b->HasTextureOrImage())
+            if (a->GetTextureOrImageHeight() == b->GetTextureOrImageHeight())
             {
-                return true;
-            }
-            else if (a->HasTextureOrImage() && !b->HasTextureOrImage())
-            {
-                return false;
-            }
-            else if (!a->HasTextureOrImage() && !b->HasTextureOrImage())
-            {
-                return false;
+                return a->GetTextureOrImageWidth() > b->GetTextureOrImageWidth();
             }
             else
             {
-                if (a->GetTextureOrImageWidth() == b->GetTextureOrImageWidth())
-                {
-                    return a->GetTextureOrImageHeight() > b->GetTextureOrImageHeight();
-                }
-                else
-                {
-                    return a->GetTextureOrImageWidth() > b->GetTextureOrImageWidth();
-                }
+                return a->GetTextureOrImageHeight() > b->GetTextureOrImageHeight();
             }
         });
 
         bool atlas_updated = false;
         for (auto i : mesh_list)
         {
-            if (i->texture || i->image)
-            {
-                bool updated;
-                this->UpdateAtlas(*i, updated);
+            bool updated;
+            this->UpdateAtlas(*i, updated);
 
-                if (updated)
-                {
-                    atlas_updated = true;
-                }
+            if (updated)
+            {
+                atlas_updated = true;
             }
         }
 
-        Vector<Mesh::Submesh> submeshes;
-        Vector<Rect> clip_rects;
-        Vector<Mesh::Vertex> vertices;
-        Vector<unsigned int> indices;
-        
-        for (const auto& i : m_view_meshes)
+        for (auto i : filled_views)
         {
-            if (i.vertices.Size() > 0 && i.indices.Size() > 0 && (i.texture || i.image))
+            auto& slot = m_slots[i->m_canvas_slot];
+            for (const auto& j : i->m_meshes)
             {
-                int index_offset = vertices.Size();
-
-                if (clip_rects.Size() == 0 || i.clip_rect != clip_rects[clip_rects.Size() - 1])
-                {
-                    clip_rects.Add(i.clip_rect);
-
-                    Mesh::Submesh submesh;
-                    submesh.index_first = indices.Size();
-                    submesh.index_count = i.indices.Size();
-                    submeshes.Add(submesh);
-                }
-                else
+                if (j.atlas_entry >= 0)
                 {
-                    submeshes[submeshes.Size() - 1].index_count += i.indices.Size();
-                }
-
-                vertices.AddRange(i.vertices);
-
-                for (int j = 0; j < i.indices.Size(); ++j)
-                {
-                    indices.Add(index_offset + i.indices[j]);
+                    slot.atlas_entries.Add(j.atlas_entry);
                 }
             }
         }
 
-        auto mesh = this->GetMesh();
-        if (vertices.Size() > 0 && indices.Size() > 0)
+        // views growing out of their slot move every slot behind them,
+        // a compaction moved the atlas rects of every slot
+        bool relayout = rebuild || m_atlas_remapped || !this->GetMesh();
+        for (int i = 0; i < filled_views.Size() && !relayout; ++i)
         {
-            if (!mesh || vertices.Size() > mesh->GetVertices().Size() || indices.Size() > mesh->GetIndices().Size())
-            {
-                mesh = RefMake<Mesh>(std::move(vertices), std::move(indices), submeshes, false, true);
-                this->SetMesh(mesh);
-            }
-            else
+            const auto& slot = m_slots[filled_views[i]->m_canvas_slot];
+
+            int vertex_count;
+            int index_count;
+            this->GetSlotGeometrySize(filled_views[i], vertex_count, index_count);
+
+            if (vertex_count > slot.vertex_capacity || index_count > slot.index_capacity)
             {
-                mesh->Update(std::move(vertices), std::move(indices), submeshes);
+                relayout = true;
             }
         }
+
+        if (relayout)
+        {
+            this->LayoutSlots();
+        }
         else
         {
-            if (mesh)
+            // batches split where the atlas page changes, refilled meshes may have moved page
+            if (m_atlas_pages.Size() > 1 && filled_views.Size() > 0)
             {
-                mesh.reset();
-                this->SetMesh(mesh);
+                m_batches_dirty = true;
             }
-        }
 
-        // update materials
-        if (this->GetMaterials().Size() != submeshes.Size())
-        {
-            Vector<Ref<Material>> materials(submeshes.Size());
-            for (int i = 0; i < materials.Size(); ++i)
+            for (auto i : filled_views)
             {
-                materials[i] = RefMake<Material>(this->GetMaterial()->GetShader());
-                materials[i]->SetColor(MaterialProperty::COLOR, Color(1, 1, 1, 1));
-                materials[i]->SetTexture(MaterialProperty::TEXTURE, m_atlas);
-				materials[i]->SetScissorRect(clip_rects[i]);
-			}
-            if (materials.Size() > 0)
+                this->UploadSlot(m_slots[i->m_canvas_slot], false);
+            }
+
+            for (auto i : colored_views)
             {
-                this->SetMaterials(materials);
+                this->UploadSlot(m_slots[i->m_canvas_slot], true);
             }
-        }
-        else
-        {
-            const auto& materials = this->GetMaterials();
-            for (int i = 0; i < materials.Size(); ++i)
+
+            if (m_batches_dirty)
             {
-                if (clip_rects[i] != materials[i]->GetScissorRect())
-                {
-					materials[i]->SetScissorRect(clip_rects[i]);
-                }
+                m_batches_dirty = false;
+
+                Vector<Mesh::Submesh> submeshes;
+                Vector<CanvasBatch> batches;
+                this->BuildBatches(submeshes, batches);
+
+                this->GetMesh()->SetSubmeshes(submeshes);
+                this->UpdateMaterials(batches);
             }
         }
 
@@ -336,7 +336,7 @@ namespace Viry3D
         {
             ByteBuffer pixels(ATLAS_SIZE * ATLAS_SIZE * 4);
             
-			m_atlas->CopyToMemory(pixels, 0, 0, 0, 0, ATLAS_SIZE, ATLAS_SIZE,
+			m_atlas_pages[0].texture->CopyToMemory(pixels, 0, 0, 0, 0, ATLAS_SIZE, ATLAS_SIZE,
 				[](const ByteBuffer& buffer) {
 					auto image = RefMake<Image>();
 					image->width = ATLAS_SIZE;
@@ -349,300 +349,1098 @@ namespace Viry3D
 #endif
     }
 
-    void CanvasRenderer::UpdateAtlas(ViewMesh& mesh, bool& updated)
+    void CanvasRenderer::UpdateView(View* view, const Rect& clip_rect, bool layout_updated, bool rebuild, Vector<View*>& filled_views, Vector<View*>& colored_views)
     {
-        int texture_width = mesh.GetTextureOrImageWidth();
-        int texture_height = mesh.GetTextureOrImageHeight();
-
-        assert(texture_width <= ATLAS_SIZE - PADDING_SIZE && texture_height <= ATLAS_SIZE - PADDING_SIZE);
+        // layout recurses into subviews, so only the topmost dirty view runs it
+        bool layout = layout_updated;
+        if (!layout && (rebuild || (view->m_dirty & ViewDirty::Layout)))
+        {
+            view->UpdateLayout();
+            layout = true;
+        }
 
-        AtlasTreeNode* node = nullptr;
+        Rect clip = Rect::Min(view->GetClipRect(), clip_rect);
 
-        AtlasTreeNode** node_ptr;
-        if ((mesh.texture && m_atlas_cache.TryGet(mesh.texture->GetId(), &node_ptr)) ||
-            (mesh.image && m_atlas_cache.TryGet(mesh.image->GetId(), &node_ptr)))
+        if (rebuild)
         {
-            node = *node_ptr;
-
-            updated = false;
+            CanvasViewSlot slot;
+            slot.view = view;
+            slot.clip_rect = clip;
+            slot.vertex_first = 0;
+            slot.vertex_capacity = 0;
+            slot.index_first = 0;
+            slot.index_capacity = 0;
+
+            view->m_canvas_slot = m_slots.Size();
+            m_slots.Add(slot);
         }
         else
         {
-            for (int i = 0; i < m_atlas_tree.Size(); ++i)
+            auto& slot = m_slots[view->m_canvas_slot];
+            if (slot.clip_rect != clip)
             {
-                node = this->FindAtlasTreeNodeToInsert(texture_width, texture_height, m_atlas_tree[i]);
-                if (node)
-                {
-                    break;
-                }
+                slot.clip_rect = clip;
+                m_batches_dirty = true;
             }
+        }
 
-            if (node == nullptr)
-            {
-                this->NewAtlasTextureLayer();
+        bool fill = layout || (view->m_dirty & ViewDirty::Geometry);
+        if (!fill && (view->m_dirty & ViewDirty::Meshes))
+        {
+            fill = !this->UpdateChangedMeshes(view);
+        }
 
-                node = this->FindAtlasTreeNodeToInsert(texture_width, texture_height, m_atlas_tree[m_atlas_tree.Size() - 1]);
-            }
+        if (fill)
+        {
+            this->ReleaseAtlasEntries(m_slots[view->m_canvas_slot].atlas_entries);
 
-            assert(node);
+            view->m_meshes.Clear();
+            // layout runs again whenever an ancestor moves, so culled views are filled once they come into view
+            if (!view->IsCulled(clip_rect))
+            {
+                view->FillSelfMeshes(view->m_meshes, clip_rect);
+            }
+            filled_views.Add(view);
+        }
+        else if (view->m_dirty & ViewDirty::Color)
+        {
+            view->FillSelfColors(view->m_meshes);
+            colored_views.Add(view);
+        }
+        view->m_dirty = 0;
 
-            // split node
-            AtlasTreeNode* left = new AtlasTreeNode();
-            AtlasTreeNode* right = new AtlasTreeNode();
+        for (const auto& i : view->GetSubviews())
+        {
+            this->UpdateView(i.get(), clip, layout, rebuild, filled_views, colored_views);
+        }
+    }
 
-            int remain_w = node->rect.w - texture_width - PADDING_SIZE;
-            int remain_h = node->rect.h - texture_height - PADDING_SIZE;
+    bool CanvasRenderer::UpdateChangedMeshes(View* view)
+    {
+        Vector<ViewMesh> meshes;
+        Vector<int> indices;
+        view->FillChangedMeshes(view->m_meshes, meshes, indices);
 
-            if (remain_w <= remain_h)
+        // only meshes drawn from the slot with the same counts can be replaced in place
+        for (int i = 0; i < meshes.Size(); ++i)
+        {
+            if (indices[i] < 0 || indices[i] >= view->m_meshes.Size())
             {
-                left->rect.x = node->rect.x + texture_width + PADDING_SIZE;
-                left->rect.y = node->rect.y;
-                left->rect.w = remain_w;
-                left->rect.h = texture_height;
-                left->layer = node->layer;
-
-                right->rect.x = node->rect.x;
-                right->rect.y = node->rect.y + texture_height + PADDING_SIZE;
-                right->rect.w = node->rect.w;
-                right->rect.h = remain_h;
-                right->layer = node->layer;
+                return false;
             }
-            else
-            {
-                left->rect.x = node->rect.x;
-                left->rect.y = node->rect.y + texture_height + PADDING_SIZE;
-                left->rect.w = texture_width;
-                left->rect.h = remain_h;
-                left->layer = node->layer;
 
-                right->rect.x = node->rect.x + texture_width + PADDING_SIZE;
-                right->rect.y = node->rect.y;
-                right->rect.w = remain_w;
-                right->rect.h = node->rect.h;
-                right->layer = node->layer;
+            const ViewMesh& old_mesh = view->m_meshes[indices[i]];
+            const ViewMesh& new_mesh = meshes[i];
+            if (old_mesh.atlas_entry < 0 || old_mesh.indices.Size() == 0 || !new_mesh.HasTextureOrImage() ||
+                old_mesh.vertices.Size() != new_mesh.vertices.Size() ||
+                old_mesh.indices.Size() != new_mesh.indices.Size() ||
+                Memory::Compare(old_mesh.indices.Bytes(), new_mesh.indices.Bytes(), old_mesh.indices.SizeInBytes()) != 0)
+            {
+                return false;
             }
+        }
 
-            node->rect.w = texture_width;
-            node->rect.h = texture_height;
-            node->children.Resize(2);
-            node->children[0] = left;
-            node->children[1] = right;
+        Vector<int> acquired;
+        for (auto& i : meshes)
+        {
+            bool updated;
+            this->UpdateAtlas(i, updated);
 
-            // copy texture to atlas
-            // add cache
-            if (mesh.texture)
+            if (i.atlas_entry < 0)
             {
-                m_atlas->CopyTexture(
-					node->layer, 0,
-					node->rect.x, node->rect.y,
-					node->rect.w, node->rect.h,
-                    mesh.texture,
-                    0, 0,
-                    0, 0,
-                    node->rect.w, node->rect.h,
-					FilterMode::None);
-
-                m_atlas_cache.Add(mesh.texture->GetId(), node);
+                this->ReleaseAtlasEntries(acquired);
+                return false;
             }
-            else if (mesh.image)
-            {
-                m_atlas->UpdateTexture(
-                    mesh.image->data,
-					0, 0,
-                    node->rect.x, node->rect.y,
-                    node->rect.w, node->rect.h);
+            acquired.Add(i.atlas_entry);
+        }
 
-                m_atlas_cache.Add(mesh.image->GetId(), node);
+        auto& slot = m_slots[view->m_canvas_slot];
+        Vector<int> released;
+
+        for (int i = 0; i < meshes.Size(); ++i)
+        {
+            ViewMesh& old_mesh = view->m_meshes[indices[i]];
+
+            for (int j = 0; j < slot.atlas_entries.Size(); ++j)
+            {
+                if (slot.atlas_entries[j] == old_mesh.atlas_entry)
+                {
+                    slot.atlas_entries.RemoveRange(j, 1);
+                    break;
+                }
             }
+            released.Add(old_mesh.atlas_entry);
+            slot.atlas_entries.Add(meshes[i].atlas_entry);
 
-            updated = true;
+            old_mesh = meshes[i];
         }
+        this->ReleaseAtlasEntries(released);
 
-        // update uv
-        Vector2 uv_offset(node->rect.x / (float) ATLAS_SIZE, node->rect.y / (float) ATLAS_SIZE);
-        Vector2 uv_scale(node->rect.w / (float) ATLAS_SIZE, node->rect.h / (float) ATLAS_SIZE);
+        if (m_atlas_pages.Size() > 1)
+        {
+            m_batches_dirty = true;
+        }
 
-        for (int i = 0; i < mesh.vertices.Size(); ++i)
+        // a relayout this frame uploads the whole canvas anyway
+        const auto& mesh = this->GetMesh();
+        if (!mesh || m_atlas_remapped || slot.index_capacity == 0)
         {
-            mesh.vertices[i].uv.x = mesh.vertices[i].uv.x * uv_scale.x + uv_offset.x;
-            mesh.vertices[i].uv.y = mesh.vertices[i].uv.y * uv_scale.y + uv_offset.y;
-            mesh.vertices[i].uv2.x = (float) node->layer;
+            return true;
         }
-    }
 
-    AtlasTreeNode* CanvasRenderer::FindAtlasTreeNodeToInsert(int w, int h, AtlasTreeNode* node)
-    {
-        if (node->children.Size() == 0)
+        Vector<int> vertex_offsets(view->m_meshes.Size());
+        int vertex_offset = 0;
+        for (int i = 0; i < view->m_meshes.Size(); ++i)
         {
-            if (node->rect.w - PADDING_SIZE >= w && node->rect.h - PADDING_SIZE >= h)
-            {
-                return node;
-            }
-            else
+            const auto& j = view->m_meshes[i];
+
+            vertex_offsets[i] = vertex_offset;
+            if (j.vertices.Size() > 0 && j.indices.Size() > 0 && j.atlas_entry >= 0)
             {
-                return nullptr;
+                vertex_offset += j.vertices.Size();
             }
         }
-        else
+
+        // write the changed vertices only, neighbouring meshes go in one update
+        Vector<Mesh::Vertex> vertices;
+        int vertex_first = 0;
+        for (int i = 0; i < indices.Size(); ++i)
         {
-            AtlasTreeNode* left = this->FindAtlasTreeNodeToInsert(w, h, node->children[0]);
-            if (left)
+            const ViewMesh& changed = view->m_meshes[indices[i]];
+            int offset = vertex_offsets[indices[i]];
+
+            if (vertices.Size() > 0 && vertex_first + vertices.Size() != offset)
             {
-                return left;
+                mesh->UpdateVertices(slot.vertex_first + vertex_first, &vertices[0], vertices.Size());
+                vertices.Clear();
             }
-            else
+            if (vertices.Size() == 0)
             {
-                return this->FindAtlasTreeNodeToInsert(w, h, node->children[1]);
+                vertex_first = offset;
             }
-        }
-    }
 
-    void CanvasRenderer::HandleTouchEvent()
-    {
-        int touch_count = Input::GetTouchCount();
-        for (int i = 0; i < touch_count; ++i)
+            this->AddAtlasVertices(changed, vertices);
+        }
+        if (vertices.Size() > 0)
         {
-            this->HitViews(Input::GetTouch(i));
+            mesh->UpdateVertices(slot.vertex_first + vertex_first, &vertices[0], vertices.Size());
         }
+
+        return true;
     }
 
-    static bool IsPointInView(const Vector2i& pos, const Vector<Mesh::Vertex>& vertices)
+    void CanvasRenderer::GetSlotGeometrySize(const View* view, int& vertex_count, int& index_count) const
     {
-        // ax + by + c = 0
-        // a = y1 - y0
-        // b = x0 - x1
-        // c = x1y0 - x0y1
-        float x0 = vertices[0].vertex.x;
-        float y0 = vertices[0].vertex.y;
-        float x1 = vertices[1].vertex.x;
-        float y1 = vertices[1].vertex.y;
-        float x2 = vertices[2].vertex.x;
-        float y2 = vertices[2].vertex.y;
-        float x3 = vertices[3].vertex.x;
-        float y3 = vertices[3].vertex.y;
-        Vector3 lines[4];
-        lines[0] = Vector3(y1 - y0, x0 - x1, x1 * y0 - x0 * y1);
-        lines[1] = Vector3(y2 - y1, x1 - x2, x2 * y1 - x1 * y2);
-        lines[2] = Vector3(y3 - y2, x2 - x3, x3 * y2 - x2 * y3);
-        lines[3] = Vector3(y0 - y3, x3 - x0, x0 * y3 - x3 * y0);
+        vertex_count = 0;
+        index_count = 0;
 
-        bool all_positive = true;
-        bool all_negative = true;
-
-        for (int i = 0; i < 4; ++i)
+        for (const auto& i : view->m_meshes)
         {
-            float sign = lines[i].x * pos.x + lines[i].y * pos.y + lines[i].z;
-            if (sign >= 0)
-            {
-                all_negative = false;
-            }
-            if (sign <= 0)
+            if (i.vertices.Size() > 0 && i.indices.Size() > 0 && i.atlas_entry >= 0)
             {
-                all_positive = false;
+                vertex_count += i.vertices.Size();
+                index_count += i.indices.Size();
             }
         }
-
-        return all_positive || all_negative;
     }
 
-    void CanvasRenderer::HitViews(const Touch& t)
+    void CanvasRenderer::FillSlotGeometry(const CanvasViewSlot& slot, Vector<Mesh::Vertex>& vertices, Vector<unsigned int>& indices) const
     {
-        Vector2i pos = Vector2i((int) t.position.x, (int) t.position.y);
-        pos.y -= this->GetCamera()->GetTargetHeight();
+        vertices.Clear();
+        indices.Clear();
 
-        if (t.phase == TouchPhase::Began)
+        for (const auto& i : slot.view->m_meshes)
         {
-            for (int i = m_view_meshes.Size() - 1; i >= 0; --i)
+            if (i.vertices.Size() > 0 && i.indices.Size() > 0 && i.atlas_entry >= 0)
             {
-                if (m_view_meshes[i].base_view)
+                int index_offset = slot.vertex_first + vertices.Size();
+
+                this->AddAtlasVertices(i, vertices);
+
+                for (int j = 0; j < i.indices.Size(); ++j)
                 {
-                    if (IsPointInView(pos, m_view_meshes[i].vertices))
-                    {
-                        View* view = m_view_meshes[i].view;
-
-                        List<View*>* touch_down_views_ptr;
-                        if (m_touch_down_views.TryGet(t.fingerId, &touch_down_views_ptr))
-                        {
-                            touch_down_views_ptr->AddLast(view);
-                        }
-                        else
-                        {
-                            List<View*> views;
-                            views.AddLast(view);
-                            m_touch_down_views.Add(t.fingerId, views);
-                        }
-
-                        bool block_event = view->OnTouchDownInside(pos);
-
-                        if (block_event)
-                        {
-                            break;
-                        }
-                    }
+                    indices.Add(index_offset + i.indices[j]);
                 }
             }
         }
-        else if (t.phase == TouchPhase::Moved)
+
+        // pad the rest of the slot with degenerate triangles
+        while (indices.Size() < slot.index_capacity)
         {
-            List<View*>* touch_down_views_ptr;
-            if (m_touch_down_views.TryGet(t.fingerId, &touch_down_views_ptr))
-            {
-                for (View* j : *touch_down_views_ptr)
-                {
-                    bool block_event = j->OnTouchDrag(pos);
+            indices.Add(slot.vertex_first);
+        }
+    }
 
-                    if (block_event)
-                    {
-                        break;
-                    }
-                }
-            }
+    void CanvasRenderer::AddAtlasVertices(const ViewMesh& mesh, Vector<Mesh::Vertex>& vertices) const
+    {
+        // map texture space uvs into the current atlas rect
+        const Recti& rect = m_atlas_entries[mesh.atlas_entry].rect;
+        Vector2 uv_offset(rect.x / (float) ATLAS_SIZE, rect.y / (float) ATLAS_SIZE);
+        Vector2 uv_scale(rect.w / (float) ATLAS_SIZE, rect.h / (float) ATLAS_SIZE);
 
-            for (int i = m_view_meshes.Size() - 1; i >= 0; --i)
-            {
-                if (m_view_meshes[i].base_view)
-                {
-                    if (IsPointInView(pos, m_view_meshes[i].vertices))
-                    {
-                        View* view = m_view_meshes[i].view;
+        for (const auto& i : mesh.vertices)
+        {
+            Mesh::Vertex v = i;
+            v.uv.x = v.uv.x * uv_scale.x + uv_offset.x;
+            v.uv.y = v.uv.y * uv_scale.y + uv_offset.y;
+            vertices.Add(v);
+        }
+    }
 
-                        bool block_event = view->OnTouchMoveInside(pos);
+    void CanvasRenderer::LayoutSlots()
+    {
+        m_atlas_remapped = false;
 
-                        if (block_event)
-                        {
-                            break;
-                        }
-                    }
-                }
-            }
+        int vertex_count = 0;
+        int index_count = 0;
+
+        for (auto& i : m_slots)
+        {
+            int slot_vertex_count;
+            int slot_index_count;
+            this->GetSlotGeometrySize(i.view, slot_vertex_count, slot_index_count);
+
+            i.vertex_first = vertex_count;
+            i.vertex_capacity = GetSlotCapacity(slot_vertex_count, 4);
+            i.index_first = index_count;
+            i.index_capacity = (GetSlotCapacity(slot_index_count, 6) + 2) / 3 * 3;
+
+            vertex_count += i.vertex_capacity;
+            index_count += i.index_capacity;
         }
-        else if (t.phase == TouchPhase::Ended)
+
+        auto mesh = this->GetMesh();
+        if (index_count == 0)
         {
-            bool blocked = false;
-            for (int i = m_view_meshes.Size() - 1; i >= 0; --i)
+            if (mesh)
             {
-                if (m_view_meshes[i].base_view)
-                {
-                    View* view = m_view_meshes[i].view;
-
-                    if (!blocked)
+                mesh.reset();
+                this->SetMesh(mesh);
+            }
+            return;
+        }
+
+        bool new_mesh = !mesh || vertex_count > m_vertex_capacity || index_count > m_index_capacity;
+        if (new_mesh)
+        {
+            m_vertex_capacity = vertex_count;
+            m_index_capacity = index_count;
+        }
+
+        Vector<Mesh::Vertex> vertices(m_vertex_capacity);
+        Vector<unsigned int> indices(m_index_capacity);
+        Memory::Zero(&vertices[0], vertices.SizeInBytes());
+        Memory::Zero(&indices[0], indices.SizeInBytes());
+
+        Vector<Mesh::Vertex> slot_vertices;
+        Vector<unsigned int> slot_indices;
+
+        for (const auto& i : m_slots)
+        {
+            this->FillSlotGeometry(i, slot_vertices, slot_indices);
+
+            if (slot_vertices.Size() > 0)
+            {
+                Memory::Copy(&vertices[i.vertex_first], slot_vertices.Bytes(), slot_vertices.SizeInBytes());
+            }
+            if (slot_indices.Size() > 0)
+            {
+                Memory::Copy(&indices[i.index_first], slot_indices.Bytes(), slot_indices.SizeInBytes());
+            }
+        }
+
+        Vector<Mesh::Submesh> submeshes;
+        Vector<CanvasBatch> batches;
+        this->BuildBatches(submeshes, batches);
+        m_batches_dirty = false;
+
+        if (new_mesh)
+        {
+            mesh = RefMake<Mesh>(std::move(vertices), std::move(indices), submeshes, true, true,
+                (int) Mesh::VertexAttributeMask::Vertex | (int) Mesh::VertexAttributeMask::Color | (int) Mesh::VertexAttributeMask::UV | (int) Mesh::VertexAttributeMask::UV2);
+            this->SetMesh(mesh);
+        }
+        else
+        {
+            mesh->Update(std::move(vertices), std::move(indices), submeshes);
+        }
+
+        this->UpdateMaterials(batches);
+    }
+
+    void CanvasRenderer::UploadSlot(const CanvasViewSlot& slot, bool color_only)
+    {
+        if (slot.index_capacity == 0)
+        {
+            return;
+        }
+
+        Vector<Mesh::Vertex> vertices;
+        Vector<unsigned int> indices;
+        this->FillSlotGeometry(slot, vertices, indices);
+
+        const auto& mesh = this->GetMesh();
+
+        if (color_only)
+        {
+            if (vertices.Size() > 0)
+            {
+                mesh->UpdateVertices(slot.vertex_first, &vertices[0], vertices.Size(), (int) Mesh::VertexAttributeMask::Color);
+            }
+        }
+        else
+        {
+            if (vertices.Size() > 0)
+            {
+                mesh->UpdateVertices(slot.vertex_first, &vertices[0], vertices.Size());
+            }
+            mesh->UpdateIndices(slot.index_first, &indices[0], indices.Size());
+        }
+    }
+
+    void CanvasRenderer::BuildBatches(Vector<Mesh::Submesh>& submeshes, Vector<CanvasBatch>& batches) const
+    {
+        // slots are adjacent in the index buffer, so neighbours with the same clip rect and atlas page share one draw
+        auto add_range = [&](const Rect& clip_rect, int page, int index_first, int index_count) {
+            if (batches.Size() > 0)
+            {
+                const CanvasBatch& last = batches[batches.Size() - 1];
+                Mesh::Submesh& submesh = submeshes[submeshes.Size() - 1];
+
+                if (last.clip_rect == clip_rect && last.page == page && submesh.index_first + submesh.index_count == index_first)
+                {
+                    submesh.index_count += index_count;
+                    return;
+                }
+            }
+
+            CanvasBatch batch;
+            batch.clip_rect = clip_rect;
+            batch.page = page;
+            batches.Add(batch);
+
+            Mesh::Submesh submesh;
+            submesh.index_first = index_first;
+            submesh.index_count = index_count;
+            submeshes.Add(submesh);
+        };
+
+        for (const auto& i : m_slots)
+        {
+            if (i.index_capacity == 0)
+            {
+                continue;
+            }
+
+            // same mesh order as FillSlotGeometry
+            int index_first = i.index_first;
+            for (const auto& j : i.view->m_meshes)
+            {
+                if (j.vertices.Size() > 0 && j.indices.Size() > 0 && j.atlas_entry >= 0)
+                {
+                    add_range(i.clip_rect, m_atlas_entries[j.atlas_entry].page, index_first, j.indices.Size());
+                    index_first += j.indices.Size();
+                }
+            }
+
+            // the degenerate padding draws nothing, it joins the batch before it
+            int padding = i.index_first + i.index_capacity - index_first;
+            if (padding > 0)
+            {
+                int page = batches.Size() > 0 ? batches[batches.Size() - 1].page : 0;
+                add_range(i.clip_rect, page, index_first, padding);
+            }
+        }
+    }
+
+    void CanvasRenderer::UpdateMaterials(const Vector<CanvasBatch>& batches)
+    {
+        if (this->GetMaterials().Size() != batches.Size())
+        {
+            Vector<Ref<Material>> materials(batches.Size());
+            for (int i = 0; i < materials.Size(); ++i)
+            {
+                materials[i] = RefMake<Material>(this->GetMaterial()->GetShader());
+                materials[i]->SetColor(MaterialProperty::COLOR, Color(1, 1, 1, 1));
+                materials[i]->SetTexture(MaterialProperty::TEXTURE, m_atlas_pages[batches[i].page].texture);
+				materials[i]->SetScissorRect(batches[i].clip_rect);
+			}
+            if (materials.Size() > 0)
+            {
+                this->SetMaterials(materials);
+            }
+        }
+        else
+        {
+            const auto& materials = this->GetMaterials();
+            for (int i = 0; i < materials.Size(); ++i)
+            {
+                if (batches[i].clip_rect != materials[i]->GetScissorRect())
+                {
+					materials[i]->SetScissorRect(batches[i].clip_rect);
+                }
+
+                // a compaction swaps the texture of its page
+                const auto& texture = m_atlas_pages[batches[i].page].texture;
+                if (materials[i]->GetTexture(MaterialProperty::TEXTURE) != texture)
+                {
+                    materials[i]->SetTexture(MaterialProperty::TEXTURE, texture);
+                }
+            }
+        }
+    }
+
+    void CanvasRenderer::UpdateAtlas(ViewMesh& mesh, bool& updated)
+    {
+        int key = mesh.texture ? mesh.texture->GetId() : mesh.image->GetId();
+
+        updated = false;
+        mesh.atlas_entry = -1;
+
+        int* index_ptr;
+        if (m_atlas_cache.TryGet(key, &index_ptr))
+        {
+            mesh.atlas_entry = *index_ptr;
+        }
+        else
+        {
+            int texture_width = mesh.GetTextureOrImageWidth();
+            int texture_height = mesh.GetTextureOrImageHeight();
+
+            int page;
+            Recti rect;
+            if (!this->AllocateAtlasRect(texture_width, texture_height, page, rect))
+            {
+                Log("ui atlas is full, can not add %dx%d", texture_width, texture_height);
+                return;
+            }
+
+            const auto& atlas = m_atlas_pages[page].texture;
+
+            // copy texture to atlas
+            if (mesh.texture)
+            {
+                atlas->CopyTexture(
+					0, 0,
+					rect.x, rect.y,
+					rect.w, rect.h,
+                    mesh.texture,
+                    0, 0,
+                    0, 0,
+                    rect.w, rect.h,
+					FilterMode::None);
+            }
+            else if (mesh.image)
+            {
+                atlas->UpdateTexture(
+                    mesh.image->data,
+					0, 0,
+                    rect.x, rect.y,
+                    rect.w, rect.h);
+            }
+
+            AtlasEntry entry;
+            entry.key = key;
+            entry.page = page;
+            entry.rect = rect;
+            entry.ref_count = 0;
+            entry.last_used = m_atlas_frame;
+
+            if (m_free_atlas_entries.Size() > 0)
+            {
+                mesh.atlas_entry = m_free_atlas_entries[m_free_atlas_entries.Size() - 1];
+                m_free_atlas_entries.Resize(m_free_atlas_entries.Size() - 1);
+                m_atlas_entries[mesh.atlas_entry] = entry;
+            }
+            else
+            {
+                mesh.atlas_entry = m_atlas_entries.Size();
+                m_atlas_entries.Add(entry);
+            }
+
+            m_atlas_cache.Add(key, mesh.atlas_entry);
+
+            updated = true;
+        }
+
+        auto& entry = m_atlas_entries[mesh.atlas_entry];
+        entry.ref_count += 1;
+        entry.last_used = m_atlas_frame;
+    }
+
+    bool CanvasRenderer::AllocateAtlasRect(int w, int h, int& page, Recti& rect)
+    {
+        if (w > ATLAS_SIZE || h > ATLAS_SIZE)
+        {
+            return false;
+        }
+
+        for (int i = 0; i < m_atlas_pages.Size(); ++i)
+        {
+            if (i != m_compact_page && m_atlas_pages[i].allocator.Allocate(w, h, rect))
+            {
+                page = i;
+                return true;
+            }
+        }
+
+        // evict unreferenced entries, least recently used first
+        List<int> unused;
+        for (int i = 0; i < m_atlas_entries.Size(); ++i)
+        {
+            if (m_atlas_entries[i].key != 0 && m_atlas_entries[i].ref_count == 0)
+            {
+                unused.AddLast(i);
+            }
+        }
+        unused.Sort([this](int a, int b) {
+            return m_atlas_entries[a].last_used < m_atlas_entries[b].last_used;
+        });
+
+        for (int i : unused)
+        {
+            int entry_page = m_atlas_entries[i].page;
+
+            this->FreeAtlasEntry(i);
+            m_atlas_eviction_count += 1;
+
+            if (entry_page != m_compact_page && m_atlas_pages[entry_page].allocator.Allocate(w, h, rect))
+            {
+                page = entry_page;
+                return true;
+            }
+        }
+
+        // enough free area may still be left in fragments, re-pack the emptiest page over the next frames
+        if (m_compact_page < 0)
+        {
+            int compact_page = -1;
+            for (int i = 0; i < m_atlas_pages.Size(); ++i)
+            {
+                int used_area = m_atlas_pages[i].allocator.GetUsedArea();
+                if (used_area + w * h <= ATLAS_SIZE * ATLAS_SIZE &&
+                    (compact_page < 0 || used_area < m_atlas_pages[compact_page].allocator.GetUsedArea()))
+                {
+                    compact_page = i;
+                }
+            }
+
+            if (compact_page >= 0)
+            {
+                this->BeginAtlasCompaction(compact_page);
+            }
+        }
+
+        // meanwhile the entry goes to a new page
+        if (m_atlas_pages.Size() < ATLAS_MAX_PAGES)
+        {
+            this->AddAtlasPage();
+
+            page = m_atlas_pages.Size() - 1;
+            return m_atlas_pages[page].allocator.Allocate(w, h, rect);
+        }
+
+        return false;
+    }
+
+    void CanvasRenderer::ReleaseAtlasEntries(Vector<int>& entries)
+    {
+        for (int i : entries)
+        {
+            auto& entry = m_atlas_entries[i];
+            assert(entry.ref_count > 0);
+            entry.ref_count -= 1;
+            entry.last_used = m_atlas_frame;
+        }
+        entries.Clear();
+    }
+
+    void CanvasRenderer::FreeAtlasEntry(int index)
+    {
+        auto& entry = m_atlas_entries[index];
+
+        m_atlas_pages[entry.page].allocator.Free(entry.rect);
+        m_atlas_cache.Remove(entry.key);
+
+        entry.key = 0;
+        entry.ref_count = 0;
+        m_free_atlas_entries.Add(index);
+    }
+
+    int CanvasRenderer::FindFragmentedAtlasPage() const
+    {
+        if (m_atlas_frame - m_atlas_compact_frame <= ATLAS_COMPACT_INTERVAL)
+        {
+            return -1;
+        }
+
+        // shelves cover more than half of the page but less than half of them is used
+        for (int i = 0; i < m_atlas_pages.Size(); ++i)
+        {
+            int allocated_area = m_atlas_pages[i].allocator.GetAllocatedArea();
+            int used_area = m_atlas_pages[i].allocator.GetUsedArea();
+
+            if (allocated_area > ATLAS_SIZE * ATLAS_SIZE / 2 && used_area < allocated_area / 2)
+            {
+                return i;
+            }
+        }
+
+        return -1;
+    }
+
+    void CanvasRenderer::BeginAtlasCompaction(int page)
+    {
+        // re-pack referenced entries first, then the cached ones by recency,
+        // tallest first inside each group. entries not fitting anymore are evicted.
+        m_compact_entries.Clear();
+        for (int i = 0; i < m_atlas_entries.Size(); ++i)
+        {
+            if (m_atlas_entries[i].key != 0 && m_atlas_entries[i].page == page)
+            {
+                m_compact_entries.AddLast(i);
+            }
+        }
+        m_compact_entries.Sort([this](int a, int b) {
+            const auto& ea = m_atlas_entries[a];
+            const auto& eb = m_atlas_entries[b];
+            if ((ea.ref_count > 0) != (eb.ref_count > 0))
+            {
+                return ea.ref_count > 0;
+            }
+            if (ea.ref_count == 0 && ea.last_used != eb.last_used)
+            {
+                return ea.last_used > eb.last_used;
+            }
+            return ea.rect.h > eb.rect.h;
+        });
+
+        m_compact_page = page;
+        m_compact_texture = this->CreateAtlasTexture();
+        m_compact_allocator.Clear();
+        m_compact_moves.Clear();
+    }
+
+    void CanvasRenderer::CancelAtlasCompaction()
+    {
+        m_compact_page = -1;
+        m_compact_texture.reset();
+        m_compact_allocator.Clear();
+        m_compact_entries.Clear();
+        m_compact_moves.Clear();
+        m_atlas_compact_frame = m_atlas_frame;
+    }
+
+    bool CanvasRenderer::StepAtlasCompaction()
+    {
+        if (m_compact_page < 0)
+        {
+            // the last page is dropped once all of its entries are gone
+            int last = m_atlas_pages.Size() - 1;
+            if (last > 0 && m_atlas_pages[last].allocator.GetUsedArea() == 0)
+            {
+                m_atlas_pages.Remove(last);
+            }
+
+            int page = this->FindFragmentedAtlasPage();
+            if (page < 0)
+            {
+                return false;
+            }
+            this->BeginAtlasCompaction(page);
+        }
+
+        AtlasPage& page = m_atlas_pages[m_compact_page];
+
+        for (int step = 0; step < ATLAS_COMPACT_STEP_ENTRIES && !m_compact_entries.Empty(); )
+        {
+            int index = m_compact_entries.First();
+            m_compact_entries.RemoveFirst();
+
+            // evicted since the compaction began
+            auto& entry = m_atlas_entries[index];
+            if (entry.key == 0 || entry.page != m_compact_page)
+            {
+                continue;
+            }
+
+            Recti rect;
+            if (m_compact_allocator.Allocate(entry.rect.w, entry.rect.h, rect))
+            {
+                m_compact_texture->CopyTexture(
+                    0, 0,
+                    rect.x, rect.y,
+                    rect.w, rect.h,
+                    page.texture,
+                    0, 0,
+                    entry.rect.x, entry.rect.y,
+                    entry.rect.w, entry.rect.h,
+                    FilterMode::None);
+
+                AtlasMove move;
+                move.entry = index;
+                move.key = entry.key;
+                move.rect = rect;
+                m_compact_moves.Add(move);
+            }
+            else if (entry.ref_count == 0)
+            {
+                this->FreeAtlasEntry(index);
+                m_atlas_eviction_count += 1;
+            }
+            else
+            {
+                // entries referenced since the compaction began do not fit, keep the page as it is
+                this->CancelAtlasCompaction();
+                return false;
+            }
+
+            ++step;
+        }
+
+        if (!m_compact_entries.Empty())
+        {
+            return false;
+        }
+
+        // every entry is copied, swap in the new texture and rects
+        page.texture = m_compact_texture;
+        page.allocator = m_compact_allocator;
+
+        for (const auto& i : m_compact_moves)
+        {
+            auto& entry = m_atlas_entries[i.entry];
+            if (entry.key == i.key && entry.page == m_compact_page)
+            {
+                entry.rect = i.rect;
+            }
+            else
+            {
+                page.allocator.Free(i.rect);
+            }
+        }
+
+        this->CancelAtlasCompaction();
+        m_atlas_compaction_count += 1;
+        m_atlas_remapped = true;
+
+        return true;
+    }
+
+    AtlasStats CanvasRenderer::GetAtlasStats() const
+    {
+        AtlasStats stats;
+        stats.width = ATLAS_SIZE;
+        stats.height = ATLAS_SIZE;
+        stats.page_count = m_atlas_pages.Size();
+        stats.entry_count = 0;
+        stats.referenced_entry_count = 0;
+        stats.used_area = 0;
+        stats.allocated_area = 0;
+        stats.eviction_count = m_atlas_eviction_count;
+        stats.compaction_count = m_atlas_compaction_count;
+
+        for (const auto& i : m_atlas_pages)
+        {
+            stats.used_area += i.allocator.GetUsedArea();
+            stats.allocated_area += i.allocator.GetAllocatedArea();
+        }
+
+        for (const auto& i : m_atlas_entries)
+        {
+            if (i.key != 0)
+            {
+                stats.entry_count += 1;
+
+                if (i.ref_count > 0)
+                {
+                    stats.referenced_entry_count += 1;
+                }
+            }
+        }
+
+        return stats;
+    }
+
+    void CanvasRenderer::HandleTouchEvent()
+    {
+        int touch_count = Input::GetTouchCount();
+        for (int i = 0; i < touch_count; ++i)
+        {
+            this->HitViews(Input::GetTouch(i));
+        }
+    }
+
+    static bool IsPointInView(const Vector2i& pos, const Vector<Mesh::Vertex>& vertices)
+    {
+        // ax + by + c = 0
+        // a = y1 - y0
+        // b = x0 - x1
+        // c = x1y0 - x0y1
+        float x0 = vertices[0].vertex.x;
+        float y0 = vertices[0].vertex.y;
+        float x1 = vertices[1].vertex.x;
+        float y1 = vertices[1].vertex.y;
+        float x2 = vertices[2].vertex.x;
+        float y2 = vertices[2].vertex.y;
+        float x3 = vertices[3].vertex.x;
+        float y3 = vertices[3].vertex.y;
+        Vector3 lines[4];
+        lines[0] = Vector3(y1 - y0, x0 - x1, x1 * y0 - x0 * y1);
+        lines[1] = Vector3(y2 - y1, x1 - x2, x2 * y1 - x1 * y2);
+        lines[2] = Vector3(y3 - y2, x2 - x3, x3 * y2 - x2 * y3);
+        lines[3] = Vector3(y0 - y3, x3 - x0, x0 * y3 - x3 * y0);
+
+        bool all_positive = true;
+        bool all_negative = true;
+
+        for (int i = 0; i < 4; ++i)
+        {
+            float sign = lines[i].x * pos.x + lines[i].y * pos.y + lines[i].z;
+            if (sign >= 0)
+            {
+                all_negative = false;
+            }
+            if (sign <= 0)
+            {
+                all_positive = false;
+            }
+        }
+
+        return all_positive || all_negative;
+    }
+
+    bool CanvasRenderer::IsPointInView(const Vector2i& pos, const View* view) const
+    {
+        for (const auto& i : view->m_meshes)
+        {
+            if (i.base_view)
+            {
+                return Viry3D::IsPointInView(pos, i.vertices);
+            }
+        }
+        return false;
+    }
+
+    void CanvasRenderer::BuildHitGrid()
+    {
+        m_hit_grid_dirty = false;
+        m_hit_entries.Clear();
+
+        float canvas_w = (float) this->GetCamera()->GetTargetWidth();
+        float canvas_h = (float) this->GetCamera()->GetTargetHeight();
+        m_hit_grid_width = Mathf::Max((int) ceil(canvas_w / HIT_GRID_CELL_SIZE), 1);
+        m_hit_grid_height = Mathf::Max((int) ceil(canvas_h / HIT_GRID_CELL_SIZE), 1);
+
+        for (int i = 0; i < m_slots.Size(); ++i)
+        {
+            View* view = m_slots[i].view;
+            if (!view->IsInteractive())
+            {
+                continue;
+            }
+
+            for (const auto& j : view->m_meshes)
+            {
+                if (j.base_view)
+                {
+                    // clip rect is top down and normalized, vertex y is 0 at the top and goes down negative
+                    const Rect& clip = m_slots[i].clip_rect;
+                    CanvasHitEntry entry;
+                    entry.view = view;
+                    entry.slot = i;
+                    entry.x_min = clip.x * canvas_w;
+                    entry.x_max = (clip.x + clip.w) * canvas_w;
+                    entry.y_min = -(clip.y + clip.h) * canvas_h;
+                    entry.y_max = -clip.y * canvas_h;
+
+                    Vector3 min = j.vertices[0].vertex;
+                    Vector3 max = min;
+                    for (const auto& k : j.vertices)
                     {
-                        if (IsPointInView(pos, m_view_meshes[i].vertices))
-                        {
-                            bool block_event = view->OnTouchUpInside(pos);
-
-                            if (block_event)
-                            {
-                                blocked = true;
-                            }
-                        }
+                        min = Vector3::Min(min, k.vertex);
+                        max = Vector3::Max(max, k.vertex);
                     }
-                    else
+                    entry.x_min = Mathf::Max(entry.x_min, min.x);
+                    entry.x_max = Mathf::Min(entry.x_max, max.x);
+                    entry.y_min = Mathf::Max(entry.y_min, min.y);
+                    entry.y_max = Mathf::Min(entry.y_max, max.y);
+
+                    if (entry.x_min <= entry.x_max && entry.y_min <= entry.y_max)
                     {
-                        view->OnTouchUpOutside(pos);
+                        m_hit_entries.Add(entry);
                     }
+                    break;
+                }
+            }
+        }
+
+        // counting pass then fill pass, cells keep the entries in draw order
+        int cell_count = m_hit_grid_width * m_hit_grid_height;
+        m_hit_cell_offsets.Clear();
+        m_hit_cell_offsets.Resize(cell_count + 1, 0);
+
+        auto get_cell_range = [&](const CanvasHitEntry& entry, int& x0, int& y0, int& x1, int& y1) {
+            x0 = Mathf::Clamp((int) floor(entry.x_min / HIT_GRID_CELL_SIZE), 0, m_hit_grid_width - 1);
+            x1 = Mathf::Clamp((int) floor(entry.x_max / HIT_GRID_CELL_SIZE), 0, m_hit_grid_width - 1);
+            y0 = Mathf::Clamp((int) floor(-entry.y_max / HIT_GRID_CELL_SIZE), 0, m_hit_grid_height - 1);
+            y1 = Mathf::Clamp((int) floor(-entry.y_min / HIT_GRID_CELL_SIZE), 0, m_hit_grid_height - 1);
+        };
+
+        for (const auto& i : m_hit_entries)
+        {
+            int x0, y0, x1, y1;
+            get_cell_range(i, x0, y0, x1, y1);
+            for (int y = y0; y <= y1; ++y)
+            {
+                for (int x = x0; x <= x1; ++x)
+                {
+                    m_hit_cell_offsets[y * m_hit_grid_width + x + 1] += 1;
                 }
             }
+        }
+
+        for (int i = 0; i < cell_count; ++i)
+        {
+            m_hit_cell_offsets[i + 1] += m_hit_cell_offsets[i];
+        }
+
+        Vector<int> cursors(cell_count);
+        for (int i = 0; i < cell_count; ++i)
+        {
+            cursors[i] = m_hit_cell_offsets[i];
+        }
+
+        m_hit_cell_entries.Resize(m_hit_cell_offsets[cell_count]);
+        for (int i = 0; i < m_hit_entries.Size(); ++i)
+        {
+            int x0, y0, x1, y1;
+            get_cell_range(m_hit_entries[i], x0, y0, x1, y1);
+            for (int y = y0; y <= y1; ++y)
+            {
+                for (int x = x0; x <= x1; ++x)
+                {
+                    m_hit_cell_entries[cursors[y * m_hit_grid_width + x]++] = i;
+                }
+            }
+        }
+    }
+
+    void CanvasRenderer::QueryHitGrid(const Vector2i& pos, Vector<int>& entries) const
+    {
+        entries.Clear();
+
+        int x = (int) floor(pos.x / (float) HIT_GRID_CELL_SIZE);
+        int y = (int) floor(-pos.y / (float) HIT_GRID_CELL_SIZE);
+        if (x < 0 || x >= m_hit_grid_width || y < 0 || y >= m_hit_grid_height)
+        {
+            return;
+        }
+
+        // topmost first
+        int cell = y * m_hit_grid_width + x;
+        for (int i = m_hit_cell_offsets[cell + 1] - 1; i >= m_hit_cell_offsets[cell]; --i)
+        {
+            int index = m_hit_cell_entries[i];
+            const CanvasHitEntry& entry = m_hit_entries[index];
+
+            if (pos.x >= entry.x_min && pos.x <= entry.x_max &&
+                pos.y >= entry.y_min && pos.y <= entry.y_max &&
+                this->IsPointInView(pos, entry.view))
+            {
+                entries.Add(index);
+            }
+        }
+    }
+
+    void CanvasRenderer::HitViews(const Touch& t)
+    {
+        Vector2i pos = Vector2i((int) t.position.x, (int) t.position.y);
+        pos.y -= this->GetCamera()->GetTargetHeight();
+
+        if (m_hit_grid_dirty)
+        {
+            this->BuildHitGrid();
+        }
+
+        Vector<int> hits;
+        this->QueryHitGrid(pos, hits);
+
+        if (t.phase == TouchPhase::Began)
+        {
+            for (int i = 0; i < hits.Size(); ++i)
+            {
+                View* view = m_hit_entries[hits[i]].view;
+
+                List<View*>* touch_down_views_ptr;
+                if (m_touch_down_views.TryGet(t.fingerId, &touch_down_views_ptr))
+                {
+                    touch_down_views_ptr->AddLast(view);
+                }
+                else
+                {
+                    List<View*> views;
+                    views.AddLast(view);
+                    m_touch_down_views.Add(t.fingerId, views);
+                }
+
+                bool block_event = view->OnTouchDownInside(pos);
+
+                if (block_event)
+                {
+                    break;
+                }
+            }
+        }
+        else if (t.phase == TouchPhase::Moved)
+        {
+            List<View*>* touch_down_views_ptr;
+            if (m_touch_down_views.TryGet(t.fingerId, &touch_down_views_ptr))
+            {
+                for (View* j : *touch_down_views_ptr)
+                {
+                    bool block_event = j->OnTouchDrag(pos);
+
+                    if (block_event)
+                    {
+                        break;
+                    }
+                }
+            }
+
+            for (int i = 0; i < hits.Size(); ++i)
+            {
+                View* view = m_hit_entries[hits[i]].view;
+
+                bool block_event = view->OnTouchMoveInside(pos);
+
+                if (block_event)
+                {
+                    break;
+                }
+            }
+        }
+        else if (t.phase == TouchPhase::Ended)
+        {
+            int blocked_entry = -1;
+            for (int i = 0; i < hits.Size(); ++i)
+            {
+                View* view = m_hit_entries[hits[i]].view;
+
+                bool block_event = view->OnTouchUpInside(pos);
+
+                if (block_event)
+                {
+                    blocked_entry = hits[i];
+                    break;
+                }
+            }
+
+            // every interactive view under the blocking one gets a touch up outside
+            for (int i = blocked_entry - 1; i >= 0; --i)
+            {
+                m_hit_entries[i].view->OnTouchUpOutside(pos);
+            }
 
             m_touch_down_views.Remove(t.fingerId);
         }
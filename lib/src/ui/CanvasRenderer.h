@@ -21,8 +21,10 @@
 #include "graphics/Texture.h"
 #include "container/Vector.h"
 #include "container/Map.h"
+#include "container/List.h"
 #include "math/Recti.h"
 #include "View.h"
+#include "AtlasAllocator.h"
 
 namespace Viry3D
 {
@@ -31,11 +33,75 @@ namespace Viry3D
 	class Camera;
     struct Touch;
 
-    struct AtlasTreeNode
+    // a texture or glyph image packed into the canvas atlas,
+    // referenced by the slots drawing it and evicted lru once unreferenced
+    struct AtlasEntry
     {
+        int key;
+        int page;
         Recti rect;
-        int layer;
-        Vector<AtlasTreeNode*> children;
+        int ref_count;
+        int last_used;
+    };
+
+    // one texture of the canvas atlas, more pages are added once the first ones are full
+    struct AtlasPage
+    {
+        Ref<Texture> texture;
+        AtlasAllocator allocator;
+    };
+
+    // an entry copied into the texture of the page being compacted
+    struct AtlasMove
+    {
+        int entry;
+        int key;
+        Recti rect;
+    };
+
+    struct AtlasStats
+    {
+        int width;
+        int height;
+        int page_count;
+        int entry_count;
+        int referenced_entry_count;
+        int used_area;
+        int allocated_area;
+        int eviction_count;
+        int compaction_count;
+
+        float GetOccupancy() const { return used_area / (float) (width * height * page_count); }
+    };
+
+    // range of the canvas buffers owned by one view, slots are laid out in draw order
+    struct CanvasViewSlot
+    {
+        View* view;
+        Rect clip_rect;
+        int vertex_first;
+        int vertex_capacity;
+        int index_first;
+        int index_capacity;
+        Vector<int> atlas_entries;
+    };
+
+    // material state of one canvas submesh
+    struct CanvasBatch
+    {
+        Rect clip_rect;
+        int page;
+    };
+
+    // screen bounds of an interactive view in vertex space, clipped by its clip rect
+    struct CanvasHitEntry
+    {
+        View* view;
+        int slot;
+        float x_min;
+        float y_min;
+        float x_max;
+        float y_max;
     };
 
     class CanvasRenderer : public MeshRenderer
@@ -48,8 +114,12 @@ namespace Viry3D
         void RemoveAllViews();
         const Vector<Ref<View>>& GetViews() const { return m_views; }
 		void MarkCanvasDirty();
+        void MarkViewDirty();
+        // touch callbacks changed, the hit test grid indexes interactive views only
+        void MarkHitTestDirty() { m_hit_grid_dirty = true; }
 		Ref<Camera> GetCamera() const { return m_camera.lock(); }
 		void SetCamera(const Ref<Camera>& camera) { m_camera = camera; }
+        AtlasStats GetAtlasStats() const;
 
 	protected:
 		virtual void Prepare();
@@ -57,23 +127,64 @@ namespace Viry3D
 
 	private:
         void CreateMaterial();
-        void NewAtlasTextureLayer();
+        Ref<Texture> CreateAtlasTexture() const;
+        void AddAtlasPage();
         void UpdateCanvas();
+        void UpdateView(View* view, const Rect& clip_rect, bool layout_updated, bool rebuild, Vector<View*>& filled_views, Vector<View*>& colored_views);
+        bool UpdateChangedMeshes(View* view);
+        void GetSlotGeometrySize(const View* view, int& vertex_count, int& index_count) const;
+        void AddAtlasVertices(const ViewMesh& mesh, Vector<Mesh::Vertex>& vertices) const;
+        void FillSlotGeometry(const CanvasViewSlot& slot, Vector<Mesh::Vertex>& vertices, Vector<unsigned int>& indices) const;
+        void LayoutSlots();
+        void UploadSlot(const CanvasViewSlot& slot, bool color_only);
+        void BuildBatches(Vector<Mesh::Submesh>& submeshes, Vector<CanvasBatch>& batches) const;
+        void UpdateMaterials(const Vector<CanvasBatch>& batches);
         void UpdateAtlas(ViewMesh& mesh, bool& updated);
-        AtlasTreeNode* FindAtlasTreeNodeToInsert(int w, int h, AtlasTreeNode* node);
-        void ReleaseAtlasTreeNode(AtlasTreeNode* node);
+        bool AllocateAtlasRect(int w, int h, int& page, Recti& rect);
+        void ReleaseAtlasEntries(Vector<int>& entries);
+        void FreeAtlasEntry(int index);
+        int FindFragmentedAtlasPage() const;
+        void BeginAtlasCompaction(int page);
+        void CancelAtlasCompaction();
+        bool StepAtlasCompaction();
         void HandleTouchEvent();
         void HitViews(const Touch& t);
+        bool IsPointInView(const Vector2i& pos, const View* view) const;
+        void BuildHitGrid();
+        void QueryHitGrid(const Vector2i& pos, Vector<int>& entries) const;
 
 	private:
 		Vector<Ref<View>> m_views;
 		bool m_canvas_dirty;
-        Ref<Texture> m_atlas;
-        int m_atlas_array_size;
-        Vector<AtlasTreeNode*> m_atlas_tree;
-        Map<int, AtlasTreeNode*> m_atlas_cache;
-        Vector<ViewMesh> m_view_meshes;
+        bool m_structure_dirty;
+        bool m_batches_dirty;
+        Vector<AtlasPage> m_atlas_pages;
+        Vector<AtlasEntry> m_atlas_entries;
+        Vector<int> m_free_atlas_entries;
+        Map<int, int> m_atlas_cache;
+        int m_atlas_frame;
+        int m_atlas_compact_frame;
+        int m_atlas_eviction_count;
+        int m_atlas_compaction_count;
+        bool m_atlas_remapped;
+        // page re-packed into a new texture over several canvas updates, -1 if none.
+        // new entries never go to this page until the compaction ends
+        int m_compact_page;
+        Ref<Texture> m_compact_texture;
+        AtlasAllocator m_compact_allocator;
+        List<int> m_compact_entries;
+        Vector<AtlasMove> m_compact_moves;
+        Vector<CanvasViewSlot> m_slots;
+        int m_vertex_capacity;
+        int m_index_capacity;
         Map<int, List<View*>> m_touch_down_views;
+        // uniform grid over the canvas, each cell lists the hit entries overlapping it in draw order
+        Vector<CanvasHitEntry> m_hit_entries;
+        Vector<int> m_hit_cell_offsets;
+        Vector<int> m_hit_cell_entries;
+        int m_hit_grid_width;
+        int m_hit_grid_height;
+        bool m_hit_grid_dirty;
         FilterMode m_filter_mode;
 		WeakRef<Camera> m_camera;
 	};
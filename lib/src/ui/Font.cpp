@@ -22,6 +22,7 @@
 #include "graphics/Image.h"
 #include "Debug.h"
 #include "Engine.h"
+#include "math/Mathf.h"
 #include <ft2build.h>
 #include FT_FREETYPE_H
 #include "ftoutln.h"
@@ -112,7 +113,8 @@ namespace Viry3D
 	}
 
 	Font::Font():
-		m_font(nullptr)
+		m_font(nullptr),
+        m_glyph_count(0)
 	{
 
 	}
@@ -125,40 +127,172 @@ namespace Viry3D
 		}
 	}
 
-	GlyphInfo Font::GetGlyph(char32_t c, int size, bool bold, bool italic, bool mono)
+    const String& Font::GetASCIICharset()
+    {
+        static String s_charset;
+        if (s_charset.Size() == 0)
+        {
+            for (char c = 32; c < 127; ++c)
+            {
+                s_charset += String(&c, 1);
+            }
+        }
+        return s_charset;
+    }
+
+    static uint64_t GetGlyphKey(char32_t c, int size, bool bold, bool italic, bool mono, bool sdf)
+    {
+        return ((uint64_t) c << 32) |
+            (uint64_t) (size & 0xffff) |
+            (bold ? (1u << 31) : 0u) |
+            (italic ? (1u << 30) : 0u) |
+            (mono ? (1u << 29) : 0u) |
+            (sdf ? (1u << 28) : 0u);
+    }
+
+    static uint32_t HashGlyphKey(uint64_t key)
+    {
+        // 64 bit finalizer of murmur3
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        key *= 0xc4ceb9fe1a85ec53ULL;
+        key ^= key >> 33;
+        return (uint32_t) key;
+    }
+
+    GlyphInfo* Font::FindGlyph(uint64_t key) const
+    {
+        if (m_glyph_table.Size() == 0)
+        {
+            return nullptr;
+        }
+
+        int mask = m_glyph_table.Size() - 1;
+        int index = HashGlyphKey(key) & mask;
+
+        while (m_glyph_table[index].glyph)
+        {
+            if (m_glyph_table[index].key == key)
+            {
+                return m_glyph_table[index].glyph;
+            }
+            index = (index + 1) & mask;
+        }
+
+        return nullptr;
+    }
+
+    GlyphInfo* Font::AddGlyph(uint64_t key)
+    {
+        // keep the load factor below one half, the table size is a power of two
+        if ((m_glyph_count + 1) * 2 > m_glyph_table.Size())
+        {
+            Vector<GlyphSlot> table(Mathf::Max(m_glyph_table.Size() * 2, 256), { 0, nullptr });
+            int mask = table.Size() - 1;
+
+            for (const auto& i : m_glyph_table)
+            {
+                if (i.glyph)
+                {
+                    int index = HashGlyphKey(i.key) & mask;
+                    while (table[index].glyph)
+                    {
+                        index = (index + 1) & mask;
+                    }
+                    table[index] = i;
+                }
+            }
+
+            m_glyph_table = std::move(table);
+        }
+
+        m_glyph_storage.AddLast(GlyphInfo());
+        GlyphInfo* glyph = &m_glyph_storage.Last();
+
+        int mask = m_glyph_table.Size() - 1;
+        int index = HashGlyphKey(key) & mask;
+        while (m_glyph_table[index].glyph)
+        {
+            index = (index + 1) & mask;
+        }
+        m_glyph_table[index].key = key;
+        m_glyph_table[index].glyph = glyph;
+        m_glyph_count += 1;
+
+        return glyph;
+    }
+
+	const GlyphInfo& Font::GetGlyph(char32_t c, int size, bool bold, bool italic, bool mono)
 	{
-		int size_key = size |
-			(bold ? (1 << 31) : 0) |
-			(italic ? (1 << 30) : 0) |
-			(mono ? (1 << 29) : 0);
+        uint64_t key = GetGlyphKey(c, size, bold, italic, mono, false);
 
-		Map<int, GlyphInfo>* p_size_glyphs;
-		if (!m_glyphs.TryGet(c, &p_size_glyphs))
-		{
-			Map<int, GlyphInfo> size_glyphs;
-			m_glyphs.Add(c, size_glyphs);
+        GlyphInfo* glyph = this->FindGlyph(key);
+        if (glyph == nullptr)
+        {
+            glyph = this->AddGlyph(key);
+            glyph->c = c;
+            glyph->size = size;
+            glyph->bold = bold;
+            glyph->italic = italic;
+            glyph->mono = mono;
+            glyph->sdf = false;
+            glyph->padding = 0;
+
+            this->RasterizeGlyph(glyph);
+        }
 
-			p_size_glyphs = &m_glyphs[c];
-		}
+        return *glyph;
+    }
 
-		GlyphInfo* p_glyph;
-		if (!p_size_glyphs->TryGet(size_key, &p_glyph))
-		{
-			GlyphInfo glyph;
-			p_size_glyphs->Add(size_key, glyph);
+    const GlyphInfo& Font::GetSDFGlyph(char32_t c)
+    {
+        uint64_t key = GetGlyphKey(c, FONT_SDF_GLYPH_SIZE, false, false, false, true);
 
-			p_glyph = &(*p_size_glyphs)[size_key];
-		}
-		else
-		{
-			return *p_glyph;
-		}
+        GlyphInfo* glyph = this->FindGlyph(key);
+        if (glyph == nullptr)
+        {
+            glyph = this->AddGlyph(key);
+            glyph->c = c;
+            glyph->size = FONT_SDF_GLYPH_SIZE;
+            glyph->bold = false;
+            glyph->italic = false;
+            glyph->mono = false;
+            glyph->sdf = true;
+            glyph->padding = FONT_SDF_SPREAD;
+
+            this->RasterizeSDFGlyph(glyph);
+        }
+
+        return *glyph;
+    }
+
+    void Font::PrewarmGlyphs(const String& chars, int size, bool bold, bool italic, bool mono)
+    {
+        auto unicode = chars.ToUnicode32();
+        for (int i = 0; i < unicode.Size(); ++i)
+        {
+            this->GetGlyph(unicode[i], size, bold, italic, mono);
+        }
+    }
+
+    void Font::PrewarmSDFGlyphs(const String& chars)
+    {
+        auto unicode = chars.ToUnicode32();
+        for (int i = 0; i < unicode.Size(); ++i)
+        {
+            this->GetSDFGlyph(unicode[i]);
+        }
+    }
 
-		p_glyph->c = c;
-		p_glyph->size = size;
-		p_glyph->bold = bold;
-		p_glyph->italic = italic;
-		p_glyph->mono = mono;
+    void Font::RasterizeGlyph(GlyphInfo* glyph)
+    {
+        char32_t c = glyph->c;
+        int size = glyph->size;
+        bool bold = glyph->bold;
+        bool italic = glyph->italic;
+        bool mono = glyph->mono;
+        GlyphInfo* p_glyph = glyph;
 
 		FT_Face face = (FT_Face) m_font;
         FT_Set_Char_Size(face, size << 6, size << 6, 0, 0);
@@ -250,10 +384,191 @@ namespace Viry3D
             p_glyph->image->format = ImageFormat::R8G8B8A8;
             p_glyph->image->data = pixels;
         }
-
-		return *p_glyph;
 	}
 
+    // squared euclidean distance transform of a sampled function in one dimension (Felzenszwalb & Huttenlocher)
+    static void DistanceTransform1D(const float* f, float* d, int* v, float* z, int n)
+    {
+        const float inf = 1e20f;
+        int k = 0;
+        v[0] = 0;
+        z[0] = -inf;
+        z[1] = inf;
+
+        for (int q = 1; q < n; ++q)
+        {
+            float s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2 * q - 2 * v[k]);
+            while (s <= z[k])
+            {
+                --k;
+                s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2 * q - 2 * v[k]);
+            }
+            ++k;
+            v[k] = q;
+            z[k] = s;
+            z[k + 1] = inf;
+        }
+
+        k = 0;
+        for (int q = 0; q < n; ++q)
+        {
+            while (z[k + 1] < q)
+            {
+                ++k;
+            }
+            d[q] = (q - v[k]) * (q - v[k]) + f[v[k]];
+        }
+    }
+
+    static void DistanceTransform2D(Vector<float>& grid, int width, int height)
+    {
+        int n = Mathf::Max(width, height);
+        Vector<float> f(n);
+        Vector<float> d(n);
+        Vector<int> v(n);
+        Vector<float> z(n + 1);
+
+        for (int x = 0; x < width; ++x)
+        {
+            for (int y = 0; y < height; ++y)
+            {
+                f[y] = grid[y * width + x];
+            }
+            DistanceTransform1D(&f[0], &d[0], &v[0], &z[0], height);
+            for (int y = 0; y < height; ++y)
+            {
+                grid[y * width + x] = d[y];
+            }
+        }
+
+        for (int y = 0; y < height; ++y)
+        {
+            DistanceTransform1D(&grid[y * width], &d[0], &v[0], &z[0], width);
+            Memory::Copy(&grid[y * width], &d[0], sizeof(float) * width);
+        }
+    }
+
+    static int FloorDiv(int a, int b)
+    {
+        return (int) floor(a / (float) b);
+    }
+
+    static int CeilDiv(int a, int b)
+    {
+        return (int) ceil(a / (float) b);
+    }
+
+    void Font::RasterizeSDFGlyph(GlyphInfo* glyph)
+    {
+        // rasterize at a higher resolution, then downsample the signed distance to the reference size
+        const int upscale = 4;
+        const int spread = glyph->padding;
+        int size = glyph->size * upscale;
+
+        FT_Face face = (FT_Face) m_font;
+        FT_Set_Char_Size(face, size << 6, size << 6, 0, 0);
+
+        FT_GlyphSlot slot = face->glyph;
+        glyph->glyph_index = FT_Get_Char_Index(face, glyph->c);
+
+        FT_Load_Char(face, glyph->c, FT_LOAD_DEFAULT);
+        FT_Render_Glyph(face->glyph, FT_RENDER_MODE_NORMAL);
+
+        glyph->advance_x = (int) Mathf::Round(slot->advance.x / 64.0f / upscale);
+        glyph->advance_y = (int) Mathf::Round(slot->advance.y / 64.0f / upscale);
+
+        int bitmap_width = slot->bitmap.width;
+        int bitmap_height = slot->bitmap.rows;
+        if (bitmap_width == 0 || bitmap_height == 0)
+        {
+            glyph->width = 0;
+            glyph->height = 0;
+            glyph->bearing_x = 0;
+            glyph->bearing_y = 0;
+            return;
+        }
+
+        // align the high resolution bitmap to the reference pixel grid and pad it with the spread
+        int left = FloorDiv(slot->bitmap_left, upscale) - spread;
+        int right = CeilDiv(slot->bitmap_left + bitmap_width, upscale) + spread;
+        int top = CeilDiv(slot->bitmap_top, upscale) + spread;
+        int bottom = FloorDiv(slot->bitmap_top - bitmap_height, upscale) - spread;
+        int offset_x = slot->bitmap_left - left * upscale;
+        int offset_y = top * upscale - slot->bitmap_top;
+
+        glyph->width = right - left;
+        glyph->height = top - bottom;
+        glyph->bearing_x = left;
+        glyph->bearing_y = top;
+
+        int grid_width = glyph->width * upscale;
+        int grid_height = glyph->height * upscale;
+        const float inf = 1e20f;
+        Vector<float> outside(grid_width * grid_height);
+        Vector<float> inside(grid_width * grid_height);
+
+        for (int y = 0; y < grid_height; ++y)
+        {
+            for (int x = 0; x < grid_width; ++x)
+            {
+                int bx = x - offset_x;
+                int by = y - offset_y;
+                bool in = false;
+                if (bx >= 0 && bx < bitmap_width && by >= 0 && by < bitmap_height)
+                {
+                    in = slot->bitmap.buffer[by * slot->bitmap.pitch + bx] >= 128;
+                }
+
+                outside[y * grid_width + x] = in ? 0 : inf;
+                inside[y * grid_width + x] = in ? inf : 0;
+            }
+        }
+
+        DistanceTransform2D(outside, grid_width, grid_height);
+        DistanceTransform2D(inside, grid_width, grid_height);
+
+        ByteBuffer pixels = ByteBuffer(glyph->width * glyph->height * 4);
+
+        for (int i = 0; i < glyph->height; ++i)
+        {
+            for (int j = 0; j < glyph->width; ++j)
+            {
+                float distance = 0;
+                for (int y = i * upscale; y < (i + 1) * upscale; ++y)
+                {
+                    for (int x = j * upscale; x < (j + 1) * upscale; ++x)
+                    {
+                        float d_out = outside[y * grid_width + x];
+                        float d_in = inside[y * grid_width + x];
+                        // distance from the pixel center to the edge, positive outside
+                        if (d_out > 0)
+                        {
+                            distance += sqrt(d_out) - 0.5f;
+                        }
+                        else
+                        {
+                            distance -= sqrt(d_in) - 0.5f;
+                        }
+                    }
+                }
+                distance /= upscale * upscale * upscale;
+
+                float alpha = Mathf::Clamp01(0.5f - distance / (2.0f * spread));
+
+                pixels[i * glyph->width * 4 + j * 4 + 0] = 255;
+                pixels[i * glyph->width * 4 + j * 4 + 1] = 255;
+                pixels[i * glyph->width * 4 + j * 4 + 2] = 255;
+                pixels[i * glyph->width * 4 + j * 4 + 3] = (unsigned char) Mathf::Round(alpha * 255);
+            }
+        }
+
+        glyph->image = RefMake<Image>();
+        glyph->image->width = glyph->width;
+        glyph->image->height = glyph->height;
+        glyph->image->format = ImageFormat::R8G8B8A8;
+        glyph->image->data = pixels;
+    }
+
     bool Font::HasKerning() const
     {
         FT_Face face = (FT_Face) m_font;
@@ -20,9 +20,15 @@
 #include "Object.h"
 #include "memory/Ref.h"
 #include "container/Map.h"
+#include "container/List.h"
 #include "string/String.h"
 #include "math/Vector2i.h"
 
+// distance field glyphs are rasterized once at this pixel size and scaled by the ui shader
+#define FONT_SDF_GLYPH_SIZE 48
+// distance range in pixels of the reference size, on each side of the glyph edge
+#define FONT_SDF_SPREAD 6
+
 namespace Viry3D
 {
     enum class FontType
@@ -49,6 +55,9 @@ namespace Viry3D
 		bool bold;
 		bool italic;
 		bool mono;
+        // metrics of sdf glyphs are in FONT_SDF_GLYPH_SIZE pixels and include the padding
+        bool sdf;
+        int padding;
         Ref<Image> image;
 	};
 
@@ -59,18 +68,38 @@ namespace Viry3D
 		static void Done();
         static Ref<Font> GetFont(FontType type);
 		static Ref<Font> LoadFromFile(const String& file);
+        static const String& GetASCIICharset();
 		virtual ~Font();
-		GlyphInfo GetGlyph(char32_t c, int size, bool bold, bool italic, bool mono);
+        // returned glyphs stay valid for the lifetime of the font
+		const GlyphInfo& GetGlyph(char32_t c, int size, bool bold, bool italic, bool mono);
+        // one distance field per char shared by all sizes, bold and italic are applied when drawing
+        const GlyphInfo& GetSDFGlyph(char32_t c);
+        void PrewarmGlyphs(const String& chars, int size, bool bold, bool italic, bool mono);
+        void PrewarmSDFGlyphs(const String& chars);
+        int GetGlyphCount() const { return m_glyph_count; }
         bool HasKerning() const;
         Vector2i GetKerning(unsigned int previous_glyph_index, unsigned int glyph_index);
 
 	private:
+        struct GlyphSlot
+        {
+            uint64_t key;
+            GlyphInfo* glyph;
+        };
+
 		Font();
+        GlyphInfo* FindGlyph(uint64_t key) const;
+        GlyphInfo* AddGlyph(uint64_t key);
+        void RasterizeGlyph(GlyphInfo* glyph);
+        void RasterizeSDFGlyph(GlyphInfo* glyph);
 
     private:
         static Map<FontType, Ref<Font>> m_fonts;
 		void* m_font;
         ByteBuffer m_face_buffer;
-		Map<char32_t, Map<int, GlyphInfo>> m_glyphs;
+        // open addressing table over stable glyph storage
+        Vector<GlyphSlot> m_glyph_table;
+        List<GlyphInfo> m_glyph_storage;
+        int m_glyph_count;
 	};
 }
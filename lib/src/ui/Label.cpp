@@ -19,6 +19,7 @@
 #include "CanvasRenderer.h"
 #include "Font.h"
 #include "graphics/Texture.h"
+#include "container/List.h"
 #include "Debug.h"
 
 namespace Viry3D
@@ -55,7 +56,7 @@ namespace Viry3D
 		{
 			for (int i = 0; i < tag_str.Size(); ++i)
 			{
-				if (tag_cstr[i] != str[char_index + i])
+				if ((char32_t) tag_cstr[i] != str[char_index + i])
 				{
 					match = false;
 					break;
@@ -120,7 +121,7 @@ namespace Viry3D
 		{
 			for (int i = 0; i < tag_str.Size(); ++i)
 			{
-				if (tag_cstr[i] != str[char_index + i])
+				if ((char32_t) tag_cstr[i] != str[char_index + i])
 				{
 					match = false;
 					break;
@@ -240,6 +241,285 @@ namespace Viry3D
     }
 
 
+    static const float SDF_BOLD_DILATION = 0.5f;
+    static const float SDF_OUTLINE_DILATION = 1.0f;
+    static const float SDF_SHADOW_SOFTNESS = 2.0f;
+    static const float SDF_MAX_DILATION = 0.45f;
+
+    // sdf glyph metrics are at the reference size, bring them to the font size
+    static GlyphInfo ScaleGlyphMetrics(const GlyphInfo& info, int font_size)
+    {
+        GlyphInfo scaled = info;
+
+        if (info.sdf)
+        {
+            float scale = font_size / (float) info.size;
+
+            scaled.width = Mathf::RoundToInt(info.width * scale);
+            scaled.height = Mathf::RoundToInt(info.height * scale);
+            scaled.bearing_x = Mathf::RoundToInt(info.bearing_x * scale);
+            scaled.bearing_y = Mathf::RoundToInt(info.bearing_y * scale);
+            scaled.advance_x = Mathf::RoundToInt(info.advance_x * scale);
+            scaled.advance_y = Mathf::RoundToInt(info.advance_y * scale);
+            scaled.padding = Mathf::RoundToInt(info.padding * scale);
+        }
+
+        return scaled;
+    }
+
+    static void AddQuad(CharMesh& mesh, int& vertex_count, int x0, int y0, int x1, int y1, const Vector2i& offset, int skew0, int skew1, const Color& color, const Vector2& style)
+    {
+        mesh.vertices.Add(Vector2i(x0 + skew0, y0) + offset);
+        mesh.vertices.Add(Vector2i(x0 + skew1, y1) + offset);
+        mesh.vertices.Add(Vector2i(x1 + skew1, y1) + offset);
+        mesh.vertices.Add(Vector2i(x1 + skew0, y0) + offset);
+        mesh.uv.Add(Vector2(0, 0));
+        mesh.uv.Add(Vector2(0, 1));
+        mesh.uv.Add(Vector2(1, 1));
+        mesh.uv.Add(Vector2(1, 0));
+        mesh.colors.Add(color);
+        mesh.colors.Add(color);
+        mesh.colors.Add(color);
+        mesh.colors.Add(color);
+        mesh.styles.Add(style);
+        mesh.styles.Add(style);
+        mesh.styles.Add(style);
+        mesh.styles.Add(style);
+        mesh.indices.Add(vertex_count + 0);
+        mesh.indices.Add(vertex_count + 1);
+        mesh.indices.Add(vertex_count + 2);
+        mesh.indices.Add(vertex_count + 0);
+        mesh.indices.Add(vertex_count + 2);
+        mesh.indices.Add(vertex_count + 3);
+
+        vertex_count += 4;
+    }
+
+    struct CharStyle
+    {
+        Color color;
+        bool bold;
+        bool italic;
+        bool underline;
+        bool shadow;
+        Color shadow_color;
+        bool outline;
+        Color outline_color;
+    };
+
+    // resolve the tag spans into one style index per char, each tag is parsed once
+    static void BuildCharStyles(const Vector<TagInfo>& tags, int char_count, const CharStyle& base_style, Vector<CharStyle>& styles, Vector<int>& style_indices)
+    {
+        styles.Clear();
+        styles.Add(base_style);
+        style_indices.Clear();
+        style_indices.Resize(char_count, 0);
+
+        for (const auto& tag : tags)
+        {
+            Color tag_color;
+            if (tag.type == TagType::Color || tag.type == TagType::Shadow || tag.type == TagType::Outline)
+            {
+                tag_color = Color::Parse(tag.value);
+            }
+
+            // styles derived by this tag from the styles already in its span
+            Map<int, int> derived;
+
+            for (int i = tag.begin; i < tag.end && i < char_count; ++i)
+            {
+                int* derived_index;
+                if (derived.TryGet(style_indices[i], &derived_index))
+                {
+                    style_indices[i] = *derived_index;
+                    continue;
+                }
+
+                CharStyle style = styles[style_indices[i]];
+                switch (tag.type)
+                {
+                    case TagType::Color:
+                        style.color = tag_color;
+                        break;
+                    case TagType::Bold:
+                        style.bold = true;
+                        break;
+                    case TagType::Italic:
+                        style.italic = true;
+                        break;
+                    case TagType::Shadow:
+                        style.shadow = true;
+                        style.shadow_color = tag_color;
+                        break;
+                    case TagType::Outline:
+                        style.outline = true;
+                        style.outline_color = tag_color;
+                        break;
+                    case TagType::Underline:
+                        style.underline = true;
+                        break;
+                }
+
+                styles.Add(style);
+                derived.Add(style_indices[i], styles.Size() - 1);
+                style_indices[i] = styles.Size() - 1;
+            }
+        }
+    }
+
+    static GlyphInfo GetCharGlyph(const Ref<Font>& font, char32_t c, int font_size, bool bold, bool italic, bool mono, bool sdf)
+    {
+        // sdf glyphs are shared by all sizes and styles, bold and italic are applied when building the quads
+        return ScaleGlyphMetrics(sdf ? font->GetSDFGlyph(c) : font->GetGlyph(c, font_size, bold, italic, mono), font_size);
+    }
+
+    static int GetBaseline(const Ref<Font>& font, int font_size, bool bold, bool italic, bool mono, bool sdf)
+    {
+        GlyphInfo base_info = GetCharGlyph(font, 'A', font_size, bold, italic, mono, sdf);
+        int base_y0 = base_info.bearing_y - base_info.padding;
+        int base_y1 = base_info.bearing_y - base_info.height + base_info.padding;
+        return Mathf::RoundToInt(base_y0 + (font_size - base_y0 + base_y1) * 0.5f);
+    }
+
+    static void GetCharBounds(const GlyphInfo& info, char32_t c, int pen_x, int pen_y, int baseline, int& x0, int& y0, int& x1, int& y1)
+    {
+        const int char_space = 0;
+
+        // the quad of a sdf glyph includes the padding, the bounds do not
+        int pad = info.padding;
+        x0 = pen_x + info.bearing_x + pad;
+        y0 = pen_y + info.bearing_y - baseline - pad;
+        x1 = x0 + info.width - pad * 2;
+        if (c == ' ' || c == '\t')
+        {
+            x1 = pen_x + info.advance_x + char_space;
+        }
+        y1 = y0 - info.height + pad * 2;
+    }
+
+    static void BuildCharMesh(CharMesh& mesh, const GlyphInfo& info, const CharStyle& style, int x0, int y0, int x1, int y1, int pen_y, int baseline, int font_size)
+    {
+        mesh.image = info.image;
+        mesh.vertices.Clear();
+        mesh.uv.Clear();
+        mesh.colors.Clear();
+        mesh.styles.Clear();
+        mesh.indices.Clear();
+
+        int pad = info.padding;
+        int vertex_count = 0;
+
+        if (info.sdf)
+        {
+            int qx0 = x0 - pad;
+            int qy0 = y0 + pad;
+            int qx1 = x1 + pad;
+            int qy1 = y1 - pad;
+            // distance field units per pixel at this font size
+            float px_to_d = info.size / (float) font_size / (2.0f * FONT_SDF_SPREAD);
+            float dilation = style.bold ? SDF_BOLD_DILATION * px_to_d : 0.0f;
+            float outline_dilation = Mathf::Min(dilation + SDF_OUTLINE_DILATION * px_to_d, SDF_MAX_DILATION);
+            dilation = Mathf::Min(dilation, SDF_MAX_DILATION);
+            int skew0 = 0;
+            int skew1 = 0;
+            if (style.italic)
+            {
+                int glyph_baseline = pen_y - baseline;
+                skew0 = Mathf::RoundToInt((qy0 - glyph_baseline) * 0.5f);
+                skew1 = Mathf::RoundToInt((qy1 - glyph_baseline) * 0.5f);
+            }
+
+            if (style.shadow)
+            {
+                AddQuad(mesh, vertex_count, qx0, qy0, qx1, qy1, Vector2i(1, -1), skew0, skew1, style.shadow_color, Vector2(dilation, SDF_SHADOW_SOFTNESS));
+            }
+
+            if (style.outline)
+            {
+                AddQuad(mesh, vertex_count, qx0, qy0, qx1, qy1, Vector2i(0, 0), skew0, skew1, style.outline_color, Vector2(outline_dilation, 1));
+            }
+
+            AddQuad(mesh, vertex_count, qx0, qy0, qx1, qy1, Vector2i(0, 0), skew0, skew1, style.color, Vector2(dilation, 1));
+        }
+        else
+        {
+            if (style.shadow)
+            {
+                AddQuad(mesh, vertex_count, x0, y0, x1, y1, Vector2i(1, -1), 0, 0, style.shadow_color, Vector2(0, 0));
+            }
+
+            if (style.outline)
+            {
+                Vector2i offsets[4];
+                offsets[0] = Vector2i(-1, 1);
+                offsets[1] = Vector2i(-1, -1);
+                offsets[2] = Vector2i(1, -1);
+                offsets[3] = Vector2i(1, 1);
+
+                for (int j = 0; j < 4; ++j)
+                {
+                    AddQuad(mesh, vertex_count, x0, y0, x1, y1, offsets[j], 0, 0, style.outline_color, Vector2(0, 0));
+                }
+            }
+
+            AddQuad(mesh, vertex_count, x0, y0, x1, y1, Vector2i(0, 0), 0, 0, style.color, Vector2(0, 0));
+        }
+    }
+
+    struct LabelShape
+    {
+        LabelShapeKey key;
+        Vector<LabelLine> lines;
+        Vector<Vector2i> char_meshes;
+        Vector2i content_size;
+        List<uint64_t>::Iterator lru;
+    };
+
+    // shaped lines shared by all labels, so equal texts and text toggles skip shaping.
+    // the lru list holds the cache hashes, most recently used first
+    static Map<uint64_t, Ref<LabelShape>> g_shape_cache;
+    static List<uint64_t> g_shape_lru;
+
+    bool LabelShapeKey::operator ==(const LabelShapeKey& right) const
+    {
+        return font_id == right.font_id &&
+            font_size == right.font_size &&
+            font_style == right.font_style &&
+            line_space == right.line_space &&
+            rich == right.rich &&
+            mono == right.mono &&
+            sdf == right.sdf &&
+            wrap_width == right.wrap_width &&
+            color == right.color &&
+            text == right.text;
+    }
+
+    uint64_t LabelShapeKey::Hash() const
+    {
+        // fnv-1a
+        uint64_t hash = 14695981039346656037ULL;
+        auto mix = [&](uint64_t value) {
+            hash ^= value;
+            hash *= 1099511628211ULL;
+        };
+
+        const char* str = text.CString();
+        for (int i = 0; i < text.Size(); ++i)
+        {
+            mix((unsigned char) str[i]);
+        }
+        mix(font_id);
+        mix(font_size);
+        mix((int) font_style);
+        mix(line_space);
+        mix((rich ? 1 : 0) | (mono ? 2 : 0) | (sdf ? 4 : 0));
+        mix((uint32_t) wrap_width);
+        mix(Mathf::RoundToInt(color.r * 255) | (Mathf::RoundToInt(color.g * 255) << 8) |
+            (Mathf::RoundToInt(color.b * 255) << 16) | ((uint64_t) Mathf::RoundToInt(color.a * 255) << 24));
+
+        return hash;
+    }
+
     Label::Label():
         m_font(Font::GetFont(FontType::Arial)),
         m_font_style(FontStyle::Normal),
@@ -249,7 +529,8 @@ namespace Viry3D
         m_mono(false),
         m_text_alignment(ViewAlignment::HCenter | ViewAlignment::VCenter),
         m_wrap_content(false),
-        m_lines_dirty(false)
+        m_lines_dirty(false),
+        m_sdf(false)
     {
     
     }
@@ -273,30 +554,45 @@ namespace Viry3D
     {
         m_font = font;
         m_lines_dirty = true;
-        this->MarkCanvasDirty();
+        this->MarkDirty(ViewDirty::Geometry);
     }
 
     void Label::SetFontStyle(FontStyle style)
     {
         m_font_style = style;
         m_lines_dirty = true;
-        this->MarkCanvasDirty();
+        this->MarkDirty(ViewDirty::Geometry);
     }
 
     void Label::SetFontSize(int size)
     {
         m_font_size = size;
         m_lines_dirty = true;
-        this->MarkCanvasDirty();
+        this->MarkDirty(ViewDirty::Geometry);
     }
 
     void Label::SetText(const String& text)
     {
         if (m_text != text)
         {
+            Vector2i content_size = m_content_size;
+            if (this->UpdateDigits(text))
+            {
+                // the alignment offset moves every glyph once the content size changes
+                if (m_content_size == content_size || (m_text_alignment & ViewAlignment::Left))
+                {
+                    this->MarkDirty(ViewDirty::Meshes);
+                }
+                else
+                {
+                    this->MarkDirty(ViewDirty::Geometry);
+                }
+                return;
+            }
+
             m_text = text;
             m_lines_dirty = true;
-            this->MarkCanvasDirty();
+            this->MarkDirty(ViewDirty::Geometry);
         }
     }
 
@@ -304,34 +600,41 @@ namespace Viry3D
     {
         m_line_space = space;
         m_lines_dirty = true;
-        this->MarkCanvasDirty();
+        this->MarkDirty(ViewDirty::Geometry);
     }
 
     void Label::SetRich(bool rich)
     {
         m_rich = rich;
         m_lines_dirty = true;
-        this->MarkCanvasDirty();
+        this->MarkDirty(ViewDirty::Geometry);
     }
 
     void Label::SetMono(bool mono)
     {
         m_mono = mono;
         m_lines_dirty = true;
-        this->MarkCanvasDirty();
+        this->MarkDirty(ViewDirty::Geometry);
     }
 
     void Label::SetTextAlignment(int alignment)
     {
         m_text_alignment = alignment;
-        this->MarkCanvasDirty();
+        this->MarkDirty(ViewDirty::Geometry);
     }
 
     void Label::SetWrapContent(bool enable)
     {
         m_wrap_content = enable;
         m_lines_dirty = true;
-        this->MarkCanvasDirty();
+        this->MarkDirty(ViewDirty::Geometry);
+    }
+
+    void Label::SetSDF(bool sdf)
+    {
+        m_sdf = sdf;
+        m_lines_dirty = true;
+        this->MarkDirty(ViewDirty::Geometry);
     }
 
     const Vector<LabelLine>& Label::GetLines()
@@ -344,15 +647,83 @@ namespace Viry3D
         return m_lines;
     }
 
+    LabelShapeKey Label::GetShapeKey() const
+    {
+        LabelShapeKey key;
+        key.text = m_text;
+        key.font_id = m_font ? m_font->GetId() : 0;
+        key.font_size = m_font_size;
+        key.font_style = m_font_style;
+        key.line_space = m_line_space;
+        key.rich = m_rich;
+        key.mono = m_mono;
+        key.sdf = m_sdf;
+        key.wrap_width = m_wrap_content ? this->GetSize().x : -1;
+        key.color = this->GetColor();
+        return key;
+    }
+
     void Label::ProcessText()
     {
-        m_lines.Clear();
+        LabelShapeKey key = this->GetShapeKey();
+        if (key.font_id != 0 && key == m_shape_key)
+        {
+            return;
+        }
+        m_shape_key = key;
 
         if (!m_font)
         {
+            m_lines.Clear();
+            m_char_meshes.Clear();
             return;
         }
 
+        uint64_t hash = key.Hash();
+        Ref<LabelShape>* cached;
+        if (g_shape_cache.TryGet(hash, &cached))
+        {
+            const Ref<LabelShape>& shape = *cached;
+            g_shape_lru.Remove(shape->lru);
+
+            if (shape->key == key)
+            {
+                g_shape_lru.AddFirst(hash);
+                shape->lru = g_shape_lru.begin();
+
+                m_lines = shape->lines;
+                m_char_meshes = shape->char_meshes;
+                m_content_size = shape->content_size;
+                return;
+            }
+
+            // hash collision, the new shape replaces the cached one
+            g_shape_cache.Remove(hash);
+        }
+
+        this->ShapeText();
+
+        if (g_shape_cache.Size() >= LABEL_SHAPE_CACHE_SIZE)
+        {
+            g_shape_cache.Remove(g_shape_lru.Last());
+            g_shape_lru.RemoveLast();
+        }
+
+        Ref<LabelShape> shape = RefMake<LabelShape>();
+        shape->key = key;
+        shape->lines = m_lines;
+        shape->char_meshes = m_char_meshes;
+        shape->content_size = m_content_size;
+        g_shape_lru.AddFirst(hash);
+        shape->lru = g_shape_lru.begin();
+        g_shape_cache.Add(hash, shape);
+    }
+
+    void Label::ShapeText()
+    {
+        m_lines.Clear();
+        m_char_meshes.Clear();
+
         auto chars = m_text.ToUnicode32();
 
         Vector<TagInfo> tags;
@@ -361,6 +732,18 @@ namespace Viry3D
             tags = ParseRichTag(chars);
         }
 
+        CharStyle base_style;
+        base_style.color = this->GetColor();
+        base_style.bold = m_font_style == FontStyle::Bold || m_font_style == FontStyle::BoldAndItalic;
+        base_style.italic = m_font_style == FontStyle::Italic || m_font_style == FontStyle::BoldAndItalic;
+        base_style.underline = false;
+        base_style.shadow = false;
+        base_style.outline = false;
+
+        Vector<CharStyle> styles;
+        Vector<int> style_indices;
+        BuildCharStyles(tags, chars.Size(), base_style, styles, style_indices);
+
         int pen_x = 0;
         int pen_y = 0;
         int x_max = 0;
@@ -374,6 +757,10 @@ namespace Viry3D
         unsigned int previous = 0;
         bool wrapped = false;
         LabelLine line;
+        // baseline of each bold and italic combination
+        int baselines[4] = { INT_MIN, INT_MIN, INT_MIN, INT_MIN };
+
+        m_char_meshes.Resize(chars.Size(), Vector2i(-1, -1));
 
         for (int i = 0; i < chars.Size(); ++i)
         {
@@ -394,45 +781,9 @@ namespace Viry3D
                 continue;
             }
 
-            Color color = this->GetColor();
-            bool bold = m_font_style == FontStyle::Bold || m_font_style == FontStyle::BoldAndItalic;
-            bool italic = m_font_style == FontStyle::Italic || m_font_style == FontStyle::BoldAndItalic;
-            Ref<Color> color_shadow;
-            Ref<Color> color_outline;
-            bool underline = false;
+            const CharStyle& style = styles[style_indices[i]];
 
-            if (m_rich)
-            {
-                for (auto& j : tags)
-                {
-                    if (i >= j.begin && i < j.end)
-                    {
-                        switch (j.type)
-                        {
-                        case TagType::Color:
-                            color = Color::Parse(j.value);
-                            break;
-                        case TagType::Bold:
-                            bold = true;
-                            break;
-                        case TagType::Italic:
-                            italic = true;
-                            break;
-                        case TagType::Shadow:
-                            color_shadow = RefMake<Color>(Color::Parse(j.value));
-                            break;
-                        case TagType::Outline:
-                            color_outline = RefMake<Color>(Color::Parse(j.value));
-                            break;
-                        case TagType::Underline:
-                            underline = true;
-                            break;
-                        }
-                    }
-                }
-            }
-
-            GlyphInfo info = m_font->GetGlyph(c, font_size, bold, italic, mono);
+            GlyphInfo info = GetCharGlyph(m_font, c, font_size, style.bold, style.italic, mono, m_sdf);
 
             //	kerning
             if (has_kerning && previous && info.glyph_index)
@@ -440,20 +791,15 @@ namespace Viry3D
                 pen_x += m_font->GetKerning(previous, info.glyph_index).x;
             }
 
-            auto base_info = m_font->GetGlyph('A', font_size, bold, italic, mono);
-            int base_y0 = base_info.bearing_y;
-            int base_y1 = base_info.bearing_y - base_info.height;
-            int baseline = Mathf::RoundToInt(base_y0 + (font_size - base_y0 + base_y1) * 0.5f);
-            const int char_space = 0;
-
-            int x0 = pen_x + info.bearing_x;
-            int y0 = pen_y + info.bearing_y - baseline;
-            int x1 = x0 + info.width;
-            if (c == ' ' || c == '\t')
+            int& baseline = baselines[(style.bold ? 1 : 0) | (style.italic ? 2 : 0)];
+            if (baseline == INT_MIN)
             {
-                x1 = pen_x + info.advance_x + char_space;
+                baseline = GetBaseline(m_font, font_size, style.bold, style.italic, mono, m_sdf);
             }
-            int y1 = y0 - info.height;
+            const int char_space = 0;
+
+            int x0, y0, x1, y1;
+            GetCharBounds(info, c, pen_x, pen_y, baseline, x0, y0, x1, y1);
 
             if (m_wrap_content && x1 > this->GetSize().x)
             {
@@ -503,105 +849,22 @@ namespace Viry3D
 
             CharMesh mesh;
             mesh.c = c;
-            mesh.image = info.image;
-
-            float uv_x0 = 0;
-            float uv_y0 = 0;
-            float uv_x1 = 1;
-            float uv_y1 = 1;
-            int vertex_count = 0;
-
-            if (color_shadow)
-            {
-                Vector2i offset = Vector2i(1, -1);
-
-                mesh.vertices.Add(Vector2i(x0, y0) + offset);
-                mesh.vertices.Add(Vector2i(x0, y1) + offset);
-                mesh.vertices.Add(Vector2i(x1, y1) + offset);
-                mesh.vertices.Add(Vector2i(x1, y0) + offset);
-                mesh.uv.Add(Vector2(uv_x0, uv_y0));
-                mesh.uv.Add(Vector2(uv_x0, uv_y1));
-                mesh.uv.Add(Vector2(uv_x1, uv_y1));
-                mesh.uv.Add(Vector2(uv_x1, uv_y0));
-                mesh.colors.Add(*color_shadow);
-                mesh.colors.Add(*color_shadow);
-                mesh.colors.Add(*color_shadow);
-                mesh.colors.Add(*color_shadow);
-                mesh.indices.Add(vertex_count + 0);
-                mesh.indices.Add(vertex_count + 1);
-                mesh.indices.Add(vertex_count + 2);
-                mesh.indices.Add(vertex_count + 0);
-                mesh.indices.Add(vertex_count + 2);
-                mesh.indices.Add(vertex_count + 3);
-
-                vertex_count += 4;
-            }
-
-            if (color_outline)
-            {
-                Vector2i offsets[4];
-                offsets[0] = Vector2i(-1, 1);
-                offsets[1] = Vector2i(-1, -1);
-                offsets[2] = Vector2i(1, -1);
-                offsets[3] = Vector2i(1, 1);
-
-                for (int j = 0; j < 4; ++j)
-                {
-                    mesh.vertices.Add(Vector2i(x0, y0) + offsets[j]);
-                    mesh.vertices.Add(Vector2i(x0, y1) + offsets[j]);
-                    mesh.vertices.Add(Vector2i(x1, y1) + offsets[j]);
-                    mesh.vertices.Add(Vector2i(x1, y0) + offsets[j]);
-                    mesh.uv.Add(Vector2(uv_x0, uv_y0));
-                    mesh.uv.Add(Vector2(uv_x0, uv_y1));
-                    mesh.uv.Add(Vector2(uv_x1, uv_y1));
-                    mesh.uv.Add(Vector2(uv_x1, uv_y0));
-                    mesh.colors.Add(*color_outline);
-                    mesh.colors.Add(*color_outline);
-                    mesh.colors.Add(*color_outline);
-                    mesh.colors.Add(*color_outline);
-                    mesh.indices.Add(vertex_count + 0);
-                    mesh.indices.Add(vertex_count + 1);
-                    mesh.indices.Add(vertex_count + 2);
-                    mesh.indices.Add(vertex_count + 0);
-                    mesh.indices.Add(vertex_count + 2);
-                    mesh.indices.Add(vertex_count + 3);
-
-                    vertex_count += 4;
-                }
-            }
-
-            {
-                mesh.vertices.Add(Vector2i(x0, y0));
-                mesh.vertices.Add(Vector2i(x0, y1));
-                mesh.vertices.Add(Vector2i(x1, y1));
-                mesh.vertices.Add(Vector2i(x1, y0));
-                mesh.uv.Add(Vector2(uv_x0, uv_y0));
-                mesh.uv.Add(Vector2(uv_x0, uv_y1));
-                mesh.uv.Add(Vector2(uv_x1, uv_y1));
-                mesh.uv.Add(Vector2(uv_x1, uv_y0));
-                mesh.colors.Add(color);
-                mesh.colors.Add(color);
-                mesh.colors.Add(color);
-                mesh.colors.Add(color);
-                mesh.indices.Add(vertex_count + 0);
-                mesh.indices.Add(vertex_count + 1);
-                mesh.indices.Add(vertex_count + 2);
-                mesh.indices.Add(vertex_count + 0);
-                mesh.indices.Add(vertex_count + 2);
-                mesh.indices.Add(vertex_count + 3);
-
-                vertex_count += 4;
-            }
+            mesh.pen = Vector2i(pen_x, pen_y);
+            mesh.right = x1;
+            BuildCharMesh(mesh, info, style, x0, y0, x1, y1, pen_y, baseline, font_size);
 
             previous = info.glyph_index;
 
+            m_char_meshes[i] = Vector2i(m_lines.Size(), line.meshes.Size());
             line.meshes.Add(mesh);
 
-            if (underline)
+            if (style.underline)
             {
                 CharMesh underline_mesh;
                 underline_mesh.c = 0;
                 underline_mesh.image = Texture::GetSharedWhiteImage();
+                underline_mesh.pen = Vector2i(pen_x, pen_y);
+                underline_mesh.right = 0;
 
                 int ux0 = pen_x;
                 int uy0 = pen_y - baseline - 2;
@@ -616,10 +879,11 @@ namespace Viry3D
                 underline_mesh.uv.Add(Vector2(1.0f / 3, 2.0f / 3));
                 underline_mesh.uv.Add(Vector2(2.0f / 3, 2.0f / 3));
                 underline_mesh.uv.Add(Vector2(2.0f / 3, 1.0f / 3));
-                underline_mesh.colors.Add(color);
-                underline_mesh.colors.Add(color);
-                underline_mesh.colors.Add(color);
-                underline_mesh.colors.Add(color);
+                underline_mesh.colors.Add(style.color);
+                underline_mesh.colors.Add(style.color);
+                underline_mesh.colors.Add(style.color);
+                underline_mesh.colors.Add(style.color);
+                underline_mesh.styles.Resize(4, Vector2(0, 0));
                 underline_mesh.indices.Add(0);
                 underline_mesh.indices.Add(1);
                 underline_mesh.indices.Add(2);
@@ -649,6 +913,151 @@ namespace Viry3D
         }
     }
 
+    static bool IsDigit(char c)
+    {
+        return c >= '0' && c <= '9';
+    }
+
+    // counters and timers only change digits, rewrite those glyph quads without shaping the text again
+    bool Label::UpdateDigits(const String& text)
+    {
+        if (m_lines_dirty || m_rich || m_wrap_content || !m_font || m_shape_key.font_id == 0 ||
+            text.Size() != m_text.Size() || !(m_shape_key == this->GetShapeKey()))
+        {
+            return false;
+        }
+
+        // digits are single bytes, so equal sizes and digit only changes keep the char indices
+        const char* old_str = m_text.CString();
+        const char* new_str = text.CString();
+        Map<int, char32_t> changes;
+        int char_index = -1;
+
+        for (int i = 0; i < text.Size(); ++i)
+        {
+            if ((old_str[i] & 0xc0) != 0x80)
+            {
+                ++char_index;
+            }
+
+            if (old_str[i] != new_str[i])
+            {
+                if (!IsDigit(old_str[i]) || !IsDigit(new_str[i]))
+                {
+                    return false;
+                }
+                changes.Add(char_index, (char32_t) new_str[i]);
+            }
+        }
+
+        if (char_index + 1 != m_char_meshes.Size())
+        {
+            return false;
+        }
+
+        int font_size = m_font_size;
+        bool bold = m_font_style == FontStyle::Bold || m_font_style == FontStyle::BoldAndItalic;
+        bool italic = m_font_style == FontStyle::Italic || m_font_style == FontStyle::BoldAndItalic;
+        bool has_kerning = m_font->HasKerning();
+
+        auto get_char = [&](int index, bool changed) {
+            const char32_t* c;
+            if (changed && changes.TryGet(index, &c))
+            {
+                return *c;
+            }
+            const Vector2i& location = m_char_meshes[index];
+            return location.x >= 0 ? m_lines[location.x].meshes[location.y].c : (char32_t) '\n';
+        };
+        auto get_kerning = [&](int index, bool changed) {
+            // kerning between a char and the one before it on the same line
+            if (!has_kerning || index == 0 || m_char_meshes[index - 1].x != m_char_meshes[index].x)
+            {
+                return 0;
+            }
+            unsigned int previous = GetCharGlyph(m_font, get_char(index - 1, changed), font_size, bold, italic, m_mono, m_sdf).glyph_index;
+            unsigned int current = GetCharGlyph(m_font, get_char(index, changed), font_size, bold, italic, m_mono, m_sdf).glyph_index;
+            return previous && current ? m_font->GetKerning(previous, current).x : 0;
+        };
+
+        // the pen positions must stay the same, otherwise the rest of the line moves
+        for (const auto& i : changes)
+        {
+            GlyphInfo old_info = GetCharGlyph(m_font, get_char(i.first, false), font_size, bold, italic, m_mono, m_sdf);
+            GlyphInfo new_info = GetCharGlyph(m_font, i.second, font_size, bold, italic, m_mono, m_sdf);
+            if (old_info.advance_x != new_info.advance_x)
+            {
+                return false;
+            }
+
+            if (get_kerning(i.first, false) != get_kerning(i.first, true))
+            {
+                return false;
+            }
+            if (i.first + 1 < m_char_meshes.Size() && get_kerning(i.first + 1, false) != get_kerning(i.first + 1, true))
+            {
+                return false;
+            }
+        }
+
+        CharStyle style;
+        style.color = m_shape_key.color;
+        style.bold = bold;
+        style.italic = italic;
+        style.underline = false;
+        style.shadow = false;
+        style.outline = false;
+        int baseline = GetBaseline(m_font, font_size, bold, italic, m_mono, m_sdf);
+
+        for (const auto& i : changes)
+        {
+            const Vector2i& location = m_char_meshes[i.first];
+            LabelLine& line = m_lines[location.x];
+            CharMesh& mesh = line.meshes[location.y];
+            GlyphInfo info = GetCharGlyph(m_font, i.second, font_size, bold, italic, m_mono, m_sdf);
+
+            int x0, y0, x1, y1;
+            GetCharBounds(info, i.second, mesh.pen.x, mesh.pen.y, baseline, x0, y0, x1, y1);
+
+            mesh.c = i.second;
+            mesh.right = x1;
+            BuildCharMesh(mesh, info, style, x0, y0, x1, y1, mesh.pen.y, baseline, font_size);
+
+            if (!m_changed_char_meshes.Contains(location))
+            {
+                m_changed_char_meshes.Add(location);
+            }
+        }
+
+        // glyph widths may differ, so the right bounds of the changed lines may move
+        int x_max = 0;
+        for (int i = 0; i < m_lines.Size(); ++i)
+        {
+            LabelLine& line = m_lines[i];
+
+            int line_x_max = 0;
+            for (const auto& j : line.meshes)
+            {
+                if (j.c != 0 && line_x_max < j.right)
+                {
+                    line_x_max = j.right;
+                }
+            }
+            line.width = line_x_max;
+
+            if (x_max < line_x_max)
+            {
+                x_max = line_x_max;
+            }
+        }
+        m_content_size.x = x_max;
+
+        m_text = text;
+        m_shape_key.text = text;
+
+        return true;
+    }
+
     void Label::UpdateLayout()
     {
         View::UpdateLayout();
@@ -701,38 +1110,97 @@ namespace Viry3D
 
         Recti rect = this->GetRect();
         rect.y = -rect.y;
+
+        // text changes only dirty the geometry, so the lines may not be processed by layout
+        const Vector<LabelLine>& lines = this->GetLines();
+
+        Vector2i offset_pos = this->ApplyTextAlignment(Vector2i(rect.w, rect.h));
+
+        for (int i = 0; i < lines.Size(); ++i)
+        {
+            const LabelLine& line = lines[i];
+            
+            for (int j = 0; j < line.meshes.Size(); ++j)
+            {
+                meshes.Add(this->BuildCharViewMesh(line.meshes[j], rect, offset_pos, clip));
+            }
+        }
+
+        m_changed_char_meshes.Clear();
+    }
+
+    ViewMesh Label::BuildCharViewMesh(const CharMesh& char_mesh, const Recti& rect, const Vector2i& offset_pos, const Rect& clip_rect)
+    {
         const Matrix4x4& vertex_matrix = this->GetVertexMatrix();
 
+        ViewMesh mesh;
+        mesh.vertices.Resize(char_mesh.vertices.Size());
+
+        for (int i = 0; i < mesh.vertices.Size(); ++i)
+        {
+            int x = rect.x + offset_pos.x + char_mesh.vertices[i].x;
+            int y = rect.y + offset_pos.y + char_mesh.vertices[i].y;
+
+            mesh.vertices[i].vertex = vertex_matrix.MultiplyPoint3x4(Vector3((float) x, (float) y, 0));
+            mesh.vertices[i].uv = char_mesh.uv[i];
+            mesh.vertices[i].color = char_mesh.colors[i] * this->GetColor();
+            mesh.vertices[i].uv2 = char_mesh.styles[i];
+        }
+
+        mesh.indices.AddRange(char_mesh.indices);
+        mesh.image = char_mesh.image;
+        mesh.view = this;
+        mesh.base_view = false;
+        mesh.clip_rect = clip_rect;
+
+        return mesh;
+    }
+
+    void Label::FillChangedMeshes(const Vector<ViewMesh>& meshes, Vector<ViewMesh>& changed_meshes, Vector<int>& changed_indices)
+    {
+        Recti rect = this->GetRect();
+        rect.y = -rect.y;
+
         Vector2i offset_pos = this->ApplyTextAlignment(Vector2i(rect.w, rect.h));
 
+        for (const auto& i : m_changed_char_meshes)
+        {
+            // same mesh order as FillSelfMeshes, the base view mesh first then one mesh per char mesh
+            int index = 1 + i.y;
+            for (int j = 0; j < i.x; ++j)
+            {
+                index += m_lines[j].meshes.Size();
+            }
+
+            // the canvas fills the whole view again for indices out of range
+            Rect clip = index < meshes.Size() ? meshes[index].clip_rect : Rect(0, 0, 1, 1);
+
+            changed_meshes.Add(this->BuildCharViewMesh(m_lines[i.x].meshes[i.y], rect, offset_pos, clip));
+            changed_indices.Add(index);
+        }
+
+        m_changed_char_meshes.Clear();
+    }
+
+    void Label::FillSelfColors(Vector<ViewMesh>& meshes)
+    {
+        // same mesh order as FillSelfMeshes, the base view mesh first then one mesh per char mesh
+        View::FillSelfColors(meshes);
+
+        int index = 1;
         for (int i = 0; i < m_lines.Size(); ++i)
         {
             const LabelLine& line = m_lines[i];
-            
-            for (int j = 0; j < line.meshes.Size(); ++j)
+
+            for (int j = 0; j < line.meshes.Size() && index < meshes.Size(); ++j)
             {
                 const CharMesh& char_mesh = line.meshes[j];
-
-                ViewMesh mesh;
-                mesh.vertices.Resize(char_mesh.vertices.Size());
+                ViewMesh& mesh = meshes[index++];
 
                 for (int k = 0; k < mesh.vertices.Size(); ++k)
                 {
-                    int x = rect.x + offset_pos.x + char_mesh.vertices[k].x;
-                    int y = rect.y + offset_pos.y + char_mesh.vertices[k].y;
-
-                    mesh.vertices[k].vertex = vertex_matrix.MultiplyPoint3x4(Vector3((float) x, (float) y, 0));
-                    mesh.vertices[k].uv = char_mesh.uv[k];
                     mesh.vertices[k].color = char_mesh.colors[k] * this->GetColor();
                 }
-
-                mesh.indices.AddRange(char_mesh.indices);
-                mesh.image = char_mesh.image;
-                mesh.view = this;
-                mesh.base_view = false;
-                mesh.clip_rect = clip;
-
-                meshes.Add(mesh);
             }
         }
     }
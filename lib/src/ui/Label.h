@@ -20,6 +20,8 @@
 #include "View.h"
 #include "math/Vector2i.h"
 
+#define LABEL_SHAPE_CACHE_SIZE 256
+
 namespace Viry3D
 {
     enum class FontStyle
@@ -36,8 +38,13 @@ namespace Viry3D
         Vector<Vector2i> vertices;
         Vector<Vector2> uv;
         Vector<Color> colors;
+        // sdf style per vertex, x is the edge dilation and y the edge softness, zero for bitmap glyphs
+        Vector<Vector2> styles;
         Vector<unsigned short> indices;
         Ref<Image> image;
+        // pen position and right bound of the glyph, kept for in place updates
+        Vector2i pen;
+        int right;
     };
 
     struct LabelLine
@@ -56,6 +63,24 @@ namespace Viry3D
 
     class Font;
 
+    // inputs that decide the shaped lines of a label
+    struct LabelShapeKey
+    {
+        String text;
+        int font_id = 0;
+        int font_size = 0;
+        FontStyle font_style = FontStyle::Normal;
+        int line_space = 0;
+        bool rich = false;
+        bool mono = false;
+        bool sdf = false;
+        int wrap_width = -1;
+        Color color;
+
+        bool operator ==(const LabelShapeKey& right) const;
+        uint64_t Hash() const;
+    };
+
     class Label : public View
     {
     public:
@@ -82,14 +107,23 @@ namespace Viry3D
         void SetTextAlignment(int alignment);
         bool IsWrapContent() const { return m_wrap_content; }
         void SetWrapContent(bool enable);
+        bool IsSDF() const { return m_sdf; }
+        // render with distance field glyphs which scale to any font size, needs a linear filtered canvas
+        void SetSDF(bool sdf);
         const Vector<LabelLine>& GetLines();
 
     protected:
         virtual void FillSelfMeshes(Vector<ViewMesh>& meshes, const Rect& clip_rect);
+        virtual void FillSelfColors(Vector<ViewMesh>& meshes);
+        virtual void FillChangedMeshes(const Vector<ViewMesh>& meshes, Vector<ViewMesh>& changed_meshes, Vector<int>& changed_indices);
 
     private:
         void ProcessText();
+        void ShapeText();
+        LabelShapeKey GetShapeKey() const;
+        bool UpdateDigits(const String& text);
         Vector2i ApplyTextAlignment(const Vector2i& target_size);
+        ViewMesh BuildCharViewMesh(const CharMesh& char_mesh, const Recti& rect, const Vector2i& offset_pos, const Rect& clip_rect);
 
     private:
         Ref<Font> m_font;
@@ -101,8 +135,14 @@ namespace Viry3D
         bool m_mono;
         int m_text_alignment;
         Vector<LabelLine> m_lines;
+        // line and mesh index of each char, x is -1 for chars without mesh
+        Vector<Vector2i> m_char_meshes;
+        // line and mesh index of the chars rewritten by UpdateDigits since the last fill
+        Vector<Vector2i> m_changed_char_meshes;
+        LabelShapeKey m_shape_key;
         Vector2i m_content_size;
         bool m_wrap_content;
         bool m_lines_dirty;
+        bool m_sdf;
     };
 }
@@ -24,7 +24,13 @@ namespace Viry3D
         m_down_pos(0, 0),
         m_scroll_start_x(false),
         m_scroll_start_y(false),
-        m_scroll_pos(0, 0)
+        m_scroll_pos(0, 0),
+        m_virtual(false),
+        m_columns(1),
+        m_margin_rows(SCROLL_VIEW_ITEM_MARGIN_ROWS),
+        m_items_dirty(false),
+        m_items_offset(0, 0),
+        m_items_size(0, 0)
     {
         m_content_view = RefMake<View>();
         this->AddSubview(m_content_view);
@@ -142,6 +148,22 @@ namespace Viry3D
     
     }
 
+    void ScrollView::Update()
+    {
+        if (m_virtual)
+        {
+            // scrolling only moves the content view, bind the items it brought into view
+            if (m_items_dirty ||
+                m_items_offset != m_content_view->GetOffset() ||
+                m_items_size != this->GetCalculatedSize())
+            {
+                this->UpdateItems();
+            }
+        }
+
+        View::Update();
+    }
+
     void ScrollView::OnResize(int width, int height)
     {
         View::OnResize(width, height);
@@ -171,7 +193,139 @@ namespace Viry3D
         m_content_view->SetOffset(pos);
     }
 
-    bool ScrollView::OnTouchUp(const Vector2i& pos)
+    void ScrollView::SetAdapter(const ScrollViewAdapter& adapter, int columns)
+    {
+        for (const auto& i : m_item_views)
+        {
+            m_content_view->RemoveSubview(i);
+        }
+        m_item_views.Clear();
+        m_item_indices.Clear();
+        m_item_pool.Clear();
+
+        m_adapter = adapter;
+        m_virtual = true;
+        m_columns = Mathf::Max(columns, 1);
+        m_items_dirty = true;
+    }
+
+    void ScrollView::NotifyDataChanged()
+    {
+        // forget the bound indices, so every visible item binds again
+        for (int i = 0; i < m_item_indices.Size(); ++i)
+        {
+            m_item_indices[i] = -1;
+        }
+        m_items_dirty = true;
+    }
+
+    void ScrollView::SetItemMarginRows(int rows)
+    {
+        m_margin_rows = Mathf::Max(rows, 0);
+        m_items_dirty = true;
+    }
+
+    void ScrollView::UpdateItems()
+    {
+        m_items_dirty = false;
+        m_items_offset = m_content_view->GetOffset();
+        m_items_size = this->GetCalculatedSize();
+
+        const Vector2i& item_size = m_adapter.item_size;
+        if (item_size.x <= 0 || item_size.y <= 0 || !m_adapter.get_item_count || !m_adapter.create_item || !m_adapter.bind_item)
+        {
+            return;
+        }
+
+        int count = m_adapter.get_item_count();
+        int rows = (count + m_columns - 1) / m_columns;
+
+        Vector2i content_size(m_columns * item_size.x, rows * item_size.y);
+        if (m_content_view->GetSize() != content_size)
+        {
+            this->SetContentViewSize(content_size);
+        }
+
+        // offset y direction is down, so scrolling down moves the content up
+        int scroll_y = Mathf::Max(-m_items_offset.y, 0);
+        int first_row = Mathf::Max(scroll_y / item_size.y - m_margin_rows, 0);
+        int last_row = Mathf::Min((scroll_y + m_items_size.y) / item_size.y + m_margin_rows, rows - 1);
+        int first = first_row * m_columns;
+        int last = Mathf::Min((last_row + 1) * m_columns, count);
+        int needed = Mathf::Max(last - first, 0);
+
+        // keep the views already bound to an item in range, the others are free for reuse
+        Vector<int> bound(needed, 0);
+        Vector<Ref<View>> item_views;
+        Vector<int> item_indices;
+        Vector<Ref<View>> free_views;
+
+        for (int i = 0; i < m_item_views.Size(); ++i)
+        {
+            int index = m_item_indices[i];
+            if (index >= first && index < last)
+            {
+                bound[index - first] = 1;
+                item_views.Add(m_item_views[i]);
+                item_indices.Add(index);
+            }
+            else
+            {
+                free_views.Add(m_item_views[i]);
+            }
+        }
+
+        for (int i = 0; i < needed; ++i)
+        {
+            if (bound[i])
+            {
+                continue;
+            }
+
+            Ref<View> view;
+            if (free_views.Size() > 0)
+            {
+                // moving an attached view does not change the canvas structure
+                view = free_views[free_views.Size() - 1];
+                free_views.Resize(free_views.Size() - 1);
+            }
+            else
+            {
+                if (m_item_pool.Size() > 0)
+                {
+                    view = m_item_pool[m_item_pool.Size() - 1];
+                    m_item_pool.Resize(m_item_pool.Size() - 1);
+                }
+                else
+                {
+                    view = m_adapter.create_item();
+                    view->SetAlignment(ViewAlignment::Left | ViewAlignment::Top);
+                    view->SetPivot(Vector2(0, 0));
+                }
+                m_content_view->AddSubview(view);
+            }
+
+            int index = first + i;
+            view->SetSize(item_size);
+            view->SetOffset(Vector2i((index % m_columns) * item_size.x, (index / m_columns) * item_size.y));
+            m_adapter.bind_item(view, index);
+
+            item_views.Add(view);
+            item_indices.Add(index);
+        }
+
+        // the visible range shrank, detach the rest into the pool
+        for (const auto& i : free_views)
+        {
+            m_content_view->RemoveSubview(i);
+            m_item_pool.Add(i);
+        }
+
+        m_item_views = item_views;
+        m_item_indices = item_indices;
+    }
+
+    bool ScrollView::OnTouchUp(const Vector2i&)
     {
         bool block_event = m_scroll_start_x || m_scroll_start_y;
         m_scroll_start_x = false;
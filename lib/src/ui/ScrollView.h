@@ -19,22 +19,42 @@
 
 #include "View.h"
 
+#define SCROLL_VIEW_ITEM_MARGIN_ROWS 2
+
 namespace Viry3D
 {
+    // items of a virtualized scroll view, views are created and bound only for visible items
+    struct ScrollViewAdapter
+    {
+        std::function<int()> get_item_count;
+        Vector2i item_size;
+        std::function<Ref<View>()> create_item;
+        std::function<void(const Ref<View>& view, int index)> bind_item;
+    };
+
     class ScrollView: public View
     {
     public:
         ScrollView();
         virtual ~ScrollView();
+        virtual void Update();
         virtual void OnResize(int width, int height);
         virtual void SetSize(const Vector2i& size);
         const Ref<View>& GetContentView() const { return m_content_view; }
         void SetContentViewSize(const Vector2i& size);
         void SetScrollThrehold(float threhold);
         void SetScrollOffset(const Vector2i& pos);
+        // vertical list when columns is 1, grid otherwise, the content view size follows the item count
+        void SetAdapter(const ScrollViewAdapter& adapter, int columns = 1);
+        // item count or item data changed, rebind all visible items
+        void NotifyDataChanged();
+        // rows kept bound above and below the visible rows
+        void SetItemMarginRows(int rows);
+        int GetItemViewCount() const { return m_item_views.Size(); }
 
     private:
         bool OnTouchUp(const Vector2i& pos);
+        void UpdateItems();
 
     private:
         Ref<View> m_content_view;
@@ -44,5 +64,15 @@ namespace Viry3D
         bool m_scroll_start_x;
         bool m_scroll_start_y;
         Vector2i m_scroll_pos;
+        ScrollViewAdapter m_adapter;
+        bool m_virtual;
+        int m_columns;
+        int m_margin_rows;
+        Vector<Ref<View>> m_item_views;
+        Vector<int> m_item_indices;
+        Vector<Ref<View>> m_item_pool;
+        bool m_items_dirty;
+        Vector2i m_items_offset;
+        Vector2i m_items_size;
     };
 }
@@ -54,53 +54,53 @@ namespace Viry3D
         m_texture_border = texture_border;
         m_atlas.reset();
         m_sprite_name = "";
-        this->MarkCanvasDirty();
+        this->MarkDirty(ViewDirty::Geometry);
     }
 
     void Sprite::SetAtlas(const Ref<SpriteAtlas>& atlas)
     {
         m_atlas = atlas;
-        this->MarkCanvasDirty();
+        this->MarkDirty(ViewDirty::Geometry);
     }
 
     void Sprite::SetSpriteName(const String& name)
     {
         m_sprite_name = name;
-        this->MarkCanvasDirty();
+        this->MarkDirty(ViewDirty::Geometry);
     }
 
     void Sprite::SetSpriteType(SpriteType type)
     {
         m_sprite_type = type;
-        this->MarkCanvasDirty();
+        this->MarkDirty(ViewDirty::Geometry);
     }
 
     void Sprite::SetFillMethod(SpriteFillMethod method)
     {
         m_fill_method = method;
         m_fill_origin = 0;
-        this->MarkCanvasDirty();
+        this->MarkDirty(ViewDirty::Geometry);
     }
 
     void Sprite::SetFillAmount(float amount)
     {
         m_fill_amount = Mathf::Clamp01(amount);
-        this->MarkCanvasDirty();
+        this->MarkDirty(ViewDirty::Geometry);
     }
 
     void Sprite::SetFillOrigin(int origin)
     {
         m_fill_origin = origin;
-        this->MarkCanvasDirty();
+        this->MarkDirty(ViewDirty::Geometry);
     }
 
     void Sprite::SetFillClockWise(bool clockwise)
     {
         m_fill_clockwise = clockwise;
-        this->MarkCanvasDirty();
+        this->MarkDirty(ViewDirty::Geometry);
     }
 
-    void Sprite::FillSelfMeshSimple(Vector<ViewMesh>& meshes, const Rect& clip_rect)
+    void Sprite::FillSelfMeshSimple(Vector<ViewMesh>& meshes)
     {
         ViewMesh& mesh = meshes[meshes.Size() - 1];
 
@@ -1296,7 +1296,7 @@ namespace Viry3D
 
         if (m_sprite_type == SpriteType::Simple)
         {
-            this->FillSelfMeshSimple(meshes, clip_rect);
+            this->FillSelfMeshSimple(meshes);
         }
         else if (m_sprite_type == SpriteType::Sliced)
         {
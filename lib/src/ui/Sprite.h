@@ -104,7 +104,7 @@ namespace Viry3D
         virtual void FillSelfMeshes(Vector<ViewMesh>& meshes, const Rect& clip_rect);
 
     private:
-        void FillSelfMeshSimple(Vector<ViewMesh>& meshes, const Rect& clip_rect);
+        void FillSelfMeshSimple(Vector<ViewMesh>& meshes);
         void FillSelfMeshSliced(Vector<ViewMesh>& meshes, const Rect& clip_rect);
         void FillSelfMeshFilledHorizontal(Vector<ViewMesh>& meshes, const Rect& clip_rect, const Rect& rect, const Matrix4x4& vertex_matrix);
         void FillSelfMeshFilledVertical(Vector<ViewMesh>& meshes, const Rect& clip_rect, const Rect& rect, const Matrix4x4& vertex_matrix);
@@ -48,7 +48,9 @@ namespace Viry3D
         m_local_scale(1, 1),
         m_clip_rect(false),
         m_rect(0, 0, 0, 0),
-        m_vertex_matrix(Matrix4x4::Identity())
+        m_vertex_matrix(Matrix4x4::Identity()),
+        m_dirty(ViewDirty::Layout | ViewDirty::Geometry),
+        m_canvas_slot(-1)
 	{
 	
 	}
@@ -93,6 +95,17 @@ namespace Viry3D
         }
     }
 
+    void View::MarkDirty(int flags)
+    {
+        m_dirty |= flags;
+
+        CanvasRenderer* canvas = this->GetCanvas();
+        if (canvas)
+        {
+            canvas->MarkViewDirty();
+        }
+    }
+
     void View::AddSubview(const Ref<View>& view)
     {
         assert(view->m_parent_view == nullptr);
@@ -129,25 +142,25 @@ namespace Viry3D
 	void View::SetColor(const Color& color)
 	{
 		m_color = color;
-        this->MarkCanvasDirty();
+        this->MarkDirty(ViewDirty::Color);
 	}
 
 	void View::SetAlignment(int alignment)
 	{
 		m_alignment = alignment;
-        this->MarkCanvasDirty();
+        this->MarkDirty(ViewDirty::Layout);
 	}
 
 	void View::SetPivot(const Vector2& pivot)
 	{
 		m_pivot = pivot;
-        this->MarkCanvasDirty();
+        this->MarkDirty(ViewDirty::Layout);
 	}
 
 	void View::SetSize(const Vector2i& size)
 	{
 		m_size = size;
-        this->MarkCanvasDirty();
+        this->MarkDirty(ViewDirty::Layout);
 	}
 
     Vector2i View::GetCalculatedSize()
@@ -186,49 +199,54 @@ namespace Viry3D
 	void View::SetOffset(const Vector2i& offset)
 	{
 		m_offset = offset;
-        this->MarkCanvasDirty();
+        this->MarkDirty(ViewDirty::Layout);
 	}
 
     void View::SetMargin(const Vector4& margin)
     {
         m_margin = margin;
-        this->MarkCanvasDirty();
+        this->MarkDirty(ViewDirty::Layout);
     }
 
     void View::SetLocalRotation(const Quaternion& rot)
     {
         m_local_rotation = rot;
-        this->MarkCanvasDirty();
+        this->MarkDirty(ViewDirty::Layout);
     }
 
     void View::SetLocalScale(const Vector2& scale)
     {
         m_local_scale = scale;
-        this->MarkCanvasDirty();
+        this->MarkDirty(ViewDirty::Layout);
     }
 
     void View::EnableClipRect(bool enable)
     {
         m_clip_rect = enable;
-        this->MarkCanvasDirty();
+        this->MarkDirty(ViewDirty::Layout);
+    }
+
+    void View::GetCanvasCorners(Vector3 corners[4]) const
+    {
+        Rect rect = Rect((float) m_rect.x, (float) -m_rect.y, (float) m_rect.w, (float) m_rect.h);
+
+        corners[0] = Vector3(rect.x, rect.y, 0);
+        corners[1] = Vector3(rect.x, rect.y - rect.h, 0);
+        corners[2] = Vector3(rect.x + rect.w, rect.y - rect.h, 0);
+        corners[3] = Vector3(rect.x + rect.w, rect.y, 0);
+
+        for (int i = 0; i < 4; ++i)
+        {
+            corners[i] = m_vertex_matrix.MultiplyPoint3x4(corners[i]);
+        }
     }
 
     Rect View::GetClipRect() const
     {
         if (this->IsClipRect())
         {
-            Rect rect = Rect((float) m_rect.x, (float) -m_rect.y, (float) m_rect.w, (float) m_rect.h);
-
             Vector3 vs[4];
-            vs[0] = Vector3(rect.x, rect.y, 0);
-            vs[1] = Vector3(rect.x, rect.y - rect.h, 0);
-            vs[2] = Vector3(rect.x + rect.w, rect.y - rect.h, 0);
-            vs[3] = Vector3(rect.x + rect.w, rect.y, 0);
-
-            for (int i = 0; i < 4; ++i)
-            {
-                vs[i] = m_vertex_matrix.MultiplyPoint3x4(vs[i]);
-            }
+            this->GetCanvasCorners(vs);
 
             float x = vs[0].x;
             float y = -vs[0].y;
@@ -245,6 +263,37 @@ namespace Viry3D
         }
     }
 
+    Rect View::GetBoundsRect() const
+    {
+        Vector3 vs[4];
+        this->GetCanvasCorners(vs);
+
+        Vector3 min = vs[0];
+        Vector3 max = vs[0];
+        for (int i = 1; i < 4; ++i)
+        {
+            min = Vector3::Min(min, vs[i]);
+            max = Vector3::Max(max, vs[i]);
+        }
+
+        float canvas_w = (float) this->GetCanvas()->GetCamera()->GetTargetWidth();
+        float canvas_h = (float) this->GetCanvas()->GetCamera()->GetTargetHeight();
+
+        return Rect(min.x / canvas_w, -max.y / canvas_h, (max.x - min.x) / canvas_w, (max.y - min.y) / canvas_h);
+    }
+
+    bool View::IsCulled(const Rect& clip_rect) const
+    {
+        // only inside clipping views, a view without clip may draw outside its rect
+        if (clip_rect == Rect(0, 0, 1, 1) || m_rect.w <= 0 || m_rect.h <= 0)
+        {
+            return false;
+        }
+
+        Rect overlap = Rect::Min(this->GetBoundsRect(), clip_rect);
+        return overlap.w <= 0 || overlap.h <= 0;
+    }
+
     void View::Update()
     {
         for (auto& i : m_subviews)
@@ -388,9 +437,28 @@ namespace Viry3D
         meshes.Add(mesh);
     }
 
+    void View::FillSelfColors(Vector<ViewMesh>& meshes)
+    {
+        for (auto& i : meshes)
+        {
+            for (auto& j : i.vertices)
+            {
+                j.color = m_color;
+            }
+        }
+    }
+
+    void View::FillChangedMeshes(const Vector<ViewMesh>&, Vector<ViewMesh>&, Vector<int>&)
+    {
+        // a view without partial updates marks its whole geometry dirty instead
+    }
+
     void View::FillMeshes(Vector<ViewMesh>& meshes, const Rect& clip_rect)
     {
-        this->FillSelfMeshes(meshes, clip_rect);
+        if (!this->IsCulled(clip_rect))
+        {
+            this->FillSelfMeshes(meshes, clip_rect);
+        }
 
         Rect clip = Rect::Min(this->GetClipRect(), clip_rect);
 
@@ -400,6 +468,50 @@ namespace Viry3D
         }
     }
 
+    void View::SetOnTouchDownInside(InputAction func)
+    {
+        m_on_touch_down_inside = func;
+        this->MarkHitTestDirty();
+    }
+
+    void View::SetOnTouchMoveInside(InputAction func)
+    {
+        m_on_touch_move_inside = func;
+        this->MarkHitTestDirty();
+    }
+
+    void View::SetOnTouchUpInside(InputAction func)
+    {
+        m_on_touch_up_inside = func;
+        this->MarkHitTestDirty();
+    }
+
+    void View::SetOnTouchUpOutside(InputAction func)
+    {
+        m_on_touch_up_outside = func;
+        this->MarkHitTestDirty();
+    }
+
+    void View::SetOnTouchDrag(InputAction func)
+    {
+        m_on_touch_drag = func;
+        this->MarkHitTestDirty();
+    }
+
+    bool View::IsInteractive() const
+    {
+        return m_on_touch_down_inside || m_on_touch_move_inside || m_on_touch_up_inside || m_on_touch_up_outside || m_on_touch_drag;
+    }
+
+    void View::MarkHitTestDirty() const
+    {
+        CanvasRenderer* canvas = this->GetCanvas();
+        if (canvas)
+        {
+            canvas->MarkHitTestDirty();
+        }
+    }
+
     bool View::OnTouchDownInside(const Vector2i& pos) const
     {
         if (m_on_touch_down_inside)
@@ -49,6 +49,8 @@ namespace Viry3D
         View* view = nullptr;
         bool base_view = false;
         Rect clip_rect = Rect(0, 0, 1, 1);
+        // canvas atlas entry of the texture or image, uvs stay in texture space
+        int atlas_entry = -1;
 
         bool HasTextureOrImage() const
         {
@@ -59,6 +61,18 @@ namespace Viry3D
         int GetTextureOrImageHeight() const;
     };
 
+    // what a view change invalidates, the canvas only rebuilds the matching parts
+    struct ViewDirty
+    {
+        enum
+        {
+            Layout = 0x00000001,    // rect and vertex matrix of the view and its subviews
+            Geometry = 0x00000002,  // vertices of the view itself
+            Color = 0x00000004,     // vertex colors only
+            Meshes = 0x00000008,    // some meshes of the view replaced, vertex and index counts unchanged
+        };
+    };
+
     struct ViewAlignment
 	{
         enum
@@ -118,12 +132,18 @@ namespace Viry3D
         bool IsClipRect() const { return m_clip_rect; }
         void EnableClipRect(bool enable);
         Rect GetClipRect() const;
+        // screen bounds of the view rect in canvas space, same space as the clip rect
+        Rect GetBoundsRect() const;
+        // views with an area fully outside the clip rect are not filled
+        bool IsCulled(const Rect& clip_rect) const;
         void FillMeshes(Vector<ViewMesh>& mesh, const Rect& clip_rect);
-        void SetOnTouchDownInside(InputAction func) { m_on_touch_down_inside = func; }
-        void SetOnTouchMoveInside(InputAction func) { m_on_touch_move_inside = func; }
-        void SetOnTouchUpInside(InputAction func) { m_on_touch_up_inside = func; }
-        void SetOnTouchUpOutside(InputAction func) { m_on_touch_up_outside = func; }
-        void SetOnTouchDrag(InputAction func) { m_on_touch_drag = func; }
+        void SetOnTouchDownInside(InputAction func);
+        void SetOnTouchMoveInside(InputAction func);
+        void SetOnTouchUpInside(InputAction func);
+        void SetOnTouchUpOutside(InputAction func);
+        void SetOnTouchDrag(InputAction func);
+        // has any touch callback, only interactive views are hit tested
+        bool IsInteractive() const;
         bool OnTouchDownInside(const Vector2i& pos) const;
         bool OnTouchMoveInside(const Vector2i& pos) const;
         bool OnTouchUpInside(const Vector2i& pos) const;
@@ -131,11 +151,25 @@ namespace Viry3D
         bool OnTouchDrag(const Vector2i& pos) const;
 
     protected:
+        // structure change, the canvas rebuilds all batches
         void MarkCanvasDirty() const;
+        void MarkHitTestDirty() const;
+        // use ViewDirty
+        void MarkDirty(int flags);
         virtual void FillSelfMeshes(Vector<ViewMesh>& meshes, const Rect& clip_rect);
+        // refresh vertex colors of meshes filled before by FillSelfMeshes
+        virtual void FillSelfColors(Vector<ViewMesh>& meshes);
+        // rebuild the meshes marked by ViewDirty::Meshes, indices refer to the meshes filled before by FillSelfMeshes
+        virtual void FillChangedMeshes(const Vector<ViewMesh>& meshes, Vector<ViewMesh>& changed_meshes, Vector<int>& changed_indices);
         void ComputeVerticesMatrix();
 
 	private:
+        // corners of the view rect through the vertex matrix, top left, bottom left, bottom right, top right
+        void GetCanvasCorners(Vector3 corners[4]) const;
+
+	private:
+        friend class CanvasRenderer;
+
 		CanvasRenderer* m_canvas;
         View* m_parent_view;
 		Vector<Ref<View>> m_subviews;
@@ -155,5 +189,8 @@ namespace Viry3D
         InputAction m_on_touch_up_inside;
         InputAction m_on_touch_up_outside;
         InputAction m_on_touch_drag;
+        int m_dirty;
+        int m_canvas_slot;
+        Vector<ViewMesh> m_meshes;
 	};
 }
@@ -992,6 +992,12 @@ public class GameObjectExporter
                 jtexture["type"] = "Texture2D";
                 jtexture["mipmap"] = tex2d.mipmapCount;
 
+                var importer = AssetImporter.GetAtPath(AssetDatabase.GetAssetPath(texture)) as TextureImporter;
+                if (importer != null)
+                {
+                    jtexture["linear"] = !importer.sRGBTexture || importer.textureType == TextureImporterType.NormalMap;
+                }
+
                 var png_path = asset_path + ".png";
 
                 jtexture["path"] = png_path;